@@ -0,0 +1,575 @@
+/*
+ * Measures the compile time of libFirm on a corpus of IR programs.  Without
+ * files, synthetic stress programs are generated: a huge basic block, deep
+ * loop nests, a giant switch and a program of 10000 functions.  They are
+ * written in the irio format and read back, so they are compiled exactly
+ * like recorded programs, i.e. files written with ir_export().
+ *
+ * Every program is compiled by a fresh libFirm instance in a child process.
+ * The stages import, optimization (each pass timed separately), lowering and
+ * code generation run under ir_timers while the obstacks are accounted.  For
+ * each program one line of JSON is written to stdout:
+ *
+ *   {"program":"huge_block","target":"host","functions":1,
+ *    "nodes":60000,"usec":{"import":...,"optimize":...,"lower":...,
+ *    "codegen":...,"total":...},"passes":{"optimize_cf":...,...},
+ *    "nodes_per_sec":...,"peak_obstack_bytes":...,"allocated_bytes":...}
+ *
+ * "nodes" counts the nodes after import.
+ *
+ * Usage: compile_time [-t triple] [-w dir] [-c trace-prefix] [file.ir...]
+ *   -t  compile for the target triple instead of the host
+ *   -w  only write the generated programs to dir/<program>.ir
+ *   -c  write a Chrome trace of each program to <trace-prefix><name>.json,
+ *       where <name> is the program or the file name without directories
+ */
+#include "firm.h"
+#include "util.h"
+#include "xmalloc.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define N_GLOBALS 64
+
+static unsigned   seed;
+static ir_type   *int_type;
+static ir_entity *globals[N_GLOBALS];
+
+static unsigned random_below(unsigned n)
+{
+	seed = seed * 1103515245u + 12345u;
+	return (seed >> 16) % n;
+}
+
+static ir_node *new_int(long value)
+{
+	return new_Const_long(mode_Is, value);
+}
+
+static void init_program(void)
+{
+	seed     = 4711;
+	int_type = get_type_for_mode(mode_Is);
+	for (unsigned i = 0; i < N_GLOBALS; ++i) {
+		char name[32];
+		snprintf(name, sizeof(name), "global%u", i);
+		globals[i] = new_global_entity(get_glob_type(), new_id_from_str(name),
+		                               int_type, ir_visibility_external,
+		                               IR_LINKAGE_DEFAULT);
+	}
+}
+
+static ir_type *get_function_type(size_t n_params)
+{
+	ir_type *const type = new_type_method(n_params, 1, false, cc_cdecl_set,
+	                                      mtp_no_property);
+	for (size_t i = 0; i < n_params; ++i)
+		set_method_param_type(type, i, int_type);
+	set_method_res_type(type, 0, int_type);
+	return type;
+}
+
+static ir_entity *new_function_entity(const char *name, size_t n_params)
+{
+	return new_global_entity(get_glob_type(), new_id_from_str(name),
+	                         get_function_type(n_params),
+	                         ir_visibility_external, IR_LINKAGE_DEFAULT);
+}
+
+/** Creates the graph of @p entity and makes it the current graph. */
+static ir_graph *begin_function(ir_entity *entity, int n_locals)
+{
+	ir_graph *const irg = new_ir_graph(entity, n_locals);
+	set_current_ir_graph(irg);
+	return irg;
+}
+
+static ir_node *get_param(unsigned n)
+{
+	return new_Proj(get_irg_args(current_ir_graph), mode_Is, n);
+}
+
+/** Returns @p value from the current (matured) block and finishes the
+ * graph. */
+static void end_function(ir_node *value)
+{
+	ir_graph *const irg   = current_ir_graph;
+	ir_node  *const in[]  = { value };
+	ir_node  *const ret   = new_Return(get_store(), 1, in);
+	add_immBlock_pred(get_irg_end_block(irg), ret);
+	irg_finalize_cons(irg);
+}
+
+static ir_node *load_global(unsigned n)
+{
+	ir_node *const load = new_Load(get_store(), new_Address(globals[n]),
+	                               mode_Is, int_type, cons_none);
+	set_store(new_Proj(load, mode_M, pn_Load_M));
+	return new_Proj(load, mode_Is, pn_Load_res);
+}
+
+static void store_global(unsigned n, ir_node *value)
+{
+	ir_node *const store = new_Store(get_store(), new_Address(globals[n]),
+	                                 value, int_type, cons_none);
+	set_store(new_Proj(store, mode_M, pn_Store_M));
+}
+
+/** Returns a random arithmetic operation of @p left and @p right. */
+static ir_node *new_random_op(ir_node *left, ir_node *right)
+{
+	switch (random_below(6)) {
+	case 0:  return new_Add(left, right);
+	case 1:  return new_Sub(left, right);
+	case 2:  return new_Mul(left, right);
+	case 3:  return new_Eor(left, right);
+	case 4:  return new_Or(new_And(left, right), new_int(random_below(256)));
+	default: return new_Shl(left, new_Const_long(mode_Iu, random_below(31)));
+	}
+}
+
+/** A single basic block of @p n_ops operations with loads and stores. */
+static void gen_huge_block(unsigned n_ops)
+{
+	begin_function(new_function_entity("huge_block", 2), 0);
+	ir_node *values[16];
+	for (unsigned i = 0; i < 16; ++i)
+		values[i] = i < 2 ? get_param(i) : new_int(i * 37);
+
+	for (unsigned i = 0; i < n_ops; ++i) {
+		ir_node *left  = values[random_below(16)];
+		ir_node *right = values[random_below(16)];
+		if (i % 32 == 16)
+			right = load_global(random_below(N_GLOBALS));
+		ir_node *const value = new_random_op(left, right);
+		if (i % 32 == 0)
+			store_global(random_below(N_GLOBALS), value);
+		values[i % 16] = value;
+	}
+
+	ir_node *sum = values[0];
+	for (unsigned i = 1; i < 16; ++i)
+		sum = new_Add(sum, values[i]);
+	mature_immBlock(get_cur_block());
+	end_function(sum);
+}
+
+/**
+ * Builds a counted loop with loop variable @p level around the next level,
+ * ending in the exit block of the loop.  Local 0 is the accumulated sum.
+ */
+static void gen_loop(unsigned level, unsigned depth, ir_node *bound)
+{
+	set_value(level + 1, new_int(0));
+	ir_node *const header = new_immBlock();
+	add_immBlock_pred(header, new_Jmp());
+	set_cur_block(header);
+	ir_node *const cmp  = new_Cmp(get_value(level + 1, mode_Is), bound,
+	                              ir_relation_less);
+	ir_node *const cond = new_Cond(cmp);
+	ir_node *const body = new_immBlock();
+	add_immBlock_pred(body, new_Proj(cond, mode_X, pn_Cond_true));
+	mature_immBlock(body);
+	ir_node *const exit = new_immBlock();
+	add_immBlock_pred(exit, new_Proj(cond, mode_X, pn_Cond_false));
+
+	set_cur_block(body);
+	ir_node *const var = get_value(level + 1, mode_Is);
+	ir_node       *sum = get_value(0, mode_Is);
+	sum = new_Add(sum, new_Mul(var, new_int(level + 3)));
+	if (level % 3 == 0)
+		store_global(level % N_GLOBALS, sum);
+	set_value(0, sum);
+	if (level + 1 < depth) {
+		gen_loop(level + 1, depth, bound);
+	} else {
+		for (unsigned i = 0; i <= level; ++i) {
+			ir_node *const other = get_value(i + 1, mode_Is);
+			set_value(0, new_random_op(get_value(0, mode_Is), other));
+		}
+	}
+	set_value(level + 1, new_Add(get_value(level + 1, mode_Is), new_int(1)));
+	add_immBlock_pred(header, new_Jmp());
+	mature_immBlock(header);
+	mature_immBlock(exit);
+	set_cur_block(exit);
+}
+
+/** A function with @p n_nests sequential loop nests of depth @p depth. */
+static void gen_loop_nests(unsigned n_nests, unsigned depth)
+{
+	begin_function(new_function_entity("loop_nests", 2), depth + 1);
+	ir_node *const bound = get_param(0);
+	set_value(0, get_param(1));
+	mature_immBlock(get_cur_block());
+	for (unsigned i = 0; i < n_nests; ++i)
+		gen_loop(0, depth, bound);
+	end_function(get_value(0, mode_Is));
+}
+
+/** A Switch with @p n_cases cases, dense at first and sparse later. */
+static void gen_giant_switch(unsigned n_cases)
+{
+	begin_function(new_function_entity("giant_switch", 2), 1);
+	ir_graph        *const irg   = current_ir_graph;
+	ir_node         *const sel   = get_param(0);
+	ir_node         *const x     = get_param(1);
+	ir_switch_table *const table = ir_new_switch_table(irg, n_cases);
+	for (unsigned i = 0; i < n_cases; ++i) {
+		long       const value = i < n_cases / 2 ? (long)i : (long)i * 7;
+		ir_tarval *const tv    = new_tarval_from_long(value, mode_Is);
+		ir_switch_table_set(table, i, tv, tv, i + 1);
+	}
+	ir_node *const swtch = new_Switch(sel, n_cases + 1, table);
+	mature_immBlock(get_cur_block());
+
+	ir_node *const join = new_immBlock();
+	for (unsigned pn = 0; pn <= n_cases; ++pn) {
+		ir_node *const block = new_immBlock();
+		add_immBlock_pred(block, new_Proj(swtch, mode_X, pn));
+		mature_immBlock(block);
+		set_cur_block(block);
+		ir_node *value = new_Add(new_Mul(x, new_int(pn)), new_int(pn * 7));
+		if (pn % 4 == 0)
+			value = new_random_op(value, load_global(pn % N_GLOBALS));
+		set_value(0, value);
+		add_immBlock_pred(join, new_Jmp());
+	}
+	mature_immBlock(join);
+	set_cur_block(join);
+	end_function(get_value(0, mode_Is));
+}
+
+/** @p n_functions small functions calling earlier ones. */
+static void gen_many_functions(unsigned n_functions)
+{
+	ir_entity **const entities = XMALLOCN(ir_entity*, n_functions);
+	for (unsigned i = 0; i < n_functions; ++i) {
+		char name[32];
+		snprintf(name, sizeof(name), "function%u", i);
+		entities[i] = new_function_entity(name, 1);
+	}
+
+	for (unsigned i = 0; i < n_functions; ++i) {
+		begin_function(entities[i], 1);
+		ir_node *const x = get_param(0);
+		if (i == 0) {
+			mature_immBlock(get_cur_block());
+			end_function(new_Add(x, new_int(1)));
+			continue;
+		}
+
+		ir_node *const cmp  = new_Cmp(x, new_int(i % 97), ir_relation_less);
+		ir_node *const cond = new_Cond(cmp);
+		mature_immBlock(get_cur_block());
+		ir_node *const join = new_immBlock();
+
+		ir_node *const call_block = new_immBlock();
+		add_immBlock_pred(call_block, new_Proj(cond, mode_X, pn_Cond_true));
+		mature_immBlock(call_block);
+		set_cur_block(call_block);
+		ir_entity *const callee = entities[random_below(i)];
+		ir_node   *const in[]   = { new_Add(x, new_int(i)) };
+		ir_node   *const call   = new_Call(get_store(), new_Address(callee),
+		                                   1, in, get_entity_type(callee));
+		set_store(new_Proj(call, mode_M, pn_Call_M));
+		ir_node *const results = new_Proj(call, mode_T, pn_Call_T_result);
+		set_value(0, new_Proj(results, mode_Is, 0));
+		add_immBlock_pred(join, new_Jmp());
+
+		ir_node *const else_block = new_immBlock();
+		add_immBlock_pred(else_block, new_Proj(cond, mode_X, pn_Cond_false));
+		mature_immBlock(else_block);
+		set_cur_block(else_block);
+		set_value(0, new_random_op(x, new_int(i)));
+		add_immBlock_pred(join, new_Jmp());
+
+		mature_immBlock(join);
+		set_cur_block(join);
+		end_function(get_value(0, mode_Is));
+	}
+	free(entities);
+}
+
+typedef struct program_t {
+	const char *name;
+	void      (*generate)(void);
+} program_t;
+
+static void gen_huge_block_program(void)   { gen_huge_block(20000); }
+static void gen_loop_nests_program(void)   { gen_loop_nests(8, 12); }
+static void gen_giant_switch_program(void) { gen_giant_switch(1000); }
+static void gen_many_functions_program(void) { gen_many_functions(10000); }
+
+static const program_t programs[] = {
+	{ "huge_block",     gen_huge_block_program     },
+	{ "loop_nests",     gen_loop_nests_program     },
+	{ "giant_switch",   gen_giant_switch_program   },
+	{ "many_functions", gen_many_functions_program },
+};
+
+typedef struct pass_t {
+	const char  *name;
+	void       (*run)(ir_graph *irg);
+	ir_timer_t  *timer;
+} pass_t;
+
+static pass_t passes[] = {
+	{ "optimize_cf",             optimize_cf,             NULL },
+	{ "scalar_replacement_opt",  scalar_replacement_opt,  NULL },
+	{ "combo",                   combo,                   NULL },
+	{ "opt_jumpthreading",       opt_jumpthreading,       NULL },
+	{ "optimize_load_store",     optimize_load_store,     NULL },
+	{ "optimize_reassociation",  optimize_reassociation,  NULL },
+	{ "do_gvn_pre",              do_gvn_pre,              NULL },
+	{ "loop_invariant_code_motion", loop_invariant_code_motion, NULL },
+	{ "place_code",              place_code,              NULL },
+	{ "optimize_cf_final",       optimize_cf,             NULL },
+};
+
+static const char *triple;
+static const char *trace_prefix;
+
+static void init_target(void)
+{
+	if (triple == NULL) {
+		ir_init();
+		return;
+	}
+	ir_init_library();
+	if (!ir_target_set(triple)) {
+		fprintf(stderr, "unknown target %s\n", triple);
+		exit(1);
+	}
+	ir_target_init();
+}
+
+static unsigned long timed_usec(ir_timer_t *timer)
+{
+	unsigned long const usec = ir_timer_elapsed_usec(timer);
+	ir_timer_reset(timer);
+	return usec;
+}
+
+/** Compiles the program in @p input and writes its line of JSON. */
+static bool compile(FILE *input, const char *name)
+{
+	ir_timer_t *const timer = ir_timer_new();
+	for (size_t p = 0; p < ARRAY_SIZE(passes); ++p)
+		passes[p].timer = ir_timer_new();
+	init_target();
+	size_t const allocated = xmalloc_bytes_allocated();
+
+	ir_timer_start(timer);
+	bool const failed = ir_import_file(input, name);
+	ir_timer_stop(timer);
+	if (failed) {
+		fprintf(stderr, "%s: could not import IR\n", name);
+		ir_finish();
+		ir_timer_free(timer);
+		return false;
+	}
+	unsigned long const import_usec = timed_usec(timer);
+
+	size_t n_nodes = 0;
+	for (size_t i = 0, n = get_irp_n_irgs(); i < n; ++i)
+		n_nodes += get_irg_last_idx(get_irp_irg(i));
+
+	ir_mem_accounting_begin();
+	if (trace_prefix != NULL)
+		ir_trace_begin();
+
+	for (size_t p = 0; p < ARRAY_SIZE(passes); ++p) {
+		pass_t *const pass = &passes[p];
+		for (size_t i = 0, n = get_irp_n_irgs(); i < n; ++i) {
+			ir_graph *const irg = get_irp_irg(i);
+			ir_timer_start(timer);
+			ir_timer_start(pass->timer);
+			pass->run(irg);
+			ir_timer_stop(pass->timer);
+			ir_timer_stop(timer);
+		}
+	}
+	unsigned long const optimize_usec = timed_usec(timer);
+
+	ir_timer_start(timer);
+	lower_highlevel();
+	be_lower_for_target();
+	ir_timer_stop(timer);
+	unsigned long const lower_usec = timed_usec(timer);
+
+	FILE *const output = tmpfile();
+	if (output == NULL) {
+		perror("tmpfile");
+		exit(1);
+	}
+	ir_timer_start(timer);
+	be_main(output, name);
+	ir_timer_stop(timer);
+	unsigned long const codegen_usec = timed_usec(timer);
+	fclose(output);
+
+	unsigned long const total_usec
+		= import_usec + optimize_usec + lower_usec + codegen_usec;
+	printf("{\"program\":\"%s\",\"target\":\"%s\",\"functions\":%zu,"
+	       "\"nodes\":%zu,\"usec\":{\"import\":%lu,\"optimize\":%lu,"
+	       "\"lower\":%lu,\"codegen\":%lu,\"total\":%lu},\"passes\":{",
+	       name, triple != NULL ? triple : "host", get_irp_n_irgs(), n_nodes,
+	       import_usec, optimize_usec, lower_usec, codegen_usec, total_usec);
+	for (size_t p = 0; p < ARRAY_SIZE(passes); ++p) {
+		printf("%s\"%s\":%lu", p > 0 ? "," : "", passes[p].name,
+		       ir_timer_elapsed_usec(passes[p].timer));
+	}
+	printf("},\"nodes_per_sec\":%.0f,\"peak_obstack_bytes\":%zu,"
+	       "\"allocated_bytes\":%zu}\n",
+	       total_usec > 0 ? n_nodes * 1e6 / total_usec : 0.0,
+	       ir_mem_peak_bytes(), xmalloc_bytes_allocated() - allocated);
+	fflush(stdout);
+
+	if (trace_prefix != NULL) {
+		char const *const slash    = strrchr(name, '/');
+		char const *const base     = slash != NULL ? slash + 1 : name;
+		size_t      const len      = strlen(trace_prefix) + strlen(base) + 6;
+		char       *const filename = XMALLOCN(char, len);
+		snprintf(filename, len, "%s%s.json", trace_prefix, base);
+		if (!ir_trace_write_chrome(filename))
+			perror(filename);
+		free(filename);
+		ir_trace_end();
+	}
+	ir_mem_accounting_end();
+	ir_finish();
+	ir_timer_free(timer);
+	for (size_t p = 0; p < ARRAY_SIZE(passes); ++p)
+		ir_timer_free(passes[p].timer);
+	return true;
+}
+
+/** Generates @p program and writes it to @p output in the irio format. */
+static bool write_program(const program_t *program, FILE *output)
+{
+	init_target();
+	init_program();
+	program->generate();
+	ir_export_file(output);
+	ir_finish();
+	return fflush(output) == 0;
+}
+
+typedef struct job_t {
+	const program_t *program; /**< program to generate, or NULL */
+	FILE            *file;
+	const char      *name;
+} job_t;
+
+static bool run_job(const job_t *job)
+{
+	if (job->program != NULL)
+		return write_program(job->program, job->file);
+	return compile(job->file, job->name);
+}
+
+/**
+ * Runs @p job in a child process: libFirm cannot be initialized again after
+ * ir_finish(), so every program needs a fresh process.
+ */
+static bool run_in_child(const job_t *job)
+{
+	fflush(stdout);
+	pid_t const pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		exit(1);
+	}
+	if (pid == 0)
+		exit(run_job(job) ? 0 : 1);
+
+	int status;
+	if (waitpid(pid, &status, 0) < 0) {
+		perror("waitpid");
+		exit(1);
+	}
+	if (WIFSIGNALED(status))
+		fprintf(stderr, "%s: killed by signal %d\n", job->name, WTERMSIG(status));
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr, "usage: %s [-t triple] [-w dir] [-c trace-prefix] [file.ir...]\n",
+	        argv0);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	const char *write_dir = NULL;
+	int         arg       = 1;
+	for (; arg < argc && argv[arg][0] == '-'; ++arg) {
+		if (arg + 1 >= argc)
+			usage(argv[0]);
+		if (strcmp(argv[arg], "-t") == 0) {
+			triple = argv[++arg];
+		} else if (strcmp(argv[arg], "-w") == 0) {
+			write_dir = argv[++arg];
+		} else if (strcmp(argv[arg], "-c") == 0) {
+			trace_prefix = argv[++arg];
+		} else {
+			usage(argv[0]);
+		}
+	}
+
+	int result = 0;
+	if (arg < argc) {
+		for (; arg < argc; ++arg) {
+			job_t job = { NULL, fopen(argv[arg], "r"), argv[arg] };
+			if (job.file == NULL) {
+				perror(argv[arg]);
+				return 1;
+			}
+			if (!run_in_child(&job))
+				result = 1;
+			fclose(job.file);
+		}
+		return result;
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(programs); ++i) {
+		program_t const *const program = &programs[i];
+		job_t job = { program, NULL, program->name };
+		if (write_dir != NULL) {
+			char filename[1024];
+			snprintf(filename, sizeof(filename), "%s/%s.ir", write_dir,
+			         program->name);
+			job.file = fopen(filename, "w");
+			if (job.file == NULL) {
+				perror(filename);
+				return 1;
+			}
+			if (!run_in_child(&job))
+				result = 1;
+			fclose(job.file);
+			continue;
+		}
+
+		job.file = tmpfile();
+		if (job.file == NULL) {
+			perror("tmpfile");
+			return 1;
+		}
+		if (run_in_child(&job)) {
+			rewind(job.file);
+			job.program = NULL;
+			if (!run_in_child(&job))
+				result = 1;
+		} else {
+			result = 1;
+		}
+		fclose(job.file);
+	}
+	return result;
+}
@@ -0,0 +1,223 @@
+/*
+ * Measures the built-in MILP solver of the lpp layer.  A set of generated
+ * problems, among them some shaped like those of the ILP copy coalescing, is
+ * written with mps_write_mps(), read back and solved.  Instead of the
+ * generated problems, .mps files given on the command line are solved.
+ *
+ * Usage: lpp_mps [file.mps...]
+ */
+#include "lpp.h"
+#include "mps.h"
+#include "xmalloc.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TIME_LIMIT 10.0
+
+static unsigned seed = 4711;
+
+static int random_int(int min, int max)
+{
+	seed = seed * 1103515245u + 12345u;
+	return min + (int)((seed >> 16) % (unsigned)(max - min + 1));
+}
+
+/**
+ * Register assignment with affinities, built like the ILP copy coalescing
+ * does: Every node gets one of its admissible colors, interfering nodes must
+ * differ and an affinity costs if its nodes differ.  A greedy coloring, if
+ * it succeeds, is given as start solution.
+ */
+static lpp_t *new_coalescing(int n_nodes, int n_colors, int n_edges,
+                             int n_affinities)
+{
+	lpp_t *lpp      = lpp_new("coalesce", lpp_minimize);
+	int   *x        = XMALLOCN(int, n_nodes * n_colors);
+	int   *color    = XMALLOCN(int, n_nodes);
+	bool  *admitted = XMALLOCN(bool, n_nodes * n_colors);
+	bool  *adj      = XMALLOCNZ(bool, n_nodes * n_nodes);
+	char   name[32];
+
+	for (int e = 0; e < n_edges; ++e) {
+		int const u = random_int(0, n_nodes - 1);
+		int const v = random_int(0, n_nodes - 1);
+		if (u != v) {
+			adj[u * n_nodes + v] = true;
+			adj[v * n_nodes + u] = true;
+		}
+	}
+
+	bool colorable = true;
+	for (int v = 0; v < n_nodes; ++v) {
+		int const cst = lpp_add_cst(lpp, NULL, lpp_equal, 1.0);
+		color[v] = -1;
+		for (int c = 0; c < n_colors; ++c) {
+			admitted[v * n_colors + c] = random_int(0, 3) != 0;
+			bool used = false;
+			for (int u = 0; u < v; ++u)
+				used |= adj[u * n_nodes + v] && color[u] == c;
+			if (color[v] < 0 && admitted[v * n_colors + c] && !used)
+				color[v] = c;
+
+			x[v * n_colors + c] = -1;
+			if (!admitted[v * n_colors + c])
+				continue;
+			snprintf(name, sizeof(name), "x%d_%d", v, c);
+			x[v * n_colors + c] = lpp_add_var(lpp, name, lpp_binary, 0.0);
+			lpp_set_factor_fast(lpp, cst, x[v * n_colors + c], 1.0);
+		}
+		colorable &= color[v] >= 0;
+	}
+	for (int u = 0; u < n_nodes; ++u) {
+		for (int v = u + 1; v < n_nodes; ++v) {
+			if (!adj[u * n_nodes + v])
+				continue;
+			for (int c = 0; c < n_colors; ++c) {
+				if (x[u * n_colors + c] < 0 || x[v * n_colors + c] < 0)
+					continue;
+				int const cst = lpp_add_cst(lpp, NULL, lpp_less_equal, 1.0);
+				lpp_set_factor_fast(lpp, cst, x[u * n_colors + c], 1.0);
+				lpp_set_factor_fast(lpp, cst, x[v * n_colors + c], 1.0);
+			}
+		}
+	}
+	for (int a = 0; a < n_affinities; ++a) {
+		int const u = random_int(0, n_nodes - 1);
+		int const v = random_int(0, n_nodes - 1);
+		if (u == v || adj[u * n_nodes + v])
+			continue;
+		int const y = lpp_add_var(lpp, NULL, lpp_binary, random_int(1, 10));
+		if (colorable)
+			lpp_set_start_value(lpp, y, color[u] != color[v]);
+		for (int c = 0; c < n_colors; ++c) {
+			if (x[u * n_colors + c] < 0)
+				continue;
+			int const cst = lpp_add_cst(lpp, NULL, lpp_less_equal, 0.0);
+			lpp_set_factor_fast(lpp, cst, x[u * n_colors + c], 1.0);
+			if (x[v * n_colors + c] >= 0)
+				lpp_set_factor_fast(lpp, cst, x[v * n_colors + c], -1.0);
+			lpp_set_factor_fast(lpp, cst, y, -1.0);
+		}
+	}
+	if (colorable) {
+		for (int i = 0; i < n_nodes * n_colors; ++i) {
+			if (x[i] >= 0)
+				lpp_set_start_value(lpp, x[i], color[i / n_colors] == i % n_colors);
+		}
+	}
+	free(adj);
+	free(admitted);
+	free(color);
+	free(x);
+	return lpp;
+}
+
+/** Multidimensional knapsack. */
+static lpp_t *new_knapsack(int n_items, int n_dims)
+{
+	lpp_t *lpp   = lpp_new("knapsack", lpp_maximize);
+	int   *items = XMALLOCN(int, n_items);
+	for (int i = 0; i < n_items; ++i)
+		items[i] = lpp_add_var(lpp, NULL, lpp_binary, random_int(10, 100));
+	for (int d = 0; d < n_dims; ++d) {
+		int sum = 0;
+		int const cst = lpp_add_cst(lpp, NULL, lpp_less_equal, 0.0);
+		for (int i = 0; i < n_items; ++i) {
+			int const weight = random_int(5, 50);
+			sum += weight;
+			lpp_set_factor_fast(lpp, cst, items[i], weight);
+		}
+		lpp_set_factor_fast(lpp, cst, 0, sum / 2);
+	}
+	free(items);
+	return lpp;
+}
+
+/** Weighted set cover. */
+static lpp_t *new_set_cover(int n_elements, int n_sets)
+{
+	lpp_t *lpp  = lpp_new("setcover", lpp_minimize);
+	int   *sets = XMALLOCN(int, n_sets);
+	for (int s = 0; s < n_sets; ++s)
+		sets[s] = lpp_add_var(lpp, NULL, lpp_binary, random_int(1, 20));
+	for (int e = 0; e < n_elements; ++e) {
+		int const cst = lpp_add_cst(lpp, NULL, lpp_greater_equal, 1.0);
+		for (int s = 0; s < n_sets; ++s) {
+			if (random_int(0, 9) == 0 || s == e % n_sets)
+				lpp_set_factor_fast(lpp, cst, sets[s], 1.0);
+		}
+	}
+	free(sets);
+	return lpp;
+}
+
+static void solve(lpp_t *lpp, char const *name)
+{
+	lpp_set_time_limit(lpp, TIME_LIMIT);
+	int const rows = lpp->cst_next - 1;
+	int const cols = lpp->var_next - 1;
+	lpp_solve(lpp, "bnb");
+	printf("%-24s %6d rows %6d cols  state %d  obj %12g  %8u iterations  %8.3fs\n",
+	       name, rows, cols, (int)lpp_get_sol_state(lpp), lpp->objval,
+	       lpp_get_iter_cnt(lpp), lpp_get_sol_time(lpp));
+}
+
+/** Writes @p orig in MPS format, reads it back and solves it. */
+static void solve_via_mps(lpp_t *orig, char const *name)
+{
+	FILE *f = tmpfile();
+	if (f == NULL) {
+		perror("tmpfile");
+		exit(1);
+	}
+	mps_write_mps(orig, s_mps_fixed, f);
+	rewind(f);
+	lpp_t *lpp = mps_read_mps(f);
+	fclose(f);
+	if (lpp == NULL || lpp->var_next != orig->var_next) {
+		fprintf(stderr, "%s: could not read back MPS\n", name);
+		exit(1);
+	}
+
+	/* the columns are read in order, so start values carry over by index */
+	for (int i = 1; i < orig->var_next; ++i) {
+		if (orig->vars[i]->value_kind == lpp_value_start)
+			lpp_set_start_value(lpp, i, orig->vars[i]->value);
+	}
+	lpp_free(orig);
+
+	solve(lpp, name);
+	lpp_free(lpp);
+}
+
+int main(int argc, char **argv)
+{
+	if (argc > 1) {
+		for (int i = 1; i < argc; ++i) {
+			FILE *f = fopen(argv[i], "r");
+			if (f == NULL) {
+				perror(argv[i]);
+				return 1;
+			}
+			lpp_t *lpp = mps_read_mps(f);
+			fclose(f);
+			if (lpp == NULL) {
+				fprintf(stderr, "%s: malformed MPS file\n", argv[i]);
+				return 1;
+			}
+			solve(lpp, argv[i]);
+			lpp_free(lpp);
+		}
+		return 0;
+	}
+
+	solve_via_mps(new_coalescing(20, 4, 30, 20),    "coalesce-20");
+	solve_via_mps(new_coalescing(30, 6, 50, 30),    "coalesce-30");
+	solve_via_mps(new_coalescing(80, 8, 200, 120),  "coalesce-80");
+	solve_via_mps(new_knapsack(30, 3),              "knapsack-30");
+	solve_via_mps(new_knapsack(50, 5),              "knapsack-50");
+	solve_via_mps(new_set_cover(60, 40),            "setcover-60");
+	solve_via_mps(new_set_cover(120, 80),           "setcover-120");
+	return 0;
+}
@@ -0,0 +1,402 @@
+/*
+ * Measures the PBQP solver of kaps.  Replays the problems found in dumps
+ * written by ir/kaps/html_dumper.c: every "1. PBQP Problem" section (see
+ * pbqp_dump_input()) is rebuilt from its cost vectors and matrices and
+ * solved repeatedly.  Without files, generated problems shaped like those of
+ * the PBQP register allocator are dumped and replayed instead.
+ *
+ * Usage: pbqp_replay [-a] [-b] [-r rounds] [dump.html...]
+ *   -a  allocate all problems in one arena and report its statistics
+ *   -b  solve with solve_pbqp_brute_force instead of solve_pbqp_heuristical
+ */
+#include "arena.h"
+#include "array.h"
+#include "brute_force.h"
+#include "heuristical.h"
+#include "html_dumper.h"
+#include "kaps.h"
+#include "matrix.h"
+#include "timing.h"
+#include "vector.h"
+#include "xmalloc.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct node_costs_t {
+	unsigned index;
+	unsigned len;
+	num     *costs;
+} node_costs_t;
+
+typedef struct edge_costs_t {
+	unsigned src;
+	unsigned tgt;
+	unsigned rows;
+	unsigned cols;
+	num     *costs;
+} edge_costs_t;
+
+typedef struct instance_t {
+	unsigned      n_nodes;
+	node_costs_t *nodes;  /**< flexible array */
+	edge_costs_t *edges;  /**< flexible array */
+} instance_t;
+
+static unsigned      rounds      = 20;
+static bool          brute_force = false;
+static pbqp_arena_t *arena       = NULL;
+static unsigned      seed        = 4711;
+
+static unsigned random_int(unsigned max)
+{
+	seed = seed * 1103515245u + 12345u;
+	return (seed >> 16) % (max + 1);
+}
+
+static char const *skip_space(char const *p)
+{
+	while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')
+		++p;
+	return p;
+}
+
+static bool starts_with(char const *p, char const *prefix)
+{
+	return strncmp(p, prefix, strlen(prefix)) == 0;
+}
+
+/** Parses a cost as written by cost2a(). */
+static char const *parse_cost(char const *p, num *cost)
+{
+	if (starts_with(p, "inf")) {
+		*cost = INF_COSTS;
+		return p + 3;
+	}
+	char *end;
+	unsigned long const value = strtoul(p, &end, 10);
+	if (end == p || value >= INF_COSTS)
+		return NULL;
+	*cost = (num)value;
+	return end;
+}
+
+/** Parses the node costs "c<sub>i</sub> = <span ...>( c c  )</span>". */
+static char const *parse_node(char const *p, instance_t *inst)
+{
+	node_costs_t node;
+	if (sscanf(p, "c<sub>%u</sub>", &node.index) != 1)
+		return NULL;
+	p = strchr(p, '(');
+	if (p == NULL)
+		return NULL;
+
+	num *costs = NEW_ARR_F(num, 0);
+	for (p = skip_space(p + 1); *p != ')'; p = skip_space(p)) {
+		num cost;
+		p = parse_cost(p, &cost);
+		if (p == NULL) {
+			DEL_ARR_F(costs);
+			return NULL;
+		}
+		ARR_APP1(num, costs, cost);
+	}
+	node.len   = ARR_LEN(costs);
+	node.costs = costs;
+	ARR_APP1(node_costs_t, inst->nodes, node);
+	if (node.index >= inst->n_nodes)
+		inst->n_nodes = node.index + 1;
+	return p;
+}
+
+/** Parses an edge matrix "{C}_{i,j}=\n\t\begin{pmatrix} ... \end{pmatrix}". */
+static char const *parse_edge(char const *p, instance_t *inst)
+{
+	edge_costs_t edge;
+	if (sscanf(p, "{C}_{%u,%u}", &edge.src, &edge.tgt) != 2)
+		return NULL;
+	p = strstr(p, "\\begin{pmatrix}");
+	if (p == NULL)
+		return NULL;
+
+	num *costs = NEW_ARR_F(num, 0);
+	edge.rows = 0;
+	for (p = skip_space(p + strlen("\\begin{pmatrix}"));
+	     !starts_with(p, "\\end{pmatrix}"); p = skip_space(p)) {
+		if (starts_with(p, "\\\\")) {
+			++edge.rows;
+			p += 2;
+		} else if (*p == '&') {
+			++p;
+		} else {
+			num cost;
+			p = parse_cost(p, &cost);
+			if (p == NULL)
+				break;
+			ARR_APP1(num, costs, cost);
+		}
+	}
+	size_t const len = ARR_LEN(costs);
+	if (p == NULL || edge.rows == 0 || len % edge.rows != 0) {
+		DEL_ARR_F(costs);
+		return NULL;
+	}
+	edge.cols  = len / edge.rows;
+	edge.costs = costs;
+	ARR_APP1(edge_costs_t, inst->edges, edge);
+	return p;
+}
+
+static void free_instance(instance_t *inst)
+{
+	for (size_t i = 0, n = ARR_LEN(inst->nodes); i < n; ++i)
+		DEL_ARR_F(inst->nodes[i].costs);
+	for (size_t i = 0, n = ARR_LEN(inst->edges); i < n; ++i)
+		DEL_ARR_F(inst->edges[i].costs);
+	DEL_ARR_F(inst->nodes);
+	DEL_ARR_F(inst->edges);
+}
+
+/**
+ * Parses the problem section starting at @p p into @p inst.
+ * Returns the end of the section or NULL if it is malformed.
+ */
+static char const *parse_instance(char const *p, instance_t *inst)
+{
+	inst->n_nodes = 0;
+	inst->nodes   = NEW_ARR_F(node_costs_t, 0);
+	inst->edges   = NEW_ARR_F(edge_costs_t, 0);
+
+	char const *vectors  = strstr(p, "<h2>1.2 Cost Vectors</h2>");
+	char const *matrices = strstr(p, "<h2>1.3 Cost Matrices</h2>");
+	if (vectors == NULL || matrices == NULL || matrices < vectors)
+		goto malformed;
+
+	for (p = strstr(vectors, "c<sub>"); p != NULL && p < matrices;
+	     p = strstr(p, "c<sub>")) {
+		p = parse_node(p, inst);
+		if (p == NULL)
+			goto malformed;
+	}
+
+	/* the section ends with the next heading */
+	char const *end = strstr(matrices + 1, "<h");
+	if (end == NULL)
+		end = matrices + strlen(matrices);
+	for (p = strstr(matrices, "{C}_{"); p != NULL && p < end;
+	     p = strstr(p, "{C}_{")) {
+		p = parse_edge(p, inst);
+		if (p == NULL)
+			goto malformed;
+	}
+	return end;
+
+malformed:
+	free_instance(inst);
+	return NULL;
+}
+
+static pbqp_t *build_pbqp(instance_t const *inst)
+{
+	pbqp_t *pbqp = alloc_pbqp_in_arena(arena, inst->n_nodes);
+
+	for (size_t i = 0, n = ARR_LEN(inst->nodes); i < n; ++i) {
+		node_costs_t const *node  = &inst->nodes[i];
+		vector_t           *costs = vector_alloc(pbqp, node->len);
+		for (unsigned c = 0; c < node->len; ++c)
+			vector_set(costs, c, node->costs[c]);
+		add_node_costs(pbqp, node->index, costs);
+	}
+	for (size_t i = 0, n = ARR_LEN(inst->edges); i < n; ++i) {
+		edge_costs_t const *edge  = &inst->edges[i];
+		pbqp_matrix_t      *costs = pbqp_matrix_alloc(pbqp, edge->rows, edge->cols);
+		memcpy(costs->entries, edge->costs, edge->rows * edge->cols * sizeof(num));
+		add_edge_costs(pbqp, edge->src, edge->tgt, costs);
+	}
+	return pbqp;
+}
+
+static void solve(instance_t const *inst, char const *name)
+{
+	ir_timer_t *timer       = ir_timer_new();
+	ir_timer_t *round_timer = ir_timer_new();
+	num         solution    = 0;
+
+	for (unsigned r = 0; r < rounds; ++r) {
+		ir_timer_start(round_timer);
+		pbqp_t *pbqp = build_pbqp(inst);
+		ir_timer_start(timer);
+		if (brute_force)
+			solve_pbqp_brute_force(pbqp);
+		else
+			solve_pbqp_heuristical(pbqp);
+		ir_timer_stop(timer);
+		solution = get_solution(pbqp);
+		free_pbqp(pbqp);
+		ir_timer_stop(round_timer);
+	}
+
+	char buf[16];
+	if (solution == INF_COSTS)
+		snprintf(buf, sizeof(buf), "inf");
+	else
+		snprintf(buf, sizeof(buf), "%u", (unsigned)solution);
+	printf("%-32s %6u nodes %7u edges  solution %10s  %10.3f ms/solve  %10.3f ms/round\n",
+	       name, (unsigned)ARR_LEN(inst->nodes),
+	       (unsigned)ARR_LEN(inst->edges), buf,
+	       ir_timer_elapsed_sec(timer) * 1000.0 / rounds,
+	       ir_timer_elapsed_sec(round_timer) * 1000.0 / rounds);
+	ir_timer_free(round_timer);
+	ir_timer_free(timer);
+}
+
+/** Replays all problems in the dump @p text. */
+static bool replay(char const *text, char const *name)
+{
+	unsigned n = 0;
+	for (char const *p = strstr(text, "<h1>1. PBQP Problem</h1>"); p != NULL;
+	     p = strstr(p, "<h1>1. PBQP Problem</h1>")) {
+		instance_t inst;
+		p = parse_instance(p, &inst);
+		if (p == NULL)
+			return false;
+
+		char label[256];
+		snprintf(label, sizeof(label), "%s#%u", name, n++);
+		solve(&inst, label);
+		free_instance(&inst);
+	}
+	return n > 0;
+}
+
+static char *read_file(FILE *f)
+{
+	char  *text = NEW_ARR_F(char, 0);
+	char   buf[4096];
+	size_t len;
+	while ((len = fread(buf, 1, sizeof(buf), f)) > 0) {
+		size_t const old_len = ARR_LEN(text);
+		ARR_RESIZE(char, text, old_len + len);
+		memcpy(text + old_len, buf, len);
+	}
+	ARR_APP1(char, text, '\0');
+	return text;
+}
+
+/**
+ * Register assignment like the PBQP allocator builds it: Some colors of a
+ * node are not allocatable, interfering nodes must differ and affinities
+ * cost if their nodes differ.
+ */
+static void dump_generated(FILE *f, unsigned n_nodes, unsigned n_colors,
+                           unsigned n_interferences, unsigned n_affinities)
+{
+	pbqp_t *pbqp = alloc_pbqp(n_nodes);
+
+	for (unsigned i = 0; i < n_nodes; ++i) {
+		vector_t *costs = vector_alloc(pbqp, n_colors);
+		for (unsigned c = 0; c < n_colors; ++c) {
+			unsigned const kind = random_int(7);
+			vector_set(costs, c, kind == 0 ? INF_COSTS : kind == 1 ? random_int(20) : 0);
+		}
+		vector_set(costs, random_int(n_colors - 1), 0);
+		add_node_costs(pbqp, i, costs);
+	}
+
+	for (unsigned e = 0; e < n_interferences + n_affinities; ++e) {
+		unsigned const src = random_int(n_nodes - 1);
+		unsigned const tgt = random_int(n_nodes - 1);
+		if (src == tgt)
+			continue;
+		bool const     interference = e < n_interferences;
+		num const      weight       = 1 + random_int(30);
+		pbqp_matrix_t *costs        = pbqp_matrix_alloc(pbqp, n_colors, n_colors);
+		for (unsigned r = 0; r < n_colors; ++r) {
+			for (unsigned c = 0; c < n_colors; ++c) {
+				num cost = interference ? (r == c ? INF_COSTS : 0)
+				                        : (r == c ? 0 : weight);
+				pbqp_matrix_set(costs, r, c, cost);
+			}
+		}
+		add_edge_costs(pbqp, src, tgt, costs);
+	}
+
+	pbqp->dump_file = f;
+	pbqp_dump_input(pbqp);
+	free_pbqp(pbqp);
+}
+
+static void replay_generated(char const *name, unsigned n_nodes,
+                             unsigned n_colors, unsigned n_interferences,
+                             unsigned n_affinities)
+{
+	FILE *f = tmpfile();
+	if (f == NULL) {
+		perror("tmpfile");
+		exit(1);
+	}
+	dump_generated(f, n_nodes, n_colors, n_interferences, n_affinities);
+	rewind(f);
+	char *text = read_file(f);
+	fclose(f);
+	if (!replay(text, name)) {
+		fprintf(stderr, "%s: could not replay dump\n", name);
+		exit(1);
+	}
+	DEL_ARR_F(text);
+}
+
+int main(int argc, char **argv)
+{
+	int i = 1;
+	for (; i < argc && argv[i][0] == '-'; ++i) {
+		if (strcmp(argv[i], "-a") == 0) {
+			if (arena == NULL)
+				arena = pbqp_arena_new();
+		} else if (strcmp(argv[i], "-b") == 0) {
+			brute_force = true;
+		} else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+			rounds = atoi(argv[++i]);
+		} else {
+			fprintf(stderr, "usage: %s [-a] [-b] [-r rounds] [dump.html...]\n",
+			        argv[0]);
+			return 1;
+		}
+	}
+	if (rounds == 0)
+		rounds = 1;
+
+	if (i < argc) {
+		for (; i < argc; ++i) {
+			FILE *f = fopen(argv[i], "r");
+			if (f == NULL) {
+				perror(argv[i]);
+				return 1;
+			}
+			char *text = read_file(f);
+			fclose(f);
+			bool const ok = replay(text, argv[i]);
+			DEL_ARR_F(text);
+			if (!ok) {
+				fprintf(stderr, "%s: no well-formed PBQP problem\n", argv[i]);
+				return 1;
+			}
+		}
+	} else {
+		replay_generated("alloc-8",   500,  8,  1500,  500);
+		replay_generated("alloc-16", 1000, 16,  4000, 1500);
+		replay_generated("alloc-32", 1000, 32,  6000, 2000);
+		replay_generated("alloc-64",  500, 64,  4000, 1000);
+	}
+
+	if (arena != NULL) {
+		printf("arena: %lu chunks, %lu chunk reuses, peak %zu KiB; "
+		       "%lu of %lu cost allocations recycled (%zu KiB)\n",
+		       arena->num_chunks, arena->num_chunks_reused,
+		       arena->peak_bytes / 1024, arena->num_recycled,
+		       arena->num_allocs, arena->recycled_bytes / 1024);
+		pbqp_arena_free(arena);
+	}
+	return 0;
+}
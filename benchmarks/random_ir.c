@@ -0,0 +1,97 @@
+/*
+ * Writes a program of random graphs (see irrandom.h) in the irio format, to
+ * measure how passes scale with the size and shape of their input.  Function
+ * i is named f<i> and generated with seed + i, so a program is reproduced by
+ * its options alone.  For a scaling curve, generate programs of growing size
+ * and compile them with compile_time:
+ *
+ *   for b in 64 128 256 512 1024; do random_ir -b $b blocks$b.ir; done
+ *   compile_time blocks*.ir
+ *
+ * Usage: random_ir [-t triple] [-s seed] [-f functions] [-b blocks] [-n ops]
+ *                  [-l loop-depth] [-m mem-percent] [-p phi-fan-in]
+ *                  [-r values] [output.ir]
+ *   -t  generate for the target triple instead of the host
+ *   -s  seed of the first function (default 1)
+ *   -f  number of functions (default 1)
+ *   -b, -n, -l, -m, -p, -r  the fields of ir_random_shape_t: blocks per
+ *       function, operations per block, maximal loop nesting, percentage of
+ *       Loads and Stores, maximal predecessors of join blocks and number of
+ *       live values (defaults see ir_random_shape_init())
+ * Without an output file the program is written to stdout.
+ */
+#include "firm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr, "usage: %s [-t triple] [-s seed] [-f functions] "
+	        "[-b blocks] [-n ops] [-l loop-depth] [-m mem-percent] "
+	        "[-p phi-fan-in] [-r values] [output.ir]\n", argv0);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	ir_init_library();
+
+	const char        *triple      = NULL;
+	unsigned           seed        = 1;
+	unsigned           n_functions = 1;
+	ir_random_shape_t  shape;
+	ir_random_shape_init(&shape);
+
+	int i = 1;
+	for (; i < argc && argv[i][0] == '-'; ++i) {
+		if (i + 1 >= argc || argv[i][1] == '\0' || argv[i][2] != '\0')
+			usage(argv[0]);
+		const char *const arg   = argv[++i];
+		unsigned    const value = (unsigned)strtoul(arg, NULL, 0);
+		switch (argv[i - 1][1]) {
+		case 't': triple            = arg;   break;
+		case 's': seed              = value; break;
+		case 'f': n_functions       = value; break;
+		case 'b': shape.n_blocks    = value; break;
+		case 'n': shape.n_ops       = value; break;
+		case 'l': shape.loop_depth  = value; break;
+		case 'm': shape.mem_percent = value; break;
+		case 'p': shape.phi_fan_in  = value; break;
+		case 'r': shape.n_values    = value; break;
+		default:  usage(argv[0]);
+		}
+	}
+	if (i + 1 < argc || shape.phi_fan_in < 2 || shape.n_values == 0)
+		usage(argv[0]);
+
+	if (triple != NULL) {
+		if (!ir_target_set(triple)) {
+			fprintf(stderr, "unknown target %s\n", triple);
+			return 1;
+		}
+	} else {
+		ir_machine_triple_t *const host = ir_get_host_machine_triple();
+		ir_target_set_triple(host);
+		ir_free_machine_triple(host);
+	}
+	ir_target_init();
+
+	for (unsigned f = 0; f < n_functions; ++f) {
+		char name[32];
+		snprintf(name, sizeof(name), "f%u", f);
+		new_random_ir_graph(name, &shape, seed + f);
+	}
+
+	int result = 0;
+	if (i < argc) {
+		result = ir_export(argv[i]);
+		if (result != 0)
+			perror(argv[i]);
+	} else {
+		ir_export_file(stdout);
+		result = ferror(stdout) != 0;
+	}
+	ir_finish();
+	return result;
+}
@@ -0,0 +1,179 @@
+/*
+ * Measures the throughput of integer tarval arithmetic.  Uses the same modes
+ * and "interesting" values as unittests/tarval_calc.c, but instead of
+ * checking algebraic laws it evaluates every operation on all pairs of
+ * values repeatedly and reports the time per operation.
+ *
+ * Usage: tarval_calc [rounds]
+ */
+#include "ident_t.h"
+#include "irmode_t.h"
+#include "irprog_t.h"
+#include "tv_t.h"
+#include "util.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef ir_tarval* (*binop)(ir_tarval const *op0, ir_tarval const *op1);
+typedef ir_tarval* (*unop)(ir_tarval const *op);
+
+static unsigned   rounds = 2000;
+static unsigned   n_tarvals;
+static ir_tarval *tarvals[8];
+
+/* tarval_div, except that x/0 == 0 */
+static ir_tarval *safe_div(ir_tarval const *op0, ir_tarval const *op1)
+{
+	if (tarval_is_null(op1))
+		return (ir_tarval*)op1;
+	return tarval_div(op0, op1);
+}
+
+static ir_tarval *safe_mod(ir_tarval const *op0, ir_tarval const *op1)
+{
+	if (tarval_is_null(op1))
+		return (ir_tarval*)op1;
+	return tarval_mod(op0, op1);
+}
+
+static ir_tarval *shl_const(ir_tarval const *op0, ir_tarval const *op1)
+{
+	(void)op1;
+	return tarval_shl_unsigned(op0, 3);
+}
+
+static ir_tarval *shr_const(ir_tarval const *op0, ir_tarval const *op1)
+{
+	(void)op1;
+	return tarval_shr_unsigned(op0, 3);
+}
+
+static ir_tarval *shrs_const(ir_tarval const *op0, ir_tarval const *op1)
+{
+	(void)op1;
+	return tarval_shrs_unsigned(op0, 3);
+}
+
+static double bench_binop(binop op)
+{
+	clock_t const start = clock();
+	for (unsigned r = 0; r < rounds; ++r) {
+		for (unsigned a = 0; a < n_tarvals; ++a) {
+			for (unsigned b = 0; b < n_tarvals; ++b) {
+				(void)op(tarvals[a], tarvals[b]);
+			}
+		}
+	}
+	clock_t const end   = clock();
+	double    const n_op = (double)rounds * n_tarvals * n_tarvals;
+	return (double)(end - start) / CLOCKS_PER_SEC * 1e9 / n_op;
+}
+
+static double bench_unop(unop op)
+{
+	clock_t const start = clock();
+	for (unsigned r = 0; r < rounds * n_tarvals; ++r) {
+		for (unsigned a = 0; a < n_tarvals; ++a) {
+			(void)op(tarvals[a]);
+		}
+	}
+	clock_t const end   = clock();
+	double    const n_op = (double)rounds * n_tarvals * n_tarvals;
+	return (double)(end - start) / CLOCKS_PER_SEC * 1e9 / n_op;
+}
+
+static void bench_mode(ir_mode *mode)
+{
+	unsigned bits = get_mode_size_bits(mode);
+
+	unsigned char buffer[bits/CHAR_BIT+1];
+	for (unsigned i = 0, n = sizeof(buffer); i < n; ++i) {
+		buffer[i] = 0x55;
+	}
+	ir_tarval *oddbits = new_tarval_from_bytes(buffer, mode);
+	for (unsigned i = 0, n = sizeof(buffer); i < n; ++i) {
+		buffer[i] = 0xaa;
+	}
+	ir_tarval *evenbits = new_tarval_from_bytes(buffer, mode);
+
+	n_tarvals = 0;
+	tarvals[n_tarvals++] = get_mode_null(mode);
+	tarvals[n_tarvals++] = get_mode_one(mode);
+	tarvals[n_tarvals++] = get_mode_all_one(mode);
+	tarvals[n_tarvals++] = get_mode_min(mode);
+	tarvals[n_tarvals++] = get_mode_max(mode);
+	tarvals[n_tarvals++] = new_tarval_from_long(bits, mode);
+	tarvals[n_tarvals++] = oddbits;
+	tarvals[n_tarvals++] = evenbits;
+
+	static const struct {
+		const char *name;
+		binop       op;
+	} binops[] = {
+		{ "add",  tarval_add  },
+		{ "sub",  tarval_sub  },
+		{ "mul",  tarval_mul  },
+		{ "div",  safe_div    },
+		{ "mod",  safe_mod    },
+		{ "and",  tarval_and  },
+		{ "or",   tarval_or   },
+		{ "eor",  tarval_eor  },
+		{ "shl",  shl_const   },
+		{ "shr",  shr_const   },
+		{ "shrs", shrs_const  },
+	};
+	static const struct {
+		const char *name;
+		unop        op;
+	} unops[] = {
+		{ "neg", tarval_neg },
+		{ "not", tarval_not },
+	};
+
+	printf("%-8s", get_mode_name(mode));
+	for (size_t i = 0; i < ARRAY_SIZE(binops); ++i) {
+		printf(" %s=%.1f", binops[i].name, bench_binop(binops[i].op));
+	}
+	for (size_t i = 0; i < ARRAY_SIZE(unops); ++i) {
+		printf(" %s=%.1f", unops[i].name, bench_unop(unops[i].op));
+	}
+	printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+	if (argc > 1)
+		rounds = (unsigned)atoi(argv[1]);
+
+	init_ident();
+	init_tarval_1();
+	init_irprog_1();
+	init_mode();
+	init_tarval_2();
+
+	ir_mode *const modes[] = {
+		new_int_mode("uint8",   8,   false, 0),
+		new_int_mode("uint16",  16,  false, 0),
+		new_int_mode("uint32",  32,  false, 0),
+		new_int_mode("uint64",  64,  false, 0),
+		new_int_mode("uint128", 128, false, 0),
+
+		new_int_mode("int8",   8,   true, 0),
+		new_int_mode("int16",  16,  true, 0),
+		new_int_mode("int32",  32,  true, 0),
+		new_int_mode("int64",  64,  true, 0),
+		new_int_mode("int128", 128, true, 0),
+	};
+
+	printf("ns per operation, %u rounds\n", rounds);
+	for (size_t i = 0; i < ARRAY_SIZE(modes); ++i) {
+		bench_mode(modes[i]);
+	}
+
+	finish_tarval();
+	finish_mode();
+	finish_ident();
+	return 0;
+}
@@ -153,6 +153,15 @@ struct _obstack_chunk /* Lives at front of each chunk. */
 	char   contents[4];           /* objects begin here */
 };
 
+/* Optional accounting of the memory of an obstack: NOTIFY is called with
+   the size of each chunk allocated (positive) or freed (negative) while the
+   ACCOUNT field of the obstack points to the structure.  _obstack_begin
+   clears the field, so the initial chunk is never notified.  */
+struct obstack_account
+{
+	void (*notify) (struct obstack_account *, ptrdiff_t);
+};
+
 struct obstack /* control current object in current chunk */
 {
 	ptrdiff_t chunk_size;         /* preferred size to allocate chunks in */
@@ -180,6 +189,7 @@ struct obstack /* control current object in current chunk */
 	unsigned alloc_failed:1;      /* No longer used, as we now call the failed
 	                                 handler on error, but retained for binary
 	                                 compatibility.  */
+	struct obstack_account *account; /* accounting of the chunks or NULL */
 };
 
 /* Declare the external functions we use; they are in obstack.c.  */
@@ -55,6 +55,12 @@ FIRM_API void *xrealloc(void *ptr, size_t size);
  */
 FIRM_API char *xstrdup(const char *str);
 
+/**
+ * Returns the total number of bytes requested from xmalloc() and xrealloc()
+ * so far by all threads, which includes the chunks of obstacks.
+ */
+FIRM_API size_t xmalloc_bytes_allocated(void);
+
 /**
  * Allocate n objects of a certain type
  */
@@ -99,7 +99,9 @@
 #include "iroptimize.h"
 #include "irouts.h"
 #include "irprintf.h"
+#include "irprofile.h"
 #include "irprog.h"
+#include "irrandom.h"
 #include "irverify.h"
 #include "lowering.h"
 #include "target.h"
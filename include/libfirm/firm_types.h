@@ -72,6 +72,9 @@ typedef struct ir_type              ir_type;
 /** @ingroup ir_graph
  * Procedure Graph */
 typedef struct ir_graph             ir_graph;
+/** @ingroup ir_graph
+ * Saved state of the nodes of a procedure graph */
+typedef struct ir_graph_snapshot    ir_graph_snapshot;
 /** @ingroup ir_prog
  * Program */
 typedef struct ir_prog              ir_prog;
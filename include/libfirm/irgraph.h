@@ -132,6 +132,28 @@ FIRM_API ir_graph *new_ir_graph(ir_entity *ent, int n_loc);
  */
 FIRM_API void free_ir_graph(ir_graph *irg);
 
+/**
+ * Saves the nodes of @p irg, so a transformation can be tried and rolled back
+ * with restore_irg_snapshot().  The reachable nodes are copied in bulk to an
+ * obstack of the snapshot and keep their node indices.  Types and entities,
+ * e.g. the frame type, are not part of a snapshot.
+ *
+ * The graph must not be under construction or lowered for the backend.
+ */
+FIRM_API ir_graph_snapshot *new_irg_snapshot(ir_graph *irg);
+
+/**
+ * Replaces the nodes of the graph of @p snapshot by the saved ones and frees
+ * the snapshot.  All nodes of the graph are discarded; nodes created after the
+ * snapshot must not be used anymore, saved node indices refer to the restored
+ * nodes.  Out edges are rebuilt if they are activated, other analysis
+ * information is invalidated.
+ */
+FIRM_API void restore_irg_snapshot(ir_graph_snapshot *snapshot);
+
+/** Frees @p snapshot without restoring it. */
+FIRM_API void free_irg_snapshot(ir_graph_snapshot *snapshot);
+
 /** Returns the entity of an IR graph. */
 FIRM_API ir_entity *get_irg_entity(const ir_graph *irg);
 /** Sets the entity of an IR graph. */
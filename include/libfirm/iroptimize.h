@@ -285,6 +285,24 @@ FIRM_API void opt_osr(ir_graph *irg, unsigned flags);
  */
 FIRM_API void remove_phi_cycles(ir_graph *irg);
 
+/**
+ * Inserts prefetches for Loads inside loops whose address is an
+ * induction variable with a constant stride, for instance the pointer
+ * induction variables created by opt_osr().
+ *
+ * The prefetch distance is chosen such that @p latency cycles are covered,
+ * assuming one cycle per node of the loop.  If profile information is
+ * available, loops with few iterations are prefetched less far ahead.
+ * Backends without prefetch instructions remove the prefetches when
+ * lowering builtins.
+ *
+ * @param irg      the graph which should be optimized
+ * @param latency  the memory latency in cycles, 0 for a default value
+ *
+ * This algorithm destroys the link field of nodes.
+ */
+FIRM_API void insert_prefetches(ir_graph *irg, unsigned latency);
+
 /** A default threshold. */
 #define DEFAULT_CLONE_THRESHOLD 20
 
@@ -397,6 +415,20 @@ FIRM_API void opt_tail_rec_irg(ir_graph *irg);
  */
 FIRM_API void combo(ir_graph *irg);
 
+/**
+ * Interprocedural sparse conditional constant propagation.
+ *
+ * Runs the lattice of combo() over the whole program, using the callee
+ * information computed by cgana() as call graph.  Constant arguments of
+ * methods that are only called from within the compilation unit, and
+ * constant results of methods are propagated to their users and folded.
+ * Methods that are found unreachable lose all their references; call
+ * garbage_collect_entities() afterwards to remove them.
+ *
+ * Frees the callee information.
+ */
+FIRM_API void ipsccp(void);
+
 /** pointer to an optimization function */
 typedef void (*opt_ptr)(ir_graph *irg);
 
@@ -404,6 +436,12 @@ typedef void (*opt_ptr)(ir_graph *irg);
  * Heuristic inliner. Calculates a benefice value for every call and inlines
  * those calls with a value higher than the threshold.
  *
+ * If profile data has been read with ir_profile_read(), calls are ranked by
+ * their measured execution count instead of their loop depth.  Inlining into
+ * rarely executed calls may only grow a method by a fraction of maxsize, and
+ * indirect calls which almost always call the same method are turned into a
+ * guarded direct call first.
+ *
  * @param maxsize             Do not inline any calls if a method has more than
  *                            maxsize firm nodes.  It may reach this limit by
  *                            inlining.
@@ -414,6 +452,24 @@ typedef void (*opt_ptr)(ir_graph *irg);
 FIRM_API void inline_functions(unsigned maxsize, int inline_threshold,
                                opt_ptr after_inline_opt);
 
+/**
+ * Partial inliner. Splits called methods which consist of a small entry part
+ * and a rarely executed remainder: The remainder is moved into a new local
+ * method which is called from the entry part.  Afterwards inline_functions()
+ * is run, which can now inline the small entry part.
+ *
+ * A remainder is only moved if it is entered by a single conditional jump,
+ * all other blocks of it are dominated by its entry block and it leaves the
+ * method only by returning.  The execution frequency of the remainder is
+ * taken from the profile if one has been read, else it is estimated.
+ *
+ * @param maxsize             see inline_functions()
+ * @param inline_threshold    see inline_functions()
+ * @param after_inline_opt    see inline_functions()
+ */
+FIRM_API void partial_inline(unsigned maxsize, int inline_threshold,
+                             opt_ptr after_inline_opt);
+
 /**
  * Combines congruent blocks into one.
  *
@@ -444,6 +500,31 @@ FIRM_API void do_loop_unrolling(ir_graph *irg);
  */
 FIRM_API void unroll_loops(ir_graph *irg, unsigned factor, unsigned maxsize);
 
+/**
+ * Perform loop unswitching on a given graph.
+ * An innermost loop containing a Cond whose selector is loop invariant is
+ * duplicated.  The original loop keeps the true branch, the copy the false
+ * branch and the Cond is evaluated once in front of the loops.  The dead
+ * branches are removed by a subsequent control flow optimization.
+ *
+ * @param irg       the IR-graph to optimize
+ * @param maxsize   the maximum number of nodes in a loop
+ */
+FIRM_API void unswitch_loops(ir_graph *irg, unsigned maxsize);
+
+/**
+ * Perform loop-invariant code motion for Loads on a given graph.
+ * Loads from loop-invariant addresses which are not modified by an aliasing
+ * operation of the loop are replaced by a single Load in front of the loop.
+ * Values stored to such an address inside the loop are forwarded to the
+ * following Loads.
+ * Address computations must already be outside of the loop, so code
+ * placement should run before this pass.
+ *
+ * @param irg       the IR-graph to optimize
+ */
+FIRM_API void loop_invariant_code_motion(ir_graph *irg);
+
 /**
  * Perform loop peeling on a given graph.
  */
@@ -475,11 +556,50 @@ FIRM_API void garbage_collect_entities(void);
  *  the outs state set to outs_none.  Backedge information is conserved.
  *  Removes old attributes of nodes.  Sets link field to NULL.
  *  Callee information must be freed (irg_callee_info_none).
+ *  The node indices are renumbered densely, so get_irg_last_idx() afterwards
+ *  returns the number of live nodes.
  *
  * @param irg  The graph to be optimized.
  */
 FIRM_API void dead_node_elimination(ir_graph *irg);
 
+/**
+ * Counts the nodes of @p irg which are reachable from its anchor, i.e. the
+ * nodes dead_node_elimination() keeps.  The difference to get_irg_last_idx()
+ * is the number of dead nodes.  Walks the graph.
+ */
+FIRM_API unsigned count_irg_live_nodes(ir_graph *irg);
+
+/**
+ * Sets the fraction of dead nodes among all nodes allocated in a graph above
+ * which compact_irg_if_sparse() runs dead_node_elimination().  The default
+ * is 0, which disables automatic compaction.
+ *
+ * With a positive threshold the passes of this header check their graph (or
+ * all graphs for interprocedural passes) with compact_irg_if_sparse() when
+ * they return to a caller outside of any other pass.  Compaction renumbers
+ * and moves all nodes, so a client which enables it must not keep nodes of a
+ * graph across such calls.
+ */
+FIRM_API void set_irg_compaction_threshold(double fraction);
+
+/** Returns the fraction set with set_irg_compaction_threshold(). */
+FIRM_API double get_irg_compaction_threshold(void);
+
+/**
+ * Runs dead_node_elimination() on @p irg if the fraction of dead nodes
+ * exceeds the compaction threshold.  Small graphs, graphs under construction
+ * or in the backend, graphs with reserved resources and graphs with analysis
+ * information about their nodes (callee and callgraph information, outs,
+ * loops, dominance or VRP data) are left alone.  The
+ * live nodes are only counted again after the node index space grew by an
+ * eighth since the last count, so the check is cheap when called often.
+ * Out edges stay active if they were.
+ *
+ * @return non-zero if the graph was compacted
+ */
+FIRM_API int compact_irg_if_sparse(ir_graph *irg);
+
 /**
  * Code Placement.
  *
@@ -0,0 +1,178 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief       Code instrumentation and execution count profiling.
+ * @author      Adam M. Szalkowski
+ * @date        06.04.2006
+ */
+#ifndef FIRM_IR_PROFILE_H
+#define FIRM_IR_PROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "firm_types.h"
+
+#include "begin.h"
+
+/**
+ * @ingroup irana
+ * @defgroup irprofile Execution Count Profiling
+ *
+ * The profiler instruments a program with counters for each basic block and
+ * records the most frequent values of selected operands: the targets of
+ * indirect calls and IJmps, Switch selectors, the divisors of Div and Mod
+ * and the size argument of calls to memcpy, memmove and memset.  When the
+ * instrumented program terminates the collected data is written to a file
+ * which can be read back in a later compiler run.
+ *
+ * Alternatively, the profiler places 64-bit counters on control flow edges.
+ * Only the edges off a maximum spanning tree of each graph, weighted by the
+ * estimated execution frequencies, get a counter; the counts of the
+ * remaining edges and of all blocks are derived when the profile is read.
+ *
+ * The profile file lists the counters of each function together with a
+ * checksum of its control flow graph.  Each run of the instrumented program
+ * adds its counts to those already in the file, forked processes included.
+ * The firmprof-merge tool of libfirmprof sums up files of separate runs.
+ *
+ * Blocks and call sites are identified by their order in a walk over the
+ * graphs, so the profile must be read at the same point of the compilation
+ * pipeline where the program was instrumented.  Functions whose checksum
+ * differs get no profile data.
+ * @{
+ */
+
+/**
+ * Sets whether the following instrumentations are safe for multi-threaded
+ * programs.  Each instrumented function then fetches a copy of the counters
+ * for the current thread on entry, and the copies are added up at exit.
+ * Disabled by default.
+ */
+FIRM_API void ir_profile_set_thread_safe(bool enable);
+
+
+/**
+ * Instruments all irgs in the program with profile code.
+ * The final code will have a counter for each basic block which is
+ * incremented in that block and records the values of the value profiling
+ * sites. After the program has run the info is written to @p filename.
+ *
+ * @returns the graph of a constructor function which registers the
+ *          counters with the profiling runtime, or NULL if the program
+ *          contains no graphs
+ */
+FIRM_API ir_graph *ir_profile_instrument(const char *filename);
+
+/**
+ * Instruments all irgs in the program with edge counters.
+ * Counters are placed on the control flow edges which are not part of a
+ * maximum spanning tree of the estimated execution frequencies, splitting
+ * critical edges where necessary.  A graph whose spanning tree would need a
+ * counter on an edge that cannot be split gets a counter in each block
+ * instead.  Values are recorded like with ir_profile_instrument().
+ *
+ * @returns the graph of a constructor function which registers the
+ *          counters with the profiling runtime, or NULL if the program
+ *          contains no graphs
+ */
+FIRM_API ir_graph *ir_profile_instrument_edges(const char *filename);
+
+/**
+ * Reads the corresponding profile info file if it exists and returns a
+ * profile info struct
+ * @param filename The name of the file containing profile information
+ */
+FIRM_API bool ir_profile_read(const char *filename);
+
+/**
+ * Frees the profile info
+ */
+FIRM_API void ir_profile_free(void);
+
+/**
+ * Returns true if profile data has been read.
+ */
+FIRM_API bool ir_profile_available(void);
+
+/**
+ * Get block execution count as determined be profiling.  Counts beyond the
+ * range of uint32_t are saturated.
+ */
+FIRM_API uint32_t ir_profile_get_block_execcount(const ir_node *block);
+
+/**
+ * Returns how often control flowed into @p block from its predecessor
+ * @p pos, or 0 if the profile contains no edge counts for the block.
+ */
+FIRM_API uint64_t ir_profile_get_edge_execcount(const ir_node *block,
+                                                int pos);
+
+/**
+ * Returns true if the profile contains an execution count for @p block.
+ * Blocks created after the profile was read have no count unless one was
+ * set with ir_profile_set_block_execcount().
+ */
+FIRM_API bool ir_profile_has_block_execcount(const ir_node *block);
+
+/**
+ * Sets the execution count of @p block.  Transformations which create new
+ * blocks may use this to keep the profile up to date.
+ */
+FIRM_API void ir_profile_set_block_execcount(const ir_node *block,
+                                             uint32_t count);
+
+/**
+ * A value recorded at a value profiling site.
+ */
+typedef struct ir_profile_value_t {
+	uint32_t   count;  /**< how often the value was recorded */
+	ir_entity *entity; /**< the called function, or NULL */
+	ir_node   *block;  /**< the target block of an IJmp, or NULL */
+	ir_tarval *value;  /**< the value of an integer operand, or NULL */
+} ir_profile_value_t;
+
+/**
+ * Returns the most frequent values recorded at the value profiling site
+ * @p node, which is an indirect Call, an IJmp, a Switch, a Div or Mod or a
+ * call of memcpy, memmove or memset.  Targets which are no function or
+ * label of the program have neither entity nor block.
+ *
+ * @param node      the site
+ * @param values    is filled with the values by decreasing count
+ * @param n_values  the maximum number of values to return
+ * @param total     is set to the number of times @p node was executed
+ * @returns the number of values stored in @p values, 0 if the profile
+ *          contains no values for @p node
+ */
+FIRM_API unsigned ir_profile_get_values(const ir_node *node,
+                                        ir_profile_value_t *values,
+                                        unsigned n_values, uint32_t *total);
+
+/**
+ * Returns the most frequent target of the indirect Call @p call.
+ *
+ * @param call   the Call node
+ * @param count  is set to the number of calls to the returned entity
+ * @param total  is set to the number of times @p call was executed
+ * @returns the most frequently called entity or NULL if no target of
+ *          @p call is known
+ */
+FIRM_API ir_entity *ir_profile_get_call_target(const ir_node *call,
+                                               uint32_t *count,
+                                               uint32_t *total);
+
+/**
+ * Initializes exec_freq structure for an irg based on profile data
+ */
+FIRM_API void ir_create_execfreqs_from_profile(void);
+
+/** @} */
+
+#include "end.h"
+
+#endif
@@ -0,0 +1,73 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Deterministic generation of random graphs.
+ */
+#ifndef FIRM_IR_IRRANDOM_H
+#define FIRM_IR_IRRANDOM_H
+
+#include "firm_types.h"
+
+#include "begin.h"
+
+/**
+ * @defgroup irrandom Random Graphs
+ *
+ * Generates valid SSA graphs of a given shape to measure how optimizations
+ * and the backend scale with the size of their input.  The graphs are built
+ * with the construction interface (see ircons.h) only, so they look like
+ * graphs of a frontend.  The same seed and shape always produce the same
+ * graph, which may be written with ir_export() to replay it later.
+ *
+ * A generated function takes two int parameters x and n and returns an int.
+ * Its control flow is a random structured nesting of sequences, branches
+ * (Cond or Switch) and loops counting up to n.  Every basic block contains
+ * arithmetic operations and Loads and Stores on an int array owned by the
+ * function.  All values stay live until the Return, which sums them up.
+ * @{
+ */
+
+/** Shape of a random graph. */
+typedef struct ir_random_shape_t {
+	unsigned n_blocks;    /**< number of basic blocks besides the start and
+	                           end block */
+	unsigned n_ops;       /**< number of operations per basic block */
+	unsigned loop_depth;  /**< maximal nesting depth of loops */
+	unsigned mem_percent; /**< percentage of operations which are Loads or
+	                           Stores */
+	unsigned phi_fan_in;  /**< maximal number of predecessors of a join
+	                           block, at least 2 */
+	unsigned n_values;    /**< number of values live at the same time, i.e.
+	                           the register pressure */
+} ir_random_shape_t;
+
+/**
+ * Initializes @p shape with a medium sized function: 64 blocks of 8
+ * operations, loops nested up to depth 3, 20% memory operations, joins of up
+ * to 4 blocks and 8 live values.
+ */
+FIRM_API void ir_random_shape_init(ir_random_shape_t *shape);
+
+/**
+ * Creates the entity @p name and a random graph of @p shape for it.
+ * The graph is added to the program.
+ *
+ * @param name   the linker name of the function, the array is named
+ *               @p name with the suffix "_mem"
+ * @param shape  the shape of the graph
+ * @param seed   the seed of the random decisions
+ * @return the new graph
+ */
+FIRM_API ir_graph *new_random_ir_graph(const char *name,
+                                       const ir_random_shape_t *shape,
+                                       unsigned seed);
+
+/** @} */
+
+#include "end.h"
+
+#endif
@@ -77,6 +77,39 @@
 FIRM_API void lower_CopyB(ir_graph *irg, unsigned max_small_size,
                           unsigned min_large_size, int allow_misalignments);
 
+/**
+ * Like lower_CopyB(), but small CopyBs use Loads and Stores of up to
+ * @p wide_mode, e.g. a vector register mode, instead of the pointer size.
+ * If misalignments are allowed, a tail smaller than the access size is copied
+ * by a single access overlapping the previous one.
+ *
+ * @param irg                 The graph to be lowered.
+ * @param max_small_size      The maximum number of bytes for a CopyB node so
+ *                            that it is still considered 'small'.
+ * @param min_large_size      The minimum number of bytes for a CopyB node so
+ *                            that it is regarded as 'large'.
+ * @param wide_mode           The widest mode for Loads and Stores, a power of
+ *                            two larger than a pointer; NULL for the pointer
+ *                            size.
+ * @param allow_misalignments Backend can handle misaligned loads and stores.
+ */
+FIRM_API void lower_CopyB_wide(ir_graph *irg, unsigned max_small_size,
+                               unsigned min_large_size, ir_mode *wide_mode,
+                               int allow_misalignments);
+
+/**
+ * Replaces calls memset(dst, 0, size) with a constant size of at most
+ * @p max_size bytes by Stores of zero, using Stores of up to @p wide_mode
+ * (NULL for the pointer size).  As the alignment of dst is unknown, this is
+ * only useful for targets that handle misaligned stores.
+ *
+ * @param irg       The graph to be lowered.
+ * @param max_size  The maximum number of bytes to fill with Stores.
+ * @param wide_mode The widest mode for Stores or NULL.
+ */
+FIRM_API void lower_zero_fill(ir_graph *irg, unsigned max_size,
+                              ir_mode *wide_mode);
+
 /**
  * Lowers all Switches (Cond nodes with non-boolean mode) depending on spare_size.
  * They will either remain the same or be converted into if-cascades.
@@ -62,6 +62,19 @@ FIRM_API void stat_ev(const char *name);
  */
 FIRM_API void stat_ev_begin(const char *filename_prefix, const char *filter);
 
+/**
+ * Initialize the stat ev machinery with the compact binary format, which
+ * is considerably cheaper to write and read than the text format.  Keys are
+ * defined once and referenced by number, values are not formatted as text.
+ * support/statev_summary.py reads both formats.
+ * @param filename_prefix  The name of the file (.evb will be appended). File
+ *                         will be truncated!
+ * @param filter           A filter as for stat_ev_begin().  The filter is
+ *                         applied once per key.
+ */
+FIRM_API void stat_ev_begin_binary(const char *filename_prefix,
+                                   const char *filter);
+
 /**
  * Shuts down stat ev machinery
  */
@@ -10,6 +10,12 @@
 #ifndef FIRM_TIMING_H
 #define FIRM_TIMING_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "firm_types.h"
+
 #include "begin.h"
 
 /**
@@ -114,6 +120,127 @@ FIRM_API unsigned long ir_timer_elapsed_usec(const ir_timer_t *timer);
  */
 FIRM_API double ir_timer_elapsed_sec(const ir_timer_t *timer);
 
+/**
+ * @defgroup irtrace Compile-time Tracing
+ *
+ * The tracer records nested regions of the compilation, e.g. the passes of
+ * iroptimize.h and the steps of the backend for each graph.  Each region
+ * records its wall time, the growth of the node index space of its graph
+ * (roughly the number of nodes created) and the number of bytes allocated
+ * with xmalloc().  While obstack accounting is enabled, regions also record
+ * the bytes live in accounted obstacks at their end and the highest number
+ * during them, which the Chrome trace shows as a counter.  The trace can be written as a
+ * Chrome trace-event file (viewable in chrome://tracing or Perfetto) and as
+ * folded stacks for flamegraph tools.
+ *
+ * Function names in the trace refer to identifiers, so the trace must be
+ * written before ir_finish().
+ * @{
+ */
+
+/**
+ * Starts recording a trace, discarding a previously recorded one.
+ */
+FIRM_API void ir_trace_begin(void);
+
+/**
+ * Stops recording and frees the trace.
+ */
+FIRM_API void ir_trace_end(void);
+
+/**
+ * Returns whether a trace is being recorded.
+ */
+FIRM_API bool ir_trace_enabled(void);
+
+/**
+ * Enters a region of the trace, which is nested in the current region.
+ * Records nothing unless a trace is being recorded.
+ *
+ * @param name  the name of the region, which must stay valid while the trace
+ *              exists
+ * @param irg   the graph the region works on, or NULL
+ */
+FIRM_API void ir_trace_enter(const char *name, ir_graph *irg);
+
+/**
+ * Leaves the region @p name, which must be the current region.  Leaving an
+ * outermost region is a pass boundary, where the graph of the region (or all
+ * graphs if it has none) is compacted with compact_irg_if_sparse() when a
+ * compaction threshold is set (see set_irg_compaction_threshold()).
+ */
+FIRM_API void ir_trace_leave(const char *name);
+
+/**
+ * Writes the regions recorded so far as Chrome trace-event JSON.
+ * @return true on success
+ */
+FIRM_API bool ir_trace_write_chrome(const char *filename);
+
+/**
+ * Writes the self time in microseconds of the regions recorded so far as
+ * folded stacks, one line per stack, which flamegraph.pl and compatible
+ * tools read.  Regions of another graph than their parent region get a
+ * frame for the function of the graph.
+ * @return true on success
+ */
+FIRM_API bool ir_trace_write_folded(const char *filename);
+
+/** @} */
+
+/**
+ * @defgroup irmemacct Obstack Accounting
+ *
+ * Obstack accounting tracks the bytes in the chunks of the obstacks of
+ * graphs, their out edges and analysis information, and of the backend
+ * (per graph data, liveness sets and the PBQP solver).  Each obstack is
+ * tagged with its owner, its function and the phase (the innermost region
+ * of the compile-time trace, see @ref irtrace) it was created in, and records
+ * its live and peak bytes.  When a phase is left, the high-water mark of the
+ * total during the phase is emitted as statistic event "obst_peak" (and the
+ * live bytes as "obst_live") in the context "obst_phase", so the statev
+ * output forms a timeline of the memory use of the passes.
+ *
+ * Phases are tracked even if no trace is recorded.
+ * @{
+ */
+
+/**
+ * Starts obstack accounting, discarding the statistics of a previous run.
+ * The obstacks of existing graphs and their out edges are accounted
+ * immediately, others as they are initialized.
+ */
+FIRM_API void ir_mem_accounting_begin(void);
+
+/**
+ * Stops obstack accounting.
+ */
+FIRM_API void ir_mem_accounting_end(void);
+
+/**
+ * Returns whether obstack accounting is enabled.
+ */
+FIRM_API bool ir_mem_accounting_enabled(void);
+
+/**
+ * Returns the number of bytes currently in accounted obstacks.
+ */
+FIRM_API size_t ir_mem_live_bytes(void);
+
+/**
+ * Returns the highest number of bytes in accounted obstacks since
+ * accounting began.
+ */
+FIRM_API size_t ir_mem_peak_bytes(void);
+
+/**
+ * Writes the owner, function, phase, peak and live bytes of each accounted
+ * obstack to @p out, sorted by decreasing peak.
+ */
+FIRM_API void ir_mem_accounting_dump(FILE *out);
+
+/** @} */
+
 #include "end.h"
 
 #endif
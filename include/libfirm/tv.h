@@ -649,9 +649,15 @@ FIRM_API int tarval_get_exponent(ir_tarval const *tv);
 FIRM_API int tarval_ieee754_can_conv_lossless(ir_tarval const *tv, const ir_mode *mode);
 
 /**
- * Returns non-zero if the result of the last IEEE-754 operation was exact.
+ * Divides two floating point tarvals like tarval_div().
+ *
+ * @param a      the dividend
+ * @param b      the divisor
+ * @param exact  set to non-zero if the result is exact, i.e. it was not
+ *               rounded and no NaN or infinity was involved
  */
-FIRM_API unsigned tarval_ieee754_get_exact(void);
+FIRM_API ir_tarval *tarval_ieee754_div(ir_tarval const *a, ir_tarval const *b,
+                                       int *exact);
 
 /**
  * Check if @p tv is a floating point NaN.
@@ -0,0 +1,212 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   a lock-free, insert-only set of pointers
+ */
+#include "lfset.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "xmalloc.h"
+
+/** Maximum number of cells in a list before it is split into a child node. */
+#define LFSET_MAX_CELLS 4
+/** Number of hash bits. */
+#define LFSET_HASH_BITS ((unsigned)(sizeof(unsigned) * 8))
+
+#ifdef __GNUC__
+#define LOAD_ACQUIRE(ptr) __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define COMPARE_AND_SWAP(ptr, expected, desired) \
+	__atomic_compare_exchange_n((ptr), &(expected), (desired), false, \
+	                            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#else
+/* Without atomic operations the set is only usable from a single thread. */
+#define LOAD_ACQUIRE(ptr) (*(ptr))
+#define COMPARE_AND_SWAP(ptr, expected, desired) \
+	(*(ptr) == (expected) ? (*(ptr) = (desired), true) \
+	                      : ((expected) = *(ptr), false))
+#endif
+
+struct lfset_cell_t {
+	lfset_cell_t *next;
+	void         *element;
+	unsigned      hash;
+};
+
+struct lfset_garbage_t {
+	lfset_garbage_t *next;
+	lfset_cell_t    *cells;
+};
+
+static bool is_node(void const *slot)
+{
+	return ((uintptr_t)slot & 1) != 0;
+}
+
+static lfset_node_t *get_node(void *slot)
+{
+	return (lfset_node_t*)((uintptr_t)slot - 1);
+}
+
+static void *make_node_slot(lfset_node_t *node)
+{
+	return (void*)((uintptr_t)node + 1);
+}
+
+static unsigned get_slot_index(unsigned hash, unsigned shift)
+{
+	return (hash >> shift) & (LFSET_FANOUT - 1);
+}
+
+static void free_cells(lfset_cell_t *cell, void (*free_element)(void*))
+{
+	while (cell != NULL) {
+		lfset_cell_t *const next = cell->next;
+		if (free_element != NULL)
+			free_element(cell->element);
+		free(cell);
+		cell = next;
+	}
+}
+
+static void free_node(lfset_node_t *node, void (*free_element)(void*))
+{
+	for (unsigned i = 0; i < LFSET_FANOUT; ++i) {
+		void *const slot = node->slots[i];
+		if (is_node(slot)) {
+			lfset_node_t *const child = get_node(slot);
+			free_node(child, free_element);
+			free(child);
+		} else {
+			free_cells((lfset_cell_t*)slot, free_element);
+		}
+	}
+}
+
+void lfset_init(lfset_t *set, lfset_cmp_function cmp_function)
+{
+	memset(&set->root, 0, sizeof(set->root));
+	set->cmp_function = cmp_function;
+	set->garbage      = NULL;
+}
+
+void lfset_destroy(lfset_t *set, void (*free_element)(void *element))
+{
+	free_node(&set->root, free_element);
+	/* replaced lists contain elements which are also in the trie */
+	for (lfset_garbage_t *garbage = set->garbage, *next; garbage != NULL;
+	     garbage = next) {
+		next = garbage->next;
+		free_cells(garbage->cells, NULL);
+		free(garbage);
+	}
+	set->garbage = NULL;
+}
+
+static void *find_in_cells(lfset_t const *set, lfset_cell_t const *cell,
+                           void const *key, unsigned hash, unsigned *n_cells)
+{
+	unsigned n = 0;
+	for (; cell != NULL; cell = cell->next, ++n) {
+		if (cell->hash == hash && set->cmp_function(cell->element, key) == 0)
+			return cell->element;
+	}
+	*n_cells = n;
+	return NULL;
+}
+
+void *lfset_find(lfset_t *set, void const *key, unsigned hash)
+{
+	lfset_node_t *node = &set->root;
+	for (unsigned shift = 0;; shift += LFSET_BITS) {
+		void *const slot = LOAD_ACQUIRE(&node->slots[get_slot_index(hash, shift)]);
+		if (is_node(slot)) {
+			node = get_node(slot);
+			continue;
+		}
+		unsigned n_cells;
+		return find_in_cells(set, (lfset_cell_t const*)slot, key, hash,
+		                     &n_cells);
+	}
+}
+
+/**
+ * Creates a child node which contains copies of the cells in @p cells.
+ */
+static lfset_node_t *split_cells(lfset_cell_t const *cells, unsigned shift)
+{
+	lfset_node_t *const node = XMALLOCZ(lfset_node_t);
+	for (lfset_cell_t const *cell = cells; cell != NULL; cell = cell->next) {
+		unsigned      const idx  = get_slot_index(cell->hash, shift);
+		lfset_cell_t *const copy = XMALLOC(lfset_cell_t);
+		*copy = *cell;
+		copy->next       = (lfset_cell_t*)node->slots[idx];
+		node->slots[idx] = copy;
+	}
+	return node;
+}
+
+static void add_garbage(lfset_t *set, lfset_cell_t *cells)
+{
+	lfset_garbage_t *const garbage = XMALLOC(lfset_garbage_t);
+	garbage->cells = cells;
+	lfset_garbage_t *head = LOAD_ACQUIRE(&set->garbage);
+	do {
+		garbage->next = head;
+	} while (!COMPARE_AND_SWAP(&set->garbage, head, garbage));
+}
+
+void *lfset_insert(lfset_t *set, void *element, unsigned hash)
+{
+	lfset_cell_t *cell  = NULL;
+	lfset_node_t *node  = &set->root;
+	unsigned      shift = 0;
+	for (;;) {
+		void **const slot_ptr = &node->slots[get_slot_index(hash, shift)];
+		void        *slot     = LOAD_ACQUIRE(slot_ptr);
+		if (is_node(slot)) {
+			node   = get_node(slot);
+			shift += LFSET_BITS;
+			continue;
+		}
+
+		lfset_cell_t *const cells = (lfset_cell_t*)slot;
+		unsigned            n_cells;
+		void *const found = find_in_cells(set, cells, element, hash, &n_cells);
+		if (found != NULL) {
+			free(cell);
+			return found;
+		}
+
+		if (n_cells >= LFSET_MAX_CELLS
+		 && shift + LFSET_BITS < LFSET_HASH_BITS) {
+			/* the list is full, replace it by a child node */
+			lfset_node_t *const child = split_cells(cells, shift + LFSET_BITS);
+			if (COMPARE_AND_SWAP(slot_ptr, slot, make_node_slot(child))) {
+				add_garbage(set, cells);
+			} else {
+				free_node(child, NULL);
+				free(child);
+			}
+			/* retry the slot */
+			continue;
+		}
+
+		if (cell == NULL) {
+			cell = XMALLOC(lfset_cell_t);
+			cell->element = element;
+			cell->hash    = hash;
+		}
+		cell->next = cells;
+		if (COMPARE_AND_SWAP(slot_ptr, slot, (void*)cell))
+			return element;
+		/* another thread changed the slot, search it again */
+	}
+}
@@ -0,0 +1,97 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   a lock-free, insert-only set of pointers
+ */
+#ifndef FIRM_ADT_LFSET_H
+#define FIRM_ADT_LFSET_H
+
+/**
+ * @ingroup adt
+ * @defgroup lfset Lock-free Set
+ * An insert-only set of pointers with a custom compare function which can be
+ * searched and extended from several threads at once without locking.
+ *
+ * The set is a hash trie: Every trie node has 16 slots indexed by 4 bits of
+ * the hash value.  A slot contains either a child node or a short list of
+ * cells holding the elements.  New elements are published with a single
+ * compare-and-swap on the slot, full lists are replaced by a new child node
+ * the same way.  As nothing is ever removed, readers never see freed memory.
+ * @{
+ */
+
+/**
+ * The type of a lfset compare function.
+ *
+ * @param element  an element of the set
+ * @param key      the searched key
+ * @return 0 if the element equals the key
+ */
+typedef int (*lfset_cmp_function)(void const *element, void const *key);
+
+/** @cond PRIVATE */
+
+#define LFSET_BITS   4
+#define LFSET_FANOUT (1u << LFSET_BITS)
+
+typedef struct lfset_cell_t    lfset_cell_t;
+typedef struct lfset_garbage_t lfset_garbage_t;
+
+typedef struct lfset_node_t {
+	void *slots[LFSET_FANOUT]; /**< cell lists or tagged child nodes */
+} lfset_node_t;
+
+/** @endcond */
+
+/** a lock-free set of pointers */
+typedef struct lfset_t {
+	lfset_node_t       root;
+	lfset_cmp_function cmp_function;
+	lfset_garbage_t   *garbage;      /**< cell lists replaced by nodes */
+} lfset_t;
+
+/**
+ * Initializes a lfset.
+ *
+ * @param set           Pointer to allocated space for the set
+ * @param cmp_function  The compare function to use
+ */
+void lfset_init(lfset_t *set, lfset_cmp_function cmp_function);
+
+/**
+ * Destroys a lfset and frees its memory.  Must not run concurrently with
+ * other operations on the set.
+ *
+ * @param set           The set
+ * @param free_element  If not NULL, called once for every element in the set
+ */
+void lfset_destroy(lfset_t *set, void (*free_element)(void *element));
+
+/**
+ * Searches an element equal to @p key.
+ *
+ * @param set   The set
+ * @param key   The key to search for
+ * @param hash  The hash value of @p key
+ * @return the element in the set or NULL if there is none
+ */
+void *lfset_find(lfset_t *set, void const *key, unsigned hash);
+
+/**
+ * Inserts @p element into the set if it does not contain an equal element.
+ *
+ * @param set      The set
+ * @param element  The element to insert
+ * @param hash     The hash value of @p element
+ * @return the equal element already in the set or @p element if it was
+ *         inserted
+ */
+void *lfset_insert(lfset_t *set, void *element, unsigned hash);
+
+/** @} */
+
+#endif
@@ -15,6 +15,20 @@
 #include <stdlib.h>
 #include <string.h>
 
+/** bytes requested so far, for compile-time tracing */
+static size_t bytes_allocated;
+
+/* Threads may allocate concurrently, so the counter is updated atomically
+ * where the compiler supports it. */
+#ifdef __GNUC__
+# define count_bytes(size) \
+	((void)__atomic_fetch_add(&bytes_allocated, (size), __ATOMIC_RELAXED))
+# define get_bytes()       __atomic_load_n(&bytes_allocated, __ATOMIC_RELAXED)
+#else
+# define count_bytes(size) ((void)(bytes_allocated += (size)))
+# define get_bytes()       bytes_allocated
+#endif
+
 static FIRM_NORETURN xnomem(void)
 {
 	/* Do not use panic() here, because it might try to allocate memory! */
@@ -27,6 +41,7 @@ void *xmalloc(size_t size)
 	void *res = malloc(size);
 
 	if (!res) xnomem();
+	count_bytes(size);
 	return res;
 }
 
@@ -36,6 +51,7 @@ void *xrealloc(void *ptr, size_t size)
 	void *res = ptr ? realloc (ptr, size) : malloc (size);
 
 	if (!res) xnomem();
+	count_bytes(size);
 	return res;
 }
 
@@ -44,3 +60,8 @@ char *xstrdup(const char *str)
 	size_t len = strlen (str) + 1;
 	return (char*) memcpy(xmalloc(len), str, len);
 }
+
+size_t xmalloc_bytes_allocated(void)
+{
+	return get_bytes();
+}
@@ -455,16 +455,14 @@ static size_t get_free_methods(ir_entity ***free_methods)
 		ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
 	}
 
-	/* insert all methods that are used in global variables initializers */
-	ir_type *global_tp = get_glob_type();
-	for (size_t j = 0, m = get_compound_n_members(global_tp); j < m; ++j) {
-		ir_entity *const ent = get_compound_member(global_tp, j);
-		add_method_address(ent, free_set);
-	}
-	ir_type *tls_tp = get_tls_type();
-	for (size_t j = 0, m = get_compound_n_members(tls_tp); j < m; ++j) {
-		ir_entity *const ent = get_compound_member(tls_tp, j);
-		add_method_address(ent, free_set);
+	/* insert all methods that are used in initializers of any segment,
+	 * including the constructor and destructor tables */
+	for (ir_segment_t s = IR_SEGMENT_FIRST; s <= IR_SEGMENT_LAST; ++s) {
+		ir_type *const segment = get_segment_type(s);
+		for (size_t j = 0, m = get_compound_n_members(segment); j < m; ++j) {
+			ir_entity *const ent = get_compound_member(segment, j);
+			add_method_address(ent, free_set);
+		}
 	}
 
 	/* the main program is even then "free", if it's not external visible. */
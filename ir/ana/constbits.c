@@ -16,6 +16,7 @@
 #include "irnode_t.h"
 #include "irnodemap.h"
 #include "iropt.h"
+#include "memacct.h"
 #include <assert.h>
 
 #ifndef VERIFY_CONSTBITS
@@ -878,6 +879,7 @@ void constbits_analyze(ir_graph *const irg)
 	assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES);
 
 	obstack_init(&irg->bitinfo.obst);
+	ir_obst_account(&irg->bitinfo.obst, "bitinfo", irg);
 	ir_nodemap_init(&irg->bitinfo.map, irg);
 	get_bitinfo_func = &get_bitinfo_recursive;
 	irg_walk_graph(irg, NULL, calc_bitinfo_walker, NULL);
@@ -16,6 +16,7 @@
 #include "irgwalk.h"
 #include "irnode_t.h"
 #include "irprog_t.h"
+#include "memacct.h"
 #include "xmalloc.h"
 
 unsigned get_irn_n_outs(const ir_node *node)
@@ -287,6 +288,7 @@ static void set_out_edges(ir_graph *irg)
 {
 	struct obstack *obst = &irg->out_obst;
 	obstack_init(obst);
+	ir_obst_account(obst, "irg_outs", irg);
 	irg->out_obst_allocated = true;
 
 	inc_irg_visited(irg);
@@ -21,6 +21,7 @@
 #include "iroptimize.h"
 #include "irouts_t.h"
 #include "irprintf.h"
+#include "memacct.h"
 #include "pdeq.h"
 #include "tv.h"
 
@@ -508,6 +509,7 @@ void set_vrp_data(ir_graph *irg)
 	assure_irg_outs(irg); /* ensure that out edges are consistent*/
 	ir_nodemap_init(&irg->vrp.infos, irg);
 	obstack_init(&irg->vrp.obst);
+	ir_obst_account(&irg->vrp.obst, "vrp", irg);
 	ir_vrp_info *info = &irg->vrp;
 
 	if (dump_hook.hook._hook_node_info == NULL) {
@@ -47,6 +47,8 @@ pmap *amd64_constants;
 
 ir_mode *amd64_mode_xmm;
 
+bool amd64_use_fast_strings = false;
+
 static ir_node *create_push(ir_node *node, ir_node *schedpoint, ir_node *sp,
                             ir_node *mem, ir_entity *ent, x86_insn_size_t size)
 {
@@ -688,16 +690,17 @@ static void amd64_generate_code(FILE *output, const char *cup_name)
 }
 
 static const ir_settings_arch_dep_t amd64_arch_dep = {
-	.replace_muls         = true,
-	.replace_divs         = true,
-	.replace_mods         = true,
-	.allow_mulhs          = true,
-	.allow_mulhu          = true,
-	.also_use_subs        = true,
-	.maximum_shifts       = 4,
-	.highest_shift_amount = 63,
-	.evaluate             = NULL,
-	.max_bits_for_mulh    = 32,
+	.replace_muls           = true,
+	.replace_divs           = true,
+	.replace_mods           = true,
+	.allow_mulhs            = true,
+	.allow_mulhu            = true,
+	.also_use_subs          = true,
+	.replace_invariant_divs = true,
+	.maximum_shifts         = 4,
+	.highest_shift_amount   = 63,
+	.evaluate               = NULL,
+	.max_bits_for_mulh      = 32,
 };
 
 static void amd64_lower_for_target(void)
@@ -736,15 +739,16 @@ static void amd64_lower_for_target(void)
 	}
 
 	foreach_irp_irg(i, irg) {
-		/* Turn all small CopyBs into loads/stores, and turn all bigger
-		 * CopyBs into memcpy calls, because we cannot handle CopyB nodes
-		 * during code generation yet.
-		 * TODO:  Adapt this once custom CopyB handling is implemented. */
-		lower_CopyB(irg, 64, 65, true);
+		/* Turn small CopyBs and zero fills into SSE loads/stores, keep
+		 * medium-sized CopyBs for rep movs and turn the rest into memcpy
+		 * calls. */
+		lower_CopyB_wide(irg, 256, 8193, amd64_mode_xmm, true);
 		be_after_transform(irg, "lower-copyb");
+		lower_zero_fill(irg, 256, amd64_mode_xmm);
+		be_after_transform(irg, "lower-zero-fill");
 	}
 
-	ir_builtin_kind supported[6];
+	ir_builtin_kind supported[7];
 	size_t  s = 0;
 	supported[s++] = ir_bk_ffs;
 	supported[s++] = ir_bk_clz;
@@ -752,6 +756,7 @@ static void amd64_lower_for_target(void)
 	supported[s++] = ir_bk_compare_swap;
 	supported[s++] = ir_bk_saturating_increment;
 	supported[s++] = ir_bk_va_start;
+	supported[s++] = ir_bk_prefetch;
 
 	assert(s <= ARRAY_SIZE(supported));
 	lower_builtins(s, supported, amd64_lower_va_arg);
@@ -834,6 +839,7 @@ void be_init_arch_amd64(void)
 {
 	static const lc_opt_table_entry_t options[] = {
 		LC_OPT_ENT_BOOL("no-red-zone", "gcc compatibility",                &amd64_use_red_zone),
+		LC_OPT_ENT_BOOL("fast-strings", "use rep movsb for block copies", &amd64_use_fast_strings),
 		LC_OPT_LAST
 	};
 	lc_opt_entry_t *be_grp    = lc_opt_get_grp(firm_opt_get_root(), "be");
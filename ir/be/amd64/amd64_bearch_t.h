@@ -23,6 +23,8 @@ extern pmap *amd64_constants; /**< A map of entities that store const tarvals */
 extern ir_mode *amd64_mode_xmm;
 
 extern bool amd64_use_red_zone;
+/** Whether rep movsb is fast (ERMS) and used for medium sized copies. */
+extern bool amd64_use_fast_strings;
 
 #define AMD64_REGISTER_SIZE   8
 /** power of two stack alignment on calls */
@@ -693,7 +693,7 @@ static void emit_copyB_prolog(unsigned size)
 	if (size & 2)
 		amd64_emitf(NULL, "movsw");
 	if (size & 4)
-		amd64_emitf(NULL, "movsd");
+		amd64_emitf(NULL, "movsl");
 }
 
 /**
@@ -704,7 +704,7 @@ static void emit_amd64_copyB(const ir_node *node)
 	unsigned size = get_amd64_copyb_attr_const(node)->size;
 
 	emit_copyB_prolog(size);
-	amd64_emitf(node, "rep movsd");
+	amd64_emitf(node, "rep movsq");
 }
 
 /**
@@ -1747,7 +1747,10 @@ static ir_node *make_store_for_mode(ir_mode *const mode, dbg_info *const dbgi, i
 {
 	construct_binop_func               cons;
 	arch_register_req_t const **const *reqs;
-	if (!mode_is_float(mode)) {
+	if (mode == amd64_mode_xmm) {
+		cons = &new_bd_amd64_movdqu_store;
+		reqs = xmm_am_reqs;
+	} else if (!mode_is_float(mode)) {
 		cons = &new_bd_amd64_mov_store;
 		reqs = gp_am_reqs;
 	} else if (mode == x86_mode_E) {
@@ -2669,11 +2672,11 @@ ir_node *amd64_new_spill(ir_node *const value, ir_node *const after)
 	return store;
 }
 
-static ir_node *create_sse_spill(dbg_info *const dbgi, ir_node *const block,
-                                 int const arity, ir_node *const *const in,
-                                 arch_register_req_t const **const in_reqs,
-                                 x86_insn_size_t const size, amd64_op_mode_t const op_mode,
-                                 x86_addr_t const addr)
+static ir_node *create_movdqu(dbg_info *const dbgi, ir_node *const block,
+                              int const arity, ir_node *const *const in,
+                              arch_register_req_t const **const in_reqs,
+                              x86_insn_size_t const size, amd64_op_mode_t const op_mode,
+                              x86_addr_t const addr)
 {
 	(void)size; /* TODO */
 	return new_bd_amd64_movdqu(dbgi, block, arity, in, in_reqs, op_mode, addr);
@@ -2707,7 +2710,7 @@ ir_node *amd64_new_reload(ir_node *value, ir_node *spill, ir_node *before)
 		pn_res = pn_amd64_fld_res;
 	} else {
 		size   = X86_SIZE_128;
-		cons   = &create_sse_spill;
+		cons   = &create_movdqu;
 		pn_res = pn_amd64_movdqu_res;
 	}
 	ir_node *const load = cons(NULL, block, ARRAY_SIZE(in), in, reg_mem_reqs,
@@ -2742,6 +2745,7 @@ static ir_node *gen_Load(ir_node *const node)
 	assert((size_t)arity <= ARRAY_SIZE(in));
 
 	create_mov_func   const cons      =
+		mode == amd64_mode_xmm                                ? &create_movdqu         :
 		mode_is_float(mode)                                   ?
 			(mode == x86_mode_E ? new_bd_amd64_fld : &new_bd_amd64_movs_xmm) :
 		get_mode_size_bits(mode) < 64 && mode_is_signed(mode) ? &new_bd_amd64_movs     :
@@ -2807,6 +2811,13 @@ static ir_node *gen_Proj_Load(ir_node *const node)
 			return be_new_Proj(new_load, pn_amd64_movs_M);
 		}
 		break;
+	case iro_amd64_movdqu:
+		if (pn == pn_Load_res) {
+			return be_new_Proj(new_load, pn_amd64_movdqu_res);
+		} else if (pn == pn_Load_M) {
+			return be_new_Proj(new_load, pn_amd64_movdqu_M);
+		}
+		break;
 	case iro_amd64_fld:
 		if (pn == pn_Load_res) {
 			return be_new_Proj(new_load, pn_amd64_fld_res);
@@ -2837,6 +2848,32 @@ static ir_node *gen_Proj_Store(ir_node *const node)
 	}
 }
 
+/**
+ * Transforms a medium-sized CopyB into rep movsb if it is fast, otherwise
+ * into rep movsq with a prolog for the remaining bytes.
+ */
+static ir_node *gen_CopyB(ir_node *const node)
+{
+	dbg_info *const dbgi    = get_irn_dbg_info(node);
+	ir_node  *const block   = be_transform_nodes_block(node);
+	ir_node  *const new_dst = be_transform_node(get_CopyB_dst(node));
+	ir_node  *const new_src = be_transform_node(get_CopyB_src(node));
+	ir_node  *const new_mem = be_transform_node(get_CopyB_mem(node));
+	unsigned  const size    = get_type_size(get_CopyB_type(node));
+
+	if (amd64_use_fast_strings) {
+		ir_node *const count = make_const(dbgi, block, size);
+		ir_node *const copyb = new_bd_amd64_rep_movsb(dbgi, block, new_dst,
+		                                              new_src, count, new_mem);
+		return be_new_Proj(copyb, pn_amd64_rep_movsb_M);
+	}
+
+	ir_node *const count = make_const(dbgi, block, size / 8);
+	ir_node *const copyb = new_bd_amd64_copyB(dbgi, block, new_dst, new_src,
+	                                          count, new_mem, size);
+	return be_new_Proj(copyb, pn_amd64_copyB_M);
+}
+
 static ir_node *gen_Alloc(ir_node *const node)
 {
 	dbg_info *const dbgi      = get_irn_dbg_info(node);
@@ -3122,6 +3159,41 @@ static ir_node *gen_saturating_increment(ir_node *const node)
 	return sbb;
 }
 
+typedef ir_node* (*create_prefetch_func)(dbg_info *dbgi, ir_node *block,
+                                         int arity, ir_node *const *in,
+                                         arch_register_req_t const **in_reqs,
+                                         x86_addr_t addr);
+
+static ir_node *gen_prefetch(ir_node *const node)
+{
+	dbg_info *const dbgi  = get_irn_dbg_info(node);
+	ir_node  *const block = be_transform_nodes_block(node);
+	ir_node  *const ptr   = get_Builtin_param(node, 0);
+
+	int        arity = 0;
+	ir_node   *in[3];
+	x86_addr_t addr;
+	memset(&addr, 0, sizeof(addr));
+	perform_address_matching(ptr, &arity, in, &addr);
+
+	arch_register_req_t const **const reqs = gp_am_reqs[arity];
+	in[arity++] = be_transform_node(get_Builtin_mem(node));
+	assert((size_t)arity <= ARRAY_SIZE(in));
+
+	/* the write hint is ignored, prefetchw is not available everywhere */
+	size_t const n_params = get_Builtin_n_params(node);
+	long   const locality = n_params > 2
+		? get_Const_long(get_Builtin_param(node, 2)) : 3;
+	create_prefetch_func const cons =
+		locality == 0 ? &new_bd_amd64_prefetchnta :
+		locality == 1 ? &new_bd_amd64_prefetcht2  :
+		locality == 2 ? &new_bd_amd64_prefetcht1  :
+		/**/            &new_bd_amd64_prefetcht0;
+	ir_node *const new_node = cons(dbgi, block, arity, in, reqs, addr);
+	set_irn_pinned(new_node, get_irn_pinned(node));
+	return new_node;
+}
+
 static ir_node *gen_va_start(ir_node *const node)
 {
 	ir_graph *const irg   = get_irn_irg(node);
@@ -3150,6 +3222,8 @@ static ir_node *gen_Builtin(ir_node *const node)
 		return gen_saturating_increment(node);
 	case ir_bk_va_start:
 		return gen_va_start(node);
+	case ir_bk_prefetch:
+		return gen_prefetch(node);
 	default:
 		break;
 	}
@@ -3179,6 +3253,7 @@ static ir_node *gen_Proj_Builtin(ir_node *const proj)
 	case ir_bk_saturating_increment:
 		return be_new_Proj(new_node, pn_amd64_sbb_res);
 	case ir_bk_va_start:
+	case ir_bk_prefetch:
 		assert(get_Proj_num(proj) == pn_Builtin_M);
 		return new_node;
 	default:
@@ -3250,6 +3325,7 @@ static void amd64_register_transformers(void)
 	be_set_transform_function(op_Cmp,               gen_Cmp);
 	be_set_transform_function(op_Cond,              gen_Cond);
 	be_set_transform_function(op_Const,             gen_Const);
+	be_set_transform_function(op_CopyB,             gen_CopyB);
 	be_set_transform_function(op_Conv,              gen_Conv);
 	be_set_transform_function(op_Div,               gen_Div);
 	be_set_transform_function(op_Eor,               gen_Eor);
@@ -238,13 +238,14 @@ static void arm_lower_for_target(void)
 		be_after_transform(irg, "lower-copyb");
 	}
 	if (arm_cg_config.fpu == ARM_FPU_SOFTFLOAT) {
-		lower_floating_point();
+		lower_floating_point(arm_cg_config.variant >= ARM_VARIANT_5T);
 		be_after_irp_transform("lower-fp");
 	}
 
-	ir_builtin_kind supported[1];
+	ir_builtin_kind supported[2];
 	size_t s = 0;
 	supported[s++] = ir_bk_clz;
+	supported[s++] = ir_bk_prefetch;
 	assert(s <= ARRAY_SIZE(supported));
 	lower_builtins(s, supported, NULL);
 	be_after_irp_transform("lower-builtins");
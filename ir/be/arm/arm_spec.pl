@@ -474,6 +474,16 @@ Str => {
 	attr      => "ir_mode *ls_mode, ir_entity *entity, int entity_sign, long offset, bool is_frame_entity",
 },
 
+Pld => {
+	state     => "exc_pinned",
+	ins       => [ "ptr", "mem" ],
+	outs      => [ "M" ],
+	in_reqs   => [ "gp", "mem" ],
+	out_reqs  => [ "mem" ],
+	emit      => 'pld %A',
+	attr_type => "arm_load_store_attr_t",
+	attr      => "ir_mode *ls_mode, ir_entity *entity, int entity_sign, long offset, bool is_frame_entity",
+},
 
 Adf => { template => $binopf },
 
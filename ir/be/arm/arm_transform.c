@@ -1379,6 +1379,26 @@ static ir_node *gen_clz(ir_node *node)
 	return new_bd_arm_Clz(dbg, block, new_op);
 }
 
+/**
+ * Transform builtin prefetch.
+ */
+static ir_node *gen_prefetch(ir_node *node)
+{
+	ir_node *new_mem = be_transform_node(get_Builtin_mem(node));
+	/* pld is available since ARMv5TE */
+	if (arm_cg_config.variant < ARM_VARIANT_6)
+		return new_mem;
+
+	ir_node  *block = be_transform_nodes_block(node);
+	dbg_info *dbgi  = get_irn_dbg_info(node);
+	arm_am_t  am    = transform_am(get_Builtin_param(node, 0), mode_Bu, false);
+	ir_node  *pld   = new_bd_arm_Pld(dbgi, block, am.base, new_mem, mode_Bu,
+	                                 am.entity, 0, am.offset,
+	                                 am.is_frame_entity);
+	set_irn_pinned(pld, get_irn_pinned(node));
+	return pld;
+}
+
 /**
  * Transform Builtin node.
  */
@@ -1386,11 +1406,12 @@ static ir_node *gen_Builtin(ir_node *node)
 {
 	ir_builtin_kind kind = get_Builtin_kind(node);
 	switch (kind) {
+	case ir_bk_prefetch:
+		return gen_prefetch(node);
 	case ir_bk_trap:
 	case ir_bk_debugbreak:
 	case ir_bk_return_address:
 	case ir_bk_frame_address:
-	case ir_bk_prefetch:
 	case ir_bk_ffs:
 		break;
 	case ir_bk_clz:
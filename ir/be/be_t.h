@@ -36,6 +36,8 @@ struct be_options_t {
 	unsigned dump_flags;       /**< backend dumping flags */
 	bool timing;               /**< time the backend phases */
 	bool opt_profile_generate; /**< instrument code for profiling */
+	bool opt_profile_edges;    /**< profile with edge counters */
+	bool opt_profile_threads;  /**< thread-safe profile counters */
 	bool opt_profile_use;      /**< use existing profile data */
 	bool omit_fp;              /**< try to omit the frame pointer */
 	bool do_verify;            /**< backend verify option */
@@ -19,6 +19,7 @@
 #include "irdump_t.h"
 #include "irnodeset.h"
 
+#include "memacct.h"
 #include "statev_t.h"
 #include "be_t.h"
 #include "belive.h"
@@ -266,6 +267,7 @@ void be_liveness_compute_sets(be_lv_t *lv)
 	be_timer_push(T_LIVE);
 	ir_nodehashmap_init(&lv->map);
 	obstack_init(&lv->obst);
+	ir_obst_account(&lv->obst, "be_lv", lv->irg);
 
 	ir_graph *irg = lv->irg;
 	unsigned n = get_irg_last_idx(irg);
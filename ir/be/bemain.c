@@ -45,9 +45,11 @@
 #include "irverify.h"
 #include "lc_opts.h"
 #include "lc_opts_enum.h"
+#include "memacct.h"
 #include "obst.h"
 #include "statev.h"
 #include "target_t.h"
+#include "timing.h"
 #include "util.h"
 #include <stdio.h>
 
@@ -59,6 +61,8 @@ be_options_t be_options = {
 	.dump_flags           = DUMP_NONE,
 	.timing               = false,
 	.opt_profile_generate = false,
+	.opt_profile_edges    = false,
+	.opt_profile_threads  = false,
 	.opt_profile_use      = false,
 	.omit_fp              = false,
 	.do_verify            = true,
@@ -89,6 +93,8 @@ static const lc_opt_table_entry_t be_main_options[] = {
 	LC_OPT_ENT_BOOL     ("verify",     "verify the backend irg",                              &be_options.do_verify),
 	LC_OPT_ENT_BOOL     ("time",       "get backend timing statistics",                       &be_options.timing),
 	LC_OPT_ENT_BOOL     ("profilegenerate", "instrument the code for execution count profiling", &be_options.opt_profile_generate),
+	LC_OPT_ENT_BOOL     ("profileedges",    "profile with counters on control flow edges",       &be_options.opt_profile_edges),
+	LC_OPT_ENT_BOOL     ("profilethreads",  "use a copy of the profile counters per thread",     &be_options.opt_profile_threads),
 	LC_OPT_ENT_BOOL     ("profileuse",      "use existing profile data",                         &be_options.opt_profile_use),
 	LC_OPT_ENT_BOOL     ("verboseasm", "enable verbose assembler output",                        &be_options.verbose_asm),
 
@@ -267,6 +273,7 @@ static void initialize_birg(be_irg_t *birg, ir_graph *irg, be_main_env_t *env)
 	memset(birg, 0, sizeof(*birg));
 	birg->main_env = env;
 	obstack_init(&birg->obst);
+	ir_obst_account(&birg->obst, "be_irg", irg);
 	irg->be_data = birg;
 
 	be_info_init_irg(irg);
@@ -293,17 +300,24 @@ static ir_graph *be_prepare_profile(const char *const cup_name)
 		if (!res) {
 			be_warningf(NULL, "could not read profile data '%s'", prof_filename);
 		} else {
-			ir_create_execfreqs_from_profile();
-			ir_profile_free();
 			have_profile = true;
 		}
 	}
 
 	ir_graph *prof_init_irg = NULL;
-	if (be_options.opt_profile_generate)
-		prof_init_irg = ir_profile_instrument(prof_filename);
+	if (be_options.opt_profile_generate) {
+		ir_profile_set_thread_safe(be_options.opt_profile_threads);
+		prof_init_irg = be_options.opt_profile_edges
+			? ir_profile_instrument_edges(prof_filename)
+			: ir_profile_instrument(prof_filename);
+	}
 
-	if (!have_profile) {
+	/* edge profiling estimates execution frequencies, so they are set from
+	 * the profile only afterwards */
+	if (have_profile) {
+		ir_create_execfreqs_from_profile();
+		ir_profile_free();
+	} else {
 		be_timer_push(T_EXECFREQ);
 		foreach_irp_irg(i, irg) {
 			ir_estimate_execfreq(irg);
@@ -449,12 +463,14 @@ void be_after_irp_transform(const char *name)
 void be_lower_for_target(void)
 {
 	assert(ir_target.isa_initialized);
+	ir_trace_enter("be_lower_for_target", NULL);
 	ir_target.isa->lower_for_target();
 	/* set the phase to low */
 	foreach_irp_irg_r(i, irg) {
 		assert(!irg_is_constrained(irg, IR_GRAPH_CONSTRAINT_TARGET_LOWERED));
 		add_irg_constraints(irg, IR_GRAPH_CONSTRAINT_TARGET_LOWERED);
 	}
+	ir_trace_leave("be_lower_for_target");
 }
 
 static int cse_setting;
@@ -465,6 +481,7 @@ bool be_step_first(ir_graph *irg)
 	if (get_entity_linkage(entity) & IR_LINKAGE_NO_CODEGEN)
 		return false;
 
+	ir_trace_enter("backend", irg);
 	be_timer_push(T_OTHER);
 	if (stat_ev_enabled) {
 		stat_ev_ctx_push_fmt("bemain_irg", "%+F", irg);
@@ -483,7 +500,9 @@ void be_step_schedule(ir_graph *irg)
 	set_opt_cse(0);
 
 	be_timer_push(T_SCHED);
+	ir_trace_enter("be_schedule", irg);
 	be_schedule_graph(irg);
+	ir_trace_leave("be_schedule");
 	be_timer_pop(T_SCHED);
 	be_dump(DUMP_SCHED, irg, "sched");
 	be_sched_verify(irg);
@@ -499,7 +518,9 @@ void be_step_regalloc(ir_graph *irg, const regalloc_if_t *regif)
 	}
 
 	/* Do register allocation */
+	ir_trace_enter("be_regalloc", irg);
 	be_allocate_registers(irg, regif);
+	ir_trace_leave("be_regalloc");
 	be_regalloc_verify(irg);
 
 	if (stat_ev_enabled) {
@@ -547,6 +568,7 @@ void be_step_last(ir_graph *irg)
 	stat_ev_ctx_pop("bemain_irg");
 
 	set_opt_cse(cse_setting);
+	ir_trace_leave("backend");
 }
 
 void be_finish(void)
@@ -580,7 +602,9 @@ void be_finish(void)
 void be_main(FILE *file_handle, const char *cup_name)
 {
 	/* Let the target control how the codegeneration works. */
+	ir_trace_enter("be_main", NULL);
 	ir_target.isa->generate_code(file_handle, cup_name);
+	ir_trace_leave("be_main");
 }
 
 ir_jit_function_t *be_jit_compile(ir_jit_segment_t *const segment,
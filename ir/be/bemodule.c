@@ -59,6 +59,7 @@ void be_init_ssaconstr(void);
 void be_init_state(void);
 
 void be_quit_pbqp(void);
+void be_quit_pbqp_coloring(void);
 
 /**
  * Driver for module initialization.
@@ -122,6 +123,7 @@ void be_init_modules(void)
 
 void be_quit_modules(void)
 {
+	be_quit_pbqp_coloring();
 #ifdef FIRM_GRGEN_BE
 	be_quit_pbqp();
 #endif
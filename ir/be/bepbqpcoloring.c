@@ -38,8 +38,10 @@
 #include "belive.h"
 #include "pdeq.h"
 #include "pqueue.h"
+#include "statev_t.h"
 
 /* pbqp includes */
+#include "arena.h"
 #include "kaps.h"
 #include "matrix.h"
 #include "vector.h"
@@ -61,6 +63,10 @@
 static bool use_exec_freq     = true;
 static bool use_late_decision = false;
 
+/** Recycles the memory of the PBQP instances of all graphs and classes,
+ * created on first use and freed by be_quit_pbqp_coloring(). */
+static pbqp_arena_t *pbqp_arena;
+
 typedef struct be_pbqp_alloc_env_t {
 	pbqp_t                      *pbqp_inst;         /**< PBQP instance for register allocation */
 	ir_graph                    *irg;               /**< The graph under examination. */
@@ -187,7 +193,7 @@ static void insert_afe_edge(be_pbqp_alloc_env_t *pbqp_alloc_env, ir_node *src_no
 	const arch_register_class_t *cls         = pbqp_alloc_env->cls;
 	unsigned                    *restr_nodes = pbqp_alloc_env->restr_nodes;
 	unsigned                     colors_n    = cls->n_regs;
-	pbqp_matrix_t               *afe_matrix  = pbqp_matrix_alloc(pbqp, colors_n, colors_n);
+	pbqp_matrix_t               *afe_matrix;
 
 	if (get_edge(pbqp, get_irn_idx(src_node), get_irn_idx(trg_node)) == NULL) {
 		if (use_exec_freq) {
@@ -197,6 +203,7 @@ static void insert_afe_edge(be_pbqp_alloc_env_t *pbqp_alloc_env, ir_node *src_no
 			int      res     = get_block_execfreq_int(&pbqp_alloc_env->execfreq_factors, copy_bl);
 
 			/* create afe-matrix */
+			afe_matrix = pbqp_matrix_alloc(pbqp, colors_n, colors_n);
 			unsigned row, col;
 			for (row = 0; row < colors_n; row++) {
 				for (col = 0; col < colors_n; col++) {
@@ -210,6 +217,8 @@ static void insert_afe_edge(be_pbqp_alloc_env_t *pbqp_alloc_env, ir_node *src_no
 #if DO_USEFUL_OPT || USE_BIPARTITE_MATCHING
 		/* do useful optimization to speed up pbqp solving */
 		if (get_free_regs(restr_nodes, cls, src_node) == 1 && get_free_regs(restr_nodes, cls, trg_node) == 1) {
+			if (use_exec_freq)
+				pbqp_matrix_free(pbqp, afe_matrix);
 			return;
 		}
 		if (get_free_regs(restr_nodes, cls, src_node) == 1 || get_free_regs(restr_nodes, cls, trg_node) == 1) {
@@ -220,11 +229,16 @@ static void insert_afe_edge(be_pbqp_alloc_env_t *pbqp_alloc_env, ir_node *src_no
 				unsigned regIdx = vector_get_min_index(get_node(pbqp, get_irn_idx(trg_node))->costs);
 				vector_add_matrix_col(get_node(pbqp, get_irn_idx(src_node))->costs, afe_matrix, regIdx);
 			}
+			if (use_exec_freq)
+				pbqp_matrix_free(pbqp, afe_matrix);
 			return;
 		}
 #endif
-		/* insert interference edge */
-		insert_edge(pbqp, src_node, trg_node, afe_matrix);
+		/* insert affinity edge, the PBQP takes over a matrix of our own */
+		if (use_exec_freq)
+			add_edge_costs(pbqp, get_irn_idx(src_node), get_irn_idx(trg_node), afe_matrix);
+		else
+			insert_edge(pbqp, src_node, trg_node, afe_matrix);
 	}
 }
 
@@ -555,7 +569,9 @@ static void be_pbqp_coloring(be_chordal_env_t *env)
 	ir_calculate_execfreq_int_factors(&pbqp_alloc_env.execfreq_factors, irg);
 
 	/* initialize pbqp allocation data structure */
-	pbqp_alloc_env.pbqp_inst        = alloc_pbqp(get_irg_last_idx(irg));  /* initialize pbqp instance */
+	if (pbqp_arena == NULL)
+		pbqp_arena = pbqp_arena_new();
+	pbqp_alloc_env.pbqp_inst        = alloc_pbqp_in_arena(pbqp_arena, get_irg_last_idx(irg));  /* initialize pbqp instance */
 	pbqp_alloc_env.cls              = cls;
 	pbqp_alloc_env.irg              = irg;
 	pbqp_alloc_env.lv               = be_get_irg_liveness(irg);
@@ -671,6 +687,12 @@ static void be_pbqp_coloring(be_chordal_env_t *env)
 #if KAPS_DUMP
 	fclose(file_before);
 #endif
+	if (stat_ev_enabled) {
+		pbqp_t const *const pbqp = pbqp_alloc_env.pbqp_inst;
+		stat_ev_int("bepbqp_cost_allocs",   pbqp->num_allocs);
+		stat_ev_int("bepbqp_cost_recycled", pbqp->num_recycled);
+		stat_ev_int("bepbqp_arena_peak",    pbqp_arena->peak_bytes);
+	}
 	free_pbqp(pbqp_alloc_env.pbqp_inst);
 	deq_free(&pbqp_alloc_env.rpeo);
 	free(pbqp_alloc_env.restr_nodes);
@@ -697,3 +719,15 @@ void be_init_pbqp_coloring(void)
 	lc_opt_add_table(pbqp_grp, options);
 	be_register_chordal_coloring("pbqp", &coloring);
 }
+
+/**
+ * Frees the memory recycled for the PBQP instances.
+ */
+BE_REGISTER_MODULE_DESTRUCTOR(be_quit_pbqp_coloring)
+void be_quit_pbqp_coloring(void)
+{
+	if (pbqp_arena != NULL) {
+		pbqp_arena_free(pbqp_arena);
+		pbqp_arena = NULL;
+	}
+}
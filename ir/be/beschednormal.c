@@ -181,6 +181,12 @@ static void collect_roots(ir_node *irn, void *env)
 	}
 }
 
+static bool is_in_manual_reg(ir_node const *const node)
+{
+	arch_register_req_t const *const req = arch_get_irn_register_req(node);
+	return req->cls != NULL && req->cls->manual_ra;
+}
+
 static ir_node **sched_node(ir_node **sched, ir_node *irn)
 {
 	if (irn_visited_else_mark(irn))
@@ -190,16 +196,24 @@ static ir_node **sched_node(ir_node **sched, ir_node *irn)
 		ir_node       *block = get_nodes_block(irn);
 		flag_and_cost *fc    = get_irn_flag_and_cost(irn);
 		irn_cost_pair *irns  = fc->costs;
-
-		for (int i = 0, arity = get_irn_arity(irn); i < arity; ++i) {
-			ir_node *pred = irns[i].irn;
-			if (get_nodes_block(pred) != block)
-				continue;
-			if (get_irn_mode(pred) == mode_M)
-				continue;
-			if (is_Proj(pred))
-				pred = get_Proj_pred(pred);
-			sched = sched_node(sched, pred);
+		int const      arity = get_irn_arity(irn);
+
+		/* Operands in manually allocated registers (flags, carry) come last,
+		 * so nothing is scheduled between producer and consumer that might
+		 * clobber them and force a rematerialization. */
+		for (int manual = 0; manual < 2; ++manual) {
+			for (int i = 0; i < arity; ++i) {
+				ir_node *pred = irns[i].irn;
+				if (get_nodes_block(pred) != block)
+					continue;
+				if (get_irn_mode(pred) == mode_M)
+					continue;
+				if (is_in_manual_reg(pred) != (manual != 0))
+					continue;
+				if (is_Proj(pred))
+					pred = get_Proj_pred(pred);
+				sched = sched_node(sched, pred);
+			}
 		}
 	}
 
@@ -33,6 +33,7 @@
 #include "iropt_t.h"
 #include "irouts.h"
 #include "irtools.h"
+#include "memacct.h"
 #include "panic.h"
 #include "pdeq.h"
 #include "util.h"
@@ -322,6 +323,7 @@ void be_transform_graph(ir_graph *irg, arch_pretrans_nodes *func)
 	/* create a new obstack */
 	struct obstack old_obst = irg->obst;
 	obstack_init(&irg->obst);
+	ir_obst_account(&irg->obst, "irg", irg);
 	irg->last_node_idx = 0;
 
 	free_vrp_data(irg);
@@ -1583,7 +1583,7 @@ static void ia32_lower_for_target(void)
 
 	/* replace floating point operations by function calls */
 	if (ia32_cg_config.use_softfloat) {
-		lower_floating_point();
+		lower_floating_point(true);
 		be_after_irp_transform("lower-fp");
 	}
 
@@ -1634,6 +1634,8 @@ static void ia32_lower_for_target(void)
 		 * memcpy calls. */
 		lower_CopyB(irg, 64, 8193, true);
 		be_after_transform(irg, "lower-copyb");
+		lower_zero_fill(irg, 64, NULL);
+		be_after_transform(irg, "lower-zero-fill");
 	}
 }
 
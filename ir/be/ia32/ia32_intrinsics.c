@@ -13,6 +13,7 @@
 #include "begnuas.h"
 #include "constbits.h"
 #include "gen_ia32_regalloc_if.h"
+#include "ia32_architecture.h"
 #include "ia32_bearch_t.h"
 #include "ia32_new_nodes.h"
 #include "ircons_t.h"
@@ -345,6 +346,36 @@ static void ia32_lower_minus64(ir_node *const node)
 	ir_set_dw_lowered(node, l_res, h_res);
 }
 
+/**
+ * Chooses between the results of a 64bit shift for amounts below and above
+ * 32 with a cmov, or with a mask if cmov is not available.
+ */
+static ir_node *ia32_select_shift(dbg_info *const dbgi, ir_node *const block,
+                                  ir_node *const amount,
+                                  ir_node *const if_small,
+                                  ir_node *const if_big)
+{
+	if (!ia32_cg_config.use_cmov)
+		return ir_dw_select_by_mask(dbgi, block, amount, if_small, if_big);
+
+	ir_graph *const irg  = get_irn_irg(block);
+	ir_mode  *const mode = get_irn_mode(amount);
+	ir_node  *const c32  = new_r_Const_long(irg, mode, 32);
+	ir_node  *const bit  = new_rd_And(dbgi, block, amount, c32);
+	ir_node  *const zero = new_r_Const_null(irg, mode);
+	ir_node  *const cmp  = new_rd_Cmp(dbgi, block, bit, zero, ir_relation_equal);
+	return new_rd_Mux(dbgi, block, cmp, if_big, if_small);
+}
+
+/**
+ * lower 64bit shifts: shld/shrd and shl/shr/sar for amounts below 32, a
+ * single shift of the other word for larger amounts.
+ */
+static void ia32_lower_shift64(ir_node *const node)
+{
+	ir_lower_dw_shift_select(node, ia32_select_shift);
+}
+
 /**
  * lower 64bit conversions
  */
@@ -544,5 +575,8 @@ void ia32_lower64(void)
 	ir_register_dw_lower_function(op_Mul,   ia32_lower_mul64);
 	ir_register_dw_lower_function(op_Minus, ia32_lower_minus64);
 	ir_register_dw_lower_function(op_Conv,  ia32_lower_conv64);
+	ir_register_dw_lower_function(op_Shl,   ia32_lower_shift64);
+	ir_register_dw_lower_function(op_Shr,   ia32_lower_shift64);
+	ir_register_dw_lower_function(op_Shrs,  ia32_lower_shift64);
 	ir_lower_dw_ops();
 }
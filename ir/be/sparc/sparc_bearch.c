@@ -508,7 +508,7 @@ static void sparc_lower_for_target(void)
 	}
 
 	if (!sparc_cg_config.use_fpu) {
-		lower_floating_point();
+		lower_floating_point(false);
 		be_after_irp_transform("lower-fp");
 	}
 
@@ -78,6 +78,15 @@ static void lower64_minus(ir_node *const node)
 	ir_set_dw_lowered(node, res_low, subx);
 }
 
+/**
+ * lower 64bit shifts without branches, selecting the result for amounts
+ * above 32 with a mask.
+ */
+static void lower64_shift(ir_node *const node)
+{
+	ir_lower_dw_shift_select(node, ir_dw_select_by_mask);
+}
+
 void sparc_lower_64bit(void)
 {
 	ir_mode *word_unsigned = sparc_reg_classes[CLASS_sparc_gp].mode;
@@ -94,6 +103,9 @@ void sparc_lower_64bit(void)
 	ir_prepare_dw_lowering(&lower_dw_params);
 	ir_register_dw_lower_function(op_Add,   lower64_add);
 	ir_register_dw_lower_function(op_Minus, lower64_minus);
+	ir_register_dw_lower_function(op_Shl,   lower64_shift);
+	ir_register_dw_lower_function(op_Shr,   lower64_shift);
+	ir_register_dw_lower_function(op_Shrs,  lower64_shift);
 	ir_register_dw_lower_function(op_Sub,   lower64_sub);
 	ir_lower_dw_ops();
 }
@@ -31,6 +31,7 @@
 #include "irprog_t.h"
 #include "irtools.h"
 #include "lc_opts.h"
+#include "memacct.h"
 #include "opt_init.h"
 #include "target_t.h"
 #include "tv_t.h"
@@ -97,6 +98,7 @@ void ir_finish(void)
 	finish_mode();
 	finish_ident();
 	finish_target();
+	finish_mem_accounting();
 	initialized = false;
 }
 
@@ -0,0 +1,224 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Accounting of the memory of obstacks.
+ *
+ * Each accounted obstack points to a record, which is notified about every
+ * chunk the obstack allocates or frees.  Records are never freed before
+ * ir_finish(), because obstacks of graphs may still point to them after
+ * accounting ended; such records belong to an older generation and ignore
+ * their notifications.
+ */
+#include "memacct.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "array.h"
+#include "entity_t.h"
+#include "irgraph_t.h"
+#include "irprog_t.h"
+#include "obst.h"
+#include "statev_t.h"
+#include "timing.h"
+#include "util.h"
+
+typedef struct mem_account_t {
+	struct obstack_account account;    /**< notified by the obstack, must be
+	                                        first */
+	const char            *owner;      /**< kind of data on the obstack */
+	const char            *function;   /**< linker name of the graph, or NULL */
+	const char            *phase;      /**< phase the obstack was created in */
+	unsigned               generation; /**< accounting run of the record */
+	size_t                 live;       /**< bytes in chunks */
+	size_t                 peak;       /**< highest value of live */
+} mem_account_t;
+
+typedef struct mem_phase_t {
+	const char *name;
+	size_t      peak; /**< highest total of live bytes during the phase */
+} mem_phase_t;
+
+static bool            enabled;
+static unsigned        generation;
+static size_t          live;
+static size_t          peak;
+static struct obstack  accounts_obst;
+static bool            accounts_obst_initialized;
+static mem_account_t **accounts;
+static mem_phase_t    *phases;
+static size_t          n_phases;
+static size_t          phases_size;
+
+static void notify(struct obstack_account *const account, ptrdiff_t const size)
+{
+	mem_account_t *const acc = (mem_account_t*)account;
+	if (acc->generation != generation)
+		return;
+
+	acc->live += size;
+	acc->peak  = MAX(acc->peak, acc->live);
+	live      += size;
+	peak       = MAX(peak, live);
+	if (n_phases > 0) {
+		mem_phase_t *const phase = &phases[n_phases - 1];
+		phase->peak = MAX(phase->peak, live);
+	}
+}
+
+void ir_obst_account(struct obstack *const obst, const char *const owner,
+                     const ir_graph *const irg)
+{
+	if (!enabled)
+		return;
+
+	mem_account_t *const acc = OALLOCZ(&accounts_obst, mem_account_t);
+	ir_entity     *const ent = irg != NULL ? get_irg_entity(irg) : NULL;
+	acc->account.notify = notify;
+	acc->owner          = owner;
+	acc->function       = ent != NULL ? get_entity_ld_name(ent) : NULL;
+	acc->phase          = n_phases > 0 ? phases[n_phases - 1].name : NULL;
+	acc->generation     = generation;
+	ARR_APP1(mem_account_t*, accounts, acc);
+	obst->account = &acc->account;
+
+	/* account the chunks allocated so far */
+	notify(&acc->account, _obstack_memory_used(obst));
+}
+
+static void account_graph(ir_graph *const irg)
+{
+	ir_obst_account(&irg->obst, "irg", irg);
+	if (irg->out_obst_allocated)
+		ir_obst_account(&irg->out_obst, "irg_outs", irg);
+}
+
+void ir_mem_accounting_begin(void)
+{
+	ir_mem_accounting_end();
+	if (!accounts_obst_initialized) {
+		obstack_init(&accounts_obst);
+		accounts_obst_initialized = true;
+	}
+	accounts = NEW_ARR_F(mem_account_t*, 0);
+	enabled  = true;
+
+	account_graph(get_const_code_irg());
+	foreach_irp_irg(i, irg) {
+		account_graph(irg);
+	}
+}
+
+void ir_mem_accounting_end(void)
+{
+	if (!enabled)
+		return;
+	enabled = false;
+	++generation;
+	live     = 0;
+	peak     = 0;
+	n_phases = 0;
+	DEL_ARR_F(accounts);
+	accounts = NULL;
+}
+
+bool ir_mem_accounting_enabled(void)
+{
+	return enabled;
+}
+
+size_t ir_mem_live_bytes(void)
+{
+	return live;
+}
+
+size_t ir_mem_peak_bytes(void)
+{
+	return peak;
+}
+
+void mem_enter_phase(const char *const name)
+{
+	if (!enabled)
+		return;
+
+	if (n_phases == phases_size) {
+		phases_size = phases_size * 2 + 16;
+		phases      = XREALLOC(phases, mem_phase_t, phases_size);
+	}
+	mem_phase_t *const phase = &phases[n_phases++];
+	phase->name = name;
+	phase->peak = live;
+}
+
+size_t mem_leave_phase(const char *const name)
+{
+	/* phases entered before accounting began are not on the stack */
+	if (!enabled || n_phases == 0)
+		return 0;
+
+	mem_phase_t const *const phase = &phases[--n_phases];
+	assert(phase->name == name || strcmp(phase->name, name) == 0);
+	size_t const phase_peak = phase->peak;
+	if (n_phases > 0) {
+		mem_phase_t *const parent = &phases[n_phases - 1];
+		parent->peak = MAX(parent->peak, phase_peak);
+	}
+
+	if (stat_ev_enabled) {
+		stat_ev_ctx_push_str("obst_phase", name);
+		stat_ev_ull("obst_peak", phase_peak);
+		stat_ev_ull("obst_live", live);
+		stat_ev_ctx_pop("obst_phase");
+	}
+	return phase_peak;
+}
+
+static int cmp_account_peak(const void *const a, const void *const b)
+{
+	mem_account_t const *const acc_a = *(mem_account_t const**)a;
+	mem_account_t const *const acc_b = *(mem_account_t const**)b;
+	if (acc_a->peak != acc_b->peak)
+		return acc_a->peak < acc_b->peak ? 1 : -1;
+	return 0;
+}
+
+void ir_mem_accounting_dump(FILE *const out)
+{
+	if (!enabled)
+		return;
+
+	size_t          const n      = ARR_LEN(accounts);
+	mem_account_t **const sorted = XMALLOCN(mem_account_t*, n);
+	MEMCPY(sorted, accounts, n);
+	qsort(sorted, n, sizeof(*sorted), cmp_account_peak);
+
+	fprintf(out, "%-12s %-32s %-24s %12s %12s\n", "owner", "function",
+	        "phase", "peak", "live");
+	for (size_t i = 0; i < n; ++i) {
+		mem_account_t const *const acc = sorted[i];
+		fprintf(out, "%-12s %-32s %-24s %12zu %12zu\n", acc->owner,
+		        acc->function != NULL ? acc->function : "-",
+		        acc->phase != NULL ? acc->phase : "-", acc->peak, acc->live);
+	}
+	fprintf(out, "%-12s %-32s %-24s %12zu %12zu\n", "total", "", "", peak,
+	        live);
+	free(sorted);
+}
+
+void finish_mem_accounting(void)
+{
+	ir_mem_accounting_end();
+	if (accounts_obst_initialized) {
+		obstack_free(&accounts_obst, NULL);
+		accounts_obst_initialized = false;
+	}
+	free(phases);
+	phases      = NULL;
+	phases_size = 0;
+}
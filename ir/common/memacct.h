@@ -0,0 +1,44 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Accounting of the memory of obstacks.
+ */
+#ifndef FIRM_COMMON_MEMACCT_H
+#define FIRM_COMMON_MEMACCT_H
+
+#include <stddef.h>
+
+#include "firm_types.h"
+#include "obstack.h"
+
+/**
+ * Accounts the memory of @p obst to @p owner and the function of @p irg
+ * (which may be NULL) while obstack accounting is enabled.  Must be called
+ * again whenever the obstack is initialized anew.
+ *
+ * @param owner  a short name of the data on the obstack, which must stay
+ *               valid until ir_finish()
+ */
+void ir_obst_account(struct obstack *obst, const char *owner,
+                     const ir_graph *irg);
+
+/**
+ * Enters the phase @p name, which must stay valid until ir_finish().
+ * Called for each region of the compile-time trace.
+ */
+void mem_enter_phase(const char *name);
+
+/**
+ * Leaves the current phase and returns the highest number of bytes live in
+ * accounted obstacks during it, or 0 if accounting is disabled.
+ */
+size_t mem_leave_phase(const char *name);
+
+/** Frees all accounting records. */
+void finish_mem_accounting(void);
+
+#endif
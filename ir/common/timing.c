@@ -7,12 +7,18 @@
  * @file
  * @brief   platform neutral timing utilities
  */
+#include <assert.h>
 #include <stdio.h>
 #include <string.h>
 
 #include "timing.h"
 #include "xmalloc.h"
 #include "panic.h"
+#include "entity_t.h"
+#include "irgraph_t.h"
+#include "iroptimize.h"
+#include "irprog_t.h"
+#include "memacct.h"
 
 #ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
@@ -417,3 +423,271 @@ double ir_timer_elapsed_sec(const ir_timer_t *timer)
 	}
 	return _time_to_sec(elapsed);
 }
+
+/**
+ * A region of the compile-time trace.
+ */
+typedef struct trace_region_t {
+	const char    *name;      /**< name of the region */
+	const char    *function;  /**< linker name of the graph, or NULL */
+	unsigned long  begin;     /**< start in microseconds since the trace
+	                               began */
+	unsigned long  end;       /**< end in microseconds */
+	unsigned long  children;  /**< time spent in nested regions */
+	long           nodes;     /**< nodes created in the graph */
+	size_t         bytes;     /**< bytes allocated on the heap */
+	size_t         obst_live; /**< bytes in accounted obstacks at the end */
+	size_t         obst_peak; /**< highest bytes in accounted obstacks */
+	size_t         parent;    /**< index of the enclosing region */
+	bool           open;      /**< whether the region was not left yet */
+	bool           accounted; /**< whether obstacks were accounted */
+} trace_region_t;
+
+/**
+ * An open region of the trace.
+ */
+typedef struct trace_frame_t {
+	size_t    region;    /**< index of the region */
+	ir_graph *irg;       /**< graph of the region, or NULL */
+	unsigned  last_idx;  /**< last node index of the graph at the start */
+	size_t    allocated; /**< bytes allocated before the region */
+} trace_frame_t;
+
+#define NO_REGION ((size_t)-1)
+
+/* Nesting of regions, maintained even without a trace: the end of an
+ * outermost region is a pass boundary, where graphs may be compacted. */
+static unsigned  pass_depth;
+static ir_graph *pass_irg;
+
+static bool            trace_enabled;
+static ir_timer_val_t  trace_start;
+static trace_region_t *trace_regions;
+static size_t          trace_n_regions;
+static size_t          trace_regions_size;
+static trace_frame_t  *trace_stack;
+static size_t          trace_depth;
+static size_t          trace_stack_size;
+
+/** Returns the microseconds since the trace began. */
+static unsigned long trace_now(void)
+{
+	ir_timer_val_t now;
+	_time_get(&now);
+	return _time_to_usec(_time_sub(&now, &now, &trace_start));
+}
+
+void ir_trace_begin(void)
+{
+	ir_trace_end();
+	trace_enabled = true;
+	_time_reset(&trace_start);
+	_time_get(&trace_start);
+}
+
+void ir_trace_end(void)
+{
+	free(trace_regions);
+	free(trace_stack);
+	trace_regions      = NULL;
+	trace_n_regions    = 0;
+	trace_regions_size = 0;
+	trace_stack        = NULL;
+	trace_depth        = 0;
+	trace_stack_size   = 0;
+	trace_enabled      = false;
+}
+
+bool ir_trace_enabled(void)
+{
+	return trace_enabled;
+}
+
+void ir_trace_enter(const char *name, ir_graph *irg)
+{
+	if (pass_depth++ == 0)
+		pass_irg = irg;
+	mem_enter_phase(name);
+	if (!trace_enabled)
+		return;
+
+	if (trace_n_regions == trace_regions_size) {
+		trace_regions_size = trace_regions_size * 2 + 64;
+		trace_regions      = XREALLOC(trace_regions, trace_region_t, trace_regions_size);
+	}
+	if (trace_depth == trace_stack_size) {
+		trace_stack_size = trace_stack_size * 2 + 16;
+		trace_stack      = XREALLOC(trace_stack, trace_frame_t, trace_stack_size);
+	}
+
+	trace_region_t *const region = &trace_regions[trace_n_regions];
+	region->name      = name;
+	region->function  = irg != NULL ? get_entity_ld_name(get_irg_entity(irg)) : NULL;
+	region->children  = 0;
+	region->nodes     = 0;
+	region->bytes     = 0;
+	region->open      = true;
+	region->accounted = false;
+	region->parent    = trace_depth > 0 ? trace_stack[trace_depth - 1].region : NO_REGION;
+
+	trace_frame_t *const frame = &trace_stack[trace_depth++];
+	frame->region    = trace_n_regions++;
+	frame->irg       = irg;
+	frame->last_idx  = irg != NULL ? get_irg_last_idx(irg) : 0;
+	frame->allocated = xmalloc_bytes_allocated();
+	/* take the time last to exclude the bookkeeping */
+	region->begin    = trace_now();
+}
+
+/** Closes the current region of the trace. */
+static void trace_leave(const char *name, size_t const obst_peak)
+{
+	unsigned long  const end = trace_now();
+	/* regions entered before the trace began are not on the stack */
+	if (trace_depth == 0)
+		return;
+	trace_frame_t *const frame  = &trace_stack[--trace_depth];
+	trace_region_t *const region = &trace_regions[frame->region];
+	assert(strcmp(region->name, name) == 0);
+	(void)name;
+
+	region->end   = end;
+	region->open  = false;
+	region->nodes = frame->irg != NULL ? (long)get_irg_last_idx(frame->irg) - (long)frame->last_idx : 0;
+	region->bytes = xmalloc_bytes_allocated() - frame->allocated;
+	if (ir_mem_accounting_enabled()) {
+		region->accounted = true;
+		region->obst_live = ir_mem_live_bytes();
+		region->obst_peak = obst_peak;
+	}
+	if (region->parent != NO_REGION)
+		trace_regions[region->parent].children += end - region->begin;
+}
+
+/** Compacts the graphs of the finished outermost region if worthwhile. */
+static void pass_boundary(void)
+{
+	ir_graph *const pass = pass_irg;
+	pass_irg = NULL;
+	if (pass != NULL) {
+		compact_irg_if_sparse(pass);
+	} else {
+		foreach_irp_irg(i, irg) {
+			compact_irg_if_sparse(irg);
+		}
+	}
+}
+
+void ir_trace_leave(const char *name)
+{
+	size_t const obst_peak = mem_leave_phase(name);
+	if (trace_enabled)
+		trace_leave(name, obst_peak);
+	assert(pass_depth > 0);
+	if (--pass_depth == 0)
+		pass_boundary();
+}
+
+/** Writes @p str as a JSON string. */
+static void write_json_string(FILE *const out, const char *str)
+{
+	putc('"', out);
+	for (; *str != '\0'; ++str) {
+		unsigned char const c = *str;
+		if (c == '"' || c == '\\')
+			fprintf(out, "\\%c", c);
+		else if (c < 0x20)
+			fprintf(out, "\\u%04x", c);
+		else
+			putc(c, out);
+	}
+	putc('"', out);
+}
+
+/** Returns the end of @p region, @p now if it is still open. */
+static unsigned long get_region_end(trace_region_t const *const region, unsigned long const now)
+{
+	return region->open ? now : region->end;
+}
+
+bool ir_trace_write_chrome(const char *filename)
+{
+	FILE *const out = fopen(filename, "w");
+	if (out == NULL)
+		return false;
+
+	unsigned long const now = trace_now();
+	fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", out);
+	for (size_t i = 0; i < trace_n_regions; ++i) {
+		trace_region_t const *const region = &trace_regions[i];
+		unsigned long         const end    = get_region_end(region, now);
+		fputs(i > 0 ? ",\n{\"name\":" : "\n{\"name\":", out);
+		write_json_string(out, region->name);
+		fprintf(out, ",\"cat\":\"firm\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%lu,\"dur\":%lu,\"args\":{",
+		        region->begin, end - region->begin);
+		if (region->function != NULL) {
+			fputs("\"function\":", out);
+			write_json_string(out, region->function);
+			putc(',', out);
+		}
+		fprintf(out, "\"nodes\":%ld,\"bytes\":%lu", region->nodes,
+		        (unsigned long)region->bytes);
+		if (!region->accounted) {
+			fputs("}}", out);
+			continue;
+		}
+		fprintf(out, ",\"obst_live\":%lu,\"obst_peak\":%lu}},\n"
+		        "{\"name\":\"obstacks\",\"ph\":\"C\",\"pid\":1,\"tid\":1,\"ts\":%lu,\"args\":{\"live\":%lu}}",
+		        (unsigned long)region->obst_live,
+		        (unsigned long)region->obst_peak, end,
+		        (unsigned long)region->obst_live);
+	}
+	fputs("\n]}\n", out);
+	return fclose(out) == 0;
+}
+
+/** Writes a frame of a folded stack, which must not contain a ';'. */
+static void write_frame(FILE *const out, const char *frame)
+{
+	for (; *frame != '\0'; ++frame)
+		putc(*frame == ';' ? '_' : *frame, out);
+}
+
+/**
+ * Writes the frames of the stack of @p index and returns the function of
+ * its graph, or NULL.
+ */
+static const char *write_stack(FILE *const out, size_t const index)
+{
+	trace_region_t const *const region   = &trace_regions[index];
+	const char                 *function = NULL;
+	if (region->parent != NO_REGION) {
+		function = write_stack(out, region->parent);
+		putc(';', out);
+	}
+	if (region->function != NULL && (function == NULL || strcmp(function, region->function) != 0)) {
+		function = region->function;
+		write_frame(out, function);
+		putc(';', out);
+	}
+	write_frame(out, region->name);
+	return function;
+}
+
+bool ir_trace_write_folded(const char *filename)
+{
+	FILE *const out = fopen(filename, "w");
+	if (out == NULL)
+		return false;
+
+	unsigned long const now = trace_now();
+	for (size_t i = 0; i < trace_n_regions; ++i) {
+		trace_region_t const *const region = &trace_regions[i];
+		unsigned long         const time   = get_region_end(region, now) - region->begin;
+		if (time <= region->children)
+			continue;
+		write_stack(out, i);
+		fprintf(out, " %lu\n", time - region->children);
+	}
+	return fclose(out) == 0;
+}
@@ -15,6 +15,7 @@
  */
 #include "irarch.h"
 
+#include "array.h"
 #include "dbginfo_t.h"
 #include "ircons.h"
 #include "ircons_t.h"
@@ -23,28 +24,26 @@
 #include "irgmod.h"
 #include "irgopt.h"
 #include "irgraph_t.h"
+#include "irgwalk.h"
 #include "irhooks.h"
+#include "irloop_t.h"
 #include "irmode_t.h"
 #include "irnode_t.h"
 #include "iropt_dbg.h"
 #include "iropt_t.h"
 #include "irprog_t.h"
 #include "irverify.h"
+#include "obst.h"
 #include "panic.h"
+#include "pmap.h"
+#include "target_t.h"
 #include "tv_t.h"
+#include "typerep.h"
 #include <assert.h>
 #include <stdlib.h>
 
 static ir_settings_arch_dep_t settings;
 
-void ir_arch_lower(ir_settings_arch_dep_t const *const new_settings)
-{
-	settings = *new_settings;
-	foreach_irp_irg(i, irg) {
-		optimize_graph_df(irg);
-	}
-}
-
 /** check, whether a mode allows a Mulh instruction. */
 static bool allow_Mulh(ir_mode *mode)
 {
@@ -1051,3 +1050,367 @@ ir_node *arch_dep_replace_mod_by_const(ir_node *irn)
 
 	return res;
 }
+
+/** The single edge entering a loop. */
+typedef struct loop_entry_t {
+	ir_node *header;    /**< the loop header, NULL if the loop has several
+	                         entries */
+	int      entry_pos; /**< the header predecessor entering the loop */
+	ir_node *preheader; /**< block in front of the header or NULL */
+} loop_entry_t;
+
+/** The reciprocal of a divisor, computed in front of a loop. */
+typedef struct reciprocal_t {
+	ir_loop *loop;       /**< the loop */
+	ir_node *divisor;    /**< the loop-invariant divisor */
+	ir_node *multiplier; /**< the magic multiplier */
+	ir_node *shift1;     /**< unsigned: pre shift, signed: post shift */
+	ir_node *shift2;     /**< unsigned: post shift */
+	ir_node *sign;       /**< signed: sign mask of the divisor */
+} reciprocal_t;
+
+typedef struct invariant_div_env_t {
+	struct obstack obst;
+	pmap          *entries;     /**< maps loops to their loop_entry_t */
+	reciprocal_t  *reciprocals; /**< the reciprocals computed so far */
+	ir_node      **divs;        /**< Divs and Mods by loop-invariant values */
+} invariant_div_env_t;
+
+static void collect_loop_blocks(ir_node ***const blocks, ir_loop *const loop)
+{
+	size_t const n_elements = get_loop_n_elements(loop);
+	for (size_t i = 0; i < n_elements; ++i) {
+		loop_element const element = get_loop_element(loop, i);
+		if (*element.kind == k_ir_node) {
+			ARR_APP1(ir_node*, *blocks, element.node);
+		} else if (*element.kind == k_ir_loop) {
+			collect_loop_blocks(blocks, element.son);
+		}
+	}
+}
+
+/**
+ * Returns the entry of @p loop.  The header of the entry is NULL if the
+ * loop has more than one entry.
+ */
+static loop_entry_t *get_loop_entry(invariant_div_env_t *const env,
+                                    ir_loop *const loop)
+{
+	loop_entry_t *entry = pmap_get(loop_entry_t, env->entries, loop);
+	if (entry != NULL)
+		return entry;
+
+	entry = OALLOCZ(&env->obst, loop_entry_t);
+	pmap_insert(env->entries, loop, entry);
+
+	ir_node **blocks = NEW_ARR_F(ir_node*, 0);
+	collect_loop_blocks(&blocks, loop);
+	for (size_t b = 0, n = ARR_LEN(blocks); b < n; ++b) {
+		ir_node *const block = blocks[b];
+		for (int i = 0, arity = get_Block_n_cfgpreds(block); i < arity; ++i) {
+			ir_node *const pred = get_Block_cfgpred_block(block, i);
+			if (pred == NULL)
+				goto several_entries;
+			ir_loop *pred_loop = get_irn_loop(pred);
+			while (pred_loop != NULL && pred_loop != loop
+			       && get_loop_depth(pred_loop) > get_loop_depth(loop))
+				pred_loop = get_loop_outer_loop(pred_loop);
+			if (pred_loop == loop)
+				continue;
+			if (entry->header != NULL)
+				goto several_entries;
+			entry->header    = block;
+			entry->entry_pos = i;
+		}
+	}
+	DEL_ARR_F(blocks);
+	return entry;
+
+several_entries:
+	entry->header = NULL;
+	DEL_ARR_F(blocks);
+	return entry;
+}
+
+static ir_node *get_preheader(loop_entry_t *const entry)
+{
+	if (entry->preheader == NULL) {
+		ir_node  *const header = entry->header;
+		ir_graph *const irg    = get_irn_irg(header);
+		ir_node  *const jmp    = get_Block_cfgpred(header, entry->entry_pos);
+		ir_node  *const pred   = get_nodes_block(jmp);
+		ir_node  *const block  = new_r_Block(irg, 1, &jmp);
+		set_Block_cfgpred(header, entry->entry_pos, new_r_Jmp(block));
+
+		set_irn_loop(block, get_irn_loop(pred));
+		entry->preheader = block;
+	}
+	return entry->preheader;
+}
+
+/**
+ * Returns the outermost loop around @p block in which @p divisor is
+ * invariant and which has a single entry, or NULL if there is none.
+ */
+static ir_loop *find_invariant_loop(invariant_div_env_t *const env,
+                                    ir_node *const block,
+                                    ir_node *const divisor)
+{
+	ir_loop *res = NULL;
+	for (ir_loop *loop = get_irn_loop(block); get_loop_depth(loop) > 0;
+	     loop = get_loop_outer_loop(loop)) {
+		loop_entry_t const *const entry = get_loop_entry(env, loop);
+		if (entry->header == NULL
+		    || !is_loop_invariant(divisor, entry->header))
+			break;
+		res = loop;
+	}
+	return res;
+}
+
+/**
+ * Post-walker: collects Divs and Mods inside loops whose divisor is
+ * loop-invariant.
+ */
+static void collect_invariant_divs(ir_node *const node, void *const data)
+{
+	ir_node *left;
+	ir_node *right;
+	if (is_Div(node)) {
+		left  = get_Div_left(node);
+		right = get_Div_right(node);
+	} else if (is_Mod(node)) {
+		left  = get_Mod_left(node);
+		right = get_Mod_right(node);
+	} else {
+		return;
+	}
+
+	/* The reciprocal is computed with a division of twice the width, which
+	 * must fit a register. */
+	ir_mode *const mode = get_irn_mode(left);
+	if (!mode_is_int(mode) || !allow_Mulh(mode)
+	    || get_mode_size_bits(mode) * 2 != ir_target_pointer_size() * 8)
+		return;
+	if (is_Const(right) || ir_throws_exception(node))
+		return;
+
+	invariant_div_env_t *const env = (invariant_div_env_t*)data;
+	if (find_invariant_loop(env, get_nodes_block(node), right) != NULL)
+		ARR_APP1(ir_node*, env->divs, node);
+}
+
+/** Returns floor(log2(@p x)) for a non-zero @p x. */
+static ir_node *new_floor_log2(dbg_info *const dbgi, ir_node *const block,
+                               ir_node *const x)
+{
+	ir_graph *const irg  = get_irn_irg(block);
+	ir_mode  *const mode = get_irn_mode(x);
+	ir_type  *const type = new_type_method(1, 1, false, cc_cdecl_set,
+	                                       mtp_no_property);
+	set_method_param_type(type, 0, get_type_for_mode(mode));
+	set_method_res_type(type, 0, get_type_for_mode(mode_Iu));
+
+	ir_node *const in[]   = { x };
+	ir_node *const no_mem = new_r_NoMem(irg);
+	ir_node *const clz    = new_rd_Builtin(dbgi, block, no_mem, ARRAY_SIZE(in),
+	                                       in, ir_bk_clz, type);
+	ir_node *const zeros  = new_r_Proj(clz, mode_Iu, pn_Builtin_max + 1);
+	ir_node *const top    = new_r_Const_long(irg, mode_Iu,
+	                                         get_mode_size_bits(mode) - 1);
+	return new_rd_Sub(dbgi, block, top, zeros);
+}
+
+/**
+ * Computes the reciprocal of the divisor @p rcp->divisor of mode @p mode in
+ * @p block, following Granlund and Montgomery, "Division by Invariant
+ * Integers using Multiplication".  The computation is branch-free and cannot
+ * trap; a zero divisor is treated like 1.
+ */
+static void compute_reciprocal(reciprocal_t *const rcp, ir_mode *const mode,
+                               ir_node *const block)
+{
+	ir_graph *const irg     = get_irn_irg(block);
+	dbg_info *const dbgi    = get_irn_dbg_info(rcp->divisor);
+	ir_mode  *const umode   = find_unsigned_mode(mode);
+	ir_mode  *const wmode   = find_double_bits_int_mode(umode);
+	unsigned  const bits    = get_mode_size_bits(mode);
+	ir_node  *const one     = new_r_Const_one(irg, wmode);
+	ir_node  *const top_bit = new_r_Const_long(irg, mode_Iu, 2 * bits - 1);
+
+	ir_node *d;
+	if (mode_is_signed(mode)) {
+		/* |d| */
+		ir_mode *const swmode = find_signed_mode(wmode);
+		ir_node *const sd     = new_rd_Conv(dbgi, block, rcp->divisor, swmode);
+		ir_node *const sign   = new_rd_Shrs(dbgi, block, sd, top_bit);
+		ir_node *const flip   = new_rd_Eor(dbgi, block, sd, sign);
+		ir_node *const abs    = new_rd_Sub(dbgi, block, flip, sign);
+		d = new_rd_Conv(dbgi, block, abs, wmode);
+	} else {
+		d = new_rd_Conv(dbgi, block, rcp->divisor, wmode);
+	}
+
+	/* d | (d == 0) */
+	ir_node *const not_d   = new_rd_Not(dbgi, block, d);
+	ir_node *const d_dec   = new_rd_Sub(dbgi, block, d, one);
+	ir_node *const is_zero = new_rd_And(dbgi, block, not_d, d_dec);
+	ir_node *const zero_1  = new_rd_Shr(dbgi, block, is_zero, top_bit);
+	d = new_rd_Or(dbgi, block, d, zero_1);
+
+	/* l = ceil(log2(d)) = floor(log2(2 * (d - 1) | 1)), at least 1 if
+	 * signed */
+	ir_node *const dec    = new_rd_Sub(dbgi, block, d, one);
+	ir_node *const dec2   = new_rd_Shl(dbgi, block, dec,
+	                                   new_r_Const_one(irg, mode_Iu));
+	ir_node *const min    = new_r_Const_long(irg, wmode,
+	                                         mode_is_signed(mode) ? 2 : 1);
+	ir_node *const l      = new_floor_log2(dbgi, block,
+	                                       new_rd_Or(dbgi, block, dec2, min));
+	ir_node *const no_mem = new_r_NoMem(irg);
+	ir_node *const n_bits = new_r_Const_long(irg, mode_Iu, bits);
+
+	ir_node *dividend;
+	if (mode_is_signed(mode)) {
+		/* m = 2^(N+l-1) / d + 1 - 2^N, the post shift is l-1 */
+		ir_node *const n_dec = new_r_Const_long(irg, mode_Iu, bits - 1);
+		ir_node *const shift = new_rd_Add(dbgi, block, l, n_dec);
+		dividend = new_rd_Shl(dbgi, block, one, shift);
+
+		ir_node *const one_u = new_r_Const_one(irg, mode_Iu);
+		rcp->shift1 = new_rd_Sub(dbgi, block, l, one_u);
+		rcp->sign   = new_rd_Shrs(dbgi, block, rcp->divisor, n_dec);
+	} else {
+		/* m = 2^N * (2^l - d) / d + 1, the shifts are min(l, 1) and
+		 * max(l-1, 0) */
+		ir_node *const pow   = new_rd_Shl(dbgi, block, one, l);
+		ir_node *const diff  = new_rd_Sub(dbgi, block, pow, d);
+		dividend = new_rd_Shl(dbgi, block, diff, n_bits);
+
+		ir_node *const zero  = new_r_Const_null(irg, mode_Iu);
+		ir_node *const neg_l = new_rd_Sub(dbgi, block, zero, l);
+		ir_node *const sign  = new_r_Const_long(irg, mode_Iu,
+		                                        get_mode_size_bits(mode_Iu) - 1);
+		rcp->shift1 = new_rd_Shr(dbgi, block, neg_l, sign);
+		rcp->shift2 = new_rd_Sub(dbgi, block, l, rcp->shift1);
+	}
+
+	ir_node *const div  = new_rd_Div(dbgi, block, no_mem, dividend, d, false);
+	ir_node *const quot = new_r_Proj(div, wmode, pn_Div_res);
+	ir_node *const m    = new_rd_Add(dbgi, block, quot, one);
+	rcp->multiplier = new_rd_Conv(dbgi, block, m, mode);
+}
+
+static reciprocal_t const *get_reciprocal(invariant_div_env_t *const env,
+                                          ir_loop *const loop,
+                                          ir_node *const divisor)
+{
+	for (size_t i = 0, n = ARR_LEN(env->reciprocals); i < n; ++i) {
+		reciprocal_t const *const rcp = &env->reciprocals[i];
+		if (rcp->loop == loop && rcp->divisor == divisor)
+			return rcp;
+	}
+
+	reciprocal_t rcp = { .loop = loop, .divisor = divisor };
+	ir_node *const block = get_preheader(get_loop_entry(env, loop));
+	compute_reciprocal(&rcp, get_irn_mode(divisor), block);
+	ARR_APP1(reciprocal_t, env->reciprocals, rcp);
+	return &env->reciprocals[ARR_LEN(env->reciprocals) - 1];
+}
+
+/** Computes @p n divided by the divisor of @p rcp in @p block. */
+static ir_node *divide_by_reciprocal(reciprocal_t const *const rcp,
+                                     dbg_info *const dbgi,
+                                     ir_node *const block, ir_node *const n)
+{
+	ir_node *const hi = new_rd_Mulh(dbgi, block, n, rcp->multiplier);
+	ir_mode *const mode = get_irn_mode(n);
+	if (mode_is_signed(mode)) {
+		/* q = ((((n + hi) >> (l-1)) - (n >> (N-1))) ^ sign) - sign */
+		ir_graph *const irg   = get_irn_irg(block);
+		ir_node  *const n_dec = new_r_Const_long(irg, mode_Iu,
+		                                         get_mode_size_bits(mode) - 1);
+		ir_node  *const sum   = new_rd_Add(dbgi, block, n, hi);
+		ir_node  *const shr   = new_rd_Shrs(dbgi, block, sum, rcp->shift1);
+		ir_node  *const n_neg = new_rd_Shrs(dbgi, block, n, n_dec);
+		ir_node  *const q     = new_rd_Sub(dbgi, block, shr, n_neg);
+		ir_node  *const flip  = new_rd_Eor(dbgi, block, q, rcp->sign);
+		return new_rd_Sub(dbgi, block, flip, rcp->sign);
+	} else {
+		/* q = (hi + ((n - hi) >> shift1)) >> shift2 */
+		ir_node *const diff = new_rd_Sub(dbgi, block, n, hi);
+		ir_node *const half = new_rd_Shr(dbgi, block, diff, rcp->shift1);
+		ir_node *const sum  = new_rd_Add(dbgi, block, hi, half);
+		return new_rd_Shr(dbgi, block, sum, rcp->shift2);
+	}
+}
+
+static void replace_invariant_div(invariant_div_env_t *const env,
+                                  ir_node *const node)
+{
+	ir_node  *const block = get_nodes_block(node);
+	dbg_info *const dbgi  = get_irn_dbg_info(node);
+	bool      const is_div = is_Div(node);
+	ir_node  *const mem   = is_div ? get_Div_mem(node) : get_Mod_mem(node);
+	ir_node  *const left  = is_div ? get_Div_left(node) : get_Mod_left(node);
+	ir_node  *const right = is_div ? get_Div_right(node) : get_Mod_right(node);
+
+	ir_loop *const loop = find_invariant_loop(env, block, right);
+	reciprocal_t const *const rcp = get_reciprocal(env, loop, right);
+
+	ir_node *res = divide_by_reciprocal(rcp, dbgi, block, left);
+	if (!is_div) {
+		ir_node *const mul = new_rd_Mul(dbgi, block, res, right);
+		res = new_rd_Sub(dbgi, block, left, mul);
+	}
+
+	ir_graph *const irg = get_irn_irg(node);
+	ir_node  *const bad = new_r_Bad(irg, mode_X);
+	ir_node  *const in[] = {
+		[pn_Div_M]         = mem,
+		[pn_Div_res]       = res,
+		[pn_Div_X_regular] = bad,
+		[pn_Div_X_except]  = bad,
+	};
+	turn_into_tuple(node, ARRAY_SIZE(in), in);
+}
+
+/**
+ * Replaces Divs and Mods by loop-invariant divisors with a multiplication by
+ * a reciprocal, which is computed once in front of the outermost loop in
+ * which the divisor is invariant.
+ */
+static void replace_invariant_divs(ir_graph *const irg)
+{
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_NO_UNREACHABLE_CODE
+		| IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO);
+
+	invariant_div_env_t env;
+	obstack_init(&env.obst);
+	env.entries     = pmap_create();
+	env.reciprocals = NEW_ARR_F(reciprocal_t, 0);
+	env.divs        = NEW_ARR_F(ir_node*, 0);
+	irg_walk_graph(irg, NULL, collect_invariant_divs, &env);
+
+	size_t const n_divs = ARR_LEN(env.divs);
+	for (size_t i = 0; i < n_divs; ++i)
+		replace_invariant_div(&env, env.divs[i]);
+
+	DEL_ARR_F(env.divs);
+	DEL_ARR_F(env.reciprocals);
+	pmap_destroy(env.entries);
+	obstack_free(&env.obst, NULL);
+
+	confirm_irg_properties(irg, n_divs > 0 ? IR_GRAPH_PROPERTIES_NONE
+	                                       : IR_GRAPH_PROPERTIES_ALL);
+}
+
+void ir_arch_lower(ir_settings_arch_dep_t const *const new_settings)
+{
+	settings = *new_settings;
+	foreach_irp_irg(i, irg) {
+		if (settings.replace_invariant_divs)
+			replace_invariant_divs(irg);
+		optimize_graph_df(irg);
+	}
+}
@@ -49,6 +49,7 @@ typedef struct ir_settings_arch_dep_t {
 	bool allow_mulhs   : 1;  /**< Use Mulhs for division by constant */
 	bool allow_mulhu   : 1;  /**< Use Mulhu for division by constant */
 	bool also_use_subs : 1;  /**< Use Subs when resolving Muls to shifts */
+	bool replace_invariant_divs : 1; /**< Use Mulh for division by loop-invariant values */
 	unsigned maximum_shifts;       /**< The maximum number of shifts that shall be inserted for a mul. */
 	unsigned highest_shift_amount; /**< The highest shift amount you want to
 	                                    tolerate. Muls which would require a higher
@@ -11,6 +11,7 @@
 #include "irgraph_t.h"
 
 #include "array.h"
+#include "cgana.h"
 #include "irbackedge_t.h"
 #include "ircons_t.h"
 #include "iredges_t.h"
@@ -19,6 +20,7 @@
 #include "irgopt.h"
 #include "irgwalk.h"
 #include "irhooks.h"
+#include "irloop.h"
 #include "irmemory.h"
 #include "irnode_t.h"
 #include "iropt_t.h"
@@ -26,8 +28,10 @@
 #include "irouts.h"
 #include "irprog_t.h"
 #include "irtools.h"
+#include "memacct.h"
 #include "type_t.h"
 #include "util.h"
+#include "vrp.h"
 #include "xmalloc.h"
 
 #define INITIAL_IDX_IRN_MAP_SIZE 1024
@@ -114,6 +118,7 @@ static ir_graph *new_r_ir_graph(ir_entity *ent, int n_loc)
 	res->ent = ent;
 	if (ent)
 		set_entity_irg(ent, res);
+	ir_obst_account(&res->obst, "irg", res);
 
 	/*--  a class type so that it can contain "inner" methods as in Pascal. --*/
 	res->frame_type = new_type_frame();
@@ -234,6 +239,7 @@ static ir_node *get_new_node(const ir_node *old_node)
 ir_graph *create_irg_copy(ir_graph *irg)
 {
 	ir_graph *res = alloc_graph();
+	ir_obst_account(&res->obst, "irg", irg);
 
 	res->irg_pinned_state = irg->irg_pinned_state;
 
@@ -267,6 +273,167 @@ ir_graph *create_irg_copy(ir_graph *irg)
 	return res;
 }
 
+/** Properties which do not depend on analysis information of the nodes. */
+#define SNAPSHOT_PROPERTIES \
+	( IR_GRAPH_PROPERTY_NO_CRITICAL_EDGES \
+	| IR_GRAPH_PROPERTY_NO_BADS \
+	| IR_GRAPH_PROPERTY_NO_TUPLES \
+	| IR_GRAPH_PROPERTY_NO_UNREACHABLE_CODE \
+	| IR_GRAPH_PROPERTY_ONE_RETURN \
+	| IR_GRAPH_PROPERTY_MANY_RETURNS)
+
+struct ir_graph_snapshot {
+	ir_graph              *irg;
+	struct obstack         obst;          /**< holds the saved nodes */
+	ir_node              **idx_irn_map;   /**< saved nodes by node index */
+	ir_node               *anchor;
+	unsigned               last_node_idx;
+	unsigned               n_nodes;       /**< number of saved nodes */
+	ir_graph_properties_t  properties;
+	ir_graph_constraints_t constraints;
+	op_pin_state           pinned_state;
+};
+
+static void count_reachable(ir_node *node, void *env)
+{
+	(void)node;
+	++*(unsigned*)env;
+}
+
+/**
+ * Copies @p node to the obstack of its graph, which holds the obstack of the
+ * snapshot meanwhile.  The inputs still refer to the original nodes.
+ */
+static ir_node *save_node(ir_graph *irg, ir_node const *node)
+{
+	struct obstack *const obst = get_irg_obstack(irg);
+	ir_op          *const op   = get_irn_op(node);
+	size_t          const size = offsetof(ir_node, attr) + op->attr_size;
+	ir_node        *const res  = (ir_node*)obstack_copy(obst, node, size);
+
+	/* nodes have no dependency edges besides in[], so in[] is the only array
+	 * shared with @p node, which must be duplicated */
+	size_t const n_in = ARR_LEN(node->in);
+	if (op->opar == oparity_dynamic)
+		res->in = NEW_ARR_F(ir_node*, n_in);
+	else
+		res->in = NEW_ARR_D(ir_node*, obst, n_in);
+	MEMCPY(res->in, node->in, n_in);
+
+	/* the copy has no out edges, no analysis information and no link to
+	 * the nodes it was copied from */
+	res->link         = NULL;
+	res->o.out        = NULL;
+	res->loop         = NULL;
+	res->backend_info = NULL;
+	for (ir_edge_kind_t i = EDGE_KIND_FIRST; i <= EDGE_KIND_LAST; ++i) {
+		INIT_LIST_HEAD(&res->edge_info[i].outs_head);
+		res->edge_info[i].edges_built = 1;
+		res->edge_info[i].out_count   = 0;
+	}
+
+	copy_node_attr(irg, node, res);
+	return res;
+}
+
+ir_graph_snapshot *new_irg_snapshot(ir_graph *irg)
+{
+	assert(!irg_is_constrained(irg, IR_GRAPH_CONSTRAINT_CONSTRUCTION));
+	assert(!irg_is_constrained(irg, IR_GRAPH_CONSTRAINT_BACKEND));
+
+	ir_graph_snapshot *const snapshot = XMALLOCZ(ir_graph_snapshot);
+	snapshot->irg           = irg;
+	snapshot->last_node_idx = irg->last_node_idx;
+	snapshot->properties    = irg->properties;
+	snapshot->constraints   = irg->constraints;
+	snapshot->pinned_state  = irg->irg_pinned_state;
+
+	/* mark the nodes dead_node_elimination() would keep */
+	irg_walk_in_or_dep(irg->anchor, count_reachable, NULL, &snapshot->n_nodes);
+	ir_visited_t const visited = get_irg_visited(irg);
+
+	/* Copy the marked nodes to the same indices, so the index map of the
+	 * snapshot maps original indices to copies.  The attributes are copied
+	 * while the graph allocates on the obstack of the snapshot. */
+	struct obstack const graph_obst = irg->obst;
+	obstack_init(&irg->obst);
+	ir_obst_account(&irg->obst, "irg_snapshot", irg);
+
+	unsigned  const n_idx = irg->last_node_idx;
+	ir_node **const map   = NEW_ARR_FZ(ir_node*, n_idx);
+	for (unsigned idx = 0; idx < n_idx; ++idx) {
+		ir_node const *const node = irg->idx_irn_map[idx];
+		if (node != NULL && node->visited >= visited)
+			map[idx] = save_node(irg, node);
+	}
+	snapshot->obst = irg->obst;
+	irg->obst      = graph_obst;
+
+	for (unsigned idx = 0; idx < n_idx; ++idx) {
+		ir_node *const copy = map[idx];
+		if (copy == NULL)
+			continue;
+		for (size_t i = 0, n = ARR_LEN(copy->in); i < n; ++i) {
+			ir_node *const pred = copy->in[i];
+			if (pred != NULL)
+				copy->in[i] = map[get_irn_idx(pred)];
+		}
+	}
+	snapshot->idx_irn_map = map;
+	snapshot->anchor      = map[get_irn_idx(irg->anchor)];
+	return snapshot;
+}
+
+void restore_irg_snapshot(ir_graph_snapshot *snapshot)
+{
+	ir_graph *const irg = snapshot->irg;
+	assert(!irg_is_constrained(irg, IR_GRAPH_CONSTRAINT_CONSTRUCTION));
+
+	bool const edges = edges_activated(irg);
+	edges_deactivate(irg);
+	free_callee_info(irg);
+	free_irg_outs(irg);
+	free_loop_information(irg);
+	free_vrp_data(irg);
+
+	/* Discard the current nodes like dead_node_elimination() does. */
+	ir_node *const end = get_irg_end(irg);
+	struct obstack graveyard_obst = irg->obst;
+	DEL_ARR_F(irg->idx_irn_map);
+
+	irg->obst             = snapshot->obst;
+	irg->idx_irn_map      = snapshot->idx_irn_map;
+	irg->anchor           = snapshot->anchor;
+	irg->last_node_idx    = snapshot->last_node_idx;
+	irg->n_live_nodes     = snapshot->n_nodes;
+	irg->live_count_idx   = snapshot->last_node_idx;
+	irg->properties       = snapshot->properties & SNAPSHOT_PROPERTIES;
+	irg->constraints      = snapshot->constraints;
+	irg->irg_pinned_state = snapshot->pinned_state;
+
+	new_identities(irg);
+	for (unsigned idx = 0; idx < irg->last_node_idx; ++idx) {
+		ir_node *const node = irg->idx_irn_map[idx];
+		if (node != NULL)
+			add_identities(node);
+	}
+
+	free_End(end);
+	obstack_free(&graveyard_obst, NULL);
+	free(snapshot);
+
+	if (edges)
+		edges_activate(irg);
+}
+
+void free_irg_snapshot(ir_graph_snapshot *snapshot)
+{
+	free_End(get_Anchor_end(snapshot->anchor));
+	obstack_free(&snapshot->obst, NULL);
+	DEL_ARR_F(snapshot->idx_irn_map);
+	free(snapshot);
+}
+
 void free_ir_graph(ir_graph *irg)
 {
 	assert(irg->kind == k_ir_graph);
@@ -105,6 +105,10 @@ typedef struct ir_vrp_info {
 struct ir_graph {
 	firm_kind              kind;          /**< Always set to k_ir_graph. */
 	unsigned               last_node_idx; /**< Last node index for graph. */
+	unsigned               n_live_nodes;  /**< Reachable nodes at the last
+	                                           count. */
+	unsigned               live_count_idx; /**< last_node_idx at the last
+	                                            count. */
 	/** The entity of this procedure, i.e., the type of the procedure and the
 	 * class it belongs to. */
 	ir_entity             *ent;
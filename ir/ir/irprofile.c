@@ -11,6 +11,7 @@
  */
 #include "irprofile.h"
 
+#include "array.h"
 #include "debug.h"
 #include "execfreq_t.h"
 #include "hashptr.h"
@@ -19,17 +20,25 @@
 #include "irdump_t.h"
 #include "irgwalk.h"
 #include "irnode_t.h"
+#include "irprintf.h"
 #include "irprog_t.h"
+#include "irtools.h"
 #include "obst.h"
+#include "pmap.h"
 #include "set.h"
+#include "target.h"
 #include "typerep.h"
+#include "unionfind.h"
 #include "util.h"
 #include "xmalloc.h"
 
+#include <math.h>
+
 /* Instrument blocks walker. */
 typedef struct block_id_walker_data_t {
 	unsigned int  id;       /**< current block id number */
 	ir_node      *counters; /**< the node representing the counter array */
+	ir_type      *type;     /**< the type of the counter array */
 } block_id_walker_data_t;
 
 /* Associate counters with blocks. */
@@ -38,12 +47,77 @@ typedef struct block_assoc_t {
 	unsigned int *counters;  /**< block execution counts */
 } block_assoc_t;
 
+/**
+ * A control flow edge of a graph profiled with edge counters.  Besides the
+ * edges of the graph there are virtual edges from blocks without successors
+ * to the end block and one from the end block to the start block, which makes
+ * the execution counts a circulation.
+ */
+typedef struct profile_edge_t {
+	unsigned src;     /**< index of the source block */
+	unsigned dst;     /**< index of the destination block */
+	int      pos;     /**< predecessor number in dst, -1 for virtual edges */
+	unsigned index;   /**< position in the edge list, breaks ties */
+	double   weight;  /**< estimated execution frequency */
+	bool     fixed;   /**< the edge cannot be split to hold a counter */
+	bool     in_tree; /**< the edge lies on the spanning tree */
+	unsigned counter; /**< counter of an edge not on the tree */
+} profile_edge_t;
+
+/**
+ * Counter placement for a graph profiled with edge counters.  Only edges off
+ * a maximum spanning tree get counters, the counts of the tree edges follow
+ * from flow conservation.  The plan only depends on the graph and its
+ * estimated execution frequencies, so reading a profile computes the same
+ * plan as instrumentation did.
+ */
+typedef struct edge_plan_t {
+	ir_node        **blocks;   /**< blocks in walk order */
+	unsigned        *n_succs;  /**< number of successors of each block */
+	profile_edge_t  *edges;    /**< edges including the virtual ones */
+	unsigned         first;      /**< first counter of the graph */
+	unsigned         n_counters; /**< number of counters of the graph */
+	bool             by_block;   /**< the graph has a counter for each block */
+} edge_plan_t;
+
+/**
+ * The counters of the program.  With thread-safe instrumentation every
+ * thread gets its own copy of the counters from __firmprof_shard(), which
+ * identifies the unit by the number stored in @c unit.
+ */
+typedef struct counters_t {
+	ir_entity *counters; /**< the counter array */
+	ir_entity *unit;     /**< number of the unit, NULL without threads */
+	ir_entity *shard;    /**< __firmprof_shard(), NULL without threads */
+} counters_t;
+
 /* minimal execution frequency (an execfreq of 0 confuses algos) */
 #define MIN_EXECFREQ 0.00001
 
+/* number of values recorded per value profiling site, must match the
+ * FIRMPROF_VALUE_SLOTS of libfirmprof */
+#define VALUE_SLOTS 4
+
+/* version and kinds of counters of the profile format, must match
+ * profile_file.h of libfirmprof */
+#define PROFILE_VERSION 3
+enum {
+	PROFILE_BLOCKS = 0,
+	PROFILE_EDGES  = 1,
+};
+
+/* instrument with a copy of the counters for each thread */
+static bool thread_safe = false;
+
 /* keep the execcounts here because they are only read once per compiler run */
 static set *profile = NULL;
 
+/* the execution counts of control flow edges, if the profile has them */
+static set *edge_profile = NULL;
+
+/* the most frequent values of the value profiling sites */
+static set *value_profile = NULL;
+
 /* Hook for vcg output. */
 static hook_entry_t *hook;
 
@@ -57,7 +131,7 @@ DEBUG_ONLY(static firm_dbg_module_t *dbg;)
  */
 typedef struct execcount_t {
 	unsigned long block; /**< block id */
-	uint32_t      count; /**< execution count */
+	uint64_t      count; /**< execution count */
 } execcount_t;
 
 /**
@@ -71,19 +145,123 @@ static int cmp_execcount(const void *a, const void *b, size_t size)
 	return ea->block != eb->block;
 }
 
+/**
+ * The execution count of the control flow edge into predecessor @c pos of a
+ * block.
+ */
+typedef struct edgecount_t {
+	unsigned long block; /**< block id */
+	int           pos;   /**< predecessor number */
+	uint64_t      count; /**< execution count */
+} edgecount_t;
+
+static int cmp_edgecount(const void *a, const void *b, size_t size)
+{
+	const edgecount_t *ea = (const edgecount_t*)a;
+	const edgecount_t *eb = (const edgecount_t*)b;
+	(void)size;
+	return ea->block != eb->block || ea->pos != eb->pos;
+}
+
+static unsigned hash_edgecount(const edgecount_t *ec)
+{
+	return hash_combine(ec->block, ec->pos);
+}
+
+/**
+ * The most frequent values recorded at a value profiling site.
+ */
+typedef struct value_histogram_t {
+	long               site;     /**< node number of the site */
+	uint32_t           total;    /**< number of executions of the site */
+	unsigned           n_values; /**< number of values */
+	ir_profile_value_t values[VALUE_SLOTS]; /**< by decreasing count */
+} value_histogram_t;
+
+static int cmp_value_histogram(const void *a, const void *b, size_t size)
+{
+	const value_histogram_t *ea = (const value_histogram_t*)a;
+	const value_histogram_t *eb = (const value_histogram_t*)b;
+	(void)size;
+	return ea->site != eb->site;
+}
+
+bool ir_profile_available(void)
+{
+	return profile != NULL;
+}
+
+bool ir_profile_has_block_execcount(const ir_node *block)
+{
+	if (profile == NULL)
+		return false;
+	execcount_t const query = { .block = get_irn_node_nr(block), .count = 0 };
+	return set_find(execcount_t, profile, &query, sizeof(query), query.block) != NULL;
+}
+
+void ir_profile_set_block_execcount(const ir_node *block, uint32_t count)
+{
+	assert(profile != NULL);
+	execcount_t const query = { .block = get_irn_node_nr(block), .count = count };
+	execcount_t *const ec   = set_insert(execcount_t, profile, &query, sizeof(query), query.block);
+	ec->count = count;
+}
+
+unsigned ir_profile_get_values(const ir_node *node, ir_profile_value_t *values,
+                               unsigned n_values, uint32_t *total)
+{
+	if (value_profile == NULL)
+		return 0;
+	value_histogram_t  const query = { .site = get_irn_node_nr(node) };
+	value_histogram_t *const vh    = set_find(value_histogram_t, value_profile, &query, sizeof(query), query.site);
+	if (vh == NULL)
+		return 0;
+	unsigned const n = MIN(n_values, vh->n_values);
+	MEMCPY(values, vh->values, n);
+	*total = vh->total;
+	return n;
+}
+
+ir_entity *ir_profile_get_call_target(const ir_node *call, uint32_t *count,
+                                      uint32_t *total)
+{
+	ir_profile_value_t values[VALUE_SLOTS];
+	unsigned const     n = ir_profile_get_values(call, values, ARRAY_SIZE(values), total);
+	for (unsigned i = 0; i < n; ++i) {
+		if (values[i].entity != NULL) {
+			*count = values[i].count;
+			return values[i].entity;
+		}
+	}
+	return NULL;
+}
+
 uint32_t ir_profile_get_block_execcount(const ir_node *block)
 {
+	if (profile == NULL)
+		return 0;
+
 	execcount_t  const query = { .block = get_irn_node_nr(block), .count = 0 };
 	execcount_t *const ec    = set_find(execcount_t, profile, &query, sizeof(query), query.block);
 
 	if (ec != NULL) {
-		return ec->count;
+		return MIN(ec->count, UINT32_MAX);
 	} else {
 		DBG((dbg, LEVEL_3, "Warning: Profile contains no data for %+F\n", block));
 		return 0;
 	}
 }
 
+uint64_t ir_profile_get_edge_execcount(const ir_node *block, int pos)
+{
+	if (edge_profile == NULL)
+		return 0;
+
+	edgecount_t  const query = { .block = get_irn_node_nr(block), .pos = pos };
+	edgecount_t *const ec    = set_find(edgecount_t, edge_profile, &query, sizeof(query), hash_edgecount(&query));
+	return ec != NULL ? ec->count : 0;
+}
+
 /**
  * Block walker, count number of blocks.
  */
@@ -123,9 +301,133 @@ static void dump_profile_node_info(void *ctx, FILE *f, const ir_node *irn)
 	if (is_Block(irn)) {
 		unsigned int execcount = ir_profile_get_block_execcount(irn);
 		fprintf(f, "profiled execution count: %u\n", execcount);
+		if (edge_profile != NULL) {
+			for (int i = 0, n = get_Block_n_cfgpreds(irn); i < n; ++i) {
+				unsigned long long const count = ir_profile_get_edge_execcount(irn, i);
+				fprintf(f, "profiled count of edge %d: %llu\n", i, count);
+			}
+		}
+	} else {
+		ir_profile_value_t values[VALUE_SLOTS];
+		uint32_t           total;
+		unsigned const     n = ir_profile_get_values(irn, values, ARRAY_SIZE(values), &total);
+		for (unsigned i = 0; i < n; ++i) {
+			ir_profile_value_t const *const value = &values[i];
+			if (value->entity != NULL)
+				ir_fprintf(f, "profiled value: %s", get_entity_ld_name(value->entity));
+			else if (value->block != NULL)
+				ir_fprintf(f, "profiled value: %+F", value->block);
+			else if (value->value != NULL)
+				ir_fprintf(f, "profiled value: %T", value->value);
+			else
+				ir_fprintf(f, "profiled value: unknown");
+			ir_fprintf(f, " (%u of %u)\n", value->count, total);
+		}
 	}
 }
 
+/**
+ * Returns whether @p call calls a function whose third argument is the size
+ * of a block of memory.
+ */
+static bool is_memory_block_call(ir_node const *const call)
+{
+	ir_entity const *const callee = get_Call_callee(call);
+	if (callee == NULL || get_Call_n_params(call) < 3)
+		return false;
+	char const *const name = get_entity_ld_name(callee);
+	return streq(name, "memcpy") || streq(name, "memmove") || streq(name, "memset");
+}
+
+/**
+ * Returns the operand whose values are recorded at @p node, or NULL if
+ * @p node is no value profiling site.  Constant operands are not recorded.
+ */
+static ir_node *get_value_site_operand(ir_node const *const node)
+{
+	ir_node *op;
+	switch (get_irn_opcode(node)) {
+	case iro_Call:
+		if (get_Call_callee(node) == NULL)
+			return get_Call_ptr(node);
+		if (!is_memory_block_call(node))
+			return NULL;
+		op = get_Call_param(node, 2);
+		break;
+	case iro_IJmp:
+		op = get_IJmp_target(node);
+		break;
+	case iro_Switch:
+		op = get_Switch_selector(node);
+		break;
+	case iro_Div:
+		op = get_Div_right(node);
+		break;
+	case iro_Mod:
+		op = get_Mod_right(node);
+		break;
+	default:
+		return NULL;
+	}
+	/* values are recorded as words */
+	ir_mode *const mode = get_irn_mode(op);
+	if (is_Const(op) || is_Address(op) || !(mode_is_int(mode) || mode_is_reference(mode))
+	    || get_mode_size_bits(mode) > get_mode_size_bits(get_reference_offset_mode(mode_P)))
+		return NULL;
+	return op;
+}
+
+/**
+ * Walker: collect the value profiling sites.
+ */
+static void collect_value_sites(ir_node *node, void *data)
+{
+	ir_node ***const sites = (ir_node***)data;
+	if (get_value_site_operand(node) != NULL)
+		ARR_APP1(ir_node*, *sites, node);
+}
+
+/**
+ * Returns the value profiling sites of the program in a fixed order.
+ */
+static ir_node **get_irp_value_sites(void)
+{
+	ir_node **sites = NEW_ARR_F(ir_node*, 0);
+	foreach_irp_irg_r(i, irg) {
+		irg_walk_graph(irg, collect_value_sites, NULL, &sites);
+	}
+	return sites;
+}
+
+/**
+ * Block walker: collect the blocks with a label.
+ */
+static void collect_label_block(ir_node *bb, void *data)
+{
+	ir_node ***const blocks = (ir_node***)data;
+	if (get_Block_entity(bb) != NULL)
+		ARR_APP1(ir_node*, *blocks, bb);
+}
+
+/**
+ * Returns the blocks of @p irg with a label, whose addresses may be values
+ * at value profiling sites.
+ */
+static ir_node **get_label_blocks(ir_graph *const irg)
+{
+	ir_node **blocks = NEW_ARR_F(ir_node*, 0);
+	irg_block_walk_graph(irg, collect_label_block, NULL, &blocks);
+	return blocks;
+}
+
+/**
+ * Returns the name identifying label @p index of @p irg in value profiles.
+ */
+static ident *get_label_name(ir_graph *const irg, size_t const index)
+{
+	return new_id_fmt("%s:%zu", get_entity_ld_name(get_irg_entity(irg)), index);
+}
+
 /**
  * Add the given method entity as a constructor.
  */
@@ -145,35 +447,155 @@ static void add_constructor(ir_entity *method)
 }
 
 /**
- * Returns an entity representing the __init_firmprof function from libfirmprof
- * This is the equivalent of:
- * extern void __init_firmprof(char *filename, uint *counters, uint size)
+ * Returns an entity representing the __init_firmprof2 function from
+ * libfirmprof, or __init_firmprof_threads if @p threads is set. This is the
+ * equivalent of:
+ * extern void __init_firmprof2(char *filename, uint kind, void *counters,
+ *     uint size, char **names, uint *checksums, uint *lengths,
+ *     uint n_functions)
+ * extern void __init_firmprof_threads(char *filename, uint kind,
+ *     void *counters, uint size, char **names, uint *checksums,
+ *     uint *lengths, uint n_functions, uint *unit)
  */
-static ir_entity *get_init_firmprof_ref(void)
+static ir_entity *get_init_firmprof_ref(bool const threads)
 {
-	ident   *const init_name = new_id_from_str("__init_firmprof");
-	ir_type *const init_type = new_type_method(3, 0, false, cc_cdecl_set, mtp_no_property);
+	ident   *const init_name = new_id_from_str(threads ? "__init_firmprof_threads" : "__init_firmprof2");
+	ir_type *const init_type = new_type_method(threads ? 9 : 8, 0, false, cc_cdecl_set, mtp_no_property);
 	ir_type *const uint      = get_type_for_mode(mode_Iu);
 	ir_type *const uintptr   = new_type_pointer(uint);
+	ir_type *const ptr       = get_type_for_mode(mode_P);
 	ir_type *const string    = new_type_pointer(get_type_for_mode(mode_Bs));
+	ir_type *const ptrptr    = new_type_pointer(ptr);
 
 	set_method_param_type(init_type, 0, string);
-	set_method_param_type(init_type, 1, uintptr);
-	set_method_param_type(init_type, 2, uint);
+	set_method_param_type(init_type, 1, uint);
+	set_method_param_type(init_type, 2, ptr);
+	set_method_param_type(init_type, 3, uint);
+	set_method_param_type(init_type, 4, ptrptr);
+	set_method_param_type(init_type, 5, uintptr);
+	set_method_param_type(init_type, 6, uintptr);
+	set_method_param_type(init_type, 7, uint);
+	if (threads)
+		set_method_param_type(init_type, 8, uintptr);
 
 	return new_entity(get_glob_type(), init_name, init_type);
 }
 
+/**
+ * Returns an entity representing the __firmprof_shard function from
+ * libfirmprof. This is the equivalent of:
+ * extern void *__firmprof_shard(uint *unit, void *counters)
+ */
+static ir_entity *get_firmprof_shard_ref(void)
+{
+	ident   *const name = new_id_from_str("__firmprof_shard");
+	ir_type *const type = new_type_method(2, 1, false, cc_cdecl_set, mtp_no_property);
+	ir_type *const ptr  = get_type_for_mode(mode_P);
+
+	set_method_param_type(type, 0, new_type_pointer(get_type_for_mode(mode_Iu)));
+	set_method_param_type(type, 1, ptr);
+	set_method_res_type(type, 0, ptr);
+
+	return new_entity(get_glob_type(), name, type);
+}
+
+/**
+ * Returns an entity representing the __init_firmprof_values function from
+ * libfirmprof. This is the equivalent of:
+ * extern void __init_firmprof_values(char *filename, void **targets,
+ *     uint *counts, uint n_sites, void **functions, char **names,
+ *     uint n_functions)
+ */
+static ir_entity *get_init_firmprof_values_ref(void)
+{
+	ident   *const init_name = new_id_from_str("__init_firmprof_values");
+	ir_type *const init_type = new_type_method(7, 0, false, cc_cdecl_set, mtp_no_property);
+	ir_type *const uint      = get_type_for_mode(mode_Iu);
+	ir_type *const uintptr   = new_type_pointer(uint);
+	ir_type *const string    = new_type_pointer(get_type_for_mode(mode_Bs));
+	ir_type *const ptrptr    = new_type_pointer(get_type_for_mode(mode_P));
+
+	set_method_param_type(init_type, 0, string);
+	set_method_param_type(init_type, 1, ptrptr);
+	set_method_param_type(init_type, 2, uintptr);
+	set_method_param_type(init_type, 3, uint);
+	set_method_param_type(init_type, 4, ptrptr);
+	set_method_param_type(init_type, 5, ptrptr);
+	set_method_param_type(init_type, 6, uint);
+
+	return new_entity(get_glob_type(), init_name, init_type);
+}
+
+/**
+ * Returns an entity representing the __firmprof_value function from
+ * libfirmprof, or __firmprof_value_int for integer values. This is the
+ * equivalent of:
+ * extern void __firmprof_value(void **targets, uint *counts, void *value)
+ * extern void __firmprof_value_int(void **targets, uint *counts,
+ *     size_t value)
+ */
+static ir_entity *get_firmprof_value_ref(bool const integer)
+{
+	ident   *const name    = new_id_from_str(integer ? "__firmprof_value_int" : "__firmprof_value");
+	ir_type *const type    = new_type_method(3, 0, false, cc_cdecl_set, mtp_no_property);
+	ir_type *const uintptr = new_type_pointer(get_type_for_mode(mode_Iu));
+	ir_type *const ptr     = get_type_for_mode(mode_P);
+	ir_type *const ptrptr  = new_type_pointer(ptr);
+	ir_mode *const mode    = integer ? get_reference_offset_mode(mode_P) : mode_P;
+
+	set_method_param_type(type, 0, ptrptr);
+	set_method_param_type(type, 1, uintptr);
+	set_method_param_type(type, 2, get_type_for_mode(mode));
+
+	return new_entity(get_glob_type(), name, type);
+}
+
+/**
+ * The entities of the value profiling sites.
+ */
+typedef struct value_sites_t {
+	ir_node  **sites;       /**< the sites in walk order */
+	unsigned   next;        /**< the next site to instrument */
+	ir_entity *record;      /**< __firmprof_value() */
+	ir_entity *record_int;  /**< __firmprof_value_int() */
+	ir_entity *targets;     /**< recorded values, VALUE_SLOTS per site */
+	ir_entity *counts;      /**< counts of the values and total per site */
+	unsigned   n_sites;     /**< number of sites */
+	ir_entity *functions;   /**< addresses of the functions and labels of
+	                             the unit */
+	ir_entity *names;       /**< names of the functions and labels */
+	unsigned   n_functions; /**< number of functions and labels */
+} value_sites_t;
+
+/**
+ * The function table of the profile, which tells the runtime the name,
+ * checksum and number of counters of each graph.
+ */
+typedef struct function_table_t {
+	unsigned   kind;        /**< kind of the counters */
+	unsigned   n_counters;  /**< number of counters */
+	ir_entity *names;       /**< names of the graphs */
+	ir_entity *checksums;   /**< checksums of the graphs */
+	ir_entity *lengths;     /**< number of counters of each graph */
+	unsigned   n_functions; /**< number of graphs */
+} function_table_t;
+
 /**
  * Generates a new irg which calls the initializer
  *
  * Pseudocode:
  *    static void __firmprof_initializer(void) __attribute__ ((constructor))
  *    {
- *        __init_firmprof(ent_filename, bblock_counts, n_blocks);
+ *        __init_firmprof2(ent_filename, kind, counts, n_counters, names,
+ *                         checksums, lengths, n_functions);
+ *        __init_firmprof_values(ent_filename, targets, counts, n_sites,
+ *                               functions, names, n_functions);
  *    }
+ *
+ * With thread-safe counters __init_firmprof_threads() is called with the
+ * additional argument unit instead of __init_firmprof2().
  */
-static ir_graph *gen_initializer_irg(ir_entity *ent_filename, ir_entity *bblock_counts, int n_blocks)
+static ir_graph *gen_initializer_irg(ir_entity *ent_filename, counters_t const *const counts, function_table_t const *const table, value_sites_t const *const values)
 {
 	ident     *const name  = new_id_from_str("__firmprof_initializer");
 	ir_type   *const owner = get_glob_type();
@@ -183,15 +605,42 @@ static ir_graph *gen_initializer_irg(ir_entity *ent_filename, ir_entity *bblock_
 	ir_graph  *const irg       = new_ir_graph(ent, 0);
 	ir_node   *const bb        = get_r_cur_block(irg);
 	ir_node   *const init_mem  = get_irg_initial_mem(irg);
-	ir_entity *const init_ent  = get_init_firmprof_ref();
+	ir_entity *const init_ent  = get_init_firmprof_ref(counts->unit != NULL);
 	ir_node   *const callee    = new_r_Address(irg, init_ent);
 	ir_node   *const filename  = new_r_Address(irg, ent_filename);
-	ir_node   *const counters  = new_r_Address(irg, bblock_counts);
-	ir_node   *const size      = new_r_Const_long(irg, mode_Iu, n_blocks);
-	ir_node   *const ins[]     = { filename, counters, size };
+	ir_node   *const ins[]     = {
+		filename,
+		new_r_Const_long(irg, mode_Iu, table->kind),
+		new_r_Address(irg, counts->counters),
+		new_r_Const_long(irg, mode_Iu, table->n_counters),
+		new_r_Address(irg, table->names),
+		new_r_Address(irg, table->checksums),
+		new_r_Address(irg, table->lengths),
+		new_r_Const_long(irg, mode_Iu, table->n_functions),
+		counts->unit != NULL ? new_r_Address(irg, counts->unit) : NULL,
+	};
+	int        const n_ins     = ARRAY_SIZE(ins) - (counts->unit == NULL);
 	ir_type   *const call_type = get_entity_type(init_ent);
-	ir_node   *const call      = new_r_Call(bb, init_mem, callee, ARRAY_SIZE(ins), ins, call_type);
-	ir_node   *const call_mem  = new_r_Proj(call, mode_M, pn_Call_M);
+	ir_node   *const call      = new_r_Call(bb, init_mem, callee, n_ins, ins, call_type);
+	ir_node         *call_mem  = new_r_Proj(call, mode_M, pn_Call_M);
+
+	if (values != NULL) {
+		ir_entity *const vinit_ent  = get_init_firmprof_values_ref();
+		ir_node   *const vcallee    = new_r_Address(irg, vinit_ent);
+		ir_node   *const vins[]     = {
+			filename,
+			new_r_Address(irg, values->targets),
+			new_r_Address(irg, values->counts),
+			new_r_Const_long(irg, mode_Iu, values->n_sites),
+			new_r_Address(irg, values->functions),
+			new_r_Address(irg, values->names),
+			new_r_Const_long(irg, mode_Iu, values->n_functions),
+		};
+		ir_type   *const vcall_type = get_entity_type(vinit_ent);
+		ir_node   *const vcall      = new_r_Call(bb, call_mem, vcallee, ARRAY_SIZE(vins), vins, vcall_type);
+		call_mem = new_r_Proj(vcall, mode_M, pn_Call_M);
+	}
+
 	ir_node   *const ret       = new_r_Return(bb, call_mem, 0, NULL);
 
 	add_immBlock_pred(get_irg_end_block(irg), ret);
@@ -201,12 +650,44 @@ static ir_graph *gen_initializer_irg(ir_entity *ent_filename, ir_entity *bblock_
 	return irg;
 }
 
+/**
+ * Adds @p inc to the counter word @p offset bytes into the counter array
+ * @p address of type @p type_arr at the end of the instrumentation code of
+ * @p bb.
+ * The link of @p bb points to the projm of the last Store of its
+ * instrumentation code, which in turn links to the first Load (or the Call
+ * of __firmprof_shard() in the start block).  That node lacks a memory
+ * argument until fix_ssa() connects it.
+ *
+ * @returns the new value of the counter word
+ */
+static ir_node *add_to_counter_word(ir_node *const bb, ir_node *const address, ir_type *const type_arr, unsigned const offset, ir_node *const inc)
+{
+	ir_graph *const irg      = get_irn_irg(bb);
+	ir_mode  *const mode_ctr = get_irn_mode(inc);
+	ir_node  *const last     = (ir_node*)get_irn_link(bb);
+	ir_node  *const mem      = last != NULL ? last : new_r_Unknown(irg, mode_M);
+	ir_mode  *const mode_off = get_reference_offset_mode(get_irn_mode(address));
+	ir_node  *const cnst     = new_r_Const_long(irg, mode_off, offset);
+	ir_node  *const ptr      = new_r_Add(bb, address, cnst);
+	ir_node  *const load     = new_r_Load(bb, mem, ptr, mode_ctr, type_arr, cons_none);
+	ir_node  *const lmem     = new_r_Proj(load, mode_M, pn_Load_M);
+	ir_node  *const proji    = new_r_Proj(load, mode_ctr, pn_Load_res);
+	ir_node  *const add      = new_r_Add(bb, proji, inc);
+	ir_node  *const store    = new_r_Store(bb, lmem, ptr, add, type_arr, cons_none);
+	ir_node  *const smem     = new_r_Proj(store, mode_M, pn_Store_M);
+
+	set_irn_link(bb, smem);
+	set_irn_link(smem, last != NULL ? get_irn_link(last) : load);
+	return add;
+}
+
 /**
  * Instrument a block with code needed for profiling.
  * This just inserts the instruction nodes, it doesn't connect the memory
  * nodes in a meaningful way.
  */
-static void instrument_block(ir_node *const bb, ir_node *const address, unsigned int const id)
+static void instrument_block(ir_node *const bb, ir_node *const address, ir_type *const type_arr, unsigned int const id)
 {
 	ir_graph *const irg = get_irn_irg(bb);
 
@@ -214,64 +695,167 @@ static void instrument_block(ir_node *const bb, ir_node *const address, unsigned
 	if (bb == get_irg_end_block(irg))
 		return;
 
-	ir_type *const type_arr = get_entity_type(get_irn_entity_attr(address));
-	ir_type *const type_ctr = get_array_element_type(type_arr);
-	ir_mode *const mode_ctr = get_type_mode(type_ctr);
-	ir_node *const unknown  = new_r_Unknown(irg, mode_M);
-	ir_mode *const mode_off = get_reference_offset_mode(get_irn_mode(address));
-	ir_node *const cnst     = new_r_Const_long(irg, mode_off, get_mode_size_bytes(mode_ctr) * id);
-	ir_node *const offset   = new_r_Add(bb, address, cnst);
-	ir_node *const load     = new_r_Load(bb, unknown, offset, mode_ctr, type_arr, cons_none);
-	ir_node *const lmem     = new_r_Proj(load, mode_M, pn_Load_M);
-	ir_node *const proji    = new_r_Proj(load, mode_ctr, pn_Load_res);
+	ir_mode *const mode_ctr = get_type_mode(get_array_element_type(type_arr));
 	ir_node *const one      = new_r_Const_one(irg, mode_ctr);
-	ir_node *const add      = new_r_Add(bb, proji, one);
-	ir_node *const store    = new_r_Store(bb, lmem, offset, add, type_arr, cons_none);
-	ir_node *const smem     = new_r_Proj(store, mode_M, pn_Store_M);
+	add_to_counter_word(bb, address, type_arr, get_mode_size_bytes(mode_ctr) * id, one);
+}
 
-	set_irn_link(bb, smem);
-	set_irn_link(smem, load);
+/**
+ * Instrument a block with the increment of the 64-bit edge counter @p id.
+ * If the counter array consists of 32-bit words, each counter takes two words
+ * in target byte order and the carry into the high word is computed without
+ * branching.
+ */
+static void instrument_edge_counter(ir_node *const bb, ir_node *const address, ir_type *const type_arr, unsigned const id)
+{
+	ir_graph *const irg      = get_irn_irg(bb);
+	ir_mode  *const mode_ctr = get_type_mode(get_array_element_type(type_arr));
+	unsigned  const size     = get_mode_size_bytes(mode_ctr);
+	ir_node  *const one      = new_r_Const_one(irg, mode_ctr);
+	if (get_mode_size_bits(mode_ctr) >= 64) {
+		add_to_counter_word(bb, address, type_arr, size * id, one);
+		return;
+	}
+
+	unsigned const big_endian = ir_target_big_endian() != 0;
+	unsigned const lo_offset  = (2 * id + big_endian) * size;
+	unsigned const hi_offset  = (2 * id + !big_endian) * size;
+	ir_node *const lo         = add_to_counter_word(bb, address, type_arr, lo_offset, one);
+
+	/* The low word wrapped around iff it is zero now, which is exactly when
+	 * the sign bit of lo | -lo is clear. */
+	ir_node *const neg   = new_r_Minus(bb, lo);
+	ir_node *const any   = new_r_Or(bb, lo, neg);
+	ir_node *const none  = new_r_Not(bb, any);
+	ir_node *const top   = new_r_Const_long(irg, mode_Iu, get_mode_size_bits(mode_ctr) - 1);
+	ir_node *const carry = new_r_Shr(bb, none, top);
+	add_to_counter_word(bb, address, type_arr, hi_offset, carry);
+}
+
+/**
+ * Appends a Call of @p callee to the instrumentation code of @p bb, see
+ * add_to_counter_word().
+ */
+static ir_node *add_instrumentation_call(ir_node *const bb, ir_entity *const callee, int const n_ins, ir_node *const *const ins)
+{
+	ir_graph *const irg  = get_irn_irg(bb);
+	ir_node  *const last = (ir_node*)get_irn_link(bb);
+	ir_node  *const mem  = last != NULL ? last : new_r_Unknown(irg, mode_M);
+	ir_node  *const ptr  = new_r_Address(irg, callee);
+	ir_type  *const type = get_entity_type(callee);
+	ir_node  *const call = new_r_Call(bb, mem, ptr, n_ins, ins, type);
+	ir_node  *const cmem = new_r_Proj(call, mode_M, pn_Call_M);
+
+	set_irn_link(bb, cmem);
+	set_irn_link(cmem, last != NULL ? get_irn_link(last) : call);
+	return call;
+}
+
+/**
+ * Instruments the value profiling sites of @p irg with calls recording the
+ * values of their operands.
+ */
+static void instrument_value_sites(ir_graph *const irg, value_sites_t *const values)
+{
+	unsigned const t_size = get_mode_size_bytes(mode_P) * VALUE_SLOTS;
+	unsigned const c_size = get_mode_size_bytes(mode_Iu) * (VALUE_SLOTS + 1);
+	for (; values->next < values->n_sites; ++values->next) {
+		ir_node *const site = values->sites[values->next];
+		if (get_irn_irg(site) != irg)
+			break;
+
+		ir_node  *const bb       = get_nodes_block(site);
+		ir_node  *const targets  = new_r_Address(irg, values->targets);
+		ir_node  *const counts   = new_r_Address(irg, values->counts);
+		ir_mode  *const mode_off = get_reference_offset_mode(get_irn_mode(targets));
+		ir_node  *const t_off    = new_r_Const_long(irg, mode_off, t_size * values->next);
+		ir_node  *const c_off    = new_r_Const_long(irg, mode_off, c_size * values->next);
+		ir_node        *op       = get_value_site_operand(site);
+		ir_entity      *record   = values->record;
+		if (!mode_is_reference(get_irn_mode(op))) {
+			op     = new_r_Conv(bb, op, mode_off);
+			record = values->record_int;
+		}
+		ir_node *const ins[] = {
+			new_r_Add(bb, targets, t_off),
+			new_r_Add(bb, counts, c_off),
+			op,
+		};
+		add_instrumentation_call(bb, record, ARRAY_SIZE(ins), ins);
+	}
 }
 
 /**
  * SSA Construction for instrumentation code memory.
  *
- * This introduces a new memory node and connects it to the instrumentation
- * codes, inserting phiM nodes as necessary. Note that afterwards, the new
- * memory is not connected to any return nodes and thus still dead.
+ * Returns the memory at the end of the instrumentation code of @p bb, or the
+ * memory flowing into @p bb if it has no instrumentation code, and connects
+ * the first Load of the instrumentation code to the memory flowing in.  This
+ * introduces a new memory node, inserting phiM nodes as necessary.  Note
+ * that the new memory is not connected to any return nodes and thus still
+ * dead.
  */
-static void fix_ssa(ir_node *const bb, void *const data)
+static ir_node *get_instrumentation_mem(pmap *const mems, ir_node *const bb)
 {
-	(void)data;
+	ir_node *const known = pmap_get(ir_node, mems, bb);
+	if (known != NULL)
+		return known;
 
-	ir_graph *const irg = get_irn_irg(bb);
+	/* The block link fields point to the projm from the instrumentation code,
+	 * the projm in turn links to the initial load or call which lacks a
+	 * memory argument at this point. */
+	ir_graph *const irg   = get_irn_irg(bb);
+	ir_node  *const proj  = (ir_node*)get_irn_link(bb);
+	ir_node  *const nomem = new_r_NoMem(irg);
 
-	/* end blocks are not instrumented, skip! */
-	if (bb == get_irg_end_block(irg))
-		return;
+	/* Record a result before visiting the predecessors to end cycles here.
+	 * Only unreachable cycles without a Phi see the preliminary NoMem. */
+	pmap_insert(mems, bb, proj != NULL ? proj : nomem);
 
 	ir_node  *mem;
 	int const arity = get_Block_n_cfgpreds(bb);
 	if (bb == get_irg_start_block(irg)) {
 		mem = get_irg_initial_mem(irg);
-	} else if (arity == 1) {
-		ir_node *const pred = get_Block_cfgpred_block(bb, 0);
-		mem = pred ? (ir_node*)get_irn_link(pred) : new_r_NoMem(irg);
+	} else if (arity <= 1) {
+		ir_node *const pred = arity == 1 ? get_Block_cfgpred_block(bb, 0) : NULL;
+		mem = pred ? get_instrumentation_mem(mems, pred) : nomem;
 	} else {
-		ir_node **ins = ALLOCAN(ir_node*, arity);
+		/* a Phi of Dummies is not optimized away */
+		ir_node  *const dummy = new_r_Dummy(irg, mode_M);
+		ir_node **const ins   = ALLOCAN(ir_node*, arity);
+		for (int n = arity; n-- != 0;)
+			ins[n] = dummy;
+		mem = new_r_Phi(bb, arity, ins, mode_M);
+		if (proj == NULL)
+			pmap_insert(mems, bb, mem);
 		for (int n = arity; n-- != 0;) {
 			ir_node *const pred = get_Block_cfgpred_block(bb, n);
-			ins[n] = pred ? (ir_node*)get_irn_link(pred) : new_r_NoMem(irg);
+			set_Phi_pred(mem, n, pred ? get_instrumentation_mem(mems, pred) : nomem);
 		}
-		mem = new_r_Phi(bb, arity, ins, mode_M);
 	}
 
-	/* The block link fields point to the projm from the instrumentation code,
-	 * the projm in turn links to the initial load which lacks a memory
-	 * argument at this point. */
-	ir_node *const proj = (ir_node*)get_irn_link(bb);
-	ir_node *const load = (ir_node*)get_irn_link(proj);
-	set_Load_mem(load, mem);
+	if (proj == NULL) {
+		pmap_insert(mems, bb, mem);
+		return mem;
+	}
+	ir_node *const first = (ir_node*)get_irn_link(proj);
+	if (is_Call(first))
+		set_Call_mem(first, mem);
+	else
+		set_Load_mem(first, mem);
+	return proj;
+}
+
+/**
+ * Block walker: connects the instrumentation code of a block to memory.
+ */
+static void fix_ssa(ir_node *const bb, void *const data)
+{
+	pmap *const mems = (pmap*)data;
+
+	/* end blocks are not instrumented, skip! */
+	if (bb != get_irg_end_block(get_irn_irg(bb)))
+		(void)get_instrumentation_mem(mems, bb);
 }
 
 /**
@@ -280,7 +864,7 @@ static void fix_ssa(ir_node *const bb, void *const data)
 static void block_instrument_walker(ir_node *bb, void *data)
 {
 	block_id_walker_data_t *wd = (block_id_walker_data_t*)data;
-	instrument_block(bb, wd->counters, wd->id);
+	instrument_block(bb, wd->counters, wd->type, wd->id);
 	++wd->id;
 }
 
@@ -288,26 +872,21 @@ static void block_instrument_walker(ir_node *bb, void *data)
  * Synchronize the original memory input of node with the additional operand
  * from the profiling code.
  */
-static ir_node *sync_mem(ir_node *bb, ir_node *mem)
+static ir_node *sync_mem(pmap *mems, ir_node *bb, ir_node *mem)
 {
-	ir_node *const ins[] = { (ir_node*)get_irn_link(bb), mem };
+	ir_node *const ins[] = { get_instrumentation_mem(mems, bb), mem };
 	return new_r_Sync(bb, ARRAY_SIZE(ins), ins);
 }
 
 /**
- * Instrument a single ir_graph, counters should point to the bblock
- * counters array.
+ * Connects the instrumentation code of @p irg to memory and the memory of
+ * the instrumentation code to the nodes leaving the graph.  The links of the
+ * blocks must be set up as described at add_to_counter_word().
  */
-static void instrument_irg(ir_graph *irg, ir_entity *counters, block_id_walker_data_t *wd)
+static void connect_instrumentation(ir_graph *irg)
 {
-	/* generate a node pointing to the count array */
-	wd->counters = new_r_Address(irg, counters);
-
-	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
-
-	/* instrument each block in the current irg */
-	irg_block_walk_graph(irg, block_instrument_walker, NULL, wd);
-	irg_block_walk_graph(irg, fix_ssa, NULL, NULL);
+	pmap *const mems = pmap_create();
+	irg_block_walk_graph(irg, fix_ssa, NULL, mems);
 
 	/* connect the new memory nodes to the return nodes */
 	ir_node *const endbb = get_irg_end_block(irg);
@@ -321,11 +900,11 @@ static void instrument_irg(ir_graph *irg, ir_entity *counters, block_id_walker_d
 		switch (get_irn_opcode(node)) {
 		case iro_Return:
 			mem = get_Return_mem(node);
-			set_Return_mem(node, sync_mem(bb, mem));
+			set_Return_mem(node, sync_mem(mems, bb, mem));
 			break;
 		case iro_Raise:
 			mem = get_Raise_mem(node);
-			set_Raise_mem(node, sync_mem(bb, mem));
+			set_Raise_mem(node, sync_mem(mems, bb, mem));
 			break;
 		case iro_Bad:
 			break;
@@ -343,11 +922,317 @@ static void instrument_irg(ir_graph *irg, ir_entity *counters, block_id_walker_d
 		if (is_Call(node)) {
 			ir_node *const bb  = get_nodes_block(node);
 			ir_node *const mem = get_Call_mem(node);
-			set_Call_mem(node, sync_mem(bb, mem));
+			set_Call_mem(node, sync_mem(mems, bb, mem));
+		}
+	}
+
+	pmap_destroy(mems);
+}
+
+/**
+ * Returns the address of the counters in @p irg.  Thread-safe counters are
+ * returned by a Call of __firmprof_shard() at the start of the graph, which
+ * becomes the head of the instrumentation code of the start block.  The links
+ * of the blocks must have been cleared.
+ */
+static ir_node *get_counters_address(ir_graph *const irg, counters_t const *const counts)
+{
+	ir_node *const address = new_r_Address(irg, counts->counters);
+	if (counts->shard == NULL)
+		return address;
+
+	ir_node *const bb     = get_irg_start_block(irg);
+	ir_node *const callee = new_r_Address(irg, counts->shard);
+	ir_node *const ins[]  = { new_r_Address(irg, counts->unit), address };
+	ir_type *const type   = get_entity_type(counts->shard);
+	ir_node *const mem    = new_r_Unknown(irg, mode_M);
+	ir_node *const call   = new_r_Call(bb, mem, callee, ARRAY_SIZE(ins), ins, type);
+	ir_node *const cmem   = new_r_Proj(call, mode_M, pn_Call_M);
+	ir_node *const ress   = new_r_Proj(call, mode_T, pn_Call_T_result);
+	set_irn_link(bb, cmem);
+	set_irn_link(cmem, call);
+	return new_r_Proj(ress, mode_P, 0);
+}
+
+/**
+ * Instrument a single ir_graph, counters should point to the bblock
+ * counters array.  The value profiling sites of @p irg are instrumented as
+ * well.
+ */
+static void instrument_irg(ir_graph *irg, counters_t const *counts, value_sites_t *values, block_id_walker_data_t *wd)
+{
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
+	irg_block_walk_graph(irg, firm_clear_link, NULL, NULL);
+
+	/* generate a node pointing to the count array */
+	wd->counters = get_counters_address(irg, counts);
+	wd->type     = get_entity_type(counts->counters);
+
+	/* instrument each block in the current irg */
+	irg_block_walk_graph(irg, block_instrument_walker, NULL, wd);
+	instrument_value_sites(irg, values);
+	connect_instrumentation(irg);
+
+	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
+}
+
+/**
+ * Block walker: collects the blocks of a graph.
+ */
+static void collect_block(ir_node *bb, void *data)
+{
+	ir_node ***const blocks = (ir_node***)data;
+	ARR_APP1(ir_node*, *blocks, bb);
+}
+
+static profile_edge_t *add_profile_edge(edge_plan_t *const plan, unsigned const src, unsigned const dst, int const pos)
+{
+	profile_edge_t const edge = {
+		.src   = src,
+		.dst   = dst,
+		.pos   = pos,
+		.index = ARR_LEN(plan->edges),
+	};
+	ARR_APP1(profile_edge_t, plan->edges, edge);
+	return &plan->edges[edge.index];
+}
+
+/**
+ * Orders edges by decreasing weight.
+ */
+static int cmp_edge_weight(const void *a, const void *b)
+{
+	profile_edge_t const *const ea = *(profile_edge_t const**)a;
+	profile_edge_t const *const eb = *(profile_edge_t const**)b;
+	if (ea->weight != eb->weight)
+		return ea->weight < eb->weight ? 1 : -1;
+	return QSORT_CMP(ea->index, eb->index);
+}
+
+/**
+ * Computes the placement of edge counters in @p irg.  The counters of the
+ * graph are numbered from @p *n_counters on, which is advanced past them.
+ */
+static void plan_edge_counters(edge_plan_t *const plan, ir_graph *const irg, unsigned *const n_counters)
+{
+	ir_estimate_execfreq(irg);
+
+	plan->blocks = NEW_ARR_F(ir_node*, 0);
+	irg_block_walk_graph(irg, collect_block, NULL, &plan->blocks);
+
+	size_t    const n_blocks = ARR_LEN(plan->blocks);
+	unsigned *const index    = XMALLOCN(unsigned, get_irg_last_idx(irg));
+	for (size_t i = 0; i < n_blocks; ++i)
+		index[get_irn_idx(plan->blocks[i])] = i;
+
+	plan->n_succs = XMALLOCNZ(unsigned, n_blocks);
+	plan->edges   = NEW_ARR_F(profile_edge_t, 0);
+	for (size_t i = 0; i < n_blocks; ++i) {
+		ir_node *const bb = plan->blocks[i];
+		for (int pos = 0, n = get_Block_n_cfgpreds(bb); pos < n; ++pos) {
+			ir_node *const pred = get_Block_cfgpred_block(bb, pos);
+			if (pred == NULL)
+				continue;
+			unsigned const src = index[get_irn_idx(pred)];
+			++plan->n_succs[src];
+			add_profile_edge(plan, src, i, pos);
+		}
+	}
+
+	/* A counter on a critical edge needs a new block on the edge, which is
+	 * impossible for edges into the end block or out of an IJmp.  Such edges
+	 * are preferred for the spanning tree. */
+	ir_node *const end_block = get_irg_end_block(irg);
+	for (size_t i = 0, n = ARR_LEN(plan->edges); i < n; ++i) {
+		profile_edge_t *const edge = &plan->edges[i];
+		ir_node        *const src  = plan->blocks[edge->src];
+		ir_node        *const dst  = plan->blocks[edge->dst];
+		if (plan->n_succs[edge->src] > 1) {
+			edge->fixed = dst == end_block
+			           || (get_Block_n_cfgpreds(dst) > 1 && is_IJmp(get_Block_cfgpred(dst, edge->pos)));
+		}
+		edge->weight = edge->fixed ? HUGE_VAL
+		             : MIN(get_block_execfreq(src), get_block_execfreq(dst));
+	}
+
+	/* Blocks ending in a call which does not return get a virtual edge to the
+	 * end block.  The virtual edge from the end block to the start block
+	 * closes the circulation and always gets a counter. */
+	unsigned const end = index[get_irn_idx(end_block)];
+	for (size_t i = 0; i < n_blocks; ++i) {
+		if (i != end && plan->n_succs[i] == 0) {
+			profile_edge_t *const edge = add_profile_edge(plan, i, end, -1);
+			edge->fixed  = true;
+			edge->weight = HUGE_VAL;
+		}
+	}
+	unsigned const start = index[get_irn_idx(get_irg_start_block(irg))];
+	add_profile_edge(plan, end, start, -1);
+	free(index);
+
+	/* Kruskal's algorithm for a maximum spanning tree */
+	size_t           const n_candidates = ARR_LEN(plan->edges) - 1;
+	profile_edge_t **const sorted       = XMALLOCN(profile_edge_t*, n_candidates);
+	for (size_t i = 0; i < n_candidates; ++i)
+		sorted[i] = &plan->edges[i];
+	QSORT(sorted, n_candidates, cmp_edge_weight);
+
+	int *const sets = XMALLOCN(int, n_blocks);
+	uf_init(sets, n_blocks);
+	plan->by_block = false;
+	for (size_t i = 0; i < n_candidates; ++i) {
+		profile_edge_t *const edge = sorted[i];
+		int             const src  = uf_find(sets, edge->src);
+		int             const dst  = uf_find(sets, edge->dst);
+		if (src != dst) {
+			edge->in_tree = true;
+			uf_union(sets, src, dst);
+		} else if (edge->fixed) {
+			/* fall back to a counter in each block */
+			plan->by_block = true;
+		}
+	}
+	free(sets);
+	free(sorted);
+
+	plan->first = *n_counters;
+	if (plan->by_block) {
+		DB((dbg, LEVEL_2, "%+F: counting blocks instead of edges\n", irg));
+		plan->n_counters = n_blocks;
+		*n_counters     += n_blocks;
+		return;
+	}
+
+	unsigned n = 0;
+	for (size_t i = 0, n_edges = ARR_LEN(plan->edges); i < n_edges; ++i) {
+		profile_edge_t *const edge = &plan->edges[i];
+		if (!edge->in_tree)
+			edge->counter = n++;
+	}
+	DB((dbg, LEVEL_2, "%+F: %u edge counters for %zu blocks\n", irg, n, n_blocks));
+	plan->n_counters = n;
+	*n_counters     += n;
+}
+
+/**
+ * Computes a checksum of the control flow of a graph from its @p blocks in
+ * walk order.  The counters of a function in a profile only belong to a
+ * graph with the same checksum.
+ */
+static unsigned get_cfg_checksum(ir_graph *const irg, ir_node *const *const blocks)
+{
+	size_t    const n_blocks = ARR_LEN(blocks);
+	unsigned *const index    = XMALLOCN(unsigned, get_irg_last_idx(irg));
+	for (size_t i = 0; i < n_blocks; ++i)
+		index[get_irn_idx(blocks[i])] = i;
+
+	unsigned hash = n_blocks;
+	for (size_t i = 0; i < n_blocks; ++i) {
+		int const n_preds = get_Block_n_cfgpreds(blocks[i]);
+		hash = hash_combine(hash, n_preds);
+		for (int pos = 0; pos < n_preds; ++pos) {
+			ir_node *const pred = get_Block_cfgpred_block(blocks[i], pos);
+			hash = hash_combine(hash, pred != NULL ? index[get_irn_idx(pred)] + 1 : 0);
+		}
+	}
+	free(index);
+	return hash;
+}
+
+/**
+ * Computes the checksum of a graph profiled with edge counters, which also
+ * covers the placement of the counters.
+ */
+static unsigned get_plan_checksum(ir_graph *const irg, edge_plan_t const *const plan)
+{
+	unsigned hash = hash_combine(get_cfg_checksum(irg, plan->blocks), plan->by_block);
+	for (size_t i = 0, n = ARR_LEN(plan->edges); i < n; ++i)
+		hash = hash_combine(hash, plan->edges[i].in_tree);
+	return hash;
+}
+
+/**
+ * Plans the edge counters of all graphs of the program in a fixed order.
+ */
+static edge_plan_t *get_irp_edge_plans(unsigned *const n_counters)
+{
+	edge_plan_t *plans = NEW_ARR_F(edge_plan_t, 0);
+	*n_counters = 0;
+	foreach_irp_irg_r(i, irg) {
+		edge_plan_t plan;
+		plan_edge_counters(&plan, irg, n_counters);
+		ARR_APP1(edge_plan_t, plans, plan);
+	}
+	return plans;
+}
+
+static void free_edge_plan(edge_plan_t *const plan)
+{
+	DEL_ARR_F(plan->blocks);
+	DEL_ARR_F(plan->edges);
+	free(plan->n_succs);
+}
+
+static void free_edge_plans(edge_plan_t *const plans)
+{
+	for (size_t i = 0, n = ARR_LEN(plans); i < n; ++i)
+		free_edge_plan(&plans[i]);
+	DEL_ARR_F(plans);
+}
+
+/**
+ * Instruments @p irg with the counters of @p plan.  Edges between a block
+ * with several successors and a block with several predecessors are split to
+ * hold their counter.  The value profiling sites of @p irg are instrumented
+ * as well.
+ */
+static void instrument_edges_irg(ir_graph *const irg, edge_plan_t const *const plan, counters_t const *const counts, value_sites_t *const values)
+{
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
+	irg_block_walk_graph(irg, firm_clear_link, NULL, NULL);
+
+	ir_node *const address = get_counters_address(irg, counts);
+	ir_type *const type    = get_entity_type(counts->counters);
+
+	bool split = false;
+	if (plan->by_block) {
+		ir_node *const end_block = get_irg_end_block(irg);
+		for (size_t i = 0, n = ARR_LEN(plan->blocks); i < n; ++i) {
+			ir_node *const bb = plan->blocks[i];
+			if (bb != end_block)
+				instrument_edge_counter(bb, address, type, plan->first + i);
+		}
+	} else {
+		for (size_t i = 0, n = ARR_LEN(plan->edges); i < n; ++i) {
+			profile_edge_t const *const edge = &plan->edges[i];
+			if (edge->in_tree)
+				continue;
+
+			ir_node *const dst = plan->blocks[edge->dst];
+			ir_node       *bb;
+			if (edge->pos < 0) {
+				/* the virtual edge into the start block */
+				bb = dst;
+			} else if (plan->n_succs[edge->src] == 1) {
+				bb = plan->blocks[edge->src];
+			} else if (get_Block_n_cfgpreds(dst) == 1) {
+				bb = dst;
+			} else {
+				ir_node *const pred = get_Block_cfgpred(dst, edge->pos);
+				bb = new_r_Block(irg, 1, &pred);
+				set_Block_cfgpred(dst, edge->pos, new_r_Jmp(bb));
+				split = true;
+			}
+			instrument_edge_counter(bb, address, type, plan->first + edge->counter);
 		}
 	}
 
+	instrument_value_sites(irg, values);
+	connect_instrumentation(irg);
 	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
+
+	if (split)
+		confirm_irg_properties(irg, IR_GRAPH_PROPERTIES_NONE);
 }
 
 /**
@@ -356,11 +1241,49 @@ static void instrument_irg(ir_graph *irg, ir_entity *counters, block_id_walker_d
  */
 static ir_entity *new_array_entity(ident *const name, ir_mode *const element_mode, unsigned const length, ir_linkage const linkage)
 {
-	ir_type *const element_type = get_type_for_mode(element_mode);
-	ir_type *const array_type   = new_type_array(element_type, length);
-	ident   *const id           = new_id_from_str(name);
-	ir_type *const owner        = get_glob_type();
-	return new_global_entity(owner, id, array_type, ir_visibility_private, linkage);
+	ir_type   *const element_type = get_type_for_mode(element_mode);
+	ir_type   *const array_type   = new_type_array(element_type, length);
+	ident     *const id           = new_id_from_str(name);
+	ir_type   *const owner        = get_glob_type();
+	ir_entity *const result       = new_global_entity(owner, id, array_type, ir_visibility_private, linkage);
+	/* without an initializer the entity would not be emitted at all */
+	set_entity_initializer(result, get_initializer_null());
+	return result;
+}
+
+/**
+ * Creates a new entity representing the equivalent of
+ * static void *const name[n] = { &entities[0], ... }
+ */
+static ir_entity *new_address_array_entity(ident *const name, ir_entity *const *const entities, size_t const n)
+{
+	ir_entity        *const result   = new_array_entity(name, mode_P, n, IR_LINKAGE_CONSTANT);
+	ir_graph         *const irg      = get_const_code_irg();
+	ir_initializer_t *const contents = create_initializer_compound(n);
+	for (size_t i = 0; i < n; ++i) {
+		ir_node          *const addr = new_r_Address(irg, entities[i]);
+		ir_initializer_t *const init = create_initializer_const(addr);
+		set_initializer_compound_value(contents, i, init);
+	}
+	set_entity_initializer(result, contents);
+	return result;
+}
+
+/**
+ * Creates a new entity representing the equivalent of
+ * static const unsigned name[n] = { values[0], ... }
+ */
+static ir_entity *new_uint_array_entity(ident *const name, unsigned const *const values, size_t const n)
+{
+	ir_entity        *const result   = new_array_entity(name, mode_Iu, n, IR_LINKAGE_CONSTANT);
+	ir_initializer_t *const contents = create_initializer_compound(n);
+	for (size_t i = 0; i < n; ++i) {
+		ir_tarval        *const c    = new_tarval_from_long(values[i], mode_Iu);
+		ir_initializer_t *const init = create_initializer_tarval(c);
+		set_initializer_compound_value(contents, i, init);
+	}
+	set_entity_initializer(result, contents);
+	return result;
 }
 
 /**
@@ -387,7 +1310,11 @@ static ir_entity *new_static_string_entity(char const *const name, char const *c
 	return result;
 }
 
-ir_graph *ir_profile_instrument(const char *filename)
+/**
+ * Instruments the program with block or edge counters and records the
+ * targets of indirect calls.
+ */
+static ir_graph *instrument_program(const char *filename, bool const edges)
 {
 	FIRM_DBG_REGISTER(dbg, "firm.ir.profile");
 
@@ -396,67 +1323,546 @@ ir_graph *ir_profile_instrument(const char *filename)
 	if (get_irp_n_irgs() == 0)
 		return NULL;
 
-	/* count the number of block first */
-	unsigned const n_blocks = get_irp_n_blocks();
+	/* describe the counters of each graph before anything changes the graphs.
+	 * Edge counters are planned just like ir_profile_read() does it. */
+	size_t     const n_irgs    = get_irp_n_irgs();
+	unsigned  *const checksums = XMALLOCN(unsigned, n_irgs);
+	unsigned  *const lengths   = XMALLOCN(unsigned, n_irgs);
+	ir_entity **const names    = XMALLOCN(ir_entity*, n_irgs);
+	edge_plan_t     *plans     = NULL;
+	function_table_t table     = {
+		.kind        = edges ? PROFILE_EDGES : PROFILE_BLOCKS,
+		.n_functions = n_irgs,
+	};
+	if (edges)
+		plans = get_irp_edge_plans(&table.n_counters);
+	size_t f = 0;
+	foreach_irp_irg_r(i, irg) {
+		if (edges) {
+			checksums[f] = get_plan_checksum(irg, &plans[f]);
+			lengths[f]   = plans[f].n_counters;
+		} else {
+			ir_node **blocks = NEW_ARR_F(ir_node*, 0);
+			irg_block_walk_graph(irg, collect_block, NULL, &blocks);
+			checksums[f]      = get_cfg_checksum(irg, blocks);
+			lengths[f]        = ARR_LEN(blocks);
+			table.n_counters += ARR_LEN(blocks);
+			DEL_ARR_F(blocks);
+		}
+		ident *const id = id_unique("__FIRMPROF__FUNCTION_NAME");
+		names[f++] = new_static_string_entity(id, get_entity_ld_name(get_irg_entity(irg)));
+	}
+	table.names     = new_address_array_entity("__FIRMPROF__FUNCTION_NAMES", names, n_irgs);
+	table.checksums = new_uint_array_entity("__FIRMPROF__CHECKSUMS", checksums, n_irgs);
+	table.lengths   = new_uint_array_entity("__FIRMPROF__LENGTHS", lengths, n_irgs);
+	free(lengths);
+	free(checksums);
 
 	/* create all the necessary types and entities. Note that the
 	 * types must have a fixed layout, because we are already running in the
 	 * backend */
-	ir_entity *const bblock_counts = new_array_entity("__FIRMPROF__BLOCK_COUNTS", mode_Iu, n_blocks, IR_LINKAGE_DEFAULT);
+	counters_t counts = { .counters = NULL };
+	if (edges) {
+		/* 64-bit counters are pairs of words on 32-bit targets */
+		bool     const native = get_mode_size_bits(get_reference_offset_mode(mode_P)) >= 64;
+		ir_mode *const mode   = ir_platform_type_mode(native ? IR_TYPE_LONG_LONG : IR_TYPE_INT, false);
+		counts.counters = new_array_entity("__FIRMPROF__EDGE_COUNTS", mode, native ? table.n_counters : 2 * table.n_counters, IR_LINKAGE_DEFAULT);
+		set_entity_alignment(counts.counters, 8);
+	} else {
+		counts.counters = new_array_entity("__FIRMPROF__BLOCK_COUNTS", mode_Iu, table.n_counters, IR_LINKAGE_DEFAULT);
+	}
+	if (thread_safe) {
+		counts.unit  = new_array_entity("__FIRMPROF__UNIT", mode_Iu, 1, IR_LINKAGE_DEFAULT);
+		counts.shard = get_firmprof_shard_ref();
+	}
 
 	ir_entity *const ent_filename = new_static_string_entity("__FIRMPROF__FILE_NAME", filename);
 
-	/* initialize block id array and instrument blocks */
-	block_id_walker_data_t wd = { .id = 0 };
-	foreach_irp_irg_r(i, irg) {
-		instrument_irg(irg, bblock_counts, &wd);
+	/* record the values of indirect call targets, indirect jump targets,
+	 * switch selectors, divisors and memory block sizes; the runtime maps
+	 * addresses to names with a table of the functions and labels of this
+	 * unit */
+	value_sites_t values = { .sites = get_irp_value_sites() };
+	values.n_sites = ARR_LEN(values.sites);
+	if (values.n_sites > 0) {
+		values.targets    = new_array_entity("__FIRMPROF__VALUE_TARGETS", mode_P, values.n_sites * VALUE_SLOTS, IR_LINKAGE_DEFAULT);
+		values.counts     = new_array_entity("__FIRMPROF__VALUE_COUNTS", mode_Iu, values.n_sites * (VALUE_SLOTS + 1), IR_LINKAGE_DEFAULT);
+		values.record     = get_firmprof_value_ref(false);
+		values.record_int = get_firmprof_value_ref(true);
+
+		ir_entity **functions = NEW_ARR_F(ir_entity*, 0);
+		ir_entity **fnames    = NEW_ARR_F(ir_entity*, 0);
+		f = 0;
+		foreach_irp_irg_r(i, irg) {
+			ir_entity *const ent  = get_irg_entity(irg);
+			ir_entity *const name = names[f++];
+			if (get_entity_linkage(ent) & IR_LINKAGE_NO_CODEGEN)
+				continue;
+			ARR_APP1(ir_entity*, functions, ent);
+			ARR_APP1(ir_entity*, fnames, name);
+
+			ir_node **const labels = get_label_blocks(irg);
+			for (size_t l = 0, n = ARR_LEN(labels); l < n; ++l) {
+				ident *const id    = id_unique("__FIRMPROF__LABEL_NAME");
+				ident *const label = get_label_name(irg, l);
+				ARR_APP1(ir_entity*, functions, get_Block_entity(labels[l]));
+				ARR_APP1(ir_entity*, fnames, new_static_string_entity(id, get_id_str(label)));
+			}
+			DEL_ARR_F(labels);
+		}
+		values.n_functions = ARR_LEN(functions);
+		values.functions   = new_address_array_entity("__FIRMPROF__FUNCTIONS", functions, values.n_functions);
+		values.names       = new_address_array_entity("__FIRMPROF__VALUE_FUNCTION_NAMES", fnames, values.n_functions);
+		DEL_ARR_F(fnames);
+		DEL_ARR_F(functions);
 	}
+	free(names);
 
-	return gen_initializer_irg(ent_filename, bblock_counts, n_blocks);
+	if (edges) {
+		edge_plan_t const *plan = plans;
+		foreach_irp_irg_r(i, irg) {
+			instrument_edges_irg(irg, plan++, &counts, &values);
+		}
+		free_edge_plans(plans);
+	} else {
+		/* initialize block id array and instrument blocks */
+		block_id_walker_data_t wd = { .id = 0 };
+		foreach_irp_irg_r(i, irg) {
+			instrument_irg(irg, &counts, &values, &wd);
+		}
+	}
+	DEL_ARR_F(values.sites);
+
+	return gen_initializer_irg(ent_filename, &counts, &table, values.n_sites > 0 ? &values : NULL);
 }
 
-static unsigned int *parse_profile(const char *filename, unsigned int num_blocks)
+void ir_profile_set_thread_safe(bool const enable)
 {
-	FILE *const f = fopen(filename, "rb");
-	if (!f) {
-		DBG((dbg, LEVEL_2, "Failed to open profile file (%s)\n", filename));
-		return NULL;
-	}
+	thread_safe = enable;
+}
 
-	/* check header */
-	uint32_t *result = NULL;
-	char      buf[8];
-	size_t    ret = fread(buf, 8, 1, f);
-	if (ret == 0 || strncmp(buf, "firmprof", 8) != 0) {
-		DBG((dbg, LEVEL_2, "Broken fileheader in profile\n"));
-		goto end;
-	}
+ir_graph *ir_profile_instrument(const char *filename)
+{
+	return instrument_program(filename, false);
+}
+
+ir_graph *ir_profile_instrument_edges(const char *filename)
+{
+	return instrument_program(filename, true);
+}
+
+/**
+ * Reads a 32-bit little endian value.
+ */
+static bool read_u32(FILE *const f, uint32_t *const value)
+{
+	unsigned char bytes[4];
+	if (fread(bytes, 1, 4, f) < 4)
+		return false;
 
-	result = XMALLOCN(unsigned int, num_blocks);
+	*value = (bytes[0] <<  0) | (bytes[1] <<  8)
+	       | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+	return true;
+}
+
+/**
+ * Reads a 64-bit little endian value.
+ */
+static bool read_u64(FILE *const f, uint64_t *const value)
+{
+	uint32_t lo;
+	uint32_t hi;
+	if (!read_u32(f, &lo) || !read_u32(f, &hi))
+		return false;
+
+	*value = (uint64_t)hi << 32 | lo;
+	return true;
+}
+
+static unsigned int *parse_profile(FILE *const f, unsigned int num_blocks)
+{
+	uint32_t *result = XMALLOCN(unsigned int, num_blocks);
 
 	/* The profiling output format is defined to be a sequence of integer
 	 * values stored little endian format. */
 	for (unsigned i = 0; i < num_blocks; ++i) {
-		unsigned char bytes[4];
-		if ((ret = fread(bytes, 1, 4, f)) < 1)
-			break;
+		if (!read_u32(f, &result[i])) {
+			DBG((dbg, LEVEL_4, "Failed to read counters... (size: %u)\n",
+				sizeof(unsigned int) * num_blocks));
+			free(result);
+			return NULL;
+		}
+	}
+
+	return result;
+}
 
-		result[i] = (bytes[0] <<  0) | (bytes[1] <<  8)
-		          | (bytes[2] << 16) | (bytes[3] << 24);
+static uint64_t *parse_edge_profile(FILE *const f, unsigned const n_counters)
+{
+	uint64_t *const result = XMALLOCN(uint64_t, n_counters);
+	for (unsigned i = 0; i < n_counters; ++i) {
+		if (!read_u64(f, &result[i])) {
+			DBG((dbg, LEVEL_4, "Failed to read edge counters... (count: %u)\n",
+			     n_counters));
+			free(result);
+			return NULL;
+		}
 	}
+	return result;
+}
+
+/**
+ * A function of a versioned profile.
+ */
+typedef struct profile_function_t {
+	uint32_t  checksum;   /**< checksum of the profiled graph */
+	uint32_t  n_counters; /**< number of counters */
+	uint64_t *counters;   /**< the counters */
+} profile_function_t;
+
+/**
+ * The function table and counters of a versioned profile.
+ */
+typedef struct function_profile_t {
+	uint32_t            version;   /**< version of the profile format */
+	uint32_t            kind;      /**< kind of the counters */
+	pmap               *functions; /**< maps linker names to functions */
+	profile_function_t *table;     /**< the functions */
+	uint64_t           *counters;  /**< the counters of all functions */
+} function_profile_t;
+
+static void free_function_profile(function_profile_t *const profile)
+{
+	pmap_destroy(profile->functions);
+	free(profile->table);
+	free(profile->counters);
+}
 
-	if (ret < 1) {
-		DBG((dbg, LEVEL_4, "Failed to read counters... (size: %u)\n",
-			sizeof(unsigned int) * num_blocks));
-		free(result);
-		result = NULL;
+/**
+ * Reads the function table and counters of a versioned profile.
+ */
+static bool parse_function_profile(FILE *const f, function_profile_t *const profile)
+{
+	uint32_t n_functions;
+	if (!read_u32(f, &profile->version) || profile->version < 2
+	    || profile->version > PROFILE_VERSION
+	    || !read_u32(f, &profile->kind) || !read_u32(f, &n_functions)) {
+		DBG((dbg, LEVEL_2, "Unsupported profile version\n"));
+		return false;
 	}
 
-end:
-	fclose(f);
+	profile->functions = pmap_create();
+	profile->table     = XMALLOCNZ(profile_function_t, n_functions + 1);
+	profile->counters  = NULL;
+
+	struct obstack obst;
+	obstack_init(&obst);
+	uint64_t total = 0;
+	for (uint32_t i = 0; i < n_functions; ++i) {
+		profile_function_t *const function = &profile->table[i];
+		uint32_t                  len;
+		if (!read_u32(f, &function->checksum) || !read_u32(f, &function->n_counters)
+		    || !read_u32(f, &len) || len > 0xffff)
+			goto error;
+		char *const name = (char*)obstack_alloc(&obst, len + 1);
+		if (fread(name, 1, len, f) < len)
+			goto error;
+		name[len] = '\0';
+		pmap_insert(profile->functions, new_id_from_str(name), function);
+		obstack_free(&obst, name);
+		total += function->n_counters;
+	}
+	obstack_free(&obst, NULL);
+
+	profile->counters = XMALLOCN(uint64_t, total + 1);
+	for (uint64_t i = 0; i < total; ++i) {
+		if (!read_u64(f, &profile->counters[i]))
+			goto error_counters;
+	}
+	uint64_t *counters = profile->counters;
+	for (uint32_t i = 0; i < n_functions; ++i) {
+		profile->table[i].counters = counters;
+		counters += profile->table[i].n_counters;
+	}
+	return true;
+
+error:
+	obstack_free(&obst, NULL);
+error_counters:
+	DBG((dbg, LEVEL_2, "Broken function table in profile\n"));
+	free_function_profile(profile);
+	return false;
+}
+
+/**
+ * Derives the execution counts of the blocks and edges of a graph from the
+ * counters of its edge plan.  The count of a tree edge follows from flow
+ * conservation once it is the only unknown edge of one of its blocks, so
+ * the tree is peeled from its leaves.  Counts that turn out negative because
+ * the program left a function without passing its end block are clamped
+ * to 0.
+ */
+static void associate_edge_counts(edge_plan_t const *const plan, uint64_t const *const counters)
+{
+	size_t    const n_blocks = ARR_LEN(plan->blocks);
+	uint64_t *const counts   = XMALLOCNZ(uint64_t, n_blocks);
+
+	if (plan->by_block) {
+		for (size_t i = 0; i < n_blocks; ++i)
+			counts[i] = counters[plan->first + i];
+	} else {
+		size_t    const n_edges    = ARR_LEN(plan->edges);
+		int64_t  *const flow       = XMALLOCNZ(int64_t, n_edges);
+		bool     *const known      = XMALLOCNZ(bool, n_edges);
+		unsigned *const n_unknown  = XMALLOCNZ(unsigned, n_blocks);
+		unsigned *const adj_begin  = XMALLOCNZ(unsigned, n_blocks + 1);
+		unsigned *const adj        = XMALLOCN(unsigned, 2 * n_edges);
+		for (size_t i = 0; i < n_edges; ++i) {
+			profile_edge_t const *const edge = &plan->edges[i];
+			if (edge->in_tree) {
+				++n_unknown[edge->src];
+				++n_unknown[edge->dst];
+			} else {
+				flow[i]  = counters[plan->first + edge->counter];
+				known[i] = true;
+			}
+			++adj_begin[edge->src];
+			++adj_begin[edge->dst];
+		}
+
+		/* incident edges of each block */
+		for (size_t i = 1; i <= n_blocks; ++i)
+			adj_begin[i] += adj_begin[i - 1];
+		for (size_t i = 0; i < n_edges; ++i) {
+			adj[--adj_begin[plan->edges[i].src]] = i;
+			adj[--adj_begin[plan->edges[i].dst]] = i;
+		}
+
+		unsigned *leaves = NEW_ARR_F(unsigned, 0);
+		for (size_t i = 0; i < n_blocks; ++i) {
+			if (n_unknown[i] == 1)
+				ARR_APP1(unsigned, leaves, i);
+		}
+		while (ARR_LEN(leaves) > 0) {
+			unsigned const bb = leaves[ARR_LEN(leaves) - 1];
+			ARR_SHRINKLEN(leaves, ARR_LEN(leaves) - 1);
+			if (n_unknown[bb] != 1)
+				continue;
+
+			int64_t  balance = 0;
+			unsigned missing = 0;
+			for (unsigned a = adj_begin[bb]; a < adj_begin[bb + 1]; ++a) {
+				unsigned              const e    = adj[a];
+				profile_edge_t const *const edge = &plan->edges[e];
+				if (!known[e]) {
+					missing = e;
+					continue;
+				}
+				if (edge->dst == bb)
+					balance += flow[e];
+				if (edge->src == bb)
+					balance -= flow[e];
+			}
+
+			profile_edge_t const *const edge = &plan->edges[missing];
+			flow[missing]  = edge->dst == bb ? -balance : balance;
+			known[missing] = true;
+			--n_unknown[edge->src];
+			--n_unknown[edge->dst];
+			unsigned const other = edge->src == bb ? edge->dst : edge->src;
+			if (n_unknown[other] == 1)
+				ARR_APP1(unsigned, leaves, other);
+		}
+		DEL_ARR_F(leaves);
+
+		for (size_t i = 0; i < n_edges; ++i) {
+			profile_edge_t const *const edge  = &plan->edges[i];
+			uint64_t              const count = MAX(flow[i], 0);
+			assert(known[i]);
+			counts[edge->dst] += count;
+			if (edge->pos < 0)
+				continue;
+
+			ir_node     *const bb    = plan->blocks[edge->dst];
+			edgecount_t  const query = {
+				.block = get_irn_node_nr(bb),
+				.pos   = edge->pos,
+				.count = count,
+			};
+			DBG((dbg, LEVEL_4, "execcount(%+F, %d): %llu\n", bb, edge->pos,
+			     (unsigned long long)count));
+			(void)set_insert(edgecount_t, edge_profile, &query, sizeof(query), hash_edgecount(&query));
+		}
+
+		free(adj);
+		free(adj_begin);
+		free(n_unknown);
+		free(known);
+		free(flow);
+	}
+
+	for (size_t i = 0; i < n_blocks; ++i) {
+		execcount_t const query = {
+			.block = get_irn_node_nr(plan->blocks[i]),
+			.count = counts[i],
+		};
+		DBG((dbg, LEVEL_4, "execcount(%+F): %llu\n", plan->blocks[i],
+		     (unsigned long long)query.count));
+		(void)set_insert(execcount_t, profile, &query, sizeof(query), query.block);
+	}
+	free(counts);
+}
+
+/**
+ * Associates the counters of a versioned profile with the graphs of the
+ * program.  A graph gets no counts unless the profile contains a function of
+ * the same name, checksum and number of counters.
+ */
+static void associate_function_counts(function_profile_t const *const function_profile)
+{
+	foreach_irp_irg_r(i, irg) {
+		ident              *const name     = get_entity_ld_ident(get_irg_entity(irg));
+		profile_function_t *const function = pmap_get(profile_function_t, function_profile->functions, name);
+		if (function_profile->kind == PROFILE_EDGES) {
+			unsigned    n_counters = 0;
+			edge_plan_t plan;
+			plan_edge_counters(&plan, irg, &n_counters);
+			if (function != NULL && function->n_counters == n_counters
+			    && function->checksum == get_plan_checksum(irg, &plan)) {
+				associate_edge_counts(&plan, function->counters);
+			} else {
+				DBG((dbg, LEVEL_2, "Profile contains no data for %+F\n", irg));
+			}
+			free_edge_plan(&plan);
+		} else {
+			ir_node **blocks = NEW_ARR_F(ir_node*, 0);
+			irg_block_walk_graph(irg, collect_block, NULL, &blocks);
+			size_t const n_blocks = ARR_LEN(blocks);
+			if (function != NULL && function->n_counters == n_blocks
+			    && function->checksum == get_cfg_checksum(irg, blocks)) {
+				for (size_t b = 0; b < n_blocks; ++b) {
+					execcount_t const query = {
+						.block = get_irn_node_nr(blocks[b]),
+						.count = function->counters[b],
+					};
+					(void)set_insert(execcount_t, profile, &query, sizeof(query), query.block);
+				}
+			} else {
+				DBG((dbg, LEVEL_2, "Profile contains no data for %+F\n", irg));
+			}
+			DEL_ARR_F(blocks);
+		}
+	}
+}
+
+/**
+ * Returns the value of a value profiling site recorded as @p value with the
+ * name @p name.  Names identify the functions and labels of the program.
+ */
+static ir_profile_value_t get_profile_value(ir_node *const site, uint64_t const value, ident *const name, pmap *const entities, pmap *const labels)
+{
+	ir_profile_value_t result = { .count = 0 };
+	ir_mode *const     mode   = get_irn_mode(get_value_site_operand(site));
+	if (get_id_str(name)[0] != '\0') {
+		result.entity = pmap_get(ir_entity, entities, name);
+		result.block  = pmap_get(ir_node, labels, name);
+	} else if (!mode_is_reference(mode)) {
+		/* addresses other than functions and labels differ between runs */
+		result.value = new_tarval_from_long((long)value, mode);
+	}
 	return result;
 }
 
+/**
+ * Reads the value profiles following the counters and remembers the most
+ * frequent values of each site.  Before version 3 of the profile format only
+ * the targets of indirect calls were recorded, by name.  Missing or
+ * mismatching value profiles are silently ignored.
+ */
+static void parse_values(FILE *const f, ir_node **const all_sites, bool const with_values)
+{
+	char buf[8];
+	if (fread(buf, 8, 1, f) == 0 || strncmp(buf, "firmvals", 8) != 0)
+		return;
+
+	ir_node **sites = NEW_ARR_F(ir_node*, 0);
+	for (size_t i = 0, n = ARR_LEN(all_sites); i < n; ++i) {
+		ir_node *const site = all_sites[i];
+		if (with_values || (is_Call(site) && get_Call_callee(site) == NULL))
+			ARR_APP1(ir_node*, sites, site);
+	}
+
+	uint32_t n_sites;
+	if (!read_u32(f, &n_sites) || n_sites != ARR_LEN(sites)) {
+		DBG((dbg, LEVEL_2, "Value profile does not match the program\n"));
+		DEL_ARR_F(sites);
+		return;
+	}
+
+	/* map linker names back to method entities and label blocks */
+	pmap          *entities = pmap_create();
+	pmap          *labels   = pmap_create();
+	ir_type *const glob     = get_glob_type();
+	for (size_t i = 0, n = get_compound_n_members(glob); i < n; ++i) {
+		ir_entity *const ent = get_compound_member(glob, i);
+		if (is_method_entity(ent))
+			pmap_insert(entities, get_entity_ld_ident(ent), ent);
+	}
+	foreach_irp_irg_r(i, irg) {
+		ir_node **const blocks = get_label_blocks(irg);
+		for (size_t l = 0, n = ARR_LEN(blocks); l < n; ++l)
+			pmap_insert(labels, get_label_name(irg, l), blocks[l]);
+		DEL_ARR_F(blocks);
+	}
+
+	struct obstack obst;
+	obstack_init(&obst);
+	for (uint32_t i = 0; i < n_sites; ++i) {
+		value_histogram_t vh = { .site = get_irn_node_nr(sites[i]) };
+		if (!read_u32(f, &vh.total))
+			goto end;
+		for (unsigned s = 0; s < VALUE_SLOTS; ++s) {
+			uint32_t count;
+			uint64_t value = 0;
+			uint32_t len;
+			if (!read_u32(f, &count) || (with_values && !read_u64(f, &value))
+			    || !read_u32(f, &len) || len > 0xffff)
+				goto end;
+			char *const name = (char*)obstack_alloc(&obst, len + 1);
+			if (fread(name, 1, len, f) < len)
+				goto end;
+			name[len] = '\0';
+
+			if (count > 0) {
+				ir_profile_value_t *const v = &vh.values[vh.n_values++];
+				*v       = get_profile_value(sites[i], value, new_id_from_str(name), entities, labels);
+				v->count = count;
+			}
+			obstack_free(&obst, name);
+		}
+		if (vh.n_values == 0)
+			continue;
+
+		/* sort by decreasing count */
+		for (unsigned s = 1; s < vh.n_values; ++s) {
+			ir_profile_value_t const v = vh.values[s];
+			unsigned                 j = s;
+			for (; j > 0 && vh.values[j - 1].count < v.count; --j)
+				vh.values[j] = vh.values[j - 1];
+			vh.values[j] = v;
+		}
+		DBG((dbg, LEVEL_4, "values(%+F): %u values, most frequent %u of %u\n",
+		     sites[i], vh.n_values, vh.values[0].count, vh.total));
+		(void)set_insert(value_histogram_t, value_profile, &vh, sizeof(vh), vh.site);
+	}
+
+end:
+	obstack_free(&obst, NULL);
+	pmap_destroy(labels);
+	pmap_destroy(entities);
+	DEL_ARR_F(sites);
+}
+
 /**
  * Reads the corresponding profile info file if it exists.
  */
@@ -467,7 +1873,7 @@ static void block_associate_walker(ir_node *bb, void *env)
 
 	query.block = get_irn_node_nr(bb);
 	query.count = b->counters[b->i++];
-	DBG((dbg, LEVEL_4, "execcount(%+F, %u): %u\n", bb, query.block, query.count));
+	DBG((dbg, LEVEL_4, "execcount(%+F, %u): %u\n", bb, query.block, (unsigned)query.count));
 	(void)set_insert(execcount_t, profile, &query, sizeof(query), query.block);
 }
 
@@ -485,6 +1891,16 @@ void ir_profile_free(void)
 		profile = NULL;
 	}
 
+	if (edge_profile) {
+		del_set(edge_profile);
+		edge_profile = NULL;
+	}
+
+	if (value_profile) {
+		del_set(value_profile);
+		value_profile = NULL;
+	}
+
 	if (hook != NULL) {
 		dump_remove_node_info_callback(hook);
 		hook = NULL;
@@ -495,19 +1911,81 @@ bool ir_profile_read(const char *filename)
 {
 	FIRM_DBG_REGISTER(dbg, "firm.ir.profile");
 
-	unsigned n_blocks = get_irp_n_blocks();
-	block_assoc_t env = {
-		.i        = 0,
-		.counters = parse_profile(filename, n_blocks)
-	};
-	if (!env.counters)
+	FILE *const f = fopen(filename, "rb");
+	if (!f) {
+		DBG((dbg, LEVEL_2, "Failed to open profile file (%s)\n", filename));
+		return false;
+	}
+
+	/* check header */
+	char buf[8];
+	if (fread(buf, 8, 1, f) == 0
+	    || (strncmp(buf, "firmprof", 8) != 0 && strncmp(buf, "firmedge", 8) != 0
+	        && strncmp(buf, "firmdata", 8) != 0)) {
+		DBG((dbg, LEVEL_2, "Broken fileheader in profile\n"));
+		fclose(f);
 		return false;
+	}
+
+	uint32_t version = 1;
+	if (strncmp(buf, "firmdata", 8) == 0) {
+		function_profile_t functions;
+		if (!parse_function_profile(f, &functions)) {
+			fclose(f);
+			return false;
+		}
+
+		ir_profile_free();
+		profile       = new_set(cmp_execcount, 16);
+		value_profile = new_set(cmp_value_histogram, 16);
+		if (functions.kind == PROFILE_EDGES)
+			edge_profile = new_set(cmp_edgecount, 16);
+
+		version = functions.version;
+		associate_function_counts(&functions);
+		free_function_profile(&functions);
+	} else if (strncmp(buf, "firmedge", 8) == 0) {
+		unsigned           n_counters;
+		edge_plan_t *const plans    = get_irp_edge_plans(&n_counters);
+		uint64_t    *const counters = parse_edge_profile(f, n_counters);
+		if (!counters) {
+			free_edge_plans(plans);
+			fclose(f);
+			return false;
+		}
 
-	ir_profile_free();
-	profile = new_set(cmp_execcount, 16);
+		ir_profile_free();
+		profile       = new_set(cmp_execcount, 16);
+		edge_profile  = new_set(cmp_edgecount, 16);
+		value_profile = new_set(cmp_value_histogram, 16);
 
-	irp_associate_blocks(&env);
-	free(env.counters);
+		for (size_t i = 0, n = ARR_LEN(plans); i < n; ++i)
+			associate_edge_counts(&plans[i], counters);
+		free(counters);
+		free_edge_plans(plans);
+	} else {
+		unsigned n_blocks = get_irp_n_blocks();
+		block_assoc_t env = {
+			.i        = 0,
+			.counters = parse_profile(f, n_blocks)
+		};
+		if (!env.counters) {
+			fclose(f);
+			return false;
+		}
+
+		ir_profile_free();
+		profile       = new_set(cmp_execcount, 16);
+		value_profile = new_set(cmp_value_histogram, 16);
+
+		irp_associate_blocks(&env);
+		free(env.counters);
+	}
+
+	ir_node **const sites = get_irp_value_sites();
+	parse_values(f, sites, version >= 3);
+	DEL_ARR_F(sites);
+	fclose(f);
 
 	/* register the vcg hook */
 	hook = dump_add_node_info_callback(dump_profile_node_info, NULL);
@@ -0,0 +1,291 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Deterministic generation of random graphs.
+ *
+ * The control flow is generated as a structured region, which creates an
+ * exact number of blocks: A region is a sequence of single blocks, branches
+ * (fan-in arms and a join block) and loops (a header, a body and an exit
+ * block), where arms and loop bodies are regions again.  Each of the
+ * n_values values and each loop counter is a local variable of the
+ * construction interface, which creates the Phis.
+ */
+#include "irrandom.h"
+
+#include <assert.h>
+
+#include "ident.h"
+#include "ircons.h"
+#include "irgraph.h"
+#include "irmode.h"
+#include "irnode.h"
+#include "irprog.h"
+#include "tv.h"
+#include "typerep.h"
+#include "util.h"
+
+/** Number of elements of the array accessed by Loads and Stores. */
+#define MEM_SIZE 64
+
+typedef struct random_env_t {
+	ir_random_shape_t const *shape;
+	unsigned                 state;    /**< state of the random generator */
+	ir_type                 *int_type;
+	ir_type                 *mem_type;
+	ir_entity               *mem;      /**< array of Loads and Stores */
+	ir_node                 *bound;    /**< parameter n, the loop bound */
+} random_env_t;
+
+void ir_random_shape_init(ir_random_shape_t *const shape)
+{
+	shape->n_blocks    = 64;
+	shape->n_ops       = 8;
+	shape->loop_depth  = 3;
+	shape->mem_percent = 20;
+	shape->phi_fan_in  = 4;
+	shape->n_values    = 8;
+}
+
+/** Returns a random number in [0, n). */
+static unsigned random_below(random_env_t *const env, unsigned const n)
+{
+	env->state = env->state * 1103515245u + 12345u;
+	return (env->state >> 16) % n;
+}
+
+static ir_node *new_int(long const value)
+{
+	return new_Const_long(mode_Is, value);
+}
+
+static unsigned random_variable(random_env_t *const env)
+{
+	return random_below(env, env->shape->n_values);
+}
+
+static ir_node *random_value(random_env_t *const env)
+{
+	return get_value(random_variable(env), mode_Is);
+}
+
+/** Returns the address of an array element, indexed by @p value or by a
+ * constant. */
+static ir_node *random_address(random_env_t *const env, ir_node *const value)
+{
+	ir_node *const index = random_below(env, 2) == 0
+		? new_int(random_below(env, MEM_SIZE))
+		: new_And(value, new_int(MEM_SIZE - 1));
+	return new_Sel(new_Address(env->mem), index, env->mem_type);
+}
+
+static void gen_memory_operation(random_env_t *const env)
+{
+	ir_node *const value = random_value(env);
+	ir_node *const ptr   = random_address(env, value);
+	if (random_below(env, 2) == 0) {
+		ir_node *const load = new_Load(get_store(), ptr, mode_Is,
+		                               env->int_type, cons_none);
+		set_store(new_Proj(load, mode_M, pn_Load_M));
+		set_value(random_variable(env), new_Proj(load, mode_Is, pn_Load_res));
+	} else {
+		ir_node *const store = new_Store(get_store(), ptr, random_value(env),
+		                                 env->int_type, cons_none);
+		set_store(new_Proj(store, mode_M, pn_Store_M));
+	}
+}
+
+static void gen_operation(random_env_t *const env)
+{
+	if (random_below(env, 100) < env->shape->mem_percent) {
+		gen_memory_operation(env);
+		return;
+	}
+
+	ir_node *const left  = random_value(env);
+	ir_node *const right = random_below(env, 4) == 0
+		? new_int(random_below(env, 256)) : random_value(env);
+	ir_node       *res;
+	switch (random_below(env, 8)) {
+	case 0:  res = new_Add(left, right); break;
+	case 1:  res = new_Sub(left, right); break;
+	case 2:  res = new_Mul(left, right); break;
+	case 3:  res = new_And(left, right); break;
+	case 4:  res = new_Or(left, right);  break;
+	case 5:  res = new_Eor(left, right); break;
+	case 6:
+		res = new_Shl(left, new_Const_long(mode_Iu, 1 + random_below(env, 31)));
+		break;
+	default:
+		res = new_Shrs(left, new_Const_long(mode_Iu, 1 + random_below(env, 31)));
+		break;
+	}
+	set_value(random_variable(env), res);
+}
+
+static void fill_block(random_env_t *const env)
+{
+	for (unsigned i = 0; i < env->shape->n_ops; ++i)
+		gen_operation(env);
+}
+
+static void gen_region(random_env_t *env, unsigned n_blocks, unsigned depth);
+
+/** Creates a Cond or Switch with @p fan_in arms, which share @p n_blocks
+ * blocks, and a join block. */
+static void gen_branch(random_env_t *const env, unsigned const fan_in,
+                       unsigned n_blocks, unsigned const depth)
+{
+	ir_node *cfop;
+	if (fan_in == 2) {
+		static ir_relation const relations[] = {
+			ir_relation_equal, ir_relation_less, ir_relation_less_equal,
+			ir_relation_greater, ir_relation_less_greater,
+		};
+		ir_relation const relation
+			= relations[random_below(env, ARRAY_SIZE(relations))];
+		cfop = new_Cond(new_Cmp(random_value(env), random_value(env), relation));
+	} else {
+		ir_graph        *const irg   = get_current_ir_graph();
+		ir_switch_table *const table = ir_new_switch_table(irg, fan_in - 1);
+		for (unsigned i = 0; i < fan_in - 1; ++i) {
+			ir_tarval *const tv = new_tarval_from_long(i, mode_Is);
+			ir_switch_table_set(table, i, tv, tv, i + 1);
+		}
+		cfop = new_Switch(random_value(env), fan_in, table);
+	}
+
+	ir_node *const join = new_immBlock();
+	for (unsigned pn = 0; pn < fan_in; ++pn) {
+		ir_node *const arm = new_immBlock();
+		add_immBlock_pred(arm, new_Proj(cfop, mode_X, pn));
+		mature_immBlock(arm);
+		set_cur_block(arm);
+
+		unsigned const arm_blocks = pn + 1 == fan_in
+			? n_blocks : random_below(env, n_blocks + 1);
+		n_blocks -= arm_blocks;
+		gen_region(env, arm_blocks, depth);
+		add_immBlock_pred(join, new_Jmp());
+	}
+	mature_immBlock(join);
+	set_cur_block(join);
+	fill_block(env);
+}
+
+/** Creates a loop counting up to n, whose body has @p n_blocks blocks
+ * besides its first one. */
+static void gen_loop(random_env_t *const env, unsigned const n_blocks,
+                     unsigned const depth)
+{
+	unsigned const counter = env->shape->n_values + depth;
+	set_value(counter, new_int(0));
+	ir_node *const header = new_immBlock();
+	add_immBlock_pred(header, new_Jmp());
+	set_cur_block(header);
+	ir_node *const cmp  = new_Cmp(get_value(counter, mode_Is), env->bound,
+	                              ir_relation_less);
+	ir_node *const cond = new_Cond(cmp);
+
+	ir_node *const body = new_immBlock();
+	add_immBlock_pred(body, new_Proj(cond, mode_X, pn_Cond_true));
+	mature_immBlock(body);
+	ir_node *const exit = new_immBlock();
+	add_immBlock_pred(exit, new_Proj(cond, mode_X, pn_Cond_false));
+	mature_immBlock(exit);
+
+	set_cur_block(body);
+	gen_region(env, n_blocks, depth + 1);
+	set_value(counter, new_Add(get_value(counter, mode_Is), new_int(1)));
+	add_immBlock_pred(header, new_Jmp());
+	mature_immBlock(header);
+
+	set_cur_block(exit);
+	fill_block(env);
+}
+
+/**
+ * Fills the current block and appends constructs with @p n_blocks blocks in
+ * total.  Ends in a matured block.
+ */
+static void gen_region(random_env_t *const env, unsigned n_blocks,
+                       unsigned const depth)
+{
+	ir_random_shape_t const *const shape = env->shape;
+	fill_block(env);
+	while (n_blocks > 0) {
+		unsigned const max_fan_in = MIN(shape->phi_fan_in, n_blocks - 1);
+		unsigned const choice     = random_below(env, 3);
+		if (choice == 0 && depth < shape->loop_depth && n_blocks >= 3) {
+			unsigned const size = 3 + random_below(env, n_blocks - 2);
+			gen_loop(env, size - 3, depth);
+			n_blocks -= size;
+		} else if (choice == 1 && max_fan_in >= 2) {
+			unsigned const fan_in = 2 + random_below(env, max_fan_in - 1);
+			unsigned const size
+				= fan_in + 1 + random_below(env, n_blocks - fan_in);
+			gen_branch(env, fan_in, size - fan_in - 1, depth);
+			n_blocks -= size;
+		} else {
+			ir_node *const block = new_immBlock();
+			add_immBlock_pred(block, new_Jmp());
+			mature_immBlock(block);
+			set_cur_block(block);
+			fill_block(env);
+			--n_blocks;
+		}
+	}
+}
+
+ir_graph *new_random_ir_graph(const char *const name,
+                              const ir_random_shape_t *const shape,
+                              unsigned const seed)
+{
+	assert(shape->n_values > 0);
+	assert(shape->phi_fan_in >= 2);
+
+	random_env_t env = {
+		.shape    = shape,
+		.state    = seed,
+		.int_type = get_type_for_mode(mode_Is),
+	};
+	env.mem_type = new_type_array(env.int_type, MEM_SIZE);
+	env.mem      = new_global_entity(get_glob_type(),
+	                                 new_id_fmt("%s_mem", name), env.mem_type,
+	                                 ir_visibility_external,
+	                                 IR_LINKAGE_DEFAULT);
+
+	ir_type *const type = new_type_method(2, 1, false, cc_cdecl_set,
+	                                      mtp_no_property);
+	set_method_param_type(type, 0, env.int_type);
+	set_method_param_type(type, 1, env.int_type);
+	set_method_res_type(type, 0, env.int_type);
+	ir_entity *const entity = new_global_entity(get_glob_type(),
+	                                            new_id_from_str(name), type,
+	                                            ir_visibility_external,
+	                                            IR_LINKAGE_DEFAULT);
+
+	int       const n_locals = shape->n_values + shape->loop_depth;
+	ir_graph *const irg      = new_ir_graph(entity, n_locals);
+	set_current_ir_graph(irg);
+	ir_node *const args = get_irg_args(irg);
+	ir_node *const x    = new_Proj(args, mode_Is, 0);
+	env.bound = new_Proj(args, mode_Is, 1);
+	for (unsigned i = 0; i < shape->n_values; ++i)
+		set_value(i, new_Add(i % 2 == 0 ? x : env.bound, new_int(i)));
+	mature_immBlock(get_cur_block());
+
+	gen_region(&env, shape->n_blocks, 0);
+
+	ir_node *sum = get_value(0, mode_Is);
+	for (unsigned i = 1; i < shape->n_values; ++i)
+		sum = new_Add(sum, get_value(i, mode_Is));
+	ir_node *const in[]   = { sum };
+	ir_node *const ret    = new_Return(get_store(), ARRAY_SIZE(in), in);
+	add_immBlock_pred(get_irg_end_block(irg), ret);
+	irg_finalize_cons(irg);
+	return irg;
+}
@@ -0,0 +1,170 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Memory recycling for PBQP instances.
+ */
+#include "arena.h"
+
+#include "adt/array.h"
+#include "memacct.h"
+#include "util.h"
+#include "xmalloc.h"
+#include <assert.h>
+#include <string.h>
+
+/** Chunk size of obstacks in an arena, large enough for many matrices. */
+#define ARENA_CHUNK_SIZE     (64 * 1024 - 64)
+/** Free chunks beyond this size are returned to the system. */
+#define ARENA_MAX_FREE_BYTES (16 * 1024 * 1024)
+
+typedef struct arena_chunk_t arena_chunk_t;
+
+struct arena_chunk_t {
+	arena_chunk_t *next;
+	size_t         size;
+};
+
+/* Keep the chunk contents aligned like memory from malloc(). */
+#define CHUNK_HEADER ((sizeof(arena_chunk_t) + 15) & ~(size_t)15)
+
+static void *arena_chunk_alloc(void *arg, ptrdiff_t size)
+{
+	pbqp_arena_t  *arena = (pbqp_arena_t*)arg;
+	arena_chunk_t *chunk;
+
+	for (arena_chunk_t **anchor = (arena_chunk_t**)&arena->free_chunks;; anchor = &chunk->next) {
+		chunk = *anchor;
+		if (chunk == NULL) {
+			chunk       = (arena_chunk_t*)xmalloc(CHUNK_HEADER + size);
+			chunk->size = size;
+			++arena->num_chunks;
+			break;
+		}
+		if (chunk->size >= (size_t)size) {
+			*anchor            = chunk->next;
+			arena->free_bytes -= chunk->size;
+			++arena->num_chunks_reused;
+			break;
+		}
+	}
+
+	arena->used_bytes += chunk->size;
+	arena->peak_bytes  = MAX(arena->peak_bytes, arena->used_bytes);
+	return (char*)chunk + CHUNK_HEADER;
+}
+
+static void arena_chunk_free(void *arg, void *mem)
+{
+	pbqp_arena_t  *arena = (pbqp_arena_t*)arg;
+	arena_chunk_t *chunk = (arena_chunk_t*)((char*)mem - CHUNK_HEADER);
+
+	arena->used_bytes -= chunk->size;
+	if (arena->free_bytes + chunk->size > ARENA_MAX_FREE_BYTES) {
+		free(chunk);
+		return;
+	}
+	chunk->next         = (arena_chunk_t*)arena->free_chunks;
+	arena->free_chunks  = chunk;
+	arena->free_bytes  += chunk->size;
+}
+
+pbqp_arena_t *pbqp_arena_new(void)
+{
+	return XMALLOCZ(pbqp_arena_t);
+}
+
+void pbqp_arena_free(pbqp_arena_t *arena)
+{
+	assert(arena->used_bytes == 0);
+
+	for (arena_chunk_t *chunk = (arena_chunk_t*)arena->free_chunks, *next;
+	     chunk != NULL; chunk = next) {
+		next = chunk->next;
+		free(chunk);
+	}
+	for (size_t i = 0; i < ARRAY_SIZE(arena->edge_buckets); ++i) {
+		if (arena->edge_buckets[i] != NULL)
+			DEL_ARR_F(arena->edge_buckets[i]);
+	}
+	for (size_t i = 0; i < ARRAY_SIZE(arena->node_buckets); ++i) {
+		if (arena->node_buckets[i] != NULL)
+			DEL_ARR_F(arena->node_buckets[i]);
+	}
+	free(arena);
+}
+
+void pbqp_init_obstack(pbqp_t *pbqp)
+{
+	pbqp_arena_t *arena = pbqp->arena;
+
+	if (arena != NULL) {
+		obstack_specify_allocation_with_arg(&pbqp->obstack, ARENA_CHUNK_SIZE,
+		                                    0, arena_chunk_alloc,
+		                                    arena_chunk_free, arena);
+	} else {
+		obstack_init(&pbqp->obstack);
+	}
+	ir_obst_account(&pbqp->obstack, "pbqp", NULL);
+
+	pbqp->free_vectors   = NEW_ARR_F(void*, 0);
+	pbqp->free_matrices  = NEW_ARR_F(void*, 0);
+	pbqp->num_allocs     = 0;
+	pbqp->num_recycled   = 0;
+	pbqp->recycled_bytes = 0;
+}
+
+void pbqp_free_memory(pbqp_t *pbqp)
+{
+	pbqp_arena_t *arena = pbqp->arena;
+
+	if (arena != NULL) {
+		arena->num_allocs     += pbqp->num_allocs;
+		arena->num_recycled   += pbqp->num_recycled;
+		arena->recycled_bytes += pbqp->recycled_bytes;
+	}
+
+	DEL_ARR_F(pbqp->free_vectors);
+	DEL_ARR_F(pbqp->free_matrices);
+	obstack_free(&pbqp->obstack, NULL);
+}
+
+void *pbqp_alloc_costs(pbqp_t *pbqp, void ***free_lists, unsigned entries,
+                       size_t size)
+{
+	/* Dead costs link to the next free costs in place. */
+	assert(size >= sizeof(void*));
+
+	++pbqp->num_allocs;
+
+	if (entries < ARR_LEN(*free_lists) && (*free_lists)[entries] != NULL) {
+		void *costs = (*free_lists)[entries];
+		(*free_lists)[entries] = *(void**)costs;
+		++pbqp->num_recycled;
+		pbqp->recycled_bytes += size;
+		return costs;
+	}
+
+	return obstack_alloc(&pbqp->obstack, size);
+}
+
+void pbqp_free_costs(void ***free_lists, unsigned entries, void *costs)
+{
+	size_t len = ARR_LEN(*free_lists);
+	if (entries >= len) {
+		ARR_RESIZE(void*, *free_lists, entries + 1);
+		memset(&(*free_lists)[len], 0, (entries + 1 - len) * sizeof(void*));
+	}
+
+	*(void**)costs         = (*free_lists)[entries];
+	(*free_lists)[entries] = costs;
+}
+
+void pbqp_forget_free_costs(pbqp_t *pbqp)
+{
+	ARR_SHRINKLEN(pbqp->free_vectors, 0);
+	ARR_SHRINKLEN(pbqp->free_matrices, 0);
+}
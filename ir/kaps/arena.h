@@ -0,0 +1,76 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Memory recycling for PBQP instances.
+ *
+ * Within an instance, dead cost vectors and matrices are kept in free lists
+ * by size and handed out again by the next allocation of that size.  Across
+ * instances, an arena keeps the obstack chunks and bucket arrays of freed
+ * instances for the next instance allocated in it.
+ */
+#ifndef KAPS_ARENA_H
+#define KAPS_ARENA_H
+
+#include "bucket_t.h"
+#include "pbqp_t.h"
+
+struct pbqp_arena_t {
+	void              *free_chunks;       /* Chunks of freed instances. */
+	size_t             free_bytes;        /* Size of the free chunks. */
+	size_t             used_bytes;        /* Size of the chunks in use. */
+	size_t             peak_bytes;        /* Maximum of used_bytes. */
+	unsigned long      num_chunks;        /* Number of allocated chunks. */
+	unsigned long      num_chunks_reused; /* Chunk requests served by free_chunks. */
+	unsigned long      num_allocs;        /* Vector and matrix allocations. */
+	unsigned long      num_recycled;      /* Allocations served by recycling. */
+	size_t             recycled_bytes;    /* Bytes served by recycling. */
+	pbqp_edge_bucket_t edge_buckets[2];   /* Pooled edge buckets. */
+	pbqp_node_bucket_t node_buckets[5];   /* Pooled node buckets. */
+};
+
+/**
+ * Creates an empty arena.
+ */
+pbqp_arena_t *pbqp_arena_new(void);
+
+/**
+ * Frees @p arena.  All instances allocated in it must have been freed.
+ */
+void pbqp_arena_free(pbqp_arena_t *arena);
+
+/**
+ * Initializes the obstack of @p pbqp, taking its chunks from the arena of
+ * @p pbqp if it has one.
+ */
+void pbqp_init_obstack(pbqp_t *pbqp);
+
+/**
+ * Releases the memory of @p pbqp.  Chunks and recycling statistics go back
+ * to its arena.
+ */
+void pbqp_free_memory(pbqp_t *pbqp);
+
+/**
+ * Allocates @p size bytes for a vector or matrix with @p entries entries,
+ * preferring one recycled with pbqp_free_costs() from @p free_lists.
+ */
+void *pbqp_alloc_costs(pbqp_t *pbqp, void ***free_lists, unsigned entries,
+                       size_t size);
+
+/**
+ * Puts the vector or matrix @p costs with @p entries entries into
+ * @p free_lists.
+ */
+void pbqp_free_costs(void ***free_lists, unsigned entries, void *costs);
+
+/**
+ * Empties the free lists of @p pbqp.  Must be called before memory is
+ * returned to the obstack with obstack_free().
+ */
+void pbqp_forget_free_costs(pbqp_t *pbqp);
+
+#endif
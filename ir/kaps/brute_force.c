@@ -9,6 +9,7 @@
  * @date    02.12.2008
  * @author  Sebastian Buchwald
  */
+#include "arena.h"
 #include "brute_force.h"
 
 #include "bucket.h"
@@ -114,6 +115,8 @@ static unsigned get_minimal_alternative(pbqp_t *pbqp, pbqp_node_t *node)
 		/* obstack_free(&pbqp->obstack, tmp); */
 		node_bucket_free(&bucket_deg3);
 
+		/* Recycled costs may live in the memory freed below. */
+		pbqp_forget_free_costs(pbqp);
 		obstack_free(&pbqp->obstack, tmp);
 	}
 
@@ -259,7 +262,7 @@ static void back_propagate_RII(pbqp_t *pbqp, pbqp_node_t *node)
 	}
 #endif
 
-	obstack_free(&pbqp->obstack, vec);
+	vector_free(pbqp, vec);
 }
 
 static void back_propagate_brute_force(pbqp_t *pbqp)
@@ -329,5 +332,5 @@ void solve_pbqp_brute_force(pbqp_t *pbqp)
 	/* Solve reduced nodes. */
 	back_propagate_brute_force(pbqp);
 
-	free_buckets();
+	free_buckets(pbqp);
 }
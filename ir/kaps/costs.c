@@ -0,0 +1,321 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Kernels on arrays of PBQP costs.
+ */
+#include "costs.h"
+
+#include "vector.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* The vector code relies on INF_COSTS being the largest num, so that a
+ * saturating add yields pbqp_add() and flagged values can be masked to
+ * INF_COSTS. */
+#if KAPS_USE_UNSIGNED && defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define COSTS_SIMD 1
+#else
+#define COSTS_SIMD 0
+#endif
+
+static void add_scalar(num *dst, size_t dst_stride, num const *src,
+                       size_t src_stride, unsigned len)
+{
+	for (unsigned i = 0; i < len; ++i)
+		dst[i * dst_stride] = pbqp_add(dst[i * dst_stride], src[i * src_stride]);
+}
+
+static void add_value_scalar(num *dst, size_t stride, num value, unsigned len)
+{
+	for (unsigned i = 0; i < len; ++i)
+		dst[i * stride] = pbqp_add(dst[i * stride], value);
+}
+
+static num min_scalar(num min, num const *vals, size_t stride,
+                      num const *flags, size_t flags_stride, unsigned len)
+{
+	for (unsigned i = 0; i < len; ++i) {
+		if (flags != NULL && flags[i * flags_stride] == INF_COSTS)
+			continue;
+		num const elem = vals[i * stride];
+		if (elem < min)
+			min = elem;
+	}
+	return min;
+}
+
+static num min_sum_scalar(num min, num const *a, size_t a_stride,
+                          num const *b, size_t b_stride, unsigned len)
+{
+	for (unsigned i = 0; i < len; ++i) {
+		num const sum = pbqp_add(a[i * a_stride], b[i * b_stride]);
+		if (sum < min)
+			min = sum;
+	}
+	return min;
+}
+
+#if COSTS_SIMD
+
+#define LANES 8
+
+typedef num vnum __attribute__((vector_size(LANES * sizeof(num))));
+
+#define ALWAYS_INLINE static inline __attribute__((always_inline))
+
+/* The helpers below are always inlined, so their calling convention for
+ * 32 byte vectors does not matter. */
+#ifndef __clang__
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+ALWAYS_INLINE vnum load(num const *p)
+{
+	vnum v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+ALWAYS_INLINE void store(num *p, vnum v)
+{
+	memcpy(p, &v, sizeof(v));
+}
+
+ALWAYS_INLINE vnum sat_add(vnum x, vnum y)
+{
+	vnum const sum = x + y;
+	return sum | (vnum)(sum < x);
+}
+
+ALWAYS_INLINE vnum vmin(vnum x, vnum y)
+{
+	vnum const less = (vnum)(x < y);
+	return (x & less) | (y & ~less);
+}
+
+ALWAYS_INLINE num reduce_min(vnum v)
+{
+	num min = v[0];
+	for (unsigned l = 1; l < LANES; ++l) {
+		if (v[l] < min)
+			min = v[l];
+	}
+	return min;
+}
+
+/* The SIMD bodies handle whole blocks of LANES values and return the number
+ * of values processed; the rest is left to the scalar code.  Each body is
+ * instantiated for the baseline instruction set and for AVX2. */
+
+ALWAYS_INLINE unsigned add_body(num *dst, num const *src, unsigned len)
+{
+	unsigned i = 0;
+	for (; i + LANES <= len; i += LANES)
+		store(dst + i, sat_add(load(dst + i), load(src + i)));
+	return i;
+}
+
+ALWAYS_INLINE unsigned add_value_body(num *dst, num value, unsigned len)
+{
+	vnum const v = (vnum){ 0 } + value;
+	unsigned   i = 0;
+	for (; i + LANES <= len; i += LANES)
+		store(dst + i, sat_add(load(dst + i), v));
+	return i;
+}
+
+ALWAYS_INLINE unsigned min_body(num *min, num const *vals, num const *flags,
+                                unsigned len)
+{
+	vnum const inf = (vnum){ 0 } + INF_COSTS;
+	vnum       m   = inf;
+	unsigned   i   = 0;
+	for (; i + LANES <= len; i += LANES) {
+		vnum v = load(vals + i);
+		if (flags != NULL)
+			v |= (vnum)(load(flags + i) == inf);
+		m = vmin(m, v);
+	}
+	*min = reduce_min(m);
+	return i;
+}
+
+ALWAYS_INLINE unsigned min_sum_body(num *min, num const *a, num const *b,
+                                    unsigned len)
+{
+	vnum     m = (vnum){ 0 } + INF_COSTS;
+	unsigned i = 0;
+	for (; i + LANES <= len; i += LANES)
+		m = vmin(m, sat_add(load(a + i), load(b + i)));
+	*min = reduce_min(m);
+	return i;
+}
+
+ALWAYS_INLINE unsigned col_mins_body(num *mins, num const *row, unsigned cols)
+{
+	unsigned i = 0;
+	for (; i + LANES <= cols; i += LANES)
+		store(mins + i, vmin(load(mins + i), load(row + i)));
+	return i;
+}
+
+#define AVX2 __attribute__((target("avx2")))
+
+static AVX2 unsigned add_avx2(num *dst, num const *src, unsigned len)
+{
+	return add_body(dst, src, len);
+}
+
+static unsigned add_base(num *dst, num const *src, unsigned len)
+{
+	return add_body(dst, src, len);
+}
+
+static AVX2 unsigned add_value_avx2(num *dst, num value, unsigned len)
+{
+	return add_value_body(dst, value, len);
+}
+
+static unsigned add_value_base(num *dst, num value, unsigned len)
+{
+	return add_value_body(dst, value, len);
+}
+
+static AVX2 unsigned min_avx2(num *min, num const *vals, num const *flags,
+                              unsigned len)
+{
+	return min_body(min, vals, flags, len);
+}
+
+static unsigned min_base(num *min, num const *vals, num const *flags,
+                         unsigned len)
+{
+	return min_body(min, vals, flags, len);
+}
+
+static AVX2 unsigned min_sum_avx2(num *min, num const *a, num const *b,
+                                  unsigned len)
+{
+	return min_sum_body(min, a, b, len);
+}
+
+static unsigned min_sum_base(num *min, num const *a, num const *b,
+                             unsigned len)
+{
+	return min_sum_body(min, a, b, len);
+}
+
+static AVX2 unsigned col_mins_avx2(num *mins, num const *row, unsigned cols)
+{
+	return col_mins_body(mins, row, cols);
+}
+
+static unsigned col_mins_base(num *mins, num const *row, unsigned cols)
+{
+	return col_mins_body(mins, row, cols);
+}
+
+static bool use_avx2(void)
+{
+	return __builtin_cpu_supports("avx2");
+}
+
+#endif
+
+void costs_add(num *dst, size_t dst_stride, num const *src, size_t src_stride,
+               unsigned len)
+{
+	unsigned done = 0;
+#if COSTS_SIMD
+	if (dst_stride == 1 && src_stride == 1)
+		done = use_avx2() ? add_avx2(dst, src, len) : add_base(dst, src, len);
+#endif
+	add_scalar(dst + done * dst_stride, dst_stride, src + done * src_stride,
+	           src_stride, len - done);
+}
+
+void costs_add_value(num *dst, size_t stride, num value, unsigned len)
+{
+	unsigned done = 0;
+#if COSTS_SIMD
+	if (stride == 1)
+		done = use_avx2() ? add_value_avx2(dst, value, len)
+		                  : add_value_base(dst, value, len);
+#endif
+	add_value_scalar(dst + done * stride, stride, value, len - done);
+}
+
+num costs_min(num const *vals, size_t stride, num const *flags,
+              size_t flags_stride, unsigned len)
+{
+	num      min  = INF_COSTS;
+	unsigned done = 0;
+#if COSTS_SIMD
+	if (stride == 1 && (flags == NULL || flags_stride == 1))
+		done = use_avx2() ? min_avx2(&min, vals, flags, len)
+		                  : min_base(&min, vals, flags, len);
+#endif
+	return min_scalar(min, vals + done * stride, stride,
+	                  flags != NULL ? flags + done * flags_stride : NULL,
+	                  flags_stride, len - done);
+}
+
+unsigned costs_min_index(num const *vals, size_t stride, num const *flags,
+                         size_t flags_stride, unsigned len)
+{
+	num const min = costs_min(vals, stride, flags, flags_stride, len);
+	if (min == INF_COSTS)
+		return 0;
+
+	for (unsigned i = 0;; ++i) {
+		assert(i < len);
+		if (vals[i * stride] == min
+		    && (flags == NULL || flags[i * flags_stride] != INF_COSTS))
+			return i;
+	}
+}
+
+num costs_min_sum(num const *a, size_t a_stride, num const *b,
+                  size_t b_stride, unsigned len)
+{
+	num      min  = INF_COSTS;
+	unsigned done = 0;
+#if COSTS_SIMD
+	if (a_stride == 1 && b_stride == 1)
+		done = use_avx2() ? min_sum_avx2(&min, a, b, len)
+		                  : min_sum_base(&min, a, b, len);
+#endif
+	return min_sum_scalar(min, a + done * a_stride, a_stride,
+	                      b + done * b_stride, b_stride, len - done);
+}
+
+void costs_col_mins(num *mins, num const *mat, unsigned rows, unsigned cols,
+                    num const *flags, size_t flags_stride)
+{
+	for (unsigned col = 0; col < cols; ++col)
+		mins[col] = INF_COSTS;
+
+#if COSTS_SIMD
+	bool const avx2 = use_avx2();
+#endif
+	for (unsigned row = 0; row < rows; ++row) {
+		if (flags[row * flags_stride] == INF_COSTS)
+			continue;
+
+		num const *row_costs = mat + row * cols;
+		unsigned   done      = 0;
+#if COSTS_SIMD
+		done = avx2 ? col_mins_avx2(mins, row_costs, cols)
+		            : col_mins_base(mins, row_costs, cols);
+#endif
+		for (unsigned col = done; col < cols; ++col) {
+			if (row_costs[col] < mins[col])
+				mins[col] = row_costs[col];
+		}
+	}
+}
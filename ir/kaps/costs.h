@@ -0,0 +1,60 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Kernels on arrays of PBQP costs.
+ *
+ * The kernels work on arrays whose elements lie @p stride nums apart, so
+ * they serve matrix rows (stride 1), matrix columns (stride cols) and the
+ * entries of cost vectors (stride VEC_STRIDE) alike.  Contiguous arrays are
+ * processed with SIMD instructions if available, where the widest supported
+ * instruction set is selected at runtime.
+ */
+#ifndef KAPS_COSTS_H
+#define KAPS_COSTS_H
+
+#include "pbqp_t.h"
+
+/** Distance of two cost vector entries in nums. */
+#define VEC_STRIDE (sizeof(vec_elem_t) / sizeof(num))
+
+/** The costs of the vector @p vec, VEC_STRIDE nums apart. */
+#define VEC_COSTS(vec) (&(vec)->entries[0].data)
+
+/** dst[i] = pbqp_add(dst[i], src[i]) */
+void costs_add(num *dst, size_t dst_stride, num const *src, size_t src_stride,
+               unsigned len);
+
+/** dst[i] = pbqp_add(dst[i], value) */
+void costs_add_value(num *dst, size_t stride, num value, unsigned len);
+
+/**
+ * Returns the minimum of all vals[i] with flags[i] != INF_COSTS, or
+ * INF_COSTS if there is none.  If @p flags is NULL, no value is ignored.
+ */
+num costs_min(num const *vals, size_t stride, num const *flags,
+              size_t flags_stride, unsigned len);
+
+/**
+ * Returns the first index of the value costs_min() determines, or 0 if
+ * it is INF_COSTS.
+ */
+unsigned costs_min_index(num const *vals, size_t stride, num const *flags,
+                         size_t flags_stride, unsigned len);
+
+/** Returns the minimum of pbqp_add(a[i], b[i]). */
+num costs_min_sum(num const *a, size_t a_stride, num const *b,
+                  size_t b_stride, unsigned len);
+
+/**
+ * Computes the minimum of every column of the rows x cols matrix @p mat,
+ * ignoring rows with flags[row] == INF_COSTS.  The matrix is traversed row by
+ * row, so all columns are handled in one pass over memory.
+ */
+void costs_col_mins(num *mins, num const *mat, unsigned rows, unsigned cols,
+                    num const *flags, size_t flags_stride);
+
+#endif
@@ -121,5 +121,5 @@ void solve_pbqp_heuristical(pbqp_t *pbqp)
 	/* Solve reduced nodes. */
 	back_propagate(pbqp);
 
-	free_buckets();
+	free_buckets(pbqp);
 }
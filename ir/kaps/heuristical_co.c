@@ -201,5 +201,5 @@ void solve_pbqp_heuristical_co(pbqp_t *pbqp, deq_t *rpeo)
 	/* Solve reduced nodes. */
 	back_propagate(pbqp);
 
-	free_buckets();
+	free_buckets(pbqp);
 }
@@ -111,7 +111,7 @@ static void back_propagate_RII(pbqp_t *pbqp, pbqp_node_t *node)
 	}
 #endif
 
-	obstack_free(&pbqp->obstack, vec);
+	vector_free(pbqp, vec);
 }
 
 static void back_propagate_RN(pbqp_t *pbqp, pbqp_node_t *node)
@@ -140,7 +140,7 @@ static void back_propagate_RN(pbqp_t *pbqp, pbqp_node_t *node)
 	}
 #endif
 
-	obstack_free(&pbqp->obstack, vec);
+	vector_free(pbqp, vec);
 }
 
 static void back_propagate_ld(pbqp_t *pbqp)
@@ -349,5 +349,5 @@ void solve_pbqp_heuristical_co_ld(pbqp_t *pbqp, deq_t *rpeo)
 	/* Solve reduced nodes. */
 	back_propagate_ld(pbqp);
 
-	free_buckets();
+	free_buckets(pbqp);
 }
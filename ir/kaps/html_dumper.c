@@ -24,12 +24,12 @@ static const char *cost2a(num const cost)
 	if (cost == INF_COSTS)
 		return "inf";
 
-	static char buf[10];
+	static char buf[24];
 
 #if KAPS_USE_UNSIGNED
-	sprintf(buf, "%u", cost);
+	snprintf(buf, sizeof(buf), "%u", cost);
 #else
-	sprintf(buf, "%10lld", cost);
+	snprintf(buf, sizeof(buf), "%10lld", cost);
 #endif
 
 	return buf;
@@ -13,6 +13,7 @@
 
 #include "adt/array.h"
 #include "adt/xmalloc.h"
+#include "arena.h"
 #include "matrix.h"
 #include "pbqp_edge.h"
 #include "pbqp_edge_t.h"
@@ -50,11 +51,12 @@ pbqp_edge_t *get_edge(pbqp_t *pbqp, unsigned src_index, unsigned tgt_index)
 	return NULL;
 }
 
-pbqp_t *alloc_pbqp(unsigned number_nodes)
+pbqp_t *alloc_pbqp_in_arena(pbqp_arena_t *arena, unsigned number_nodes)
 {
 	pbqp_t *pbqp = XMALLOC(pbqp_t);
 
-	obstack_init(&pbqp->obstack);
+	pbqp->arena = arena;
+	pbqp_init_obstack(pbqp);
 
 #ifdef NDEBUG
 	pbqp->solution     = 0;
@@ -79,9 +81,21 @@ pbqp_t *alloc_pbqp(unsigned number_nodes)
 	return pbqp;
 }
 
+pbqp_t *alloc_pbqp(unsigned number_nodes)
+{
+	return alloc_pbqp_in_arena(NULL, number_nodes);
+}
+
 void free_pbqp(pbqp_t *pbqp)
 {
-	obstack_free(&pbqp->obstack, NULL);
+	for (size_t index = 0; index < pbqp->num_nodes; ++index) {
+		pbqp_node_t *node = pbqp->nodes[index];
+
+		if (node != NULL)
+			DEL_ARR_F(node->edges);
+	}
+
+	pbqp_free_memory(pbqp);
 	free(pbqp);
 }
 
@@ -94,6 +108,7 @@ void add_node_costs(pbqp_t *pbqp, unsigned node_index, vector_t *costs)
 		pbqp->nodes[node_index] = node;
 	} else {
 		vector_add(node->costs, costs);
+		vector_free(pbqp, costs);
 	}
 }
 
@@ -113,6 +128,7 @@ void add_edge_costs(pbqp_t *pbqp, unsigned src_index, unsigned tgt_index,
 			vector_set(diagonal, i, value);
 		}
 
+		pbqp_matrix_free(pbqp, costs);
 		add_node_costs(pbqp, src_index, diagonal);
 
 		return;
@@ -130,6 +146,7 @@ void add_edge_costs(pbqp_t *pbqp, unsigned src_index, unsigned tgt_index,
 		alloc_edge(pbqp, src_index, tgt_index, costs);
 	} else {
 		pbqp_matrix_add(edge->costs, costs);
+		pbqp_matrix_free(pbqp, costs);
 	}
 }
 
@@ -19,18 +19,26 @@
  */
 pbqp_t *alloc_pbqp(unsigned number_nodes);
 
+/**
+ * Create an empty PBQP instance with the given number of nodes, whose memory
+ * is taken from and returned to the given arena.
+ */
+pbqp_t *alloc_pbqp_in_arena(pbqp_arena_t *arena, unsigned number_nodes);
+
 /**
  * Free the given PBQP.
  */
 void free_pbqp(pbqp_t *pbqp);
 
 /**
- * Add costs vector to given node.
+ * Add costs vector to given node.  The vector must have been allocated for
+ * the PBQP and is owned by it afterwards.
  */
 void add_node_costs(pbqp_t *pbqp, unsigned node_index, vector_t *costs);
 
 /**
- * Add costs matrix between given nodes.
+ * Add costs matrix between given nodes.  The matrix must have been allocated
+ * for the PBQP and is owned by it afterwards.
  */
 void add_edge_costs(pbqp_t *pbqp, unsigned src_index, unsigned tgt_index,
                     pbqp_matrix_t *costs);
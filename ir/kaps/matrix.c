@@ -11,31 +11,41 @@
  */
 #include "matrix.h"
 
+#include "arena.h"
+#include "costs.h"
 #include "pbqp_t.h"
 #include "vector.h"
 #include <assert.h>
 #include <string.h>
 
-pbqp_matrix_t *pbqp_matrix_alloc(pbqp_t *pbqp, unsigned rows, unsigned cols)
+static pbqp_matrix_t *pbqp_matrix_alloc_uninitialized(pbqp_t *pbqp, unsigned rows, unsigned cols)
 {
 	assert(cols > 0);
 	assert(rows > 0);
 
 	unsigned length = rows * cols;
-	pbqp_matrix_t *mat = (pbqp_matrix_t *)obstack_alloc(&pbqp->obstack, sizeof(*mat) + sizeof(*mat->entries) * length);
+	pbqp_matrix_t *mat = (pbqp_matrix_t *)pbqp_alloc_costs(pbqp, &pbqp->free_matrices, length, sizeof(*mat) + sizeof(*mat->entries) * length);
 
 	mat->cols = cols;
 	mat->rows = rows;
-	memset(mat->entries, 0, sizeof(*mat->entries) * length);
+
+	return mat;
+}
+
+pbqp_matrix_t *pbqp_matrix_alloc(pbqp_t *pbqp, unsigned rows, unsigned cols)
+{
+	pbqp_matrix_t *mat = pbqp_matrix_alloc_uninitialized(pbqp, rows, cols);
+
+	memset(mat->entries, 0, sizeof(*mat->entries) * rows * cols);
 
 	return mat;
 }
 
 pbqp_matrix_t *pbqp_matrix_copy(pbqp_t *pbqp, pbqp_matrix_t *m)
 {
-	unsigned       len  = m->rows * m->cols;
-	pbqp_matrix_t *copy = (pbqp_matrix_t *)obstack_copy(&pbqp->obstack, m, sizeof(*copy) + sizeof(*copy->entries) * len);
-	assert(copy);
+	pbqp_matrix_t *copy = pbqp_matrix_alloc_uninitialized(pbqp, m->rows, m->cols);
+
+	memcpy(copy->entries, m->entries, sizeof(*copy->entries) * m->rows * m->cols);
 
 	return copy;
 }
@@ -44,8 +54,7 @@ pbqp_matrix_t *pbqp_matrix_copy_and_transpose(pbqp_t *pbqp, pbqp_matrix_t *m)
 {
 	unsigned       cols = m->cols;
 	unsigned       rows = m->rows;
-	unsigned       len  = rows * cols;
-	pbqp_matrix_t *copy = (pbqp_matrix_t *)obstack_alloc(&pbqp->obstack, sizeof(*copy) + sizeof(*copy->entries) * len);
+	pbqp_matrix_t *copy = pbqp_matrix_alloc_uninitialized(pbqp, cols, rows);
 
 	for (unsigned i = 0; i < rows; ++i) {
 		for (unsigned j = 0; j < cols; ++j) {
@@ -53,12 +62,14 @@ pbqp_matrix_t *pbqp_matrix_copy_and_transpose(pbqp_t *pbqp, pbqp_matrix_t *m)
 		}
 	}
 
-	copy->cols = rows;
-	copy->rows = cols;
-
 	return copy;
 }
 
+void pbqp_matrix_free(pbqp_t *pbqp, pbqp_matrix_t *mat)
+{
+	pbqp_free_costs(&pbqp->free_matrices, mat->rows * mat->cols, mat);
+}
+
 void pbqp_matrix_transpose(pbqp_t *pbqp, pbqp_matrix_t *mat)
 {
 	unsigned       len = mat->rows * mat->cols;
@@ -66,7 +77,7 @@ void pbqp_matrix_transpose(pbqp_t *pbqp, pbqp_matrix_t *mat)
 
 	memcpy(mat, tmp, sizeof(*mat) + sizeof(*mat->entries) * len);
 
-	obstack_free(&pbqp->obstack, tmp);
+	pbqp_matrix_free(pbqp, tmp);
 }
 
 void pbqp_matrix_add(pbqp_matrix_t *sum, pbqp_matrix_t *summand)
@@ -74,11 +85,7 @@ void pbqp_matrix_add(pbqp_matrix_t *sum, pbqp_matrix_t *summand)
 	assert(sum->cols == summand->cols);
 	assert(sum->rows == summand->rows);
 
-	unsigned len = sum->rows * sum->cols;
-
-	for (unsigned i = 0; i < len; ++i) {
-		sum->entries[i] = pbqp_add(sum->entries[i], summand->entries[i]);
-	}
+	costs_add(sum->entries, 1, summand->entries, 1, sum->rows * sum->cols);
 }
 
 void pbqp_matrix_set_col_value(pbqp_matrix_t *mat, unsigned col, num value)
@@ -113,48 +120,30 @@ void pbqp_matrix_set(pbqp_matrix_t *mat, unsigned row, unsigned col, num value)
 
 num pbqp_matrix_get_col_min(pbqp_matrix_t *matrix, unsigned col_index, vector_t *flags)
 {
-	num      min     = INF_COSTS;
-	unsigned col_len = matrix->cols;
-	unsigned row_len = matrix->rows;
-
-	assert(row_len == flags->len);
+	assert(matrix->rows == flags->len);
+	assert(col_index < matrix->cols);
 
-	for (unsigned row_index = 0; row_index < row_len; ++row_index) {
-		/* Ignore virtual deleted columns. */
-		if (flags->entries[row_index].data == INF_COSTS) continue;
-
-		num elem = matrix->entries[row_index * col_len + col_index];
+	/* Ignore virtual deleted rows. */
+	return costs_min(&matrix->entries[col_index], matrix->cols,
+	                 VEC_COSTS(flags), VEC_STRIDE, matrix->rows);
+}
 
-		if (elem < min) {
-			min = elem;
-		}
-	}
+void pbqp_matrix_get_col_mins(pbqp_matrix_t *matrix, vector_t *flags, num *mins)
+{
+	assert(matrix->rows == flags->len);
 
-	return min;
+	costs_col_mins(mins, matrix->entries, matrix->rows, matrix->cols,
+	               VEC_COSTS(flags), VEC_STRIDE);
 }
 
 unsigned pbqp_matrix_get_col_min_index(pbqp_matrix_t *matrix, unsigned col_index, vector_t *flags)
 {
-	unsigned min_index = 0;
-	num      min       = INF_COSTS;
-	unsigned col_len   = matrix->cols;
-	unsigned row_len   = matrix->rows;
+	assert(matrix->rows == flags->len);
+	assert(col_index < matrix->cols);
 
-	assert(row_len == flags->len);
-
-	for (unsigned row_index = 0; row_index < row_len; ++row_index) {
-		/* Ignore virtual deleted columns. */
-		if (flags->entries[row_index].data == INF_COSTS) continue;
-
-		num elem = matrix->entries[row_index * col_len + col_index];
-
-		if (elem < min) {
-			min       = elem;
-			min_index = row_index;
-		}
-	}
-
-	return min_index;
+	/* Ignore virtual deleted rows. */
+	return costs_min_index(&matrix->entries[col_index], matrix->cols,
+	                       VEC_COSTS(flags), VEC_STRIDE, matrix->rows);
 }
 
 void pbqp_matrix_sub_col_value(pbqp_matrix_t *matrix, unsigned col_index,
@@ -180,46 +169,26 @@ void pbqp_matrix_sub_col_value(pbqp_matrix_t *matrix, unsigned col_index,
 
 num pbqp_matrix_get_row_min(pbqp_matrix_t *matrix, unsigned row_index, vector_t *flags)
 {
-	num      min = INF_COSTS;
 	unsigned len = flags->len;
 
 	assert(matrix->cols == len);
+	assert(row_index < matrix->rows);
 
-	for (unsigned col_index = 0; col_index < len; ++col_index) {
-		/* Ignore virtual deleted columns. */
-		if (flags->entries[col_index].data == INF_COSTS) continue;
-
-		num elem = matrix->entries[row_index * len + col_index];
-
-		if (elem < min) {
-			min = elem;
-		}
-	}
-
-	return min;
+	/* Ignore virtual deleted columns. */
+	return costs_min(&matrix->entries[row_index * len], 1, VEC_COSTS(flags),
+	                 VEC_STRIDE, len);
 }
 
 unsigned pbqp_matrix_get_row_min_index(pbqp_matrix_t *matrix, unsigned row_index, vector_t *flags)
 {
-	unsigned min_index = 0;
-	num      min       = INF_COSTS;
-	unsigned len       = flags->len;
+	unsigned len = flags->len;
 
 	assert(matrix->cols == len);
+	assert(row_index < matrix->rows);
 
-	for (unsigned col_index = 0; col_index < len; ++col_index) {
-		/* Ignore virtual deleted columns. */
-		if (flags->entries[col_index].data == INF_COSTS) continue;
-
-		num elem = matrix->entries[row_index * len + col_index];
-
-		if (elem < min) {
-			min = elem;
-			min_index = col_index;
-		}
-	}
-
-	return min_index;
+	/* Ignore virtual deleted columns. */
+	return costs_min_index(&matrix->entries[row_index * len], 1,
+	                       VEC_COSTS(flags), VEC_STRIDE, len);
 }
 
 void pbqp_matrix_sub_row_value(pbqp_matrix_t *matrix, unsigned row_index,
@@ -277,9 +246,7 @@ void pbqp_matrix_add_to_all_cols(pbqp_matrix_t *mat, vector_t *vec)
 	for (unsigned row_index = 0; row_index < row_len; ++row_index) {
 		num value = vec->entries[row_index].data;
 
-		for (unsigned col_index = 0; col_index < col_len; ++col_index) {
-			mat->entries[row_index * col_len + col_index] = pbqp_add(mat->entries[row_index * col_len + col_index], value);
-		}
+		costs_add_value(&mat->entries[row_index * col_len], 1, value, col_len);
 	}
 }
 
@@ -291,10 +258,7 @@ void pbqp_matrix_add_to_all_rows(pbqp_matrix_t *mat, vector_t *vec)
 	assert(col_len == vec->len);
 
 	for (unsigned row_index = 0; row_index < row_len; ++row_index) {
-		for (unsigned col_index = 0; col_index < col_len; ++col_index) {
-			num value = vec->entries[col_index].data;
-
-			mat->entries[row_index * col_len + col_index] = pbqp_add(mat->entries[row_index * col_len + col_index], value);
-		}
+		costs_add(&mat->entries[row_index * col_len], 1, VEC_COSTS(vec),
+		          VEC_STRIDE, col_len);
 	}
 }
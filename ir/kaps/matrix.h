@@ -21,6 +21,9 @@ pbqp_matrix_t *pbqp_matrix_copy(pbqp_t *pbqp, pbqp_matrix_t *m);
 
 pbqp_matrix_t *pbqp_matrix_copy_and_transpose(pbqp_t *pbqp, pbqp_matrix_t *m);
 
+/* Recycles mat, which must not be used afterwards. */
+void pbqp_matrix_free(pbqp_t *pbqp, pbqp_matrix_t *mat);
+
 void pbqp_matrix_transpose(pbqp_t *pbqp, pbqp_matrix_t *mat);
 
 /* sum += summand */
@@ -31,6 +34,9 @@ void pbqp_matrix_set(pbqp_matrix_t *mat, unsigned row, unsigned col, num value);
 num pbqp_matrix_get_col_min(pbqp_matrix_t *matrix, unsigned col_index, vector_t *flags);
 num pbqp_matrix_get_row_min(pbqp_matrix_t *matrix, unsigned row_index, vector_t *flags);
 
+/* mins[col] = pbqp_matrix_get_col_min(matrix, col, flags) for all columns */
+void pbqp_matrix_get_col_mins(pbqp_matrix_t *matrix, vector_t *flags, num *mins);
+
 unsigned pbqp_matrix_get_col_min_index(pbqp_matrix_t *matrix, unsigned col_index, vector_t *flags);
 unsigned pbqp_matrix_get_row_min_index(pbqp_matrix_t *matrix, unsigned row_index, vector_t *flags);
 
@@ -12,7 +12,9 @@
 #include "kaps.h"
 
 #include "adt/array.h"
+#include "arena.h"
 #include "bucket.h"
+#include "costs.h"
 #include "matrix.h"
 #include "optimal.h"
 #include "panic.h"
@@ -24,6 +26,7 @@
 #include "vector.h"
 #include <assert.h>
 #include <stdbool.h>
+#include <string.h>
 
 #if KAPS_DUMP
 #include "html_dumper.h"
@@ -56,26 +59,78 @@ static void insert_into_rm_bucket(pbqp_edge_t *edge)
 	edge_bucket_insert(&rm_bucket, edge);
 }
 
-static void init_buckets(void)
+/* Buckets are taken from and returned to the arena of the instance, so that
+ * consecutive instances reuse the bucket arrays. */
+static void take_edge_bucket(pbqp_arena_t *arena, unsigned slot,
+                             pbqp_edge_bucket_t *bucket)
 {
-	edge_bucket_init(&edge_bucket);
-	edge_bucket_init(&rm_bucket);
-	node_bucket_init(&reduced_bucket);
+	if (arena == NULL || arena->edge_buckets[slot] == NULL) {
+		edge_bucket_init(bucket);
+		return;
+	}
+	*bucket = arena->edge_buckets[slot];
+	arena->edge_buckets[slot] = NULL;
+	ARR_SHRINKLEN(*bucket, 0);
+}
+
+static void take_node_bucket(pbqp_arena_t *arena, unsigned slot,
+                             pbqp_node_bucket_t *bucket)
+{
+	if (arena == NULL || arena->node_buckets[slot] == NULL) {
+		node_bucket_init(bucket);
+		return;
+	}
+	*bucket = arena->node_buckets[slot];
+	arena->node_buckets[slot] = NULL;
+	ARR_SHRINKLEN(*bucket, 0);
+}
+
+static void return_edge_bucket(pbqp_arena_t *arena, unsigned slot,
+                               pbqp_edge_bucket_t *bucket)
+{
+	if (arena == NULL || arena->edge_buckets[slot] != NULL) {
+		edge_bucket_free(bucket);
+		return;
+	}
+	arena->edge_buckets[slot] = *bucket;
+	*bucket = NULL;
+}
+
+static void return_node_bucket(pbqp_arena_t *arena, unsigned slot,
+                               pbqp_node_bucket_t *bucket)
+{
+	if (arena == NULL || arena->node_buckets[slot] != NULL) {
+		node_bucket_free(bucket);
+		return;
+	}
+	arena->node_buckets[slot] = *bucket;
+	*bucket = NULL;
+}
+
+static void init_buckets(pbqp_t *pbqp)
+{
+	pbqp_arena_t *arena = pbqp->arena;
+
+	take_edge_bucket(arena, 0, &edge_bucket);
+	take_edge_bucket(arena, 1, &rm_bucket);
+	take_node_bucket(arena, 4, &reduced_bucket);
 
 	for (int i = 0; i < 4; ++i) {
-		node_bucket_init(&node_buckets[i]);
+		take_node_bucket(arena, i, &node_buckets[i]);
 	}
 }
 
-void free_buckets(void)
+void free_buckets(pbqp_t *pbqp)
 {
+	pbqp_arena_t *arena = pbqp->arena;
+
 	for (int i = 0; i < 4; ++i) {
-		node_bucket_free(&node_buckets[i]);
+		return_node_bucket(arena, i, &node_buckets[i]);
 	}
 
-	edge_bucket_free(&edge_bucket);
-	edge_bucket_free(&rm_bucket);
-	node_bucket_free(&reduced_bucket);
+	return_edge_bucket(arena, 0, &edge_bucket);
+	return_edge_bucket(arena, 1, &rm_bucket);
+	return_node_bucket(arena, 4, &reduced_bucket);
 
 	buckets_filled = 0;
 }
@@ -171,10 +226,14 @@ static void normalize_towards_target(pbqp_edge_t *edge)
 	assert(src_vec->len > 0);
 	assert(tgt_len > 0);
 
+	/* Handling a column only changes that column, so the minima of all
+	 * columns are determined in a single pass over the matrix. */
+	num *mins = ALLOCAN(num, tgt_len);
+	pbqp_matrix_get_col_mins(mat, src_vec, mins);
 
 	/* Normalize towards target node. */
 	for (unsigned tgt_index = 0; tgt_index < tgt_len; ++tgt_index) {
-		num min = pbqp_matrix_get_col_min(mat, tgt_index, src_vec);
+		num min = mins[tgt_index];
 
 		if (min != 0) {
 			if (tgt_vec->entries[tgt_index].data == INF_COSTS) {
@@ -630,7 +689,7 @@ void initial_simplify_edges(pbqp_t *pbqp)
 
 	unsigned node_len = pbqp->num_nodes;
 
-	init_buckets();
+	init_buckets(pbqp);
 
 	/* First simplify all edges. */
 	for (unsigned node_index = 0; node_index < node_len; ++node_index) {
@@ -807,7 +866,7 @@ static void back_propagate_RII(pbqp_t *pbqp, pbqp_node_t *node)
 	}
 #endif
 
-	obstack_free(&pbqp->obstack, vec);
+	vector_free(pbqp, vec);
 }
 
 void back_propagate(pbqp_t *pbqp)
@@ -964,30 +1023,30 @@ void apply_RII(pbqp_t *pbqp)
 	vector_t      *node_vec = node->costs;
 	unsigned       col_len  = tgt_vec->len;
 	unsigned       row_len  = src_vec->len;
+	unsigned       node_len = node_vec->len;
 	pbqp_matrix_t *mat      = pbqp_matrix_alloc(pbqp, row_len, col_len);
 
-	for (unsigned row_index = 0; row_index < row_len; ++row_index) {
-		for (unsigned col_index = 0; col_index < col_len; ++col_index) {
-			vector_t *vec = vector_copy(pbqp, node_vec);
-
-			if (src_is_src) {
-				vector_add_matrix_col(vec, src_mat, row_index);
-			} else {
-				vector_add_matrix_row(vec, src_mat, row_index);
-			}
+	/* Work on matrices whose rows belong to the alternatives of the neighbors,
+	 * so all sums below are over contiguous memory. */
+	pbqp_matrix_t *src_rows = src_is_src ? pbqp_matrix_copy_and_transpose(pbqp, src_mat) : src_mat;
+	pbqp_matrix_t *tgt_rows = tgt_is_src ? pbqp_matrix_copy_and_transpose(pbqp, tgt_mat) : tgt_mat;
+	num           *sum      = ALLOCAN(num, node_len);
 
-			if (tgt_is_src) {
-				vector_add_matrix_col(vec, tgt_mat, col_index);
-			} else {
-				vector_add_matrix_row(vec, tgt_mat, col_index);
-			}
-
-			mat->entries[row_index * col_len + col_index] = vector_get_min(vec);
+	for (unsigned row_index = 0; row_index < row_len; ++row_index) {
+		memcpy(sum, VEC_COSTS(node_vec), node_len * sizeof(*sum));
+		costs_add(sum, 1, &src_rows->entries[row_index * node_len], 1, node_len);
 
-			obstack_free(&pbqp->obstack, vec);
+		for (unsigned col_index = 0; col_index < col_len; ++col_index) {
+			mat->entries[row_index * col_len + col_index]
+				= costs_min_sum(sum, 1, &tgt_rows->entries[col_index * node_len], 1, node_len);
 		}
 	}
 
+	if (src_rows != src_mat)
+		pbqp_matrix_free(pbqp, src_rows);
+	if (tgt_rows != tgt_mat)
+		pbqp_matrix_free(pbqp, tgt_rows);
+
 	pbqp_edge_t *edge = get_edge(pbqp, src_node->index, tgt_node->index);
 
 	/* Disconnect node. */
@@ -1008,7 +1067,7 @@ void apply_RII(pbqp_t *pbqp)
 		pbqp_matrix_add(edge->costs, mat);
 
 		/* Free local matrix. */
-		obstack_free(&pbqp->obstack, mat);
+		pbqp_matrix_free(pbqp, mat);
 
 		reorder_node_after_edge_deletion(src_node);
 		reorder_node_after_edge_deletion(tgt_node);
@@ -1151,6 +1210,7 @@ pbqp_node_t *get_node_with_max_degree(void)
 
 unsigned get_local_minimal_alternative(pbqp_t *pbqp, pbqp_node_t *node)
 {
+	(void)pbqp;
 	vector_t *node_vec   = node->costs;
 	unsigned  node_len   = node_vec->len;
 	unsigned  max_degree = pbqp_node_get_degree(node);
@@ -1164,19 +1224,17 @@ unsigned get_local_minimal_alternative(pbqp_t *pbqp, pbqp_node_t *node)
 			pbqp_edge_t   *edge   = node->edges[edge_index];
 			pbqp_matrix_t *mat    = edge->costs;
 			bool           is_src = edge->src == node;
-			vector_t      *vec;
+			num            min;
 
 			if (is_src) {
-				vec = vector_copy(pbqp, edge->tgt->costs);
-				vector_add_matrix_row(vec, mat, node_index);
+				min = costs_min_sum(VEC_COSTS(edge->tgt->costs), VEC_STRIDE,
+				                    &mat->entries[node_index * mat->cols], 1, mat->cols);
 			} else {
-				vec = vector_copy(pbqp, edge->src->costs);
-				vector_add_matrix_col(vec, mat, node_index);
+				min = costs_min_sum(VEC_COSTS(edge->src->costs), VEC_STRIDE,
+				                    &mat->entries[node_index], mat->cols, mat->rows);
 			}
 
-			value = pbqp_add(value, vector_get_min(vec));
-
-			obstack_free(&pbqp->obstack, vec);
+			value = pbqp_add(value, min);
 		}
 
 		if (value < min) {
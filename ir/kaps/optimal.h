@@ -28,7 +28,7 @@ void apply_RM(pbqp_t *pbqp, pbqp_node_t *node);
 void back_propagate(pbqp_t *pbqp);
 num determine_solution(pbqp_t *pbqp);
 void fill_node_buckets(pbqp_t *pbqp);
-void free_buckets(void);
+void free_buckets(pbqp_t *pbqp);
 unsigned get_local_minimal_alternative(pbqp_t *pbqp, pbqp_node_t *node);
 pbqp_node_t *get_node_with_max_degree(void);
 void initial_simplify_edges(pbqp_t *pbqp);
@@ -40,8 +40,9 @@ pbqp_edge_t *alloc_edge(pbqp_t *pbqp, unsigned src_index, unsigned tgt_index,
 
 	if (transpose) {
 		edge->costs = pbqp_matrix_copy_and_transpose(pbqp, costs);
+		pbqp_matrix_free(pbqp, costs);
 	} else {
-		edge->costs = pbqp_matrix_copy(pbqp, costs);
+		edge->costs = costs;
 	}
 
 	/*
@@ -25,7 +25,7 @@ pbqp_node_t *alloc_node(pbqp_t *pbqp, unsigned node_index, vector_t *costs)
 	pbqp_node_t *node = OALLOC(&pbqp->obstack, pbqp_node_t);
 
 	node->edges = NEW_ARR_F(pbqp_edge_t *, 0);
-	node->costs = vector_copy(pbqp, costs);
+	node->costs = costs;
 	node->bucket_index = UINT_MAX;
 	node->solution = UINT_MAX;
 	node->index = node_index;
@@ -35,9 +35,10 @@
 #include "matrix_t.h"
 #include "vector_t.h"
 
-typedef struct pbqp_edge_t pbqp_edge_t;
-typedef struct pbqp_node_t pbqp_node_t;
-typedef struct pbqp_t      pbqp_t;
+typedef struct pbqp_arena_t pbqp_arena_t;
+typedef struct pbqp_edge_t  pbqp_edge_t;
+typedef struct pbqp_node_t  pbqp_node_t;
+typedef struct pbqp_t       pbqp_t;
 
 struct pbqp_t {
 	struct obstack obstack;            /* Obstack. */
@@ -45,6 +46,12 @@ struct pbqp_t {
 	size_t         num_nodes;          /* Number of PBQP nodes. */
 	pbqp_node_t  **nodes;              /* Nodes of PBQP. */
 	FILE          *dump_file;          /* File to dump in. */
+	pbqp_arena_t  *arena;              /* Arena providing the memory or NULL. */
+	void         **free_vectors;       /* Recycled vectors by length. */
+	void         **free_matrices;      /* Recycled matrices by number of entries. */
+	unsigned long  num_allocs;         /* Number of vector and matrix allocations. */
+	unsigned long  num_recycled;       /* Allocations served by recycling. */
+	size_t         recycled_bytes;     /* Bytes served by recycling. */
 #if KAPS_STATISTIC
 	unsigned       num_bf;             /* Number of brute force reductions. */
 	unsigned       num_edges;          /* Number of independent edges. */
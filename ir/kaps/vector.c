@@ -12,6 +12,8 @@
 #include "vector.h"
 
 #include "adt/array.h"
+#include "arena.h"
+#include "costs.h"
 #include <string.h>
 
 num pbqp_add(num x, num y)
@@ -37,12 +39,20 @@ num pbqp_add(num x, num y)
 	return res;
 }
 
-vector_t *vector_alloc(pbqp_t *pbqp, unsigned length)
+static vector_t *vector_alloc_uninitialized(pbqp_t *pbqp, unsigned length)
 {
-	vector_t *vec = (vector_t *)obstack_alloc(&pbqp->obstack, sizeof(*vec) + sizeof(*vec->entries) * length);
 	assert(length > 0);
 
+	vector_t *vec = (vector_t *)pbqp_alloc_costs(pbqp, &pbqp->free_vectors, length, sizeof(*vec) + sizeof(*vec->entries) * length);
 	vec->len = length;
+
+	return vec;
+}
+
+vector_t *vector_alloc(pbqp_t *pbqp, unsigned length)
+{
+	vector_t *vec = vector_alloc_uninitialized(pbqp, length);
+
 	memset(vec->entries, 0, sizeof(*vec->entries) * length);
 
 	return vec;
@@ -51,21 +61,25 @@ vector_t *vector_alloc(pbqp_t *pbqp, unsigned length)
 vector_t *vector_copy(pbqp_t *pbqp, vector_t *v)
 {
 	unsigned  len  = v->len;
-	vector_t *copy = (vector_t *)obstack_copy(&pbqp->obstack, v, sizeof(*copy) + sizeof(*copy->entries) * len);
-	assert(copy);
+	vector_t *copy = vector_alloc_uninitialized(pbqp, len);
+
+	memcpy(copy->entries, v->entries, sizeof(*copy->entries) * len);
 
 	return copy;
 }
 
+void vector_free(pbqp_t *pbqp, vector_t *vec)
+{
+	pbqp_free_costs(&pbqp->free_vectors, vec->len, vec);
+}
+
 void vector_add(vector_t *sum, vector_t *summand)
 {
 	unsigned len = sum->len;
 
 	assert(len == summand->len);
 
-	for (unsigned i = 0; i < len; ++i) {
-		sum->entries[i].data = pbqp_add(sum->entries[i].data, summand->entries[i].data);
-	}
+	costs_add(VEC_COSTS(sum), VEC_STRIDE, VEC_COSTS(summand), VEC_STRIDE, len);
 }
 
 void vector_set(vector_t *vec, unsigned index, num value)
@@ -84,11 +98,7 @@ void vector_set_description(vector_t *vec, unsigned index, const char *name)
 
 void vector_add_value(vector_t *vec, num value)
 {
-	unsigned len = vec->len;
-
-	for (unsigned index = 0; index < len; ++index) {
-		vec->entries[index].data = pbqp_add(vec->entries[index].data, value);
-	}
+	costs_add_value(VEC_COSTS(vec), VEC_STRIDE, value, vec->len);
 }
 
 void vector_add_matrix_col(vector_t *vec, pbqp_matrix_t *mat, unsigned col_index)
@@ -98,9 +108,8 @@ void vector_add_matrix_col(vector_t *vec, pbqp_matrix_t *mat, unsigned col_index
 	assert(len == mat->rows);
 	assert(col_index < mat->cols);
 
-	for (unsigned index = 0; index < len; ++index) {
-		vec->entries[index].data = pbqp_add(vec->entries[index].data, mat->entries[index * mat->cols + col_index]);
-	}
+	costs_add(VEC_COSTS(vec), VEC_STRIDE, &mat->entries[col_index], mat->cols,
+	          len);
 }
 
 void vector_add_matrix_row(vector_t *vec, pbqp_matrix_t *mat, unsigned row_index)
@@ -110,46 +119,20 @@ void vector_add_matrix_row(vector_t *vec, pbqp_matrix_t *mat, unsigned row_index
 	assert(len == mat->cols);
 	assert(row_index < mat->rows);
 
-
-	for (unsigned index = 0; index < len; ++index) {
-		vec->entries[index].data = pbqp_add(vec->entries[index].data, mat->entries[row_index * mat->cols + index]);
-	}
+	costs_add(VEC_COSTS(vec), VEC_STRIDE, &mat->entries[row_index * len], 1,
+	          len);
 }
 
 num vector_get_min(vector_t *vec)
 {
-	unsigned len = vec->len;
-	num      min = INF_COSTS;
-
-	assert(len > 0);
+	assert(vec->len > 0);
 
-	for (unsigned index = 0; index < len; ++index) {
-		num elem = vec->entries[index].data;
-
-		if (elem < min) {
-			min = elem;
-		}
-	}
-
-	return min;
+	return costs_min(VEC_COSTS(vec), VEC_STRIDE, NULL, 0, vec->len);
 }
 
 unsigned vector_get_min_index(vector_t *vec)
 {
-	unsigned len       = vec->len;
-	unsigned min_index = 0;
-	num      min       = INF_COSTS;
-
-	assert(len > 0);
-
-	for (unsigned index = 0; index < len; ++index) {
-		num elem = vec->entries[index].data;
-
-		if (elem < min) {
-			min = elem;
-			min_index = index;
-		}
-	}
+	assert(vec->len > 0);
 
-	return min_index;
+	return costs_min_index(VEC_COSTS(vec), VEC_STRIDE, NULL, 0, vec->len);
 }
@@ -21,6 +21,9 @@ vector_t *vector_alloc(pbqp_t *pbqp, unsigned length);
 /* Copy the given vector. */
 vector_t *vector_copy(pbqp_t *pbqp, vector_t *v);
 
+/* Recycles vec, which must not be used afterwards. */
+void vector_free(pbqp_t *pbqp, vector_t *vec);
+
 /* sum += summand */
 void vector_add(vector_t *sum, vector_t *summand);
 
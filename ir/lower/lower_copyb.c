@@ -6,10 +6,17 @@
 /**
  * @file
  * @brief   Lower small CopyB nodes into a series of Load/Store nodes
+ *
+ * Small copies use the widest access mode the target offers.  If misaligned
+ * accesses are allowed, a tail that does not fill a whole access is covered
+ * by a single access overlapping the previous one.  Copies from zero
+ * initialized constants and memset calls filling memory with zero are turned
+ * into Stores of zero.
  * @author  Michael Beck, Matthias Braun, Manuel Mohr
  */
 #include "adt/list.h"
-#include "ircons.h"
+#include "bitfiddle.h"
+#include "ircons_t.h"
 #include "irgmod.h"
 #include "irgwalk.h"
 #include "irnode_t.h"
@@ -20,21 +27,27 @@
 #include "target_t.h"
 #include "type_t.h"
 #include "util.h"
+#include <limits.h>
 
 static unsigned max_small_size; /**< The maximum size of a CopyB node
                                      so that it is regarded as 'small'. */
 static unsigned min_large_size; /**< The minimum size of a CopyB node
                                      so that it is regarded as 'large'. */
 static unsigned native_mode_bytes; /**< The size of the native mode in bytes. */
+static ir_mode *wide_mode; /**< The widest mode for loads and stores or NULL
+                                if it is the native mode. */
 static bool allow_misalignments; /**< Whether backend can handle misaligned
                                       loads and stores. */
 
 typedef struct walk_env {
-	ir_node **copybs; /**< The list of CopyB nodes. */
+	ir_node **nodes; /**< The list of nodes to lower. */
 } walk_env_t;
 
 static ir_mode *get_ir_mode(unsigned mode_bytes)
 {
+	if (wide_mode != NULL && mode_bytes == get_mode_size_bytes(wide_mode))
+		return wide_mode;
+
 	switch (mode_bytes) {
 	case 1:  return mode_Bu;
 	case 2:  return mode_Hu;
@@ -45,52 +58,200 @@ static ir_mode *get_ir_mode(unsigned mode_bytes)
 	}
 }
 
+/**
+ * Returns the size of the widest access to memory aligned to @p alignment.
+ */
+static unsigned get_max_access_bytes(unsigned alignment)
+{
+	unsigned max_bytes = wide_mode != NULL ? get_mode_size_bytes(wide_mode)
+	                                       : native_mode_bytes;
+	if (allow_misalignments)
+		return max_bytes;
+	return MIN(floor_po2(alignment), max_bytes);
+}
+
+typedef void (*access_func)(void *env, unsigned offset, ir_mode *mode);
+
+/**
+ * Splits @p size bytes into accesses of at most @p max_bytes bytes and calls
+ * @p func for each of them.  If @p overlap is set, the tail is covered by a
+ * single access overlapping the previous one instead of a series of
+ * smaller accesses.
+ */
+static void split_into_accesses(unsigned size, unsigned max_bytes,
+                                bool overlap, access_func func, void *env)
+{
+	unsigned offset     = 0;
+	unsigned mode_bytes = max_bytes;
+	while (offset < size) {
+		ir_mode *mode = get_ir_mode(mode_bytes);
+		for (; offset + mode_bytes <= size; offset += mode_bytes)
+			func(env, offset, mode);
+
+		unsigned const rest = size - offset;
+		if (overlap && offset > 0 && rest > 0) {
+			unsigned const tail_bytes = ceil_po2(rest);
+			func(env, size - tail_bytes, get_ir_mode(tail_bytes));
+			return;
+		}
+
+		mode_bytes /= 2;
+	}
+}
+
+typedef struct access_env_t {
+	dbg_info      *dbgi;
+	ir_node       *block;
+	ir_type       *type;  /**< accessed type, NULL for the access mode */
+	ir_node       *src;   /**< source address, NULL for a zero fill */
+	ir_node       *dst;
+	ir_node       *mem;   /**< memory of the accesses */
+	ir_node      **syncs; /**< memory results of independent stores */
+	ir_cons_flags  flags;
+} access_env_t;
+
+static ir_node *get_access_address(ir_node *block, ir_node *base,
+                                   unsigned offset)
+{
+	if (offset == 0)
+		return base;
+
+	ir_graph *irg          = get_irn_irg(block);
+	ir_mode  *mode_ref_int = get_reference_offset_mode(get_irn_mode(base));
+	ir_node  *addr_const   = new_r_Const_long(irg, mode_ref_int, offset);
+	return new_r_Add(block, base, addr_const);
+}
+
+static void copy_access(void *ctx, unsigned offset, ir_mode *mode)
+{
+	access_env_t *env      = (access_env_t*)ctx;
+	ir_node      *addr_src = get_access_address(env->block, env->src, offset);
+	ir_node      *load     = new_rd_Load(env->dbgi, env->block, env->mem,
+	                                     addr_src, mode, env->type, env->flags);
+	ir_node      *load_res = new_r_Proj(load, mode, pn_Load_res);
+	ir_node      *load_mem = new_r_Proj(load, mode_M, pn_Load_M);
+
+	ir_node *addr_dst  = get_access_address(env->block, env->dst, offset);
+	ir_node *store     = new_rd_Store(env->dbgi, env->block, load_mem, addr_dst,
+	                                  load_res, env->type, env->flags);
+	env->mem = new_r_Proj(store, mode_M, pn_Store_M);
+}
+
+static void zero_access(void *ctx, unsigned offset, ir_mode *mode)
+{
+	access_env_t *env   = (access_env_t*)ctx;
+	ir_graph     *irg   = get_irn_irg(env->block);
+	ir_node      *addr  = get_access_address(env->block, env->dst, offset);
+	ir_node      *zero  = new_r_Const_null(irg, mode);
+	ir_type      *type  = env->type != NULL ? env->type : get_type_for_mode(mode);
+	ir_node      *store = new_rd_Store(env->dbgi, env->block, env->mem, addr,
+	                                   zero, type, env->flags);
+	ARR_APP1(ir_node*, env->syncs, new_r_Proj(store, mode_M, pn_Store_M));
+}
+
+/**
+ * Fills @p size bytes at @p dst with zero using independent Stores and
+ * returns the resulting memory.
+ */
+static ir_node *create_zero_fill(dbg_info *dbgi, ir_node *block, ir_node *mem,
+                                 ir_node *dst, ir_type *type, unsigned size,
+                                 unsigned max_bytes, ir_cons_flags flags)
+{
+	access_env_t env = {
+		.dbgi  = dbgi,
+		.block = block,
+		.type  = type,
+		.dst   = dst,
+		.mem   = mem,
+		.syncs = NEW_ARR_F(ir_node*, 0),
+		.flags = flags,
+	};
+	/* The Stores all write zero, so overlapping ones need no order. */
+	split_into_accesses(size, max_bytes, allow_misalignments, zero_access,
+	                    &env);
+
+	size_t n_syncs = ARR_LEN(env.syncs);
+	ir_node *res = n_syncs == 0 ? mem
+	             : n_syncs == 1 ? env.syncs[0]
+	             : new_r_Sync(block, n_syncs, env.syncs);
+	DEL_ARR_F(env.syncs);
+	return res;
+}
+
+static bool initializer_is_zero(const ir_initializer_t *initializer)
+{
+	switch (get_initializer_kind(initializer)) {
+	case IR_INITIALIZER_NULL:
+		return true;
+	case IR_INITIALIZER_TARVAL:
+		return tarval_is_null(get_initializer_tarval_value(initializer));
+	case IR_INITIALIZER_CONST:
+		return is_irn_null(get_initializer_const_value(initializer));
+	case IR_INITIALIZER_COMPOUND:
+		for (size_t i = 0, n = get_initializer_compound_n_entries(initializer);
+		     i < n; ++i) {
+			if (!initializer_is_zero(get_initializer_compound_value(initializer, i)))
+				return false;
+		}
+		return true;
+	}
+	panic("invalid initializer");
+}
+
+/**
+ * Returns whether @p addr points to a constant which is all zero, as emitted
+ * by frontends for zero initialized aggregates.
+ */
+static bool is_zero_constant(const ir_node *addr)
+{
+	if (!is_Address(addr))
+		return false;
+
+	ir_entity *entity = get_Address_entity(addr);
+	if (!(get_entity_linkage(entity) & IR_LINKAGE_CONSTANT))
+		return false;
+
+	ir_initializer_t *initializer = get_entity_initializer(entity);
+	return initializer != NULL && initializer_is_zero(initializer);
+}
+
 /**
  * Turn a small CopyB node into a series of Load/Store nodes.
  */
 static void lower_small_copyb_node(ir_node *irn)
 {
-	ir_graph      *irg         = get_irn_irg(irn);
 	dbg_info      *dbgi        = get_irn_dbg_info(irn);
 	ir_node       *block       = get_nodes_block(irn);
 	ir_type       *tp          = get_CopyB_type(irn);
 	ir_node       *addr_src    = get_CopyB_src(irn);
 	ir_node       *addr_dst    = get_CopyB_dst(irn);
 	ir_node       *mem         = get_CopyB_mem(irn);
-	ir_mode       *mode_ref    = get_irn_mode(addr_src);
-	unsigned       mode_bytes  = allow_misalignments ? native_mode_bytes
-	                                                 : get_type_alignment(tp);
+	unsigned       max_bytes   = get_max_access_bytes(get_type_alignment(tp));
 	unsigned       size        = get_type_size(tp);
-	unsigned       offset      = 0;
 	bool           is_volatile = get_CopyB_volatility(irn) == volatility_is_volatile;
 	ir_cons_flags  flags       = is_volatile ? cons_volatile : cons_none;
 
-	while (offset < size) {
-		ir_mode *mode = get_ir_mode(mode_bytes);
-		for (; offset + mode_bytes <= size; offset += mode_bytes) {
-			ir_mode *mode_ref_int = get_reference_offset_mode(mode_ref);
-
-			/* construct offset */
-			ir_node *addr_const = new_r_Const_long(irg, mode_ref_int, offset);
-			ir_node *add        = new_r_Add(block, addr_src, addr_const);
-
-			ir_node *load     = new_rd_Load(dbgi, block, mem, add, mode, tp, flags);
-			ir_node *load_res = new_r_Proj(load, mode, pn_Load_res);
-			ir_node *load_mem = new_r_Proj(load, mode_M, pn_Load_M);
-
-			ir_node *addr_const2 = new_r_Const_long(irg, mode_ref_int, offset);
-			ir_node *add2        = new_r_Add(block, addr_dst, addr_const2);
-
-			ir_node *store     = new_rd_Store(dbgi, block, load_mem, add2, load_res, tp, flags);
-			ir_node *store_mem = new_r_Proj(store, mode_M, pn_Store_M);
-
-			mem = store_mem;
-		}
-
-		mode_bytes /= 2;
+	if (!is_volatile && is_zero_constant(addr_src)) {
+		mem = create_zero_fill(dbgi, block, mem, addr_dst, tp, size,
+		                       max_bytes, flags);
+		exchange(irn, mem);
+		return;
 	}
 
-	exchange(irn, mem);
+	access_env_t env = {
+		.dbgi  = dbgi,
+		.block = block,
+		.type  = tp,
+		.src   = addr_src,
+		.dst   = addr_dst,
+		.mem   = mem,
+		.flags = flags,
+	};
+	/* Volatile memory must be accessed exactly once. */
+	split_into_accesses(size, max_bytes, allow_misalignments && !is_volatile,
+	                    copy_access, &env);
+
+	exchange(irn, env.mem);
 }
 
 static ir_type *get_memcpy_methodtype(void)
@@ -171,29 +332,123 @@ static void find_copyb_nodes(ir_node *irn, void *ctx)
 
 	/* Okay, either small or large CopyB, so link it in and lower it later. */
 	walk_env_t *env = (walk_env_t*)ctx;
-	ARR_APP1(ir_node*, env->copybs, irn);
+	ARR_APP1(ir_node*, env->nodes, irn);
 }
 
-void lower_CopyB(ir_graph *irg, unsigned max_small_sz, unsigned min_large_sz,
-                 int allow_misaligns)
+/**
+ * Returns whether @p call is memset(dst, 0, size) with a constant size
+ * between 1 and @p max_size.
+ */
+static bool is_small_zero_fill(const ir_node *call, unsigned max_size)
 {
-	assert(max_small_sz < min_large_sz && "CopyB size ranges must not overlap");
+	ir_entity *callee = get_Call_callee(call);
+	if (callee == NULL || !streq(get_entity_name(callee), "memset")
+	    || get_Call_n_params(call) != 3 || ir_throws_exception(call))
+		return false;
+
+	ir_type *call_tp = get_Call_type(call);
+	if (get_method_n_ress(call_tp) > 1)
+		return false;
+
+	ir_node *value = get_Call_param(call, 1);
+	ir_node *len   = get_Call_param(call, 2);
+	if (!is_irn_null(value) || !is_Const(len))
+		return false;
+
+	ir_tarval *tv = get_Const_tarval(len);
+	if (!tarval_is_long(tv))
+		return false;
+	long size = get_tarval_long(tv);
+	return 0 < size && size <= (long)max_size;
+}
+
+/**
+ * Turn memset(dst, 0, size) into Stores of zero.
+ */
+static void lower_zero_fill_call(ir_node *call)
+{
+	dbg_info *dbgi  = get_irn_dbg_info(call);
+	ir_node  *block = get_nodes_block(call);
+	ir_node  *dst   = get_Call_param(call, 0);
+	unsigned  size  = get_Const_long(get_Call_param(call, 2));
+	unsigned  bytes = get_max_access_bytes(1);
+	ir_node  *mem   = create_zero_fill(dbgi, block, get_Call_mem(call), dst,
+	                                   NULL, size, bytes, cons_none);
+
+	ir_node *const res  = new_r_Tuple(block, 1, &dst);
+	ir_node *const in[] = {
+		[pn_Call_M]        = mem,
+		[pn_Call_T_result] = res,
+	};
+	turn_into_tuple(call, ARRAY_SIZE(in), in);
+}
+
+/**
+ * Post-Walker: find memset calls filling small blocks with zero.
+ */
+static void find_zero_fill_calls(ir_node *irn, void *ctx)
+{
+	walk_env_t *env = (walk_env_t*)ctx;
+	if (is_Call(irn) && is_small_zero_fill(irn, max_small_size))
+		ARR_APP1(ir_node*, env->nodes, irn);
+}
 
+static void init_parameters(unsigned max_small_sz, unsigned min_large_sz,
+                            ir_mode *wide, int allow_misaligns)
+{
 	max_small_size      = max_small_sz;
 	min_large_size      = min_large_sz;
 	native_mode_bytes   = ir_target_pointer_size();
+	wide_mode           = wide;
 	allow_misalignments = allow_misaligns;
 
-	walk_env_t env = { .copybs = NEW_ARR_F(ir_node*, 0) };
+	assert((wide == NULL || (get_mode_size_bytes(wide) > native_mode_bytes
+	        && is_po2_or_zero(get_mode_size_bytes(wide))))
+	       && "wide mode must be a power of two larger than a pointer");
+}
+
+void lower_CopyB_wide(ir_graph *irg, unsigned max_small_sz,
+                      unsigned min_large_sz, ir_mode *wide,
+                      int allow_misaligns)
+{
+	assert(max_small_sz < min_large_sz && "CopyB size ranges must not overlap");
+
+	init_parameters(max_small_sz, min_large_sz, wide, allow_misaligns);
+
+	walk_env_t env = { .nodes = NEW_ARR_F(ir_node*, 0) };
 	irg_walk_graph(irg, NULL, find_copyb_nodes, &env);
 
 	bool changed = false;
-	for (size_t i = 0, n = ARR_LEN(env.copybs); i != n; ++i) {
-		lower_copyb_node(env.copybs[i]);
+	for (size_t i = 0, n = ARR_LEN(env.nodes); i != n; ++i) {
+		lower_copyb_node(env.nodes[i]);
+		changed = true;
+	}
+	confirm_irg_properties(irg, changed ? IR_GRAPH_PROPERTIES_CONTROL_FLOW
+	                                    : IR_GRAPH_PROPERTIES_ALL);
+
+	DEL_ARR_F(env.nodes);
+}
+
+void lower_CopyB(ir_graph *irg, unsigned max_small_sz, unsigned min_large_sz,
+                 int allow_misaligns)
+{
+	lower_CopyB_wide(irg, max_small_sz, min_large_sz, NULL, allow_misaligns);
+}
+
+void lower_zero_fill(ir_graph *irg, unsigned max_size, ir_mode *wide)
+{
+	init_parameters(max_size, UINT_MAX, wide, true);
+
+	walk_env_t env = { .nodes = NEW_ARR_F(ir_node*, 0) };
+	irg_walk_graph(irg, NULL, find_zero_fill_calls, &env);
+
+	bool changed = false;
+	for (size_t i = 0, n = ARR_LEN(env.nodes); i != n; ++i) {
+		lower_zero_fill_call(env.nodes[i]);
 		changed = true;
 	}
 	confirm_irg_properties(irg, changed ? IR_GRAPH_PROPERTIES_CONTROL_FLOW
 	                                    : IR_GRAPH_PROPERTIES_ALL);
 
-	DEL_ARR_F(env.copybs);
+	DEL_ARR_F(env.nodes);
 }
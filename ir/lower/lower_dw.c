@@ -999,6 +999,93 @@ static void lower_Shl(ir_node *const node)
 	ir_set_dw_lowered(node, phi_low, phi_high);
 }
 
+ir_node *ir_dw_select_by_mask(dbg_info *const dbgi, ir_node *const block,
+                              ir_node *const amount, ir_node *const if_small,
+                              ir_node *const if_big)
+{
+	/* move the word size bit of the amount to the sign bit and smear it */
+	ir_graph *const irg     = get_irn_irg(block);
+	ir_mode  *const mode    = get_irn_mode(if_small);
+	unsigned  const bits    = get_mode_size_bits(env.p.word_unsigned);
+	ir_node  *const to_top  = new_r_Const_long(irg, env.p.word_unsigned,
+	                                           bits - 1 - log2_floor(bits));
+	ir_node  *const top     = new_rd_Shl(dbgi, block, amount, to_top);
+	ir_node  *const stop    = create_conv(block, top, env.p.word_signed);
+	ir_node  *const sign    = new_r_Const_long(irg, env.p.word_unsigned,
+	                                           bits - 1);
+	ir_node  *const smeared = new_rd_Shrs(dbgi, block, stop, sign);
+	ir_node  *const mask    = create_conv(block, smeared, mode);
+	ir_node  *const diff    = new_rd_Eor(dbgi, block, if_small, if_big);
+	ir_node  *const masked  = new_rd_And(dbgi, block, diff, mask);
+	return new_rd_Eor(dbgi, block, if_small, masked);
+}
+
+void ir_lower_dw_shift_select(ir_node *const node,
+                              lower_dw_select_func const select)
+{
+	ir_node  *const block        = get_nodes_block(node);
+	dbg_info *const dbgi         = get_irn_dbg_info(node);
+	ir_graph *const irg          = get_irn_irg(node);
+	ir_mode  *const low_unsigned = env.p.word_unsigned;
+	ir_mode  *const mode         = get_node_high_mode(node);
+	ir_node  *const left         = get_binop_left(node);
+	ir_node  *const left_low     = get_lowered_low(left);
+	ir_node  *const left_high    = get_lowered_high(left);
+	assert(get_mode_modulo_shift(get_irn_mode(node))
+	       == get_mode_size_bits(get_irn_mode(node)));
+	assert(get_mode_modulo_shift(mode) == get_mode_size_bits(mode));
+
+	ir_node *right = get_binop_right(node);
+	assert(!mode_is_signed(get_irn_mode(right)));
+	if (needs_lowering(get_irn_mode(right))) {
+		right = get_lowered_low(right);
+	} else {
+		right = create_conv(block, right, low_unsigned);
+	}
+
+	/* for amounts below the word size, the bits moving from one word into
+	 * the other are shifted by 1 and ~amount, because shifting by
+	 * word size - amount does not work for amount 0 */
+	ir_node *const one       = new_r_Const_one(irg, low_unsigned);
+	ir_node *const not_right = new_rd_Not(dbgi, block, right);
+	ir_node *res_low;
+	ir_node *res_high;
+	if (is_Shl(node)) {
+		ir_node *const low      = new_rd_Shl(dbgi, block, left_low, right);
+		ir_node *const conv     = create_conv(block, left_low, mode);
+		ir_node *const carry0   = new_rd_Shr(dbgi, block, conv, one);
+		ir_node *const carry1   = new_rd_Shr(dbgi, block, carry0, not_right);
+		ir_node *const shifted  = new_rd_Shl(dbgi, block, left_high, right);
+		ir_node *const high     = new_rd_Or(dbgi, block, shifted, carry1);
+		ir_node *const low_high = create_conv(block, low, mode);
+		ir_node *const zero     = new_r_Const_null(irg, low_unsigned);
+		res_low  = select(dbgi, block, right, low, zero);
+		res_high = select(dbgi, block, right, high, low_high);
+	} else {
+		bool     const is_shrs  = is_Shrs(node);
+		ir_node *const high     = is_shrs
+			? new_rd_Shrs(dbgi, block, left_high, right)
+			: new_rd_Shr(dbgi, block, left_high, right);
+		ir_node *const conv     = create_conv(block, left_high, low_unsigned);
+		ir_node *const carry0   = new_rd_Shl(dbgi, block, conv, one);
+		ir_node *const carry1   = new_rd_Shl(dbgi, block, carry0, not_right);
+		ir_node *const shifted  = new_rd_Shr(dbgi, block, left_low, right);
+		ir_node *const low      = new_rd_Or(dbgi, block, shifted, carry1);
+		ir_node *const high_low = create_conv(block, high, low_unsigned);
+		ir_node *fill;
+		if (is_shrs) {
+			ir_node *const sign = new_r_Const_long(irg, low_unsigned,
+			                                       get_mode_size_bits(mode) - 1);
+			fill = new_rd_Shrs(dbgi, block, left_high, sign);
+		} else {
+			fill = new_r_Const_null(irg, mode);
+		}
+		res_low  = select(dbgi, block, right, low, high_low);
+		res_high = select(dbgi, block, right, high, fill);
+	}
+	ir_set_dw_lowered(node, res_low, res_high);
+}
+
 /**
  * Translate a Minus operation.
  *
@@ -84,6 +84,30 @@ static inline ir_node *get_lowered_high(ir_node *node)
 
 void ir_default_lower_dw_Conv(ir_node *node);
 
+/**
+ * Chooses @p if_small if the shift amount @p amount is less than the word
+ * size and @p if_big otherwise.  Must not create control flow.
+ */
+typedef ir_node *(*lower_dw_select_func)(dbg_info *dbgi, ir_node *block,
+                                         ir_node *amount, ir_node *if_small,
+                                         ir_node *if_big);
+
+/**
+ * Selects with a mask derived from the shift amount, suitable for targets
+ * without conditional moves.
+ */
+ir_node *ir_dw_select_by_mask(dbg_info *dbgi, ir_node *block, ir_node *amount,
+                              ir_node *if_small, ir_node *if_big);
+
+/**
+ * Lowers a doubleword Shl, Shr or Shrs without control flow.  The result for
+ * shift amounts below the word size uses the double shift pattern
+ * Or(Shl(high, c), Shr(Shr(low, 1), Not(c))), which backends can match to a
+ * single instruction; @p select chooses between it and the result for larger
+ * amounts.
+ */
+void ir_lower_dw_shift_select(ir_node *node, lower_dw_select_func select);
+
 /**
  * We need a custom version of part_block_edges because during transformation
  * not all data-dependencies are explicit yet if a lowered nodes users are not
@@ -5,18 +5,19 @@
 
 /**
  * @file
- * @brief   Lower floating point operations to function calls
+ * @brief   Lower floating point operations to integer operations and
+ *          function calls
  * @author  Sebastian Buchwald
  */
 #include "lower_softfloat.h"
 
+#include "array.h"
 #include "dbginfo_t.h"
 #include "ircons_t.h"
 #include "iredges_t.h"
 #include "irgmod.h"
 #include "irgwalk.h"
 #include "irmode_t.h"
-#include "irnodeset.h"
 #include "irop_t.h"
 #include "iropt_dbg.h"
 #include "iroptimize.h"
@@ -24,19 +25,16 @@
 #include "lowering.h"
 #include "panic.h"
 #include "pmap.h"
-#include "target_t.h"
+#include "target.h"
 #include "tv_t.h"
 #include "type_t.h"
+#include "util.h"
 #include <stdbool.h>
 
 typedef bool (*lower_softfloat_func)(ir_node *node);
 
 static ir_type *binop_tp_d;
 static ir_type *binop_tp_f;
-static ir_type *cmp_tp_d;
-static ir_type *cmp_tp_f;
-static ir_type *unop_tp_d;
-static ir_type *unop_tp_f;
 static ir_type *unop_tp_d_f;
 static ir_type *unop_tp_d_is;
 static ir_type *unop_tp_d_iu;
@@ -59,7 +57,9 @@ static ir_type *unop_tp_lu_f;
 /** A map from a method type to its lowered type. */
 static pmap *lowered_type;
 
-static ir_nodeset_t created_mux_nodes;
+/** Whether the target has a clz instruction for exact int to float
+ * conversions. */
+static bool native_clz;
 
 /**
  * @return The lowered (floating point) mode.
@@ -127,12 +127,6 @@ static ir_type *get_softfloat_type(const ir_node *n)
 		else if (operand_mode == mode_D)
 			return binop_tp_d;
 		break;
-	case iro_Cmp:
-		if (operand_mode == mode_F)
-			return cmp_tp_f;
-		else if (operand_mode == mode_D)
-			return cmp_tp_d;
-		break;
 
 	case iro_Conv: {
 		ir_mode *const mode = get_irn_mode(n);
@@ -183,13 +177,6 @@ static ir_type *get_softfloat_type(const ir_node *n)
 		}
 		break;
 	}
-
-	case iro_Minus:
-		if (operand_mode == mode_F)
-			return unop_tp_f;
-		else if (operand_mode == mode_D)
-			return unop_tp_d;
-		break;
 	default: break;
 	}
 
@@ -291,6 +278,51 @@ static ir_node *make_softfloat_call(ir_node *const n, char const *const name,
 	return result;
 }
 
+/**
+ * @return A Const of mode @p mode with the bits @p value << @p shift.
+ */
+static ir_node *new_shifted_Const(ir_graph *const irg, ir_mode *const mode,
+                                  long const value, unsigned const shift)
+{
+	ir_tarval *const tv = new_tarval_from_long(value, mode);
+	return new_r_Const(irg, tarval_shl_unsigned(tv, shift));
+}
+
+/**
+ * @return A Const of the integer mode @p mode with only the sign bit of a
+ *         float with the same size set.
+ */
+static ir_node *new_sign_Const(ir_graph *const irg, ir_mode *const mode)
+{
+	return new_shifted_Const(irg, mode, 1, get_mode_size_bits(mode) - 1);
+}
+
+/**
+ * @return A Const of the integer mode @p mode with the bits of +infinity in
+ *         the float mode @p float_mode.
+ */
+static ir_node *new_inf_Const(ir_graph *const irg, ir_mode *const mode,
+                              ir_mode *const float_mode)
+{
+	long const exponent_mask = (1L << get_mode_exponent_size(float_mode)) - 1;
+	return new_shifted_Const(irg, mode, exponent_mask,
+	                         get_mode_mantissa_size(float_mode));
+}
+
+/**
+ * @return The integer mode of the target platform for the inline operations
+ *         on the bits of the float mode @p mode.  Unlike the lowered modes,
+ *         it has the modulo shift of the target.
+ */
+static ir_mode *get_bits_mode(ir_mode *const mode, bool const is_signed)
+{
+	ir_platform_type_t const type = mode == mode_F ? IR_TYPE_INT
+	                                               : IR_TYPE_LONG_LONG;
+	ir_mode *const bits_mode = ir_platform_type_mode(type, is_signed);
+	assert(get_mode_size_bits(bits_mode) == get_mode_size_bits(mode));
+	return bits_mode;
+}
+
 /**
  * Transforms an Add into the appropriate soft float function.
  */
@@ -381,6 +413,57 @@ static ir_type *lower_type_if_needed(ir_type *tp)
 	}
 }
 
+/**
+ * Transforms a Call of fabs() or fabsf() into a clear of the sign bit.
+ */
+static bool lower_fabs_Call(ir_node *const n)
+{
+	ir_node *const callee = get_Call_ptr(n);
+	if (!is_Address(callee) || get_Call_n_params(n) != 1
+	    || ir_throws_exception(n))
+		return false;
+
+	ir_type    *const type = get_Call_type(n);
+	ir_node    *const op   = get_Call_param(n, 0);
+	ir_mode    *const mode = get_irn_mode(op);
+	char const *const name = get_entity_ld_name(get_Address_entity(callee));
+	if (!(mode == mode_D && streq(name, "fabs"))
+	    && !(mode == mode_F && streq(name, "fabsf")))
+		return false;
+	if (get_method_n_ress(type) != 1
+	    || get_type_mode(get_method_res_type(type, 0)) != mode)
+		return false;
+
+	dbg_info *const dbgi     = get_irn_dbg_info(n);
+	ir_node  *const block    = get_nodes_block(n);
+	ir_graph *const irg      = get_irn_irg(n);
+	ir_mode  *const mode_u   = get_lowered_mode(mode);
+	ir_node  *const bits     = new_rd_Bitcast(dbgi, block, op, mode_u);
+	ir_node  *const sign_bit = new_sign_Const(irg, mode_u);
+	ir_node  *const abs_mask = new_rd_Not(dbgi, block, sign_bit);
+	ir_node  *const abs      = new_rd_And(dbgi, block, bits, abs_mask);
+	ir_node  *const result   = new_rd_Bitcast(dbgi, block, abs, mode);
+
+	foreach_out_edge_safe(n, edge) {
+		ir_node *const proj = get_edge_src_irn(edge);
+		switch ((pn_Call)get_Proj_num(proj)) {
+		case pn_Call_M:
+			exchange(proj, get_Call_mem(n));
+			continue;
+		case pn_Call_T_result:
+			foreach_out_edge_safe(proj, res_edge) {
+				exchange(get_edge_src_irn(res_edge), result);
+			}
+			continue;
+		case pn_Call_X_regular:
+		case pn_Call_X_except:
+			break;
+		}
+		panic("unexpected Proj number");
+	}
+	return true;
+}
+
 /**
  * Adapts the method type of a Call.
  */
@@ -411,7 +494,34 @@ static bool lower_Builtin(ir_node *node)
 }
 
 /**
- * Transforms a Cmp into the appropriate soft float function.
+ * @return A signed integer key for the float with the signed integer bits
+ *         @p bits, whose order is the order of the floats with -0 equal to
+ *         +0.  @p nan is set to a value which is negative iff the float is a
+ *         NaN.
+ */
+static ir_node *new_order_key(dbg_info *const dbgi, ir_node *const block,
+                              ir_node *const bits, ir_mode *const float_mode,
+                              ir_node **const nan)
+{
+	ir_graph *const irg      = get_irn_irg(block);
+	ir_mode  *const mode     = get_irn_mode(bits);
+	ir_node  *const sign_bit = new_sign_Const(irg, mode);
+	ir_node  *const abs_mask = new_rd_Not(dbgi, block, sign_bit);
+	ir_node  *const abs      = new_rd_And(dbgi, block, bits, abs_mask);
+	ir_node  *const inf      = new_inf_Const(irg, mode, float_mode);
+	*nan = new_rd_Sub(dbgi, block, inf, abs);
+
+	ir_node *const top  = new_r_Const_long(irg, mode_Iu,
+	                                       get_mode_size_bits(mode) - 1);
+	ir_node *const sign = new_rd_Shrs(dbgi, block, bits, top);
+	ir_node *const flip = new_rd_Eor(dbgi, block, abs, sign);
+	return new_rd_Sub(dbgi, block, flip, sign);
+}
+
+/**
+ * Transforms a Cmp into an integer Cmp of the order keys of its operands.
+ * If an operand is a NaN, the keys are replaced by a pair, whose integer
+ * relation yields the result for unordered operands.
  */
 static bool lower_Cmp(ir_node *const n)
 {
@@ -420,98 +530,59 @@ static bool lower_Cmp(ir_node *const n)
 	if (!mode_is_float(op_mode))
 		return false;
 
-	dbg_info *const dbgi = get_irn_dbg_info(n);
-	ir_graph *const irg  = get_irn_irg(n);
-	ir_node  *const zero = new_rd_Const_null(dbgi, irg, mode_Is);
-
-	char const  *name     = NULL;
-	char const  *name2    = NULL;
-	ir_node     *result   = NULL;
-	ir_relation  relation = get_Cmp_relation(n);
-	switch (relation) {
-	case ir_relation_false:
-		result = zero;
-		break;
-	case ir_relation_equal:
-		name = "eq";
-		break;
-	case ir_relation_less:
-		name = "lt";
-		break;
-	case ir_relation_greater:
-		name = "gt";
-		break;
-	case ir_relation_unordered:
-		name     = "unord";
-		relation = ir_relation_less_greater;
-		break;
-	case ir_relation_less_equal:
-		name = "le";
-		break;
-	case ir_relation_greater_equal:
-		name = "ge";
-		break;
-	case ir_relation_less_greater:
-		name  = "unord";
-		name2 = "ne";
-		break;
-	case ir_relation_less_equal_greater:
-		name     = "unord";
-		relation = ir_relation_equal;
-		break;
-	case ir_relation_unordered_equal:
-		name     = "unord";
-		relation = ir_relation_less_greater;
-		name2    = "ne";
-		break;
-	case ir_relation_unordered_less:
-		name     = "ge";
-		relation = ir_relation_less;
-		break;
-	case ir_relation_unordered_less_equal:
-		name     = "gt";
-		relation = ir_relation_less_equal;
-		break;
-	case ir_relation_unordered_greater:
-		name     = "le";
-		relation = ir_relation_greater;
-		break;
-	case ir_relation_unordered_greater_equal:
-		name     = "lt";
-		relation = ir_relation_greater_equal;
-		break;
-	case ir_relation_unordered_less_greater:
-		name     = "eq";
-		relation = ir_relation_less_greater;
-		break;
-	case ir_relation_true:
-		result = zero;
-		break;
-	}
-
-	ir_node *const block = get_nodes_block(n);
-	ir_node *const right = get_Cmp_right(n);
-
-	if (result == NULL) {
-		ir_node *const in[] = { left, right };
-		result = make_softfloat_call(n, name, ARRAY_SIZE(in), in);
+	dbg_info   *const dbgi      = get_irn_dbg_info(n);
+	ir_node    *const block     = get_nodes_block(n);
+	ir_graph   *const irg       = get_irn_irg(n);
+	ir_node    *const right     = get_Cmp_right(n);
+	ir_relation const relation  = get_Cmp_relation(n);
+	ir_relation const ordered   = relation & ir_relation_less_equal_greater;
+	bool        const unordered = relation & ir_relation_unordered;
+	ir_mode    *const mode      = get_bits_mode(op_mode, true);
+	ir_node    *const zero      = new_r_Const_null(irg, mode);
+
+	if (relation == ir_relation_false || relation == ir_relation_true) {
+		exchange(n, new_rd_Cmp(dbgi, block, zero, zero, relation));
+		return true;
 	}
 
-	ir_node *cmp = new_r_Cmp(block, result, zero, relation);
-
-	/* We need two calls into the softfloat library */
-	if (name2 != NULL) {
-		ir_node *const in[] = { left, right };
-		result   = make_softfloat_call(n, name2, ARRAY_SIZE(in), in);
-		relation = get_Cmp_relation(n);
-
-		ir_node *const mux = new_rd_Mux(dbgi, block, cmp, result, zero);
-
-		arch_allow_ifconv_func const allow_ifconv = ir_target.allow_ifconv;
-		if (!allow_ifconv(cmp, result, zero))
-			ir_nodeset_insert(&created_mux_nodes, mux);
-
-		cmp = new_r_Cmp(block, mux, zero, relation);
+	ir_node *const left_bits  = new_rd_Bitcast(dbgi, block, left, mode);
+	ir_node *const right_bits = new_rd_Bitcast(dbgi, block, right, mode);
+	ir_node       *left_nan;
+	ir_node       *right_nan;
+	ir_node       *left_key   = new_order_key(dbgi, block, left_bits, op_mode,
+	                                          &left_nan);
+	ir_node       *right_key  = new_order_key(dbgi, block, right_bits, op_mode,
+	                                          &right_nan);
+
+	/* All bits are set iff an operand is a NaN. */
+	ir_node *const any_nan = new_rd_Or(dbgi, block, left_nan, right_nan);
+	ir_node *const top     = new_r_Const_long(irg, mode_Iu,
+	                                          get_mode_size_bits(mode) - 1);
+	ir_node *const nan     = new_rd_Shrs(dbgi, block, any_nan, top);
+
+	ir_node *cmp;
+	if (ordered == ir_relation_false) {
+		cmp = new_rd_Cmp(dbgi, block, nan, zero, ir_relation_less_greater);
+	} else if (ordered == ir_relation_less_equal_greater) {
+		assert(!unordered);
+		cmp = new_rd_Cmp(dbgi, block, nan, zero, ir_relation_equal);
+	} else {
+		/* For unordered operands compare 0 with -1, 0 or 1, such that the
+		 * integer relation is in the relation iff it contains unordered. */
+		ir_relation const wanted = unordered ? ordered
+		                                     : ordered ^ ir_relation_less_equal_greater;
+		long        const value  = wanted & ir_relation_less  ?  1
+		                         : wanted & ir_relation_equal ?  0
+		                                                      : -1;
+		ir_node *const keep = new_rd_Not(dbgi, block, nan);
+		left_key  = new_rd_And(dbgi, block, left_key, keep);
+		right_key = new_rd_And(dbgi, block, right_key, keep);
+		if (value != 0) {
+			ir_node *const c       = new_r_Const_long(irg, mode, value);
+			ir_node *const replace = new_rd_And(dbgi, block, nan, c);
+			right_key = new_rd_Or(dbgi, block, right_key, replace);
+		}
+		cmp = new_rd_Cmp(dbgi, block, left_key, right_key, ordered);
 	}
 
 	exchange(n, cmp);
@@ -536,6 +607,110 @@ static bool lower_Const(ir_node *const n)
 	return true;
 }
 
+/**
+ * @return Whether every value of the integer mode @p op_mode is exactly
+ *         representable in the float mode @p mode and fits into 32 bits.
+ */
+static bool is_exact_int_conversion(ir_mode *const op_mode,
+                                    ir_mode *const mode)
+{
+	unsigned const bits = get_mode_size_bits(op_mode);
+	return get_mode_arithmetic(op_mode) == irma_twos_complement
+	    && bits <= get_mode_size_bits(mode_Iu)
+	    && bits <= get_mode_mantissa_size(mode) + 1;
+}
+
+/**
+ * @return The bits of @p op converted to the float mode @p mode, which
+ *         represents all values of @p op exactly.  The leading one of the
+ *         absolute value is found with a clz Builtin and shifted into the
+ *         implicit one of the mantissa.
+ */
+static ir_node *new_exact_int_to_float(dbg_info *const dbgi,
+                                       ir_node *const block,
+                                       ir_node *const op, ir_mode *const mode)
+{
+	ir_graph *const irg      = get_irn_irg(block);
+	ir_mode  *const op_mode  = get_irn_mode(op);
+	ir_mode  *const mode_u   = get_bits_mode(mode, false);
+	ir_mode  *const mode_s32 = get_bits_mode(mode_F, true);
+	ir_mode  *const mode_u32 = get_bits_mode(mode_F, false);
+	unsigned  const top      = get_mode_size_bits(mode_u32) - 1;
+	ir_node  *const top_c    = new_r_Const_long(irg, mode_Iu, top);
+
+	ir_node *abs;
+	ir_node *sign = NULL;
+	if (mode_is_signed(op_mode)) {
+		ir_node *const val   = op_mode == mode_s32 ? op
+		                     : new_rd_Conv(dbgi, block, op, mode_s32);
+		ir_node *const smask = new_rd_Shrs(dbgi, block, val, top_c);
+		ir_node *const flip  = new_rd_Eor(dbgi, block, val, smask);
+		ir_node *const sabs  = new_rd_Sub(dbgi, block, flip, smask);
+		ir_node *const sbits = new_rd_Conv(dbgi, block, smask, mode_u32);
+		ir_node *const sbit  = new_sign_Const(irg, mode_u32);
+		abs  = new_rd_Conv(dbgi, block, sabs, mode_u32);
+		sign = new_rd_And(dbgi, block, sbits, sbit);
+	} else {
+		abs = op_mode == mode_u32 ? op : new_rd_Conv(dbgi, block, op, mode_u32);
+	}
+
+	/* Or in a one to avoid clz(0), the result for 0 is masked out below. */
+	ir_node *const one     = new_r_Const_one(irg, mode_u32);
+	ir_node *const nonzero = new_rd_Or(dbgi, block, abs, one);
+	ir_type *const type    = new_type_method(1, 1, false, cc_cdecl_set,
+	                                         mtp_no_property);
+	set_method_param_type(type, 0, get_type_for_mode(mode_u32));
+	set_method_res_type(type, 0, get_type_for_mode(mode_u32));
+	ir_node *const in[]   = { nonzero };
+	ir_node *const no_mem = new_r_NoMem(irg);
+	ir_node *const clz    = new_rd_Builtin(dbgi, block, no_mem, ARRAY_SIZE(in),
+	                                       in, ir_bk_clz, type);
+	ir_node *const zeros  = new_r_Proj(clz, mode_u32, pn_Builtin_max + 1);
+	ir_node *const norm   = new_rd_Shl(dbgi, block, abs, zeros);
+
+	/* The leading one of the normalized value ends up in the lowest exponent
+	 * bit, so the exponent is one less than the biased exponent. */
+	unsigned const mantissa_size = get_mode_mantissa_size(mode);
+	long     const bias          = (1L << (get_mode_exponent_size(mode) - 1)) - 1;
+	ir_node *const exp_top  = new_r_Const_long(irg, mode_u32, bias + top - 1);
+	ir_node *const exp      = new_rd_Sub(dbgi, block, exp_top, zeros);
+	ir_node *const exp_u    = mode_u == mode_u32 ? exp
+	                        : new_rd_Conv(dbgi, block, exp, mode_u);
+	ir_node *const mant_c   = new_r_Const_long(irg, mode_Iu, mantissa_size);
+	ir_node *const exp_bits = new_rd_Shl(dbgi, block, exp_u, mant_c);
+	ir_node       *mantissa = mode_u == mode_u32 ? norm
+	                        : new_rd_Conv(dbgi, block, norm, mode_u);
+	if (mantissa_size < top) {
+		ir_node *const shift = new_r_Const_long(irg, mode_Iu,
+		                                        top - mantissa_size);
+		mantissa = new_rd_Shr(dbgi, block, mantissa, shift);
+	} else {
+		ir_node *const shift = new_r_Const_long(irg, mode_Iu,
+		                                        mantissa_size - top);
+		mantissa = new_rd_Shl(dbgi, block, mantissa, shift);
+	}
+	ir_node *bits = new_rd_Add(dbgi, block, exp_bits, mantissa);
+
+	if (sign != NULL) {
+		if (mode_u != mode_u32) {
+			ir_node *const sign_u = new_rd_Conv(dbgi, block, sign, mode_u);
+			ir_node *const shift  = new_r_Const_long(irg, mode_Iu,
+			                                         get_mode_size_bits(mode_u) - top - 1);
+			sign = new_rd_Shl(dbgi, block, sign_u, shift);
+		}
+		bits = new_rd_Or(dbgi, block, bits, sign);
+	}
+
+	/* All bits are set iff the value is not zero. */
+	ir_node *const abs_s   = new_rd_Conv(dbgi, block, abs, mode_s32);
+	ir_node *const neg     = new_rd_Minus(dbgi, block, abs_s);
+	ir_node *const any     = new_rd_Or(dbgi, block, abs_s, neg);
+	ir_node *const nz_mask = new_rd_Shrs(dbgi, block, any, top_c);
+	ir_node *const mask    = new_rd_Conv(dbgi, block, nz_mask, mode_u);
+	bits = new_rd_And(dbgi, block, bits, mask);
+	return new_rd_Bitcast(dbgi, block, bits, mode);
+}
+
 /**
  * Transforms a Conv into the appropriate soft float function.
  */
@@ -556,6 +731,11 @@ static bool lower_Conv(ir_node *const n)
 		else
 			name = "fixuns";
 	} else if (!mode_is_float(op_mode)) {
+		if (native_clz && is_exact_int_conversion(op_mode, mode)) {
+			exchange(n, new_exact_int_to_float(dbgi, block, op, mode));
+			return true;
+		}
+
 		ir_mode *min_mode;
 		if (mode_is_signed(op_mode)) {
 			name     = "float";
@@ -689,7 +869,7 @@ static bool lower_Load(ir_node *n)
 }
 
 /**
- * Transforms a Minus into the appropriate soft float function.
+ * Transforms a Minus into a flip of the sign bit.
  */
 static bool lower_Minus(ir_node *n)
 {
@@ -697,9 +877,15 @@ static bool lower_Minus(ir_node *n)
 	if (!mode_is_float(mode))
 		return false;
 
-	ir_node *const op     = get_Minus_op(n);
-	ir_node *const in[]   = { op };
-	ir_node *const result = make_softfloat_call(n, "neg", ARRAY_SIZE(in), in);
+	dbg_info *const dbgi     = get_irn_dbg_info(n);
+	ir_node  *const block    = get_nodes_block(n);
+	ir_graph *const irg      = get_irn_irg(n);
+	ir_mode  *const mode_u   = get_lowered_mode(mode);
+	ir_node  *const op       = get_Minus_op(n);
+	ir_node  *const bits     = new_rd_Bitcast(dbgi, block, op, mode_u);
+	ir_node  *const sign_bit = new_sign_Const(irg, mode_u);
+	ir_node  *const flipped  = new_rd_Eor(dbgi, block, bits, sign_bit);
+	ir_node  *const result   = new_rd_Bitcast(dbgi, block, flipped, mode);
 	exchange(n, result);
 	return true;
 }
@@ -721,6 +907,152 @@ static bool lower_Mul(ir_node *n)
 	return true;
 }
 
+/**
+ * @return The exponent k, if @p tv is 2^k or -2^k for a normal 2^k and a
+ *         k != 0, and 0 otherwise.
+ */
+static long get_pow2_exponent(ir_tarval *const tv)
+{
+	ir_mode   *const mode          = get_tarval_mode(tv);
+	ir_mode   *const mode_u        = get_lowered_mode(mode);
+	unsigned   const mantissa_size = get_mode_mantissa_size(mode);
+	ir_tarval *const bits          = tarval_bitcast(tv, mode_u);
+	ir_tarval *const one           = get_mode_one(mode_u);
+	ir_tarval *const mantissa_mask
+		= tarval_sub(tarval_shl_unsigned(one, mantissa_size), one);
+	if (!tarval_is_null(tarval_and(bits, mantissa_mask)))
+		return 0;
+
+	long const exp_mask = (1L << get_mode_exponent_size(mode)) - 1;
+	long const bias     = exp_mask >> 1;
+	long const exp
+		= get_tarval_long(tarval_shr_unsigned(bits, mantissa_size)) & exp_mask;
+	if (exp == 0 || exp == exp_mask)
+		return 0;
+	return exp - bias;
+}
+
+/**
+ * Collects float Muls by a power of two into the array @p env.
+ */
+static void collect_pow2_Muls(ir_node *const n, void *const env)
+{
+	if (!is_Mul(n) || !mode_is_float(get_irn_mode(n)))
+		return;
+
+	ir_node *const right = get_Mul_right(n);
+	if (is_Const(right) && get_pow2_exponent(get_Const_tarval(right)) != 0) {
+		ir_node ***const muls = (ir_node***)env;
+		ARR_APP1(ir_node*, *muls, n);
+	}
+}
+
+/**
+ * Transforms a float Mul by 2^k or -2^k into control flow: If the product of
+ * a normal left operand is normal, the exponent is adjusted inline.  Only the
+ * remaining cases, i.e. zeros, denormals, infinities, NaNs and products
+ * leaving the normal range, are left to a Mul in a separate block, which
+ * becomes a soft float call.
+ */
+static void lower_pow2_Mul(ir_node *const n)
+{
+	dbg_info  *const dbgi   = get_irn_dbg_info(n);
+	ir_graph  *const irg    = get_irn_irg(n);
+	ir_mode   *const mode   = get_irn_mode(n);
+	ir_mode   *const mode_u = get_bits_mode(mode, false);
+	ir_node   *const left   = get_Mul_left(n);
+	ir_node   *const right  = get_Mul_right(n);
+	ir_tarval *const tv     = get_Const_tarval(right);
+	long       const k      = get_pow2_exponent(tv);
+
+	/* Split the block in two halfs, with the Mul in the upper block. */
+	ir_node *const lower_block = get_nodes_block(n);
+	part_block(n);
+	ir_node *const upper_block = get_nodes_block(n);
+
+	/* The product is normal iff the biased exponent e of the left operand
+	 * satisfies 1 <= e <= max and 1 <= e + k <= max. */
+	unsigned const mantissa_size = get_mode_mantissa_size(mode);
+	long     const exp_mask      = (1L << get_mode_exponent_size(mode)) - 1;
+	long     const lo            = MAX(1, 1 - k);
+	long     const hi            = MIN(exp_mask - 1, exp_mask - 1 - k);
+	ir_node *const bits     = new_rd_Bitcast(dbgi, upper_block, left, mode_u);
+	ir_node *const mant_c   = new_r_Const_long(irg, mode_Iu, mantissa_size);
+	ir_node *const shifted  = new_rd_Shr(dbgi, upper_block, bits, mant_c);
+	ir_node *const mask_c   = new_r_Const_long(irg, mode_u, exp_mask);
+	ir_node *const exp      = new_rd_And(dbgi, upper_block, shifted, mask_c);
+	ir_node *const lo_c     = new_r_Const_long(irg, mode_u, lo);
+	ir_node *const offset   = new_rd_Sub(dbgi, upper_block, exp, lo_c);
+	ir_node *const range_c  = new_r_Const_long(irg, mode_u, hi - lo + 1);
+	ir_node *const in_range = new_rd_Cmp(dbgi, upper_block, offset, range_c,
+	                                     ir_relation_less);
+
+	ir_node *const cond       = new_rd_Cond(dbgi, upper_block, in_range);
+	ir_node *const proj_true  = new_r_Proj(cond, mode_X, pn_Cond_true);
+	ir_node *const proj_false = new_r_Proj(cond, mode_X, pn_Cond_false);
+	ir_node *const fast_block = new_r_Block(irg, 1, &proj_true);
+	ir_node *const slow_block = new_r_Block(irg, 1, &proj_false);
+
+	ir_node *const k_bits = new_shifted_Const(irg, mode_u, k < 0 ? -k : k,
+	                                          mantissa_size);
+	ir_node *fast = k < 0 ? new_rd_Sub(dbgi, fast_block, bits, k_bits)
+	                      : new_rd_Add(dbgi, fast_block, bits, k_bits);
+	if (tarval_is_negative(tv)) {
+		ir_node *const sign_bit = new_sign_Const(irg, mode_u);
+		fast = new_rd_Eor(dbgi, fast_block, fast, sign_bit);
+	}
+	fast = new_rd_Bitcast(dbgi, fast_block, fast, mode);
+	ir_node *const slow = new_rd_Mul(dbgi, slow_block, left, right);
+
+	/* Kill the jump from upper to lower block and replace the in array. */
+	assert(get_Block_n_cfgpreds(lower_block) == 1);
+	kill_node(get_Block_cfgpred(lower_block, 0));
+	ir_node *const jmps[] = {
+		new_r_Jmp(fast_block),
+		new_r_Jmp(slow_block),
+	};
+	set_irn_in(lower_block, ARRAY_SIZE(jmps), jmps);
+
+	ir_node *const vals[] = { fast, slow };
+	ir_node *const phi    = new_r_Phi(lower_block, ARRAY_SIZE(vals), vals, mode);
+	collect_new_phi_node(phi);
+	exchange(n, phi);
+
+	/* Link the Projs with the Cond for the next part_block() call. */
+	set_irn_link(proj_true,  get_irn_link(cond));
+	set_irn_link(proj_false, proj_true);
+	set_irn_link(cond,       proj_false);
+}
+
+/**
+ * Lowers all float Muls by a power of two of @p irg with lower_pow2_Mul().
+ *
+ * @return Whether the graph changed.
+ */
+static bool lower_pow2_Muls(ir_graph *const irg)
+{
+	ir_node **muls = NEW_ARR_F(ir_node*, 0);
+	irg_walk_graph(irg, NULL, collect_pow2_Muls, &muls);
+
+	size_t const n_muls = ARR_LEN(muls);
+	if (n_muls > 0) {
+		ir_resources_t const resources
+			= IR_RESOURCE_IRN_LINK | IR_RESOURCE_PHI_LIST;
+		/* This is required by part_block(). */
+		ir_reserve_resources(irg, resources);
+		collect_phiprojs_and_start_block_nodes(irg);
+
+		for (size_t i = 0; i < n_muls; ++i)
+			lower_pow2_Mul(muls[i]);
+
+		ir_free_resources(irg, resources);
+		clear_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE
+		                        | IR_GRAPH_PROPERTY_NO_CRITICAL_EDGES);
+	}
+	DEL_ARR_F(muls);
+	return n_muls > 0;
+}
+
 /**
  * Transforms a Sub into the appropriate soft float function.
  */
@@ -785,11 +1117,7 @@ static void ir_prepare_softfloat_lowering(void)
 
 	make_binop_type(&binop_tp_d, type_D, type_D, type_D);
 	make_binop_type(&binop_tp_f, type_F, type_F, type_F);
-	make_binop_type(&cmp_tp_d,   type_D, type_D, type_Is);
-	make_binop_type(&cmp_tp_f,   type_F, type_F, type_Is);
 
-	make_unop_type(&unop_tp_d,    type_D,  type_D);
-	make_unop_type(&unop_tp_f,    type_F,  type_F);
 	make_unop_type(&unop_tp_d_f,  type_D,  type_F);
 	make_unop_type(&unop_tp_d_is, type_D,  type_Is);
 	make_unop_type(&unop_tp_d_iu, type_D,  type_Iu);
@@ -810,20 +1138,14 @@ static void ir_prepare_softfloat_lowering(void)
 	make_unop_type(&unop_tp_lu_f, type_Lu, type_F);
 }
 
-/**
- * Callback to lower only the Mux nodes we created.
- */
-static int lower_mux_cb(ir_node *mux)
-{
-	return ir_nodeset_contains(&created_mux_nodes, mux);
-}
-
-void lower_floating_point(void)
+void lower_floating_point(bool has_native_clz)
 {
+	native_clz = has_native_clz;
 	ir_prepare_softfloat_lowering();
 
 	ir_clear_opcodes_generic_func();
 	ir_register_softloat_lower_function(op_Add,   lower_Add);
+	ir_register_softloat_lower_function(op_Call,  lower_fabs_Call);
 	ir_register_softloat_lower_function(op_Cmp,   lower_Cmp);
 	ir_register_softloat_lower_function(op_Conv,  lower_Conv);
 	ir_register_softloat_lower_function(op_Div,   lower_Div);
@@ -833,16 +1155,10 @@ void lower_floating_point(void)
 
 	bool *const changed_irgs = XMALLOCNZ(bool, get_irp_n_irgs());
 	foreach_irp_irg(i, irg) {
-		ir_nodeset_init(&created_mux_nodes);
-
 		assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES);
 
+		changed_irgs[i] |= lower_pow2_Muls(irg);
 		irg_walk_graph(irg, NULL, lower_node, &changed_irgs[i]);
-
-		if (ir_nodeset_size(&created_mux_nodes) > 0)
-			lower_mux(irg, lower_mux_cb);
-
-		ir_nodeset_destroy(&created_mux_nodes);
 	}
 
 	ir_clear_opcodes_generic_func();
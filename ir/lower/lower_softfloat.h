@@ -11,11 +11,17 @@
 #ifndef FIRM_LOWER_LOWER_SOFTFLOAT_H
 #define FIRM_LOWER_LOWER_SOFTFLOAT_H
 
+#include <stdbool.h>
+
 /**
  * Lowers all floating-point operations.
  *
  * They are replaced by calls into a soft float library.
+ *
+ * @param has_native_clz  whether the target supports the clz Builtin
+ *                        natively, then exact conversions of small integers
+ *                        are done inline instead of by a library call
  */
-void lower_floating_point(void);
+void lower_floating_point(bool has_native_clz);
 
 #endif
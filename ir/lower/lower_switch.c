@@ -6,19 +6,29 @@
 /**
  * @file
  * @brief   Lowering of Switches if necessary or advantageous.
+ *
+ * Sparse switches are split into clusters: jump tables for dense regions,
+ * bit tests for small regions with few targets and single case tests.  The
+ * clusters are then dispatched by a decision tree balanced by the execution
+ * frequencies of the cases.
  * @author  Moritz Kroll
  */
 #include "array.h"
+#include "execfreq.h"
 #include "ircons.h"
 #include "irgopt.h"
 #include "irgwalk.h"
 #include "irnode_t.h"
 #include "irnodeset.h"
 #include "irouts_t.h"
+#include "irprofile.h"
 #include "lowering.h"
 #include "panic.h"
 #include "util.h"
+#include <math.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
 
 typedef struct walk_env_t {
 	ir_nodeset_t  processed;
@@ -29,19 +39,57 @@ typedef struct walk_env_t {
 } walk_env_t;
 
 typedef struct target_t {
-	ir_node *block;     /**< block that is targetted */
-	uint16_t n_entries; /**< number of table entries targetting this block */
-	uint16_t i;
+	ir_node  *block;     /**< block that is targetted */
+	ir_node **preds;     /**< new control flow predecessors of the block */
+	unsigned  n_entries; /**< number of table entries targetting this block */
+	unsigned  table_pn;  /**< pn of the block in the table under construction */
+	double    weight;    /**< estimated execution frequency of the block */
 } target_t;
 
+/**
+ * A case of the switch.  The values of the case are stored as offsets from
+ * the smallest case value, so consecutive cases have consecutive offsets.
+ */
+typedef struct case_t {
+	const ir_switch_table_entry *entry;
+	uint64_t                     lo;     /**< offset of entry->min */
+	uint64_t                     hi;     /**< offset of entry->max */
+	double                       weight; /**< estimated execution frequency */
+} case_t;
+
+typedef enum cluster_kind_t {
+	CLUSTER_RANGE,    /**< a single case, tested by a comparison */
+	CLUSTER_TABLE,    /**< dense cases, dispatched by a table switch */
+	CLUSTER_BIT_TEST, /**< cases with few targets, tested by bit masks */
+} cluster_kind_t;
+
+/** A sequence of consecutive cases which is lowered as a unit. */
+typedef struct cluster_t {
+	cluster_kind_t kind;
+	unsigned       first;  /**< index of the first case */
+	unsigned       last;   /**< index of the last case */
+	double         weight; /**< sum of the case weights */
+} cluster_t;
+
+/** Offsets the selector is known to lie in at some point of the lowering. */
+typedef struct bounds_t {
+	bool     has_lo;
+	bool     has_hi;
+	uint64_t lo;
+	uint64_t hi;
+} bounds_t;
+
 typedef struct switch_info_t {
 	ir_node     *switchn;
 	ir_tarval   *switch_min;
 	ir_tarval   *switch_max;
-	ir_node     *default_block;
 	unsigned     num_cases;
-	target_t    *targets;
-	ir_node    **defusers;    /**< the Projs pointing to the default case */
+	unsigned     n_targets;
+	target_t    *targets;     /**< the targets indexed by pn */
+	case_t      *cases;       /**< the cases sorted by value */
+	ir_mode     *offset_mode; /**< unsigned mode of the selector */
+	bool         has_offsets; /**< whether offsets fit into case_t */
+	walk_env_t  *env;
 } switch_info_t;
 
 /**
@@ -76,6 +124,19 @@ static void analyse_switch0(switch_info_t *info, ir_node *switchn)
 	info->num_cases  = num_cases;
 }
 
+/**
+ * Returns the execution frequency of @p block, taken from the profile if
+ * @p use_profile is set.
+ */
+static double get_target_weight(const ir_node *block, bool use_profile)
+{
+	if (use_profile) {
+		return ir_profile_has_block_execcount(block)
+		     ? (double)ir_profile_get_block_execcount(block) : 0.0;
+	}
+	return get_block_execfreq(block);
+}
+
 /**
  * Analyse the stuff that anayse_switch0() left out
  */
@@ -84,14 +145,20 @@ static void analyse_switch1(switch_info_t *info)
 	const ir_node  *switchn   = info->switchn;
 	unsigned        n_outs    = get_Switch_n_outs(switchn);
 	target_t       *targets   = XMALLOCNZ(target_t, n_outs);
+	const ir_node  *block     = get_nodes_block(switchn);
+	bool            use_profile
+		= ir_profile_available() && ir_profile_has_block_execcount(block);
 	foreach_irn_out_r(switchn, i, proj) {
 		unsigned pn     = get_Proj_num(proj);
 		ir_node *target = get_irn_out(proj, 0);
 
 		assert((unsigned)pn < n_outs);
 		assert(targets[(unsigned)pn].block == NULL);
-		targets[(unsigned)pn].block = target;
+		targets[(unsigned)pn].block  = target;
+		targets[(unsigned)pn].weight = get_target_weight(target, use_profile);
 	}
+	for (unsigned pn = 0; pn < n_outs; ++pn)
+		targets[pn].preds = NEW_ARR_F(ir_node*, 0);
 
 	const ir_switch_table *table = get_Switch_table(switchn);
 	for (size_t e = 0, n_entries = ir_switch_table_get_n_entries(table);
@@ -105,8 +172,8 @@ static void analyse_switch1(switch_info_t *info)
 		++target->n_entries;
 	}
 
-	info->default_block = targets[pn_Switch_default].block;
-	info->targets       = targets;
+	info->n_targets = n_outs;
+	info->targets   = targets;
 }
 
 static int compare_entries(const void *a, const void *b)
@@ -127,6 +194,20 @@ static int compare_entries(const void *a, const void *b)
 	return 1;
 }
 
+/**
+ * Subtracts @p delta from a case value in the mode of @p delta, like it is done
+ * for the selector, and converts the result to @p new_mode.
+ */
+static ir_tarval *normalize_case_value(ir_tarval *value, ir_mode *new_mode,
+                                       ir_tarval *delta)
+{
+	if (delta != NULL) {
+		value = tarval_convert_to(value, get_tarval_mode(delta));
+		value = tarval_sub(value, delta);
+	}
+	return tarval_convert_to(value, new_mode);
+}
+
 static void normalize_table(ir_node *switchn, ir_mode *new_mode,
                             ir_tarval *delta)
 {
@@ -144,19 +225,12 @@ static void normalize_table(ir_node *switchn, ir_mode *new_mode,
 			break;
 		}
 
-		ir_tarval *min = entry->min;
-		min = tarval_convert_to(min, new_mode);
-		if (delta != NULL)
-			min = tarval_sub(min, delta);
-
+		ir_tarval *min = normalize_case_value(entry->min, new_mode, delta);
 		if (entry->min == entry->max) {
 			entry->min = min;
 			entry->max = min;
 		} else {
-			ir_tarval *max = entry->max;
-			max = tarval_convert_to(max, new_mode);
-			if (delta != NULL)
-				max = tarval_sub(max, delta);
+			ir_tarval *max = normalize_case_value(entry->max, new_mode, delta);
 			entry->min = min;
 			entry->max = max;
 		}
@@ -260,8 +334,6 @@ static bool normalize_switch(switch_info_t *info, ir_mode *selector_mode)
 		mode     = selector_mode;
 		info->switch_min = tarval_convert_to(info->switch_min, mode);
 		info->switch_max = tarval_convert_to(info->switch_max, mode);
-		if (delta != NULL)
-			delta = tarval_convert_to(delta, mode);
 		set_Switch_selector(switchn, selector);
 	}
 
@@ -284,91 +356,599 @@ static ir_node *create_case_cond(const ir_switch_table_entry *entry,
 	if (entry->min == entry->max) {
 		cmp = new_rd_Cmp(dbgi, block, selector, minconst, ir_relation_equal);
 	} else {
+		/* compare unsigned, so values below the range wrap around */
+		ir_mode   *mode         = find_unsigned_mode(get_irn_mode(selector));
 		ir_tarval *adjusted_max = tarval_sub(entry->max, entry->min);
 		ir_node   *sub          = new_rd_Sub(dbgi, block, selector, minconst);
-		ir_node   *maxconst     = new_r_Const(irg, adjusted_max);
-		cmp = new_rd_Cmp(dbgi, block, sub, maxconst, ir_relation_less_equal);
+		ir_node   *offset       = new_rd_Conv(dbgi, block, sub, mode);
+		ir_node   *maxconst     = new_r_Const(irg, tarval_convert_to(adjusted_max, mode));
+		cmp = new_rd_Cmp(dbgi, block, offset, maxconst, ir_relation_less_equal);
 	}
 	return new_rd_Cond(dbgi, block, cmp);
 }
 
-static void connect_to_target(target_t *target, ir_node *cf)
+static uint64_t get_tarval_uint64(const ir_tarval *tv)
+{
+	unsigned n_bytes = get_mode_size_bytes(get_tarval_mode(tv));
+	uint64_t res     = 0;
+	for (unsigned b = 0; b < n_bytes; ++b)
+		res |= (uint64_t)get_tarval_sub_bits(tv, b) << (8 * b);
+	return res;
+}
+
+static ir_tarval *new_tarval_from_uint64(uint64_t value, ir_mode *mode)
+{
+	unsigned char buf[sizeof(value)];
+	for (unsigned b = 0; b < sizeof(buf); ++b)
+		buf[b] = (unsigned char)(value >> (8 * b));
+	return new_tarval_from_bytes(buf, mode);
+}
+
+/**
+ * Computes the offsets and weights of the cases of a normalized table.
+ */
+static void analyse_cases(switch_info_t *info)
+{
+	const ir_switch_table *table     = get_Switch_table(info->switchn);
+	size_t                 n_entries = ir_switch_table_get_n_entries(table);
+	ir_mode               *mode      = info->offset_mode;
+	case_t                *cases     = NEW_ARR_F(case_t, n_entries);
+
+	/* Without frequencies, all cases are equally likely. */
+	bool has_weights = false;
+	for (unsigned pn = 0; pn < info->n_targets; ++pn) {
+		if (info->targets[pn].weight > 0)
+			has_weights = true;
+	}
+	if (!has_weights)
+		info->targets[pn_Switch_default].weight = 0.0;
+
+	ir_tarval *base = NULL;
+	for (size_t e = 0; e < n_entries; ++e) {
+		const ir_switch_table_entry *entry
+			= ir_switch_table_get_entry_const(table, e);
+		const target_t *target = &info->targets[entry->pn];
+		case_t         *c      = &cases[e];
+
+		c->entry  = entry;
+		c->weight = has_weights ? target->weight / target->n_entries : 1.0;
+		c->lo     = 0;
+		c->hi     = 0;
+		if (!info->has_offsets)
+			continue;
+
+		ir_tarval *min = tarval_convert_to(entry->min, mode);
+		ir_tarval *max = tarval_convert_to(entry->max, mode);
+		if (base == NULL)
+			base = min;
+		c->lo = get_tarval_uint64(tarval_sub(min, base));
+		c->hi = get_tarval_uint64(tarval_sub(max, base));
+	}
+	info->cases = cases;
+}
+
+/**
+ * A table is used for a sequence of cases under the same conditions as for a
+ * whole switch: there must be enough cases and only few spare table entries.
+ */
+static bool is_table_cluster(const switch_info_t *info, unsigned first,
+                             unsigned last, bool *too_sparse)
+{
+	const walk_env_t *env       = info->env;
+	const case_t     *cases     = info->cases;
+	unsigned          num_cases = last - first + 1;
+	uint64_t          spare     = cases[last].hi - cases[first].lo
+	                            - (num_cases - 1);
+
+	/* adding cases never reduces the spare entries */
+	*too_sparse = spare >= env->spare_size;
+	return num_cases > env->small_switch && !*too_sparse;
+}
+
+/**
+ * Bit tests pay off if they replace enough comparisons.  Like in other
+ * compilers, a case range counts as two comparisons.
+ */
+static bool is_bit_test_cluster(const switch_info_t *info, unsigned first,
+                                unsigned last, bool *too_wide)
 {
-	ir_node *block     = target->block;
-	unsigned n_entries = target->n_entries;
-	if (get_Block_n_cfgpreds(block) != (int)n_entries) {
-		ir_node **new_in = ALLOCAN(ir_node*, n_entries);
-		ir_graph *irg    = get_irn_irg(block);
-		ir_node  *dummy  = new_r_Dummy(irg, mode_X);
-		for (unsigned i = 0; i < n_entries; ++i) {
-			new_in[i] = dummy;
+	const case_t *cases = info->cases;
+	unsigned      bits  = get_mode_size_bits(info->env->selector_mode);
+
+	*too_wide = bits > 64 || cases[last].hi - cases[first].lo >= bits;
+	if (*too_wide)
+		return false;
+
+	unsigned pns[3];
+	unsigned n_pns  = 0;
+	unsigned n_cmps = 0;
+	for (unsigned i = first; i <= last; ++i) {
+		unsigned pn = cases[i].entry->pn;
+		unsigned p  = 0;
+		while (p < n_pns && pns[p] != pn)
+			++p;
+		if (p == n_pns) {
+			if (n_pns == ARRAY_SIZE(pns))
+				return false;
+			pns[n_pns++] = pn;
 		}
-		set_irn_in(block, n_entries, new_in);
-		assert(target->i == 0);
+		n_cmps += cases[i].lo == cases[i].hi ? 1 : 2;
 	}
-	assert(target->i < n_entries);
-	set_Block_cfgpred(target->block, target->i++, cf);
+	return (n_pns == 1 && n_cmps >= 3)
+	    || (n_pns == 2 && n_cmps >= 5)
+	    || (n_pns == 3 && n_cmps >= 6);
+}
+
+static void append_cluster(cluster_t **clusters, const switch_info_t *info,
+                           cluster_kind_t kind, unsigned first, unsigned last)
+{
+	double weight = 0.0;
+	for (unsigned i = first; i <= last; ++i)
+		weight += info->cases[i].weight;
+
+	cluster_t cluster = { kind, first, last, weight };
+	ARR_APP1(cluster_t, *clusters, cluster);
 }
 
 /**
- * Creates an if cascade realizing binary search.
+ * Partitions the cases from @p first to @p last into as few clusters of kind
+ * @p kind and single cases as possible.
+ * @returns the number of cases covered by @p kind clusters
  */
-static void create_if_cascade(switch_info_t *info, ir_node *block,
-                              ir_switch_table_entry *curcases,
-                              unsigned numcases)
-{
-	ir_graph      *irg      = get_irn_irg(block);
-	const ir_node *switchn  = info->switchn;
-	dbg_info      *dbgi     = get_irn_dbg_info(switchn);
-	ir_node       *selector = get_Switch_selector(switchn);
-
-	if (numcases == 0) {
-		/* zero cases: "goto default;" */
-		ARR_APP1(ir_node*, info->defusers, new_r_Jmp(block));
-	} else if (numcases == 1) {
-		/*only one case: "if (sel == val) goto target else goto default;"*/
-		const ir_switch_table_entry *entry = &curcases[0];
-		ir_node *cond      = create_case_cond(entry, dbgi, block, selector);
-		ir_node *trueproj  = new_r_Proj(cond, mode_X, pn_Cond_true);
-		ir_node *falseproj = new_r_Proj(cond, mode_X, pn_Cond_false);
+static unsigned find_clusters_of_kind(switch_info_t *info,
+                                      cluster_t **clusters,
+                                      cluster_kind_t kind, unsigned first,
+                                      unsigned last, unsigned *end)
+{
+	unsigned  n            = last - first + 1;
+	unsigned *min_clusters = XMALLOCN(unsigned, n + 1);
+
+	/* min_clusters[i] is the least number of clusters for the cases from
+	 * first + i to last, end[i] the end of the first of them */
+	min_clusters[n] = 0;
+	for (unsigned i = n; i-- > 0;) {
+		min_clusters[i] = min_clusters[i + 1] + 1;
+		end[i]          = i;
+		for (unsigned j = i + 1; j < n; ++j) {
+			bool stop;
+			bool fits = kind == CLUSTER_TABLE
+				? is_table_cluster(info, first + i, first + j, &stop)
+				: is_bit_test_cluster(info, first + i, first + j, &stop);
+			if (stop)
+				break;
+			if (fits && min_clusters[j + 1] + 1 <= min_clusters[i]) {
+				min_clusters[i] = min_clusters[j + 1] + 1;
+				end[i]          = j;
+			}
+		}
+	}
+	free(min_clusters);
+
+	unsigned covered = 0;
+	for (unsigned i = 0; i < n; i = end[i] + 1) {
+		if (end[i] == i) {
+			append_cluster(clusters, info, CLUSTER_RANGE, first + i, first + i);
+		} else {
+			append_cluster(clusters, info, kind, first + i, first + end[i]);
+			covered += end[i] - i + 1;
+		}
+	}
+	return covered;
+}
+
+/**
+ * Splits the cases into jump tables for dense regions, bit tests for small
+ * regions with few targets and single cases for the rest.
+ */
+static cluster_t *find_clusters(switch_info_t *info)
+{
+	unsigned   n_cases  = ARR_LEN(info->cases);
+	cluster_t *clusters = NEW_ARR_F(cluster_t, 0);
+	if (n_cases == 0)
+		return clusters;
+	if (!info->has_offsets) {
+		for (unsigned i = 0; i < n_cases; ++i)
+			append_cluster(&clusters, info, CLUSTER_RANGE, i, i);
+		return clusters;
+	}
+
+	unsigned  *end    = XMALLOCN(unsigned, n_cases);
+	cluster_t *tables = NEW_ARR_F(cluster_t, 0);
+	find_clusters_of_kind(info, &tables, CLUSTER_TABLE, 0, n_cases - 1, end);
+
+	/* use bit tests for runs of cases outside of tables, and instead of
+	 * tables which fit into a machine word, avoiding the indirect jump */
+	for (size_t t = 0, n_tables = ARR_LEN(tables); t < n_tables;) {
+		if (tables[t].kind == CLUSTER_TABLE) {
+			bool too_wide;
+			if (is_bit_test_cluster(info, tables[t].first, tables[t].last, &too_wide))
+				tables[t].kind = CLUSTER_BIT_TEST;
+			ARR_APP1(cluster_t, clusters, tables[t]);
+			++t;
+			continue;
+		}
+		size_t run_end = t;
+		while (run_end + 1 < n_tables && tables[run_end + 1].kind != CLUSTER_TABLE)
+			++run_end;
+		find_clusters_of_kind(info, &clusters, CLUSTER_BIT_TEST,
+		                      tables[t].first, tables[run_end].last, end);
+		t = run_end + 1;
+	}
+
+	DEL_ARR_F(tables);
+	free(end);
+	return clusters;
+}
+
+static bool bounds_within(const bounds_t *bounds, uint64_t lo, uint64_t hi)
+{
+	return bounds->has_lo && bounds->has_hi && lo <= bounds->lo
+	    && bounds->hi <= hi;
+}
+
+static unsigned distance(unsigned a, unsigned b)
+{
+	return a < b ? b - a : a - b;
+}
+
+static ir_node *new_block_after(ir_node *cf)
+{
+	ir_node *in[] = { cf };
+	return new_r_Block(get_irn_irg(cf), ARRAY_SIZE(in), in);
+}
+
+static void connect_to_target(target_t *target, ir_node *cf)
+{
+	ARR_APP1(ir_node*, target->preds, cf);
+}
+
+static void connect_to_default(switch_info_t *info, ir_node *cf)
+{
+	connect_to_target(&info->targets[pn_Switch_default], cf);
+}
+
+/**
+ * Creates a Cond for @p c in @p block and connects its true Proj to the target
+ * of @p c.
+ * @returns the false Proj
+ */
+static ir_node *create_case_test(switch_info_t *info, ir_node *block,
+                                 const case_t *c)
+{
+	dbg_info *dbgi     = get_irn_dbg_info(info->switchn);
+	ir_node  *selector = get_Switch_selector(info->switchn);
+	ir_node  *cond     = create_case_cond(c->entry, dbgi, block, selector);
+	ir_node  *trueproj = new_r_Proj(cond, mode_X, pn_Cond_true);
+	connect_to_target(&info->targets[c->entry->pn], trueproj);
+	return new_r_Proj(cond, mode_X, pn_Cond_false);
+}
+
+/**
+ * Computes the offset of the selector from the smallest value of @p cluster
+ * and checks that it is in range unless @p bounds already guarantee that.
+ * @returns the block where the offset is in range
+ */
+static ir_node *create_range_check(switch_info_t *info, ir_node *block,
+                                   const cluster_t *cluster,
+                                   const bounds_t *bounds, ir_node **offset)
+{
+	ir_graph     *irg      = get_irn_irg(block);
+	dbg_info     *dbgi     = get_irn_dbg_info(info->switchn);
+	ir_node      *selector = get_Switch_selector(info->switchn);
+	const case_t *first    = &info->cases[cluster->first];
+	const case_t *last     = &info->cases[cluster->last];
+	ir_node      *min      = new_r_Const(irg, first->entry->min);
+	ir_node      *sub      = new_rd_Sub(dbgi, block, selector, min);
+	*offset = new_rd_Conv(dbgi, block, sub, info->offset_mode);
+
+	if (bounds_within(bounds, first->lo, last->hi))
+		return block;
+
+	ir_tarval *span     = new_tarval_from_uint64(last->hi - first->lo,
+	                                             info->offset_mode);
+	ir_node   *maxconst = new_r_Const(irg, span);
+	ir_node   *cmp      = new_rd_Cmp(dbgi, block, *offset, maxconst,
+	                                 ir_relation_less_equal);
+	ir_node   *cond     = new_rd_Cond(dbgi, block, cmp);
+	connect_to_default(info, new_r_Proj(cond, mode_X, pn_Cond_false));
+	return new_block_after(new_r_Proj(cond, mode_X, pn_Cond_true));
+}
+
+/**
+ * Creates a Switch for the cases of @p cluster.
+ */
+static void create_table(switch_info_t *info, ir_node *block,
+                         const cluster_t *cluster, const bounds_t *bounds)
+{
+	ir_node *offset;
+	block = create_range_check(info, block, cluster, bounds, &offset);
+
+	ir_graph        *irg     = get_irn_irg(block);
+	dbg_info        *dbgi    = get_irn_dbg_info(info->switchn);
+	ir_mode         *mode    = info->env->selector_mode;
+	const case_t    *cases   = info->cases;
+	uint64_t         base    = cases[cluster->first].lo;
+	unsigned         n_cases = cluster->last - cluster->first + 1;
+	ir_switch_table *table   = ir_new_switch_table(irg, n_cases);
+	unsigned         n_outs  = pn_Switch_max + 1;
+	for (unsigned i = 0; i < n_cases; ++i) {
+		const case_t *c      = &cases[cluster->first + i];
+		target_t     *target = &info->targets[c->entry->pn];
+		if (target->table_pn == 0)
+			target->table_pn = n_outs++;
+
+		ir_tarval *min = new_tarval_from_uint64(c->lo - base, mode);
+		ir_tarval *max = c->lo == c->hi
+		               ? min : new_tarval_from_uint64(c->hi - base, mode);
+		ir_switch_table_set(table, i, min, max, target->table_pn);
+	}
+
+	ir_node *selector = new_rd_Conv(dbgi, block, offset, mode);
+	ir_node *switchn  = new_rd_Switch(dbgi, block, selector, n_outs, table);
+	ir_nodeset_insert(&info->env->processed, switchn);
+
+	connect_to_default(info, new_r_Proj(switchn, mode_X, pn_Switch_default));
+	for (unsigned i = 0; i < n_cases; ++i) {
+		target_t *target = &info->targets[cases[cluster->first + i].entry->pn];
+		if (target->table_pn == 0)
+			continue;
+		ir_node *proj = new_r_Proj(switchn, mode_X, target->table_pn);
+		connect_to_target(target, proj);
+		target->table_pn = 0;
+	}
+}
+
+typedef struct bit_test_t {
+	unsigned pn;
+	uint64_t mask;
+	double   weight;
+} bit_test_t;
+
+/**
+ * Creates tests "(mask & (1 << offset)) != 0" for the targets of @p cluster,
+ * hottest target first.
+ */
+static void create_bit_tests(switch_info_t *info, ir_node *block,
+                             const cluster_t *cluster, const bounds_t *bounds)
+{
+	ir_node *offset;
+	block = create_range_check(info, block, cluster, bounds, &offset);
+
+	const case_t *cases     = info->cases;
+	uint64_t      base      = cases[cluster->first].lo;
+	uint64_t      n_covered = 0;
+	bit_test_t    tests[3];
+	unsigned      n_tests   = 0;
+	for (unsigned i = cluster->first; i <= cluster->last; ++i) {
+		const case_t *c = &cases[i];
+		unsigned      t = 0;
+		while (t < n_tests && tests[t].pn != c->entry->pn)
+			++t;
+		if (t == n_tests) {
+			assert(n_tests < ARRAY_SIZE(tests));
+			tests[n_tests++] = (bit_test_t){ c->entry->pn, 0, 0.0 };
+		}
+
+		unsigned width = (unsigned)(c->hi - c->lo + 1);
+		uint64_t bits  = width == 64 ? ~(uint64_t)0
+		                             : (((uint64_t)1 << width) - 1);
+		tests[t].mask   |= bits << (c->lo - base);
+		tests[t].weight += c->weight;
+		n_covered       += width;
+	}
+	for (unsigned t = 1; t < n_tests; ++t) {
+		for (unsigned u = t; u > 0 && tests[u].weight > tests[u - 1].weight; --u) {
+			bit_test_t tmp = tests[u];
+			tests[u]     = tests[u - 1];
+			tests[u - 1] = tmp;
+		}
+	}
+
+	/* if every offset in range belongs to a case, the last test is implied */
+	bool      complete = n_covered == cases[cluster->last].hi - base + 1;
+	ir_graph *irg      = get_irn_irg(block);
+	dbg_info *dbgi     = get_irn_dbg_info(info->switchn);
+	ir_mode  *mode     = info->env->selector_mode;
+	ir_node  *one      = new_r_Const(irg, get_mode_one(mode));
+	ir_node  *shift    = new_rd_Conv(dbgi, block, offset, mode);
+	ir_node  *bit      = new_rd_Shl(dbgi, block, one, shift);
+	ir_node  *zero     = new_r_Const(irg, get_mode_null(mode));
+	for (unsigned t = 0; t < n_tests; ++t) {
+		target_t *target = &info->targets[tests[t].pn];
+		if (t == n_tests - 1 && complete) {
+			connect_to_target(target, new_r_Jmp(block));
+			break;
+		}
+
+		ir_tarval *mask_tv = new_tarval_from_uint64(tests[t].mask, mode);
+		ir_node   *mask    = new_r_Const(irg, mask_tv);
+		ir_node   *and     = new_rd_And(dbgi, block, mask, bit);
+		ir_node   *cmp     = new_rd_Cmp(dbgi, block, and, zero,
+		                                ir_relation_less_greater);
+		ir_node   *cond    = new_rd_Cond(dbgi, block, cmp);
+		connect_to_target(target, new_r_Proj(cond, mode_X, pn_Cond_true));
 
-		connect_to_target(&info->targets[entry->pn], trueproj);
-		ARR_APP1(ir_node*, info->defusers, falseproj);
-	} else if (numcases == 2) {
-		/* only two cases: "if (sel == val[0]) goto target[0];" */
-		const ir_switch_table_entry *entry0 = &curcases[0];
-		const ir_switch_table_entry *entry1 = &curcases[1];
-		ir_node *cond      = create_case_cond(entry0, dbgi, block, selector);
-		ir_node *trueproj  = new_r_Proj(cond, mode_X, pn_Cond_true);
 		ir_node *falseproj = new_r_Proj(cond, mode_X, pn_Cond_false);
-		connect_to_target(&info->targets[entry0->pn], trueproj);
+		if (t == n_tests - 1)
+			connect_to_default(info, falseproj);
+		else
+			block = new_block_after(falseproj);
+	}
+}
+
+static void create_cluster(switch_info_t *info, ir_node *block,
+                           const cluster_t *cluster, const bounds_t *bounds)
+{
+	switch (cluster->kind) {
+	case CLUSTER_RANGE: {
+		const case_t *c = &info->cases[cluster->first];
+		if (bounds_within(bounds, c->lo, c->hi)) {
+			connect_to_target(&info->targets[c->entry->pn], new_r_Jmp(block));
+		} else {
+			connect_to_default(info, create_case_test(info, block, c));
+		}
+		return;
+	}
+	case CLUSTER_TABLE:
+		create_table(info, block, cluster, bounds);
+		return;
+	case CLUSTER_BIT_TEST:
+		create_bit_tests(info, block, cluster, bounds);
+		return;
+	}
+	panic("invalid cluster kind");
+}
 
-		ir_node *in[]    = { falseproj };
-		ir_node *neblock = new_r_Block(irg, ARRAY_SIZE(in), in);
+static int compare_cluster_weights(const void *a, const void *b)
+{
+	const cluster_t *cluster0 = (const cluster_t*)a;
+	const cluster_t *cluster1 = (const cluster_t*)b;
+	if (cluster0->weight != cluster1->weight)
+		return cluster0->weight > cluster1->weight ? -1 : 1;
+	/* keep the order of equally likely cases */
+	return cluster0->first < cluster1->first ? -1 : 1;
+}
 
-		/* second part: "else if (sel == val[1]) goto target[1] else goto default;" */
-		ir_node *cond1      = create_case_cond(entry1, dbgi, neblock, selector);
-		ir_node *trueproj1  = new_r_Proj(cond1, mode_X, pn_Cond_true);
-		ir_node *falseproj1 = new_r_Proj(cond1, mode_X, pn_Cond_false);
-		connect_to_target(&info->targets[entry1->pn], trueproj1);
-		ARR_APP1(ir_node*, info->defusers, falseproj1);
-	} else {
-		/* recursive case: split cases in the middle */
-		unsigned midcase = numcases / 2;
-		const ir_switch_table_entry *entry = &curcases[midcase];
-		ir_node *val = new_r_Const(irg, entry->min);
-		ir_node *cmp = new_rd_Cmp(dbgi, block, selector, val, ir_relation_less);
-		ir_node *cond = new_rd_Cond(dbgi, block, cmp);
+/**
+ * Tests the single case clusters @p clusters one after another, hottest
+ * first.
+ */
+static void create_chain(switch_info_t *info, ir_node *block,
+                         cluster_t *clusters, unsigned n_clusters,
+                         const bounds_t *bounds)
+{
+	QSORT(clusters, n_clusters, compare_cluster_weights);
+	for (unsigned i = 0; i + 1 < n_clusters; ++i) {
+		const case_t *c = &info->cases[clusters[i].first];
+		block = new_block_after(create_case_test(info, block, c));
+	}
+	create_cluster(info, block, &clusters[n_clusters - 1], bounds);
+}
 
-		ir_node *ltin[]  = { new_r_Proj(cond, mode_X, pn_Cond_true) };
-		ir_node *ltblock = new_r_Block(irg, ARRAY_SIZE(ltin), ltin);
+/**
+ * Creates a decision tree for the sorted @p clusters.  The clusters are split
+ * such that both subtrees are about equally likely, so frequent cases are
+ * decided with few comparisons.
+ */
+static void create_decision_tree(switch_info_t *info, ir_node *block,
+                                 cluster_t *clusters, unsigned n_clusters,
+                                 const bounds_t *bounds)
+{
+	if (n_clusters == 0) {
+		connect_to_default(info, new_r_Jmp(block));
+		return;
+	} else if (n_clusters == 1) {
+		create_cluster(info, block, &clusters[0], bounds);
+		return;
+	}
 
-		ir_node *gein[]  = { new_r_Proj(cond, mode_X, pn_Cond_false) };
-		ir_node *geblock = new_r_Block(irg, ARRAY_SIZE(gein), gein);
+	bool only_ranges = true;
+	double total     = 0.0;
+	for (unsigned i = 0; i < n_clusters; ++i) {
+		only_ranges &= clusters[i].kind == CLUSTER_RANGE;
+		total       += clusters[i].weight;
+	}
+	if (only_ranges && n_clusters <= 3) {
+		create_chain(info, block, clusters, n_clusters, bounds);
+		return;
+	}
 
-		create_if_cascade(info, ltblock, curcases, midcase);
-		create_if_cascade(info, geblock, curcases + midcase, numcases - midcase);
+	/* split at the weighted median, prefer the middle for equal weights */
+	unsigned middle    = n_clusters / 2;
+	unsigned pivot     = middle;
+	double   best_diff = total;
+	double   left      = 0.0;
+	for (unsigned k = 1; k < n_clusters; ++k) {
+		left += clusters[k - 1].weight;
+		double diff = fabs(total - 2 * left);
+		if (diff < best_diff || (diff == best_diff
+		    && distance(k, middle) < distance(pivot, middle))) {
+			best_diff = diff;
+			pivot     = k;
+		}
 	}
+
+	ir_graph     *irg      = get_irn_irg(block);
+	dbg_info     *dbgi     = get_irn_dbg_info(info->switchn);
+	ir_node      *selector = get_Switch_selector(info->switchn);
+	const case_t *c        = &info->cases[clusters[pivot].first];
+	ir_node      *val      = new_r_Const(irg, c->entry->min);
+	ir_node      *cmp      = new_rd_Cmp(dbgi, block, selector, val,
+	                                    ir_relation_less);
+	ir_node      *cond     = new_rd_Cond(dbgi, block, cmp);
+	ir_node      *ltblock  = new_block_after(new_r_Proj(cond, mode_X, pn_Cond_true));
+	ir_node      *geblock  = new_block_after(new_r_Proj(cond, mode_X, pn_Cond_false));
+
+	bounds_t lt_bounds = *bounds;
+	bounds_t ge_bounds = *bounds;
+	if (info->has_offsets) {
+		lt_bounds.has_hi = true;
+		lt_bounds.hi     = c->lo - 1;
+		ge_bounds.has_lo = true;
+		ge_bounds.lo     = c->lo;
+	}
+	create_decision_tree(info, ltblock, clusters, pivot, &lt_bounds);
+	create_decision_tree(info, geblock, clusters + pivot, n_clusters - pivot,
+	                     &ge_bounds);
+}
+
+/**
+ * Tests single cases which are more likely than all other cases and the
+ * default together before the decision tree.
+ * @returns the block for the remaining cases
+ */
+static ir_node *peel_hot_cases(switch_info_t *info, ir_node *block,
+                               cluster_t *clusters, unsigned *n_clusters)
+{
+	double total = info->targets[pn_Switch_default].weight;
+	for (unsigned i = 0; i < *n_clusters; ++i)
+		total += clusters[i].weight;
+
+	while (*n_clusters > 1) {
+		unsigned hot = *n_clusters;
+		for (unsigned i = 0; i < *n_clusters; ++i) {
+			if (clusters[i].kind == CLUSTER_RANGE
+			    && (hot == *n_clusters || clusters[i].weight > clusters[hot].weight))
+				hot = i;
+		}
+		if (hot == *n_clusters || clusters[hot].weight <= total / 2)
+			break;
+
+		const case_t *c = &info->cases[clusters[hot].first];
+		block  = new_block_after(create_case_test(info, block, c));
+		total -= clusters[hot].weight;
+		memmove(&clusters[hot], &clusters[hot + 1],
+		        (*n_clusters - hot - 1) * sizeof(clusters[0]));
+		--*n_clusters;
+	}
+	return block;
+}
+
+/**
+ * Replaces the predecessors of @p block by @p preds.  The blocks had a single
+ * predecessor before, so their Phis get the same value for every new one.
+ */
+static void set_block_preds(ir_node *block, ir_node **preds)
+{
+	int n_preds = (int)ARR_LEN(preds);
+	if (n_preds == 0) {
+		/* no value reaches the block anymore */
+		ir_graph *irg = get_irn_irg(block);
+		ARR_APP1(ir_node*, preds, new_r_Bad(irg, mode_X));
+		n_preds = 1;
+	}
+
+	foreach_irn_out(block, i, node) {
+		if (!is_Phi(node))
+			continue;
+		assert(get_Phi_n_preds(node) == 1);
+		ir_node  *val = get_Phi_pred(node, 0);
+		ir_node **in  = ALLOCAN(ir_node*, n_preds);
+		for (int p = 0; p < n_preds; ++p)
+			in[p] = val;
+		set_irn_in(node, n_preds, in);
+	}
+	set_irn_in(block, n_preds, preds);
 }
 
 /**
@@ -421,18 +1001,31 @@ static void find_switch_nodes(ir_node *block, void *ctx)
 
 	normalize_table(switchn, selector_mode, NULL);
 	analyse_switch1(&info);
+	info.env         = env;
+	info.offset_mode = mode;
+	info.has_offsets = get_mode_size_bits(mode) <= 64;
+	analyse_cases(&info);
 
-	/* Now create the if cascade */
-	env->changed  = true;
-	info.defusers = NEW_ARR_F(ir_node*, 0);
-	block         = get_nodes_block(switchn);
-	ir_switch_table *table = get_Switch_table(switchn);
-	create_if_cascade(&info, block, table->entries, table->n_entries);
+	/* Now decompose the switch into tables, bit tests and comparisons */
+	env->changed = true;
+	block        = get_nodes_block(switchn);
+	cluster_t *clusters   = find_clusters(&info);
+	unsigned   n_clusters = ARR_LEN(clusters);
+	block = peel_hot_cases(&info, block, clusters, &n_clusters);
 
-	/* Connect new default case users */
-	set_irn_in(info.default_block, ARR_LEN(info.defusers), info.defusers);
+	bounds_t bounds = { false, false, 0, 0 };
+	create_decision_tree(&info, block, clusters, n_clusters, &bounds);
+
+	/* Connect the targets to their new predecessors */
+	for (unsigned pn = 0; pn < info.n_targets; ++pn) {
+		target_t *target = &info.targets[pn];
+		if (target->block != NULL)
+			set_block_preds(target->block, target->preds);
+		DEL_ARR_F(target->preds);
+	}
 
-	DEL_ARR_F(info.defusers);
+	DEL_ARR_F(clusters);
+	DEL_ARR_F(info.cases);
 	free(info.targets);
 }
 
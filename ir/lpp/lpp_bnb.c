@@ -0,0 +1,818 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Built-in branch-and-bound MILP solver.
+ *
+ * The problem is brought into the form
+ *
+ *   min c^T x   subject to   A x + s = b,  l <= (x, s) <= u
+ *
+ * with one slack variable per row whose bounds encode the constraint type.
+ * The basis inverse is kept in product form as a list of eta columns and is
+ * rebuilt from the slack basis regularly.
+ *
+ * Binary variables have finite bounds and continuous variables get a large
+ * artificial upper bound, so the slack basis is dual feasible and the dual
+ * simplex is the only algorithm needed: Branching just fixes the bounds of a
+ * binary variable, which keeps the current basis dual feasible.  Each node is
+ * therefore solved starting from the optimal basis of the previous one.
+ */
+#include "lpp_bnb.h"
+
+#include "array.h"
+#include "panic.h"
+#include "sp_matrix.h"
+#include "timing.h"
+#include "util.h"
+#include "xmalloc.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PRIMAL_TOL       1e-7  /**< tolerance for bound violations */
+#define DUAL_TOL         1e-9  /**< tolerance for reduced cost signs */
+#define PIVOT_TOL        1e-9  /**< smallest acceptable pivot element */
+#define DROP_TOL         1e-12 /**< eta entries below this are dropped */
+#define INT_TOL          1e-6  /**< tolerance for integrality */
+#define ARTIFICIAL_UB    1e9   /**< upper bound of continuous variables */
+#define REINVERT_UPDATES 64    /**< minimal basis updates between reinversions */
+
+typedef enum lp_result_t {
+	LP_OPTIMAL,
+	LP_INFEASIBLE,
+	LP_ABORTED,
+} lp_result_t;
+
+/** An eta column: the identity matrix with one column replaced. */
+typedef struct eta_t {
+	int row;   /**< the replaced column */
+	int start; /**< index of the first entry in eta_idx/eta_val */
+} eta_t;
+
+/** A branching decision on the path from the root to the current node. */
+typedef struct branch_t {
+	int  var;    /**< the branching variable */
+	bool up;     /**< value of the variable in the first child */
+	bool second; /**< the second child is being explored */
+} branch_t;
+
+typedef struct bnb_t {
+	lpp_t      *lpp;
+	int         n_rows;       /**< number of constraints */
+	int         n_structs;    /**< number of structural variables */
+	int         n_vars;       /**< structural variables and one slack per row */
+
+	/* the constraint matrix without slacks in column-major order */
+	int        *col_start;
+	int        *col_row;
+	double     *col_val;
+	double     *rhs;
+
+	double     *obj;          /**< objective of the structurals, minimized */
+	double     *cost;         /**< costs used by the simplex, perturbed */
+	double      cost_error;   /**< bound on the objective error of perturbation */
+	bool        integral_obj; /**< integral solutions have integral objective */
+	bool       *is_binary;
+	double     *lb;           /**< current lower bounds */
+	double     *ub;           /**< current upper bounds */
+
+	/* simplex state */
+	double     *x;            /**< values of all variables */
+	double     *d;            /**< reduced costs of all variables */
+	double     *alpha;        /**< the current pivot row */
+	double     *work;         /**< a dense vector over the rows */
+	int        *head;         /**< variable at each basis position */
+	int        *pos;          /**< basis position of each variable or -1 */
+	int        *basics;       /**< scratch list of basic variables */
+	eta_t      *etas;         /**< the basis inverse in product form */
+	int        *eta_idx;
+	double     *eta_val;
+	unsigned    n_updates;    /**< basis changes since the last reinversion */
+	unsigned    n_reinvert;   /**< basis changes before the next reinversion */
+
+	/* search state */
+	ir_timer_t *timer;
+	unsigned    iterations;
+	bool        has_incumbent;
+	double      incumbent_obj;
+	double     *incumbent;
+} bnb_t;
+
+static bool is_slack(bnb_t const *bnb, int var)
+{
+	return var >= bnb->n_structs;
+}
+
+/** Stores column @p var of [A I] into the dense vector @p v. */
+static void load_column(bnb_t const *bnb, int var, double *v)
+{
+	memset(v, 0, bnb->n_rows * sizeof(*v));
+	if (is_slack(bnb, var)) {
+		v[var - bnb->n_structs] = 1.0;
+		return;
+	}
+	for (int i = bnb->col_start[var], e = bnb->col_start[var + 1]; i < e; ++i)
+		v[bnb->col_row[i]] = bnb->col_val[i];
+}
+
+/** Returns the scalar product of column @p var of [A I] with @p v. */
+static double dot_column(bnb_t const *bnb, int var, double const *v)
+{
+	if (is_slack(bnb, var))
+		return v[var - bnb->n_structs];
+	double sum = 0.0;
+	for (int i = bnb->col_start[var], e = bnb->col_start[var + 1]; i < e; ++i)
+		sum += v[bnb->col_row[i]] * bnb->col_val[i];
+	return sum;
+}
+
+static int get_eta_end(bnb_t const *bnb, size_t k)
+{
+	if (k + 1 < ARR_LEN(bnb->etas))
+		return bnb->etas[k + 1].start;
+	return (int)ARR_LEN(bnb->eta_idx);
+}
+
+/** Computes B^-1 v in place. */
+static void ftran(bnb_t const *bnb, double *v)
+{
+	for (size_t k = 0, n = ARR_LEN(bnb->etas); k < n; ++k) {
+		eta_t const *const eta = &bnb->etas[k];
+		double       const t   = v[eta->row];
+		if (t == 0.0)
+			continue;
+		v[eta->row] = 0.0;
+		for (int i = eta->start, e = get_eta_end(bnb, k); i < e; ++i)
+			v[bnb->eta_idx[i]] += t * bnb->eta_val[i];
+	}
+}
+
+/** Computes v^T B^-1 in place. */
+static void btran(bnb_t const *bnb, double *v)
+{
+	for (size_t k = ARR_LEN(bnb->etas); k-- > 0;) {
+		eta_t const *const eta = &bnb->etas[k];
+		double             sum = 0.0;
+		for (int i = eta->start, e = get_eta_end(bnb, k); i < e; ++i)
+			sum += v[bnb->eta_idx[i]] * bnb->eta_val[i];
+		v[eta->row] = sum;
+	}
+}
+
+/**
+ * Appends the eta column which puts a new column at basis position @p row.
+ * @p y is the new column multiplied by the current basis inverse.
+ */
+static void add_eta(bnb_t *bnb, int row, double const *y)
+{
+	double const pivot = y[row];
+	eta_t  const eta   = { row, (int)ARR_LEN(bnb->eta_idx) };
+	ARR_APP1(eta_t, bnb->etas, eta);
+	for (int i = 0; i < bnb->n_rows; ++i) {
+		double val;
+		if (i == row) {
+			val = 1.0 / pivot;
+		} else if (fabs(y[i]) > DROP_TOL) {
+			val = -y[i] / pivot;
+		} else {
+			continue;
+		}
+		ARR_APP1(int,    bnb->eta_idx, i);
+		ARR_APP1(double, bnb->eta_val, val);
+	}
+}
+
+/**
+ * Returns the bound a nonbasic variable has to be at to be dual feasible.
+ * If that bound is infinite, the cost of the variable is shifted instead.
+ */
+static double get_nonbasic_value(bnb_t *bnb, int var)
+{
+	double const lb = bnb->lb[var];
+	double const ub = bnb->ub[var];
+	if (lb == ub)
+		return lb;
+
+	double const d = bnb->d[var];
+	bool         at_lb;
+	if (d > DUAL_TOL) {
+		at_lb = true;
+	} else if (d < -DUAL_TOL) {
+		at_lb = false;
+	} else {
+		/* stay at the nearer bound */
+		double const x = bnb->x[var];
+		at_lb = ub == HUGE_VAL || (lb != -HUGE_VAL && x - lb <= ub - x);
+	}
+	if (at_lb ? lb == -HUGE_VAL : ub == HUGE_VAL) {
+		bnb->cost[var] -= d;
+		bnb->d[var]     = 0.0;
+		at_lb           = !at_lb;
+	}
+	return at_lb ? lb : ub;
+}
+
+static void compute_duals(bnb_t *bnb)
+{
+	double *const pi = bnb->work;
+	for (int r = 0; r < bnb->n_rows; ++r)
+		pi[r] = bnb->cost[bnb->head[r]];
+	btran(bnb, pi);
+	for (int j = 0; j < bnb->n_vars; ++j) {
+		if (bnb->pos[j] >= 0)
+			bnb->d[j] = 0.0;
+		else
+			bnb->d[j] = bnb->cost[j] - dot_column(bnb, j, pi);
+	}
+}
+
+static void compute_primals(bnb_t *bnb)
+{
+	double *const v = bnb->work;
+	memcpy(v, bnb->rhs, bnb->n_rows * sizeof(*v));
+	for (int j = 0; j < bnb->n_vars; ++j) {
+		if (bnb->pos[j] >= 0)
+			continue;
+		double const x = get_nonbasic_value(bnb, j);
+		bnb->x[j] = x;
+		if (x == 0.0)
+			continue;
+		if (is_slack(bnb, j)) {
+			v[j - bnb->n_structs] -= x;
+		} else {
+			for (int i = bnb->col_start[j], e = bnb->col_start[j + 1]; i < e; ++i)
+				v[bnb->col_row[i]] -= x * bnb->col_val[i];
+		}
+	}
+	ftran(bnb, v);
+	for (int r = 0; r < bnb->n_rows; ++r)
+		bnb->x[bnb->head[r]] = v[r];
+}
+
+/**
+ * Rebuilds the product form of the basis inverse by replacing the columns of
+ * the slack basis one after another, and recomputes primal and dual values.
+ */
+static void reinvert(bnb_t *bnb)
+{
+	int const n_rows   = bnb->n_rows;
+	int       n_basics = 0;
+	ARR_SHRINKLEN(bnb->etas,    0);
+	ARR_SHRINKLEN(bnb->eta_idx, 0);
+	ARR_SHRINKLEN(bnb->eta_val, 0);
+	bnb->n_updates = 0;
+
+	for (int r = 0; r < n_rows; ++r) {
+		int const var = bnb->head[r];
+		if (!is_slack(bnb, var))
+			bnb->basics[n_basics++] = var;
+		bnb->head[r] = -1;
+	}
+	for (int r = 0; r < n_rows; ++r) {
+		int const slack = bnb->n_structs + r;
+		if (bnb->pos[slack] >= 0) {
+			bnb->head[r]     = slack;
+			bnb->pos[slack] = r;
+		}
+	}
+
+	double *const y = bnb->work;
+	for (int k = 0; k < n_basics; ++k) {
+		int const var = bnb->basics[k];
+		load_column(bnb, var, y);
+		ftran(bnb, y);
+
+		int    best     = -1;
+		double best_abs = PIVOT_TOL;
+		for (int r = 0; r < n_rows; ++r) {
+			if (bnb->head[r] < 0 && fabs(y[r]) > best_abs) {
+				best     = r;
+				best_abs = fabs(y[r]);
+			}
+		}
+		if (best < 0) {
+			/* the column is (numerically) dependent, a slack replaces it */
+			bnb->pos[var] = -1;
+			continue;
+		}
+		add_eta(bnb, best, y);
+		bnb->head[best] = var;
+		bnb->pos[var]   = best;
+	}
+	for (int r = 0; r < n_rows; ++r) {
+		if (bnb->head[r] < 0) {
+			int const slack = bnb->n_structs + r;
+			bnb->head[r]    = slack;
+			bnb->pos[slack] = r;
+		}
+	}
+	/* a reinversion costs about as much as one update per structural column */
+	bnb->n_reinvert = MAX(REINVERT_UPDATES, (unsigned)n_basics);
+
+	compute_duals(bnb);
+	compute_primals(bnb);
+}
+
+static bool is_time_exceeded(bnb_t const *bnb)
+{
+	double const limit = bnb->lpp->time_limit_secs;
+	return limit > 0.0 && ir_timer_elapsed_sec(bnb->timer) > limit;
+}
+
+/** Returns the basis position with the largest bound violation or -1. */
+static int select_leaving(bnb_t const *bnb)
+{
+	int    best       = -1;
+	double best_viol  = PRIMAL_TOL;
+	for (int r = 0; r < bnb->n_rows; ++r) {
+		int    const var  = bnb->head[r];
+		double const x    = bnb->x[var];
+		double const viol = x < bnb->lb[var] ? bnb->lb[var] - x : x - bnb->ub[var];
+		if (viol > best_viol) {
+			best      = r;
+			best_viol = viol;
+		}
+	}
+	return best;
+}
+
+/**
+ * Returns whether nonbasic variable @p var may enter the basis.  @p a is its
+ * pivot row entry, negated if the leaving variable has to increase.
+ */
+static bool is_entering_candidate(bnb_t const *bnb, int var, double a)
+{
+	if (fabs(a) <= PIVOT_TOL || bnb->lb[var] == bnb->ub[var])
+		return false;
+	if (bnb->x[var] == bnb->lb[var])
+		return a > 0.0;
+	return a < 0.0;
+}
+
+/** Reoptimizes the current basis with the dual simplex. */
+static lp_result_t dual_simplex(bnb_t *bnb)
+{
+	int      const n_rows         = bnb->n_rows;
+	int      const n_vars         = bnb->n_vars;
+	unsigned const max_iterations = 50 * (unsigned)(n_rows + n_vars) + 1000;
+	double  *const alpha          = bnb->alpha;
+	double  *const v              = bnb->work;
+
+	for (unsigned iteration = 0;; ++iteration) {
+		if (iteration >= max_iterations)
+			return LP_ABORTED;
+		if (iteration % 64 == 0 && is_time_exceeded(bnb))
+			return LP_ABORTED;
+		if (bnb->n_updates >= bnb->n_reinvert)
+			reinvert(bnb);
+
+		int const r = select_leaving(bnb);
+		if (r < 0)
+			return LP_OPTIMAL;
+		int    const leave = bnb->head[r];
+		double const x_l   = bnb->x[leave];
+		bool   const below = x_l < bnb->lb[leave];
+		double const bound = below ? bnb->lb[leave] : bnb->ub[leave];
+
+		/* compute the pivot row */
+		memset(v, 0, n_rows * sizeof(*v));
+		v[r] = 1.0;
+		btran(bnb, v);
+
+		/* two pass ratio test by Harris */
+		double max_ratio = HUGE_VAL;
+		for (int j = 0; j < n_vars; ++j) {
+			if (bnb->pos[j] >= 0)
+				continue;
+			double const a = dot_column(bnb, j, v);
+			alpha[j] = a;
+			if (!is_entering_candidate(bnb, j, below ? -a : a))
+				continue;
+			double const ratio = (fabs(bnb->d[j]) + DUAL_TOL) / fabs(a);
+			if (ratio < max_ratio)
+				max_ratio = ratio;
+		}
+		int    enter    = -1;
+		double best_abs = 0.0;
+		for (int j = 0; j < n_vars; ++j) {
+			if (bnb->pos[j] >= 0)
+				continue;
+			double const a = alpha[j];
+			if (!is_entering_candidate(bnb, j, below ? -a : a))
+				continue;
+			if (fabs(bnb->d[j]) / fabs(a) <= max_ratio && fabs(a) > best_abs) {
+				enter    = j;
+				best_abs = fabs(a);
+			}
+		}
+		if (enter < 0)
+			return LP_INFEASIBLE;
+
+		/* compute the entering column */
+		double *const y = v;
+		load_column(bnb, enter, y);
+		ftran(bnb, y);
+		double const a_q = alpha[enter];
+		if (fabs(y[r] - a_q) > 1e-6 * (1.0 + fabs(a_q)) && bnb->n_updates > 0) {
+			/* row and column disagree, start again with a fresh inverse */
+			reinvert(bnb);
+			continue;
+		}
+
+		/* update reduced costs */
+		double const theta = bnb->d[enter] / a_q;
+		for (int j = 0; j < n_vars; ++j) {
+			if (bnb->pos[j] < 0)
+				bnb->d[j] -= theta * alpha[j];
+		}
+		bnb->d[enter] = 0.0;
+		bnb->d[leave] = -theta;
+
+		/* update primal values */
+		double const delta = (x_l - bound) / y[r];
+		for (int i = 0; i < n_rows; ++i) {
+			if (y[i] != 0.0)
+				bnb->x[bnb->head[i]] -= delta * y[i];
+		}
+		bnb->x[enter] += delta;
+		bnb->x[leave]  = bound;
+
+		add_eta(bnb, r, y);
+		bnb->head[r]     = enter;
+		bnb->pos[enter]  = r;
+		bnb->pos[leave]  = -1;
+		++bnb->n_updates;
+		++bnb->iterations;
+	}
+}
+
+/** Changes the bounds of @p var and moves it if it is nonbasic. */
+static void set_bounds(bnb_t *bnb, int var, double lb, double ub)
+{
+	bnb->lb[var] = lb;
+	bnb->ub[var] = ub;
+	if (bnb->pos[var] >= 0)
+		return;
+
+	double const old_x = bnb->x[var];
+	double const new_x = get_nonbasic_value(bnb, var);
+	if (new_x == old_x)
+		return;
+
+	double *const y = bnb->work;
+	load_column(bnb, var, y);
+	ftran(bnb, y);
+	double const delta = new_x - old_x;
+	for (int r = 0; r < bnb->n_rows; ++r) {
+		if (y[r] != 0.0)
+			bnb->x[bnb->head[r]] -= delta * y[r];
+	}
+	bnb->x[var] = new_x;
+}
+
+/** Returns a lower bound for all solutions below a node with LP value @p z. */
+static double get_node_bound(bnb_t const *bnb, double z)
+{
+	double const bound = z - bnb->cost_error - DUAL_TOL * (1.0 + fabs(z));
+	if (bnb->integral_obj)
+		return ceil(bound - INT_TOL);
+	return bound;
+}
+
+/** Returns whether no solution with objective at least @p bound is better than the incumbent. */
+static bool is_pruned(bnb_t const *bnb, double bound)
+{
+	if (!bnb->has_incumbent)
+		return false;
+	double const tol = bnb->integral_obj ? 0.5
+	                 : DUAL_TOL * (1.0 + fabs(bnb->incumbent_obj));
+	return bound >= bnb->incumbent_obj - tol;
+}
+
+static double get_lp_objective(bnb_t const *bnb)
+{
+	double sum = 0.0;
+	for (int j = 0; j < bnb->n_vars; ++j)
+		sum += bnb->cost[j] * bnb->x[j];
+	return sum;
+}
+
+/** Returns the most fractional binary variable or -1 if there is none. */
+static int select_branch_var(bnb_t const *bnb)
+{
+	int    best      = -1;
+	double best_frac = INT_TOL;
+	for (int j = 0; j < bnb->n_structs; ++j) {
+		if (!bnb->is_binary[j])
+			continue;
+		double const x    = bnb->x[j];
+		double const frac = fmin(x - floor(x), ceil(x) - x);
+		if (frac > best_frac) {
+			best      = j;
+			best_frac = frac;
+		}
+	}
+	return best;
+}
+
+static void log_incumbent(bnb_t const *bnb)
+{
+	lpp_t *const lpp = bnb->lpp;
+	if (lpp->log == NULL)
+		return;
+	double const sign = lpp->opt_type == lpp_minimize ? 1.0 : -1.0;
+	fprintf(lpp->log, "bnb: incumbent %g after %u iterations, %.2fs\n",
+	        sign * bnb->incumbent_obj, bnb->iterations,
+	        ir_timer_elapsed_sec(bnb->timer));
+}
+
+/** Makes the integral LP solution the incumbent if it is better. */
+static void update_incumbent(bnb_t *bnb)
+{
+	double obj = 0.0;
+	for (int j = 0; j < bnb->n_structs; ++j) {
+		double x = bnb->x[j];
+		if (bnb->is_binary[j])
+			x = x >= 0.5 ? 1.0 : 0.0;
+		obj += bnb->obj[j] * x;
+	}
+	if (bnb->has_incumbent && obj >= bnb->incumbent_obj)
+		return;
+
+	for (int j = 0; j < bnb->n_structs; ++j) {
+		double const x = bnb->x[j];
+		bnb->incumbent[j] = bnb->is_binary[j] ? (x >= 0.5 ? 1.0 : 0.0) : x;
+	}
+	bnb->has_incumbent = true;
+	bnb->incumbent_obj = obj;
+	log_incumbent(bnb);
+}
+
+/** Uses the start values as incumbent if they form a feasible solution. */
+static void use_start_values(bnb_t *bnb)
+{
+	lpp_t *const lpp = bnb->lpp;
+	for (int j = 0; j < bnb->n_structs; ++j) {
+		lpp_name_t const *const var = lpp->vars[1 + j];
+		if (var->value_kind != lpp_value_start)
+			return;
+		if (var->value < 0.0 || (bnb->is_binary[j] && var->value != 0.0 && var->value != 1.0))
+			return;
+	}
+
+	double *const activity = bnb->work;
+	double        obj      = 0.0;
+	memset(activity, 0, bnb->n_rows * sizeof(*activity));
+	for (int j = 0; j < bnb->n_structs; ++j) {
+		double const x = lpp->vars[1 + j]->value;
+		obj += bnb->obj[j] * x;
+		for (int i = bnb->col_start[j], e = bnb->col_start[j + 1]; i < e; ++i)
+			activity[bnb->col_row[i]] += x * bnb->col_val[i];
+	}
+	for (int r = 0; r < bnb->n_rows; ++r) {
+		int    const slack = bnb->n_structs + r;
+		double const s     = bnb->rhs[r] - activity[r];
+		double const tol   = PRIMAL_TOL * (1.0 + fabs(bnb->rhs[r]));
+		if (s < bnb->lb[slack] - tol || s > bnb->ub[slack] + tol)
+			return;
+	}
+
+	for (int j = 0; j < bnb->n_structs; ++j)
+		bnb->incumbent[j] = lpp->vars[1 + j]->value;
+	bnb->has_incumbent = true;
+	bnb->incumbent_obj = obj;
+	log_incumbent(bnb);
+}
+
+/**
+ * Build the solver data structures from the LPP matrix.
+ * @note: The LPP matrix is freed after this step, to save memory.
+ */
+static bnb_t *new_bnb(lpp_t *lpp)
+{
+	int    const n_rows    = lpp->cst_next - 1;
+	int    const n_structs = lpp->var_next - 1;
+	int    const n_vars    = n_structs + n_rows;
+	int    const n_entries = matrix_get_entries(lpp->m);
+	double const sign      = lpp->opt_type == lpp_minimize ? 1.0 : -1.0;
+
+	bnb_t *const bnb = XMALLOCZ(bnb_t);
+	bnb->lpp       = lpp;
+	bnb->n_rows    = n_rows;
+	bnb->n_structs = n_structs;
+	bnb->n_vars    = n_vars;
+	bnb->col_start = XMALLOCN(int, n_structs + 1);
+	bnb->col_row   = XMALLOCN(int, n_entries + 1);
+	bnb->col_val   = XMALLOCN(double, n_entries + 1);
+	bnb->rhs       = XMALLOCN(double, n_rows + 1);
+	bnb->obj       = XMALLOCNZ(double, n_structs + 1);
+	bnb->cost      = XMALLOCNZ(double, n_vars + 1);
+	bnb->is_binary = XMALLOCNZ(bool, n_structs + 1);
+	bnb->lb        = XMALLOCN(double, n_vars + 1);
+	bnb->ub        = XMALLOCN(double, n_vars + 1);
+	bnb->x         = XMALLOCNZ(double, n_vars + 1);
+	bnb->d         = XMALLOCNZ(double, n_vars + 1);
+	bnb->alpha     = XMALLOCNZ(double, n_vars + 1);
+	bnb->work      = XMALLOCNZ(double, n_rows + 1);
+	bnb->head      = XMALLOCN(int, n_rows + 1);
+	bnb->pos       = XMALLOCN(int, n_vars + 1);
+	bnb->basics    = XMALLOCN(int, n_rows + 1);
+	bnb->incumbent = XMALLOCNZ(double, n_structs + 1);
+	bnb->etas      = NEW_ARR_F(eta_t, 0);
+	bnb->eta_idx   = NEW_ARR_F(int, 0);
+	bnb->eta_val   = NEW_ARR_F(double, 0);
+	bnb->timer     = ir_timer_new();
+
+	bnb->integral_obj = true;
+	int o = 0;
+	for (int j = 0; j < n_structs; ++j) {
+		bnb->col_start[j] = o;
+		matrix_foreach_in_col(lpp->m, 1 + j, elem) {
+			if (elem->row == 0) {
+				bnb->obj[j] = sign * elem->val;
+				continue;
+			}
+			bnb->col_row[o] = elem->row - 1;
+			bnb->col_val[o] = elem->val;
+			++o;
+		}
+
+		bool const is_binary = lpp->vars[1 + j]->type.var_type == lpp_binary;
+		bnb->is_binary[j] = is_binary;
+		bnb->lb[j]        = 0.0;
+		bnb->ub[j]        = is_binary ? 1.0 : ARTIFICIAL_UB;
+		bnb->pos[j]       = -1;
+		if (bnb->obj[j] != 0.0 && (!is_binary || bnb->obj[j] != rint(bnb->obj[j])))
+			bnb->integral_obj = false;
+	}
+	bnb->col_start[n_structs] = o;
+
+	for (int r = 0; r < n_rows; ++r) {
+		int const slack = n_structs + r;
+		bnb->rhs[r] = matrix_get(lpp->m, 1 + r, 0);
+		switch (lpp->csts[1 + r]->type.cst_type) {
+		case lpp_equal:
+			bnb->lb[slack] = 0.0;
+			bnb->ub[slack] = 0.0;
+			break;
+		case lpp_less_equal:
+			bnb->lb[slack] = 0.0;
+			bnb->ub[slack] = HUGE_VAL;
+			break;
+		case lpp_greater_equal:
+			bnb->lb[slack] = -HUGE_VAL;
+			bnb->ub[slack] = 0.0;
+			break;
+		default:
+			panic("invalid constraint type");
+		}
+		bnb->head[r]    = slack;
+		bnb->pos[slack] = r;
+	}
+
+	/* Perturb the costs of the binary variables slightly, so the dual simplex
+	 * does not stall on the many dual degenerate vertices of 0/1 problems. */
+	unsigned seed = 42;
+	for (int j = 0; j < n_structs; ++j) {
+		double const c = bnb->obj[j];
+		if (!bnb->is_binary[j]) {
+			bnb->cost[j] = c;
+			continue;
+		}
+		seed = seed * 1103515245u + 12345u;
+		double const xi = (1.0 + (seed >> 16 & 0x7fff) / 32768.0) * 1e-8 * (1.0 + fabs(c));
+		bnb->cost[j]     = c >= 0.0 ? c + xi : c - xi;
+		bnb->cost_error += xi;
+	}
+
+	lpp_free_matrix(lpp);
+	return bnb;
+}
+
+static void free_bnb(bnb_t *bnb)
+{
+	ir_timer_free(bnb->timer);
+	DEL_ARR_F(bnb->eta_val);
+	DEL_ARR_F(bnb->eta_idx);
+	DEL_ARR_F(bnb->etas);
+	free(bnb->incumbent);
+	free(bnb->basics);
+	free(bnb->pos);
+	free(bnb->head);
+	free(bnb->work);
+	free(bnb->alpha);
+	free(bnb->d);
+	free(bnb->x);
+	free(bnb->ub);
+	free(bnb->lb);
+	free(bnb->is_binary);
+	free(bnb->cost);
+	free(bnb->obj);
+	free(bnb->rhs);
+	free(bnb->col_val);
+	free(bnb->col_row);
+	free(bnb->col_start);
+	free(bnb);
+}
+
+static void bnb_solve(bnb_t *bnb)
+{
+	lpp_t  *const lpp  = bnb->lpp;
+	double  const sign = lpp->opt_type == lpp_minimize ? 1.0 : -1.0;
+
+	/* a bound given by the user ends the search as soon as it is reached */
+	double target = -HUGE_VAL;
+	if (lpp->set_bound)
+		target = get_node_bound(bnb, sign * lpp->bound);
+
+	ir_timer_start(bnb->timer);
+	if (lpp->log != NULL) {
+		fprintf(lpp->log, "bnb: %d rows, %d columns\n", bnb->n_rows,
+		        bnb->n_structs);
+	}
+	use_start_values(bnb);
+	reinvert(bnb);
+
+	branch_t *stack      = NEW_ARR_F(branch_t, 0);
+	double    root_bound = -HUGE_VAL;
+	bool      aborted    = false;
+	for (;;) {
+		lp_result_t const res = dual_simplex(bnb);
+		if (res == LP_ABORTED) {
+			aborted = true;
+			break;
+		}
+
+		int branch_var = -1;
+		if (res == LP_OPTIMAL) {
+			double const bound = get_node_bound(bnb, get_lp_objective(bnb));
+			if (ARR_LEN(stack) == 0) {
+				root_bound = bound;
+				if (lpp->log != NULL)
+					fprintf(lpp->log, "bnb: root bound %g\n", sign * bound);
+			}
+			if (!is_pruned(bnb, bound)) {
+				branch_var = select_branch_var(bnb);
+				if (branch_var < 0)
+					update_incumbent(bnb);
+			}
+		}
+		if (is_pruned(bnb, fmax(root_bound, target)))
+			break;
+
+		if (branch_var >= 0) {
+			branch_t const branch = { branch_var, bnb->x[branch_var] >= 0.5, false };
+			double   const fixed  = branch.up ? 1.0 : 0.0;
+			ARR_APP1(branch_t, stack, branch);
+			set_bounds(bnb, branch_var, fixed, fixed);
+			continue;
+		}
+
+		/* backtrack to the deepest branch with an unexplored child */
+		while (ARR_LEN(stack) > 0) {
+			branch_t *const top = &stack[ARR_LEN(stack) - 1];
+			if (!top->second) {
+				double const fixed = top->up ? 0.0 : 1.0;
+				top->second = true;
+				set_bounds(bnb, top->var, fixed, fixed);
+				break;
+			}
+			set_bounds(bnb, top->var, 0.0, 1.0);
+			ARR_SHRINKLEN(stack, ARR_LEN(stack) - 1);
+		}
+		if (ARR_LEN(stack) == 0)
+			break;
+	}
+	DEL_ARR_F(stack);
+	ir_timer_stop(bnb->timer);
+
+	if (bnb->has_incumbent) {
+		lpp->sol_state = aborted ? lpp_feasible : lpp_optimal;
+		for (int j = 0; j < bnb->n_structs; ++j) {
+			lpp_name_t *const var = lpp->vars[1 + j];
+			var->value      = bnb->incumbent[j];
+			var->value_kind = lpp_value_solution;
+			if (!bnb->is_binary[j] && var->value >= ARTIFICIAL_UB - PRIMAL_TOL)
+				lpp->sol_state = lpp_unbounded;
+		}
+		lpp->objval     = sign * bnb->incumbent_obj;
+		lpp->best_bound = sign * (aborted ? root_bound : bnb->incumbent_obj);
+	} else {
+		lpp->sol_state = aborted ? lpp_unknown : lpp_infeasible;
+	}
+	lpp->iterations = bnb->iterations;
+	lpp->sol_time   = ir_timer_elapsed_sec(bnb->timer);
+}
+
+void lpp_solve_bnb(lpp_t *lpp)
+{
+	bnb_t *bnb = new_bnb(lpp);
+	bnb_solve(bnb);
+	free_bnb(bnb);
+}
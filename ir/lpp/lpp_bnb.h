@@ -0,0 +1,24 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Built-in branch-and-bound MILP solver.
+ */
+#ifndef LPP_BNB_H
+#define LPP_BNB_H
+
+#include "lpp.h"
+
+/**
+ * Solves @p lpp with a depth-first branch and bound over binary variables.
+ * The LP relaxations are solved by a bounded dual simplex which is warm
+ * started from the basis of the parent node.  If start values are given for
+ * all variables and they form a feasible solution, it is used as the initial
+ * incumbent.
+ */
+void lpp_solve_bnb(lpp_t *lpp);
+
+#endif
@@ -9,6 +9,7 @@
  */
 #include "lpp_solvers.h"
 
+#include "lpp_bnb.h"
 #include "lpp_cplex.h"
 #include "lpp_gurobi.h"
 #include "util.h"
@@ -26,6 +27,7 @@ static lpp_solver_t const lpp_solvers[] = {
 #ifdef WITH_GUROBI
 	{ lpp_solve_gurobi,  "gurobi",  1 },
 #endif
+	{ lpp_solve_bnb,     "bnb",     1 },
 	{ NULL,              NULL,      0 }
 };
 
@@ -9,9 +9,16 @@
  */
 #include "mps.h"
 
+#include "hashptr.h"
+#include "obst.h"
 #include "panic.h"
+#include "set.h"
+#include "util.h"
 #include <assert.h>
+#include <ctype.h>
 #include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
 
 /**
  * These must comply to the enum cst_t in lpp.h
@@ -126,7 +133,9 @@ void mps_write_mps(lpp_t *lpp, lpp_mps_style_t style, FILE *out)
 
 		/* participation in constraints */
 		count = 0;
+		bool empty = true;
 		matrix_foreach_in_col(lpp->m, curr->nr, elem) {
+			empty = false;
 			if (count == 0) {
 				before = elem;
 				count = 1;
@@ -137,6 +146,9 @@ void mps_write_mps(lpp_t *lpp, lpp_mps_style_t style, FILE *out)
 		}
 		if (count == 1)
 			mps_write_line(out, style, l_data_col1, curr->name, lpp->csts[before->row]->name, (double)before->val);
+		/* a column must appear at least once to be declared */
+		if (empty)
+			mps_write_line(out, style, l_data_col1, curr->name, lpp->csts[0]->name, 0.0);
 	}
 	mps_insert_markers(out, style, lpp_invalid, last_type, marker_nr); /* potential end-marker */
 
@@ -170,3 +182,197 @@ void mps_write_mst(lpp_t *lpp, lpp_mps_style_t style, FILE *out)
 	}
 	mps_write_line(out, style, l_ind_end);
 }
+
+typedef enum {
+	sec_none, sec_name, sec_objsense, sec_rows, sec_cols, sec_rhs
+} mps_section_t;
+
+/** Maps a name in the file to the index of the row or column in the lpp. */
+typedef struct mps_name_t {
+	const char *name;
+	int         nr;
+} mps_name_t;
+
+typedef struct mps_reader_t {
+	lpp_t         *lpp;
+	char           name[256];
+	lpp_opt_t      opt_type;
+	mps_section_t  section;
+	bool           integer;  /**< inside an INTORG/INTEND block */
+	set           *rows;
+	set           *cols;
+	struct obstack obst;
+} mps_reader_t;
+
+#define MPS_MAX_TOKENS 6
+
+static int cmp_mps_name(const void *x, const void *y, size_t size)
+{
+	const mps_name_t *n = (const mps_name_t*)x;
+	const mps_name_t *m = (const mps_name_t*)y;
+	(void)size;
+	return strcmp(n->name, m->name);
+}
+
+static void mps_add_name(mps_reader_t *rd, set *map, const char *name, int nr)
+{
+	mps_name_t n;
+	n.name = (char*)obstack_copy0(&rd->obst, name, strlen(name));
+	n.nr   = nr;
+	(void)set_insert(mps_name_t, map, &n, sizeof(n), hash_str(n.name));
+}
+
+static int mps_find_name(set *map, const char *name)
+{
+	mps_name_t find;
+	find.name = name;
+	mps_name_t *found = set_find(mps_name_t, map, &find, sizeof(find), hash_str(name));
+	return found ? found->nr : -1;
+}
+
+/**
+ * Names starting with '_' are reserved for names generated by the lpp, so
+ * such rows and columns get a new generated name.
+ */
+static const char *mps_lpp_name(const char *name)
+{
+	return name[0] == '_' ? NULL : name;
+}
+
+/** Sets the entries given as (row, value) pairs in @p tok. */
+static bool mps_set_entries(mps_reader_t *rd, int col, char **tok, int n_tok)
+{
+	if (n_tok != 3 && n_tok != 5)
+		return false;
+	for (int i = 1; i + 1 < n_tok; i += 2) {
+		int const row = mps_find_name(rd->rows, tok[i]);
+		if (row < 0)
+			return false;
+		lpp_set_factor_fast(rd->lpp, row, col, strtod(tok[i + 1], NULL));
+	}
+	return true;
+}
+
+static bool mps_read_header(mps_reader_t *rd, char **tok, int n_tok)
+{
+	if (streq(tok[0], "NAME")) {
+		if (n_tok > 1)
+			snprintf(rd->name, sizeof(rd->name), "%s", tok[1]);
+		rd->section = sec_name;
+	} else if (streq(tok[0], "OBJSENSE")) {
+		if (n_tok > 1 && strncmp(tok[1], "MAX", 3) == 0)
+			rd->opt_type = lpp_maximize;
+		rd->section = sec_objsense;
+	} else if (streq(tok[0], "ROWS") && rd->lpp == NULL) {
+		rd->lpp     = lpp_new(rd->name, rd->opt_type);
+		rd->section = sec_rows;
+	} else if (streq(tok[0], "COLUMNS") && rd->lpp != NULL) {
+		rd->section = sec_cols;
+	} else if (streq(tok[0], "RHS") && rd->lpp != NULL) {
+		rd->section = sec_rhs;
+	} else {
+		/* BOUNDS, RANGES etc. are never written */
+		return false;
+	}
+	return true;
+}
+
+static bool mps_read_data(mps_reader_t *rd, char **tok, int n_tok)
+{
+	switch (rd->section) {
+	case sec_objsense:
+		if (strncmp(tok[0], "MAX", 3) == 0)
+			rd->opt_type = lpp_maximize;
+		return true;
+
+	case sec_rows: {
+		if (n_tok != 2)
+			return false;
+		lpp_cst_t type;
+		switch (tok[0][0]) {
+		case 'N':
+			mps_add_name(rd, rd->rows, tok[1], 0);
+			return true;
+		case 'E': type = lpp_equal;         break;
+		case 'L': type = lpp_less_equal;    break;
+		case 'G': type = lpp_greater_equal; break;
+		default:  return false;
+		}
+		int const nr = lpp_add_cst(rd->lpp, mps_lpp_name(tok[1]), type, 0.0);
+		mps_add_name(rd, rd->rows, tok[1], nr);
+		return true;
+	}
+
+	case sec_cols: {
+		if (n_tok == 3 && streq(tok[1], "'MARKER'")) {
+			rd->integer = streq(tok[2], "'INTORG'");
+			return true;
+		}
+		int col = mps_find_name(rd->cols, tok[0]);
+		if (col < 0) {
+			lpp_var_t const type = rd->integer ? lpp_binary : lpp_continous;
+			col = lpp_add_var(rd->lpp, mps_lpp_name(tok[0]), type, 0.0);
+			mps_add_name(rd, rd->cols, tok[0], col);
+		}
+		return mps_set_entries(rd, col, tok, n_tok);
+	}
+
+	case sec_rhs:
+		return mps_set_entries(rd, 0, tok, n_tok);
+
+	default:
+		return false;
+	}
+}
+
+lpp_t *mps_read_mps(FILE *in)
+{
+	mps_reader_t rd;
+	char         line[1024];
+	bool         ok = false;
+
+	memset(&rd, 0, sizeof(rd));
+	rd.opt_type = lpp_minimize;
+	rd.section  = sec_none;
+	rd.rows     = new_set(cmp_mps_name, 64);
+	rd.cols     = new_set(cmp_mps_name, 64);
+	obstack_init(&rd.obst);
+
+	while (fgets(line, sizeof(line), in) != NULL) {
+		char *tok[MPS_MAX_TOKENS];
+		int   n_tok  = 0;
+		bool  header = !isspace((unsigned char)line[0]);
+
+		for (char *c = line; *c != '\0';) {
+			while (isspace((unsigned char)*c))
+				*c++ = '\0';
+			if (*c == '\0')
+				break;
+			if (n_tok == MPS_MAX_TOKENS)
+				goto end;
+			tok[n_tok++] = c;
+			while (*c != '\0' && !isspace((unsigned char)*c))
+				++c;
+		}
+		if (n_tok == 0 || tok[0][0] == '*')
+			continue;
+
+		if (header && streq(tok[0], "ENDATA")) {
+			ok = rd.lpp != NULL;
+			break;
+		}
+		if (!(header ? mps_read_header(&rd, tok, n_tok)
+		             : mps_read_data(&rd, tok, n_tok)))
+			break;
+	}
+
+end:
+	obstack_free(&rd.obst, NULL);
+	del_set(rd.cols);
+	del_set(rd.rows);
+	if (!ok && rd.lpp != NULL) {
+		lpp_free(rd.lpp);
+		rd.lpp = NULL;
+	}
+	return rd.lpp;
+}
@@ -34,4 +34,12 @@ void mps_write_mps(lpp_t *lpp, lpp_mps_style_t style, FILE *out);
  */
 void mps_write_mst(lpp_t *lpp, lpp_mps_style_t style, FILE *out);
 
+/**
+ * Reads a lp problem object (lpp) from the stream in.  Both styles written
+ * by mps_write_mps() are accepted as long as no identifier contains spaces.
+ * Integer variables are read as binary ones.
+ * @return the problem or NULL if the input is malformed
+ */
+lpp_t *mps_read_mps(FILE *in);
+
 #endif
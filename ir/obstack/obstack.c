@@ -90,6 +90,14 @@ int obstack_exit_failure = EXIT_FAILURE;
       (*(void (*) (void *)) (h)->freefun) ((old_chunk)); \
   } while (0)
 
+/* Tell the accounting of H, if any, that a chunk of SIZE bytes was
+   allocated (SIZE > 0) or freed (SIZE < 0).  */
+# define ACCOUNT_CHUNK(h, size) \
+  do { \
+    if ((h) -> account) \
+      (*(h)->account->notify) ((h)->account, (size)); \
+  } while (0)
+
 
 /* Initialize an obstack H for use.  Specify chunk size SIZE (0 means default).
    Objects start on multiples of ALIGNMENT (0 means use default).
@@ -140,6 +148,7 @@ int _obstack_begin(struct obstack *h, int size, int alignment,
   /* The initial chunk now contains no empty object.  */
   h->maybe_empty_object = 0;
   h->alloc_failed = 0;
+  h->account = 0;
   return 1;
 }
 
@@ -186,6 +195,7 @@ int _obstack_begin_1(struct obstack *h, int size, int alignment,
   /* The initial chunk now contains no empty object.  */
   h->maybe_empty_object = 0;
   h->alloc_failed = 0;
+  h->account = 0;
   return 1;
 }
 
@@ -217,6 +227,7 @@ void _obstack_newchunk(struct obstack *h, ptrdiff_t length)
   h->chunk = new_chunk;
   new_chunk->prev = old_chunk;
   new_chunk->limit = h->chunk_limit = (char *) new_chunk + new_size;
+  ACCOUNT_CHUNK (h, new_size);
 
   /* Compute an aligned object_base in the new chunk */
   object_base =
@@ -251,6 +262,7 @@ void _obstack_newchunk(struct obstack *h, ptrdiff_t length)
 			  h->alignment_mask)))
     {
       new_chunk->prev = old_chunk->prev;
+      ACCOUNT_CHUNK (h, -(old_chunk->limit - (char *) old_chunk));
       CALL_FREEFUN (h, old_chunk);
     }
 
@@ -302,6 +314,7 @@ void obstack_free(struct obstack *h, void *obj)
   while (lp != 0 && ((void *) lp >= obj || (void *) (lp)->limit < obj))
     {
       plp = lp->prev;
+      ACCOUNT_CHUNK (h, -(lp->limit - (char *) lp));
       CALL_FREEFUN (h, lp);
       lp = plp;
       /* If we switch chunks, we can't tell whether the new current
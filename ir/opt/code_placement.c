@@ -19,6 +19,7 @@
 #include "irnode_t.h"
 #include "iroptimize.h"
 #include "pdeq.h"
+#include "timing.h"
 #include <stdbool.h>
 
 #ifndef NDEBUG
@@ -328,6 +329,7 @@ static void place_late(ir_graph *irg, deq_t *worklist)
 /* Code Placement. */
 void place_code(ir_graph *irg)
 {
+	ir_trace_enter("place_code", irg);
 	/* Handle graph state */
 	assure_irg_properties(irg,
 		IR_GRAPH_PROPERTY_NO_CRITICAL_EDGES |
@@ -354,4 +356,5 @@ void place_code(ir_graph *irg)
 
 	deq_free(&worklist);
 	confirm_irg_properties(irg, IR_GRAPH_PROPERTIES_CONTROL_FLOW);
+	ir_trace_leave("place_code");
 }
@@ -22,6 +22,7 @@
  * compatibility".
  */
 #include "array.h"
+#include "combo_t.h"
 #include "debug.h"
 #include "ircons.h"
 #include "irdump.h"
@@ -42,6 +43,7 @@
 #include "panic.h"
 #include "pmap.h"
 #include "set.h"
+#include "timing.h"
 #include "tv_t.h"
 #include <assert.h>
 
@@ -81,15 +83,6 @@ typedef struct listmap_t {
 	listmap_entry_t *values; /**< List of all values in the map. */
 } listmap_t;
 
-/**
- * A lattice element. Because we handle constants and symbolic constants
- * different, we have to use this union.
- */
-typedef union {
-	ir_tarval *tv;
-	ir_entity *ent;
-} lattice_elem_t;
-
 /**
  * A node.
  */
@@ -168,10 +161,6 @@ static void set_irn_node(ir_node *irn, node_t *node)
 	set_irn_link(irn, node);
 }
 
-/* we use dataflow like names here */
-#define tarval_top    tarval_unknown
-#define tarval_bottom tarval_bad
-
 static inline bool is_reachable(const node_t *node)
 {
 	assert(is_Block(node->node));
@@ -187,6 +176,9 @@ DEBUG_ONLY(static const char *what_reason;)
 /** Next partition number. */
 DEBUG_ONLY(static unsigned part_nr = 0;)
 
+/** The interprocedural callbacks of the current run, NULL if none. */
+static combo_ipa_t *ipa_env;
+
 /* forward */
 static node_t *identity(node_t *node);
 
@@ -2219,6 +2211,24 @@ static void compute_Proj(node_t *node)
 	}
 
 	ir_node *pred = get_Proj_pred(proj);
+	if (ipa_env != NULL && is_Proj(pred)) {
+		/* parameters and call results are seeded interprocedurally */
+		ir_node *const tuple = get_Proj_pred(pred);
+		unsigned const num   = get_Proj_num(pred);
+		if (is_Start(tuple) && num == pn_Start_T_args) {
+			ir_graph *const irg = get_irn_irg(proj);
+			node->type = ipa_env->get_param(ipa_env, irg, get_Proj_num(proj));
+			return;
+		} else if (is_Call(tuple) && num == pn_Call_T_result) {
+			if (get_irn_node(tuple)->type.tv == tarval_bottom) {
+				node->type.tv = tarval_bottom;
+			} else {
+				node->type = ipa_env->get_result(ipa_env, tuple, get_Proj_num(proj));
+			}
+			return;
+		}
+	}
+
 	if (mode == mode_X) {
 		/* handle mode_X nodes */
 		switch (get_irn_opcode(pred)) {
@@ -3178,7 +3188,27 @@ static void add_memory_keeps(ir_graph *irg, ir_node **kept_memory, size_t len)
 	ir_nodeset_destroy(&set);
 }
 
-void combo(ir_graph *irg)
+lattice_elem_t combo_get_value(ir_node const *irn)
+{
+	return get_node_type(irn);
+}
+
+/**
+ * Post-Walker, report reachable Calls and Returns to the interprocedural
+ * callbacks.
+ */
+static void visit_ipa(ir_node *irn, void *ctx)
+{
+	combo_ipa_t *const ipa = (combo_ipa_t*)ctx;
+	if (!is_Call(irn) && !is_Return(irn))
+		return;
+
+	node_t *const block = get_irn_node(get_nodes_block(irn));
+	if (is_reachable(block) && get_irn_node(irn)->type.tv != tarval_bottom)
+		ipa->visit(ipa, irn);
+}
+
+static void do_combo(ir_graph *irg, combo_ipa_t *ipa, bool apply)
 {
 	assure_irg_properties(irg,
 		IR_GRAPH_PROPERTY_NO_BADS
@@ -3204,6 +3234,7 @@ void combo(ir_graph *irg)
 	set_value_of_func(get_node_tarval);
 
 	set_compute_functions();
+	ipa_env = ipa;
 	DEBUG_ONLY(part_nr = 0;)
 
 	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK | IR_RESOURCE_PHI_LIST);
@@ -3234,6 +3265,11 @@ void combo(ir_graph *irg)
 	dump_all_partitions(&env);
 	check_all_partitions(&env);
 
+	if (!apply) {
+		irg_walk_graph(irg, NULL, visit_ipa, ipa);
+		goto done;
+	}
+
 	/* apply the result */
 
 	/* check, which nodes must be kept */
@@ -3262,6 +3298,7 @@ void combo(ir_graph *irg)
 		DB((dbg, LEVEL_1, "Unoptimized Control Flow left"));
 	}
 
+done:
 	ir_free_resources(irg, IR_RESOURCE_IRN_LINK | IR_RESOURCE_PHI_LIST);
 
 	/* remove the partition hook */
@@ -3273,6 +3310,20 @@ void combo(ir_graph *irg)
 
 	/* restore value_of() default behavior */
 	set_value_of_func(NULL);
+	ipa_env = NULL;
+
+	if (apply)
+		confirm_irg_properties(irg, IR_GRAPH_PROPERTIES_NONE);
+}
+
+void combo(ir_graph *irg)
+{
+	ir_trace_enter("combo", irg);
+	do_combo(irg, NULL, true);
+	ir_trace_leave("combo");
+}
 
-	confirm_irg_properties(irg, IR_GRAPH_PROPERTIES_NONE);
+void combo_ipa(ir_graph *irg, combo_ipa_t *ipa, bool apply)
+{
+	do_combo(irg, ipa, apply);
 }
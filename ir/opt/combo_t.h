@@ -0,0 +1,70 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Interprocedural interface of Cliff Click's combo algorithm.
+ * @author  Michael Beck
+ */
+#ifndef FIRM_OPT_COMBO_T_H
+#define FIRM_OPT_COMBO_T_H
+
+#include <stdbool.h>
+
+#include "firm_types.h"
+
+/* we use dataflow like names here */
+#define tarval_top    tarval_unknown
+#define tarval_bottom tarval_bad
+
+/**
+ * A lattice element. Because we handle constants and symbolic constants
+ * different, we have to use this union.
+ */
+typedef union {
+	ir_tarval *tv;
+	ir_entity *ent;
+} lattice_elem_t;
+
+typedef struct combo_ipa_t combo_ipa_t;
+
+/**
+ * Callbacks connecting a combo run to an interprocedural lattice.
+ *
+ * All values are lattice elements in the combo sense: tarval_bottom means
+ * "no value reaches this point (yet)", tarval_top means "not constant".
+ */
+struct combo_ipa_t {
+	/** Returns the lattice value of parameter @p pos of graph @p irg. */
+	lattice_elem_t (*get_param)(combo_ipa_t *ipa, ir_graph *irg, unsigned pos);
+	/** Returns the lattice value of result @p pos of the Call @p call. */
+	lattice_elem_t (*get_result)(combo_ipa_t *ipa, ir_node *call, unsigned pos);
+	/**
+	 * Called after the analysis for every Call and Return node in a
+	 * reachable block.  The lattice values of their operands can be
+	 * queried with combo_get_value().  Not called when the result is
+	 * applied to the graph.
+	 */
+	void (*visit)(combo_ipa_t *ipa, ir_node *node);
+};
+
+/**
+ * Runs combo on @p irg, seeding parameters and call results from @p ipa.
+ *
+ * @param irg    the graph to run on
+ * @param ipa    the interprocedural callbacks
+ * @param apply  if true, the graph is optimized like combo() does, else
+ *               only the visit callback is invoked and the graph is left
+ *               unchanged
+ */
+void combo_ipa(ir_graph *irg, combo_ipa_t *ipa, bool apply);
+
+/**
+ * Returns the lattice value computed for @p irn.  Only valid inside the
+ * visit callback of a combo_ipa() run.
+ */
+lattice_elem_t combo_get_value(ir_node const *irn);
+
+#endif
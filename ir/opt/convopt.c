@@ -30,6 +30,7 @@
 #include "irnode_t.h"
 #include "iropt_t.h"
 #include "iroptimize.h"
+#include "timing.h"
 #include "tv.h"
 #include "util.h"
 #include "vrp.h"
@@ -275,6 +276,7 @@ static void conv_opt_walker(ir_node *node, void *data)
 
 void conv_opt(ir_graph *irg)
 {
+	ir_trace_enter("conv_opt", irg);
 	FIRM_DBG_REGISTER(dbg, "firm.opt.conv");
 
 	assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES);
@@ -293,4 +295,5 @@ void conv_opt(ir_graph *irg)
 
 	confirm_irg_properties(irg,
 		global_changed ? IR_GRAPH_PROPERTIES_NONE : IR_GRAPH_PROPERTIES_ALL);
+	ir_trace_leave("conv_opt");
 }
@@ -14,6 +14,7 @@
  * this by copying all (reachable) nodes to a new obstack and throwing away
  * the old one.
  */
+#include "array.h"
 #include "cgana.h"
 #include "iredges_t.h"
 #include "irgraph_t.h"
@@ -24,9 +25,18 @@
 #include "iroptimize.h"
 #include "irouts.h"
 #include "irtools.h"
+#include "memacct.h"
 #include "pmap.h"
+#include "timing.h"
 #include "vrp.h"
 
+/** Graphs with fewer nodes are never compacted automatically. */
+#define COMPACTION_MIN_NODES 1024
+
+/** Fraction of dead nodes above which graphs are compacted, 0 disables
+ * automatic compaction. */
+static double compaction_threshold = 0;
+
 /**
  * Reroute the inputs of a node from nodes in the old graph to copied nodes in
  * the new graph
@@ -74,6 +84,7 @@ static void copy_graph_env(ir_graph *irg)
  */
 void dead_node_elimination(ir_graph *irg)
 {
+	ir_trace_enter("dead_node_elimination", irg);
 	edges_deactivate(irg);
 
 	/* Handle graph state */
@@ -81,7 +92,11 @@ void dead_node_elimination(ir_graph *irg)
 	free_irg_outs(irg);
 	free_loop_information(irg);
 	free_vrp_data(irg);
-	clear_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE);
+	/* dominance and out information refer to the old nodes */
+	clear_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE
+	                   | IR_GRAPH_PROPERTY_CONSISTENT_POSTDOMINANCE
+	                   | IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE_FRONTIERS
+	                   | IR_GRAPH_PROPERTY_CONSISTENT_OUTS);
 
 	/* A quiet place, where the old obstack can rest in peace,
 	   until it will be cremated. */
@@ -89,6 +104,7 @@ void dead_node_elimination(ir_graph *irg)
 
 	/* A new obstack, where the reachable nodes will be copied to. */
 	obstack_init(&irg->obst);
+	ir_obst_account(&irg->obst, "irg", irg);
 	irg->last_node_idx = 0;
 
 	/* We also need a new value table for CSE */
@@ -101,4 +117,78 @@ void dead_node_elimination(ir_graph *irg)
 
 	/* Free memory from old unoptimized obstack */
 	obstack_free(&graveyard_obst, 0);  /* First empty the obstack ... */
+
+	/* The indices are dense now, shrink the index map if it is mostly
+	 * unused. */
+	unsigned const n_nodes = irg->last_node_idx;
+	if ((size_t)ARR_LEN(irg->idx_irn_map) > 2 * (size_t)n_nodes)
+		ARR_SETLEN(ir_node*, irg->idx_irn_map, n_nodes);
+	irg->n_live_nodes   = n_nodes;
+	irg->live_count_idx = n_nodes;
+	ir_trace_leave("dead_node_elimination");
+}
+
+static void count_node(ir_node *node, void *env)
+{
+	(void)node;
+	++*(unsigned*)env;
+}
+
+unsigned count_irg_live_nodes(ir_graph *irg)
+{
+	/* walk like copy_graph_env() */
+	unsigned n_nodes = 0;
+	irg_walk_in_or_dep(irg->anchor, count_node, NULL, &n_nodes);
+	irg->n_live_nodes   = n_nodes;
+	irg->live_count_idx = irg->last_node_idx;
+	return n_nodes;
+}
+
+void set_irg_compaction_threshold(double fraction)
+{
+	compaction_threshold = fraction;
+}
+
+double get_irg_compaction_threshold(void)
+{
+	return compaction_threshold;
+}
+
+/**
+ * Returns true if analysis information refers to the nodes of @p irg, which
+ * dead_node_elimination() would silently discard.
+ */
+static bool has_analysis_info(ir_graph const *const irg)
+{
+	return irg->callee_info_state != irg_callee_info_none
+	    || irg->callees != NULL || irg->callers != NULL
+	    || irg->out_obst_allocated || irg->loop != NULL
+	    || irg->vrp.infos.data != NULL
+	    || (irg->properties & (IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE
+	                         | IR_GRAPH_PROPERTY_CONSISTENT_POSTDOMINANCE
+	                         | IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE_FRONTIERS))
+	       != 0;
+}
+
+int compact_irg_if_sparse(ir_graph *irg)
+{
+	if (compaction_threshold <= 0 || irg->be_data != NULL
+	    || irg_is_constrained(irg, IR_GRAPH_CONSTRAINT_CONSTRUCTION)
+	    || ir_resources_reserved(irg) != 0 || has_analysis_info(irg))
+		return false;
+
+	unsigned const allocated = irg->last_node_idx;
+	if (allocated < COMPACTION_MIN_NODES
+	    || allocated < irg->live_count_idx + irg->live_count_idx / 8)
+		return false;
+
+	unsigned const live = count_irg_live_nodes(irg);
+	if (allocated - live <= compaction_threshold * allocated)
+		return false;
+
+	bool const edges = edges_activated(irg);
+	dead_node_elimination(irg);
+	if (edges)
+		edges_activate(irg);
+	return true;
 }
@@ -26,6 +26,7 @@
 #include "opt_init.h"
 #include "panic.h"
 #include "raw_bitset.h"
+#include "timing.h"
 #include "util.h"
 #include <stdbool.h>
 
@@ -805,6 +806,7 @@ static mtp_additional_properties check_nothrow_or_malloc(ir_graph *irg, bool top
 
 void optimize_funccalls(void)
 {
+	ir_trace_enter("optimize_funccalls", NULL);
 	/* prepare: mark all graphs as not analyzed */
 	size_t last_idx = get_irp_last_idx();
 	ready_set = rbitset_malloc(last_idx);
@@ -836,6 +838,7 @@ void optimize_funccalls(void)
 
 	free(busy_set);
 	free(ready_set);
+	ir_trace_leave("optimize_funccalls");
 }
 
 void firm_init_funccalls(void)
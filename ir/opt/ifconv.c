@@ -19,6 +19,7 @@
 #include "irtools.h"
 #include "pdeq.h"
 #include "target_t.h"
+#include "timing.h"
 #include <assert.h>
 #include <stdbool.h>
 
@@ -445,7 +446,7 @@ static void fill_waitq(ir_node *node, void *env) {
 	deq_push_pointer_right(waitq, node);
 }
 
-void opt_if_conv_cb(ir_graph *irg, arch_allow_ifconv_func callback)
+static void if_conv(ir_graph *irg, arch_allow_ifconv_func callback)
 {
 	walker_env  env   = { .allow_ifconv = callback, .changed = false };
 	deq_t waitq;
@@ -495,7 +496,16 @@ void opt_if_conv_cb(ir_graph *irg, arch_allow_ifconv_func callback)
 		| IR_GRAPH_PROPERTY_ONE_RETURN);
 }
 
+void opt_if_conv_cb(ir_graph *irg, arch_allow_ifconv_func callback)
+{
+	ir_trace_enter("opt_if_conv_cb", irg);
+	if_conv(irg, callback);
+	ir_trace_leave("opt_if_conv_cb");
+}
+
 void opt_if_conv(ir_graph *irg)
 {
-	opt_if_conv_cb(irg, ir_target.allow_ifconv);
+	ir_trace_enter("opt_if_conv", irg);
+	if_conv(irg, ir_target.allow_ifconv);
+	ir_trace_leave("opt_if_conv");
 }
@@ -0,0 +1,364 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Interprocedural sparse conditional constant propagation.
+ * @author  Michael Beck
+ *
+ * Runs the lattice of Cliff Click's combo algorithm over the whole program:
+ * Each graph is analyzed with its parameters and the results of its calls
+ * seeded from an interprocedural lattice.  The values reaching the
+ * parameters of reachable Call nodes and the operands of reachable Return
+ * nodes are fed back into that lattice until a fixpoint is reached.  The
+ * call relation is taken from the callee information computed by cgana().
+ *
+ * Only methods that cannot be called from outside the compilation unit or
+ * through a pointer (i.e., that are not "free") get their parameters
+ * specialized.  Results are propagated for every call whose callees are all
+ * known.  Finally combo is applied to every reachable graph with the final
+ * lattice, folding constant parameters and call results.  Methods never
+ * found reachable are left alone; all references to them are removed from
+ * the reachable code, so garbage_collect_entities() removes them afterwards.
+ */
+#include "array.h"
+#include "cgana.h"
+#include "combo_t.h"
+#include "debug.h"
+#include "irgraph_t.h"
+#include "irgwalk.h"
+#include "irnode_t.h"
+#include "iroptimize.h"
+#include "irprog_t.h"
+#include "obst.h"
+#include "pset.h"
+#include "timing.h"
+#include "tv_t.h"
+#include "typerep.h"
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg;)
+
+/** Interprocedural lattice information of a graph. */
+typedef struct ipsccp_irg_t {
+	ir_graph        *irg;
+	lattice_elem_t  *params;          /**< lattice values of the parameters */
+	lattice_elem_t  *results;         /**< lattice values of the results */
+	ir_graph       **callers;         /**< graphs that contain calls of irg */
+	size_t           n_params;
+	size_t           n_results;
+	bool             is_free     : 1; /**< may be called from the outside */
+	bool             reachable   : 1; /**< has a reachable caller */
+	bool             on_worklist : 1;
+} ipsccp_irg_t;
+
+typedef struct ipsccp_env_t {
+	combo_ipa_t     ipa;      /**< must be the first member */
+	struct obstack  obst;
+	ipsccp_irg_t  **worklist; /**< graphs that must be (re-)analyzed */
+	ipsccp_irg_t   *current;  /**< the graph currently analyzed */
+} ipsccp_env_t;
+
+static ipsccp_irg_t *get_irg_info(ir_graph const *const irg)
+{
+	return (ipsccp_irg_t*)get_irg_link(irg);
+}
+
+/** Returns the info of the graph of @p ent or NULL if it has none. */
+static ipsccp_irg_t *get_entity_info(ir_entity *const ent)
+{
+	if (is_unknown_entity(ent))
+		return NULL;
+	ir_graph *const irg = get_entity_irg(ent);
+	return irg != NULL ? get_irg_info(irg) : NULL;
+}
+
+#ifdef DEBUG_libfirm
+static bool is_lattice_con(lattice_elem_t const v)
+{
+	if (is_tarval(v.tv))
+		return tarval_is_constant(v.tv);
+	return true;
+}
+#endif
+
+/**
+ * Raises @p *res to the join of itself and @p v.
+ *
+ * @return true if @p *res changed
+ */
+static bool raise_value(lattice_elem_t *const res, lattice_elem_t v,
+                        ir_mode *const mode)
+{
+	/* never propagate a constant into a value of different mode */
+	if (is_tarval(v.tv) && tarval_is_constant(v.tv)
+	 && get_tarval_mode(v.tv) != mode)
+		v.tv = tarval_top;
+
+	if (res->tv == v.tv || v.tv == tarval_bottom || res->tv == tarval_top)
+		return false;
+	if (res->tv == tarval_bottom)
+		*res = v;
+	else
+		res->tv = tarval_top;
+	return true;
+}
+
+static void add_to_worklist(ipsccp_env_t *const env, ipsccp_irg_t *const info)
+{
+	if (info->on_worklist)
+		return;
+	info->on_worklist = true;
+	ARR_APP1(ipsccp_irg_t*, env->worklist, info);
+}
+
+static lattice_elem_t ipsccp_get_param(combo_ipa_t *const ipa,
+                                       ir_graph *const irg, unsigned const pos)
+{
+	(void)ipa;
+	ipsccp_irg_t *const info = get_irg_info(irg);
+	lattice_elem_t res = { .tv = tarval_top };
+	if (pos < info->n_params)
+		res = info->params[pos];
+	return res;
+}
+
+static lattice_elem_t ipsccp_get_result(combo_ipa_t *const ipa,
+                                        ir_node *const call, unsigned const pos)
+{
+	(void)ipa;
+	lattice_elem_t res   = { .tv = tarval_bottom };
+	size_t   const n     = cg_get_call_n_callees(call);
+	ir_type *const ctp   = get_Call_type(call);
+	if (n == 0 || pos >= get_method_n_ress(ctp))
+		goto unknown;
+	ir_mode *const mode = get_type_mode(get_method_res_type(ctp, pos));
+
+	for (size_t i = 0; i < n; ++i) {
+		/* the graph might be replaced at link time */
+		ir_entity    *const callee = cg_get_call_callee(call, i);
+		ipsccp_irg_t *const info   = get_entity_info(callee);
+		if (info == NULL || pos >= info->n_results
+		 || get_entity_linktime_irg(callee) == NULL)
+			goto unknown;
+		raise_value(&res, info->results[pos], mode);
+	}
+	return res;
+
+unknown:
+	res.tv = tarval_top;
+	return res;
+}
+
+/**
+ * Like ipsccp_get_result() but never returns Bottom: A callee that does not
+ * return does not allow us to replace its result by anything.
+ */
+static lattice_elem_t ipsccp_get_result_apply(combo_ipa_t *const ipa,
+                                              ir_node *const call,
+                                              unsigned const pos)
+{
+	lattice_elem_t res = ipsccp_get_result(ipa, call, pos);
+	if (res.tv == tarval_bottom)
+		res.tv = tarval_top;
+	return res;
+}
+
+static lattice_elem_t ipsccp_get_param_apply(combo_ipa_t *const ipa,
+                                             ir_graph *const irg,
+                                             unsigned const pos)
+{
+	lattice_elem_t res = ipsccp_get_param(ipa, irg, pos);
+	if (res.tv == tarval_bottom)
+		res.tv = tarval_top;
+	return res;
+}
+
+/** Feeds the arguments of a reachable Call into the lattice of its callees. */
+static void visit_call(ipsccp_env_t *const env, ir_node *const call)
+{
+	size_t   const n_args = get_Call_n_params(call);
+	ir_type *const ctp    = get_Call_type(call);
+	for (size_t i = 0, n = cg_get_call_n_callees(call); i < n; ++i) {
+		ipsccp_irg_t *const info = get_entity_info(cg_get_call_callee(call, i));
+		if (info == NULL)
+			continue;
+
+		bool changed = !info->reachable;
+		info->reachable = true;
+		if (!info->is_free) {
+			ir_type *const mtp = get_entity_type(get_irg_entity(info->irg));
+			bool const mismatch = n_args != info->n_params
+			                   || is_method_variadic(mtp);
+			for (size_t p = 0; p < info->n_params; ++p) {
+				ir_type *const ptp  = get_method_param_type(mtp, p);
+				ir_mode *const mode = get_type_mode(ptp);
+				lattice_elem_t value;
+				if (mismatch || mode == NULL
+				 || get_type_mode(get_method_param_type(ctp, p)) != mode) {
+					value.tv = tarval_top;
+				} else {
+					value = combo_get_value(get_Call_param(call, p));
+				}
+				changed |= raise_value(&info->params[p], value, mode);
+			}
+		}
+		if (changed)
+			add_to_worklist(env, info);
+	}
+}
+
+/** Feeds the operands of a reachable Return into the result lattice. */
+static void visit_return(ipsccp_env_t *const env, ir_node *const ret)
+{
+	ipsccp_irg_t *const info = env->current;
+	ir_type      *const mtp  = get_entity_type(get_irg_entity(info->irg));
+	size_t        const n    = get_Return_n_ress(ret);
+	bool          changed    = false;
+	for (size_t i = 0; i < info->n_results; ++i) {
+		ir_mode *const mode = get_type_mode(get_method_res_type(mtp, i));
+		lattice_elem_t value = { .tv = tarval_top };
+		if (i < n && mode != NULL)
+			value = combo_get_value(get_Return_res(ret, i));
+		changed |= raise_value(&info->results[i], value, mode);
+	}
+	if (!changed)
+		return;
+
+	for (size_t i = 0, n_callers = ARR_LEN(info->callers); i < n_callers; ++i) {
+		ipsccp_irg_t *const caller = get_irg_info(info->callers[i]);
+		if (caller->reachable)
+			add_to_worklist(env, caller);
+	}
+}
+
+static void ipsccp_visit(combo_ipa_t *const ipa, ir_node *const node)
+{
+	ipsccp_env_t *const env = (ipsccp_env_t*)ipa;
+	if (is_Call(node))
+		visit_call(env, node);
+	else
+		visit_return(env, node);
+}
+
+/**
+ * Walker: Records the graph of a Call as caller of all its callees.
+ */
+static void collect_callers(ir_node *const node, void *const ctx)
+{
+	if (!is_Call(node))
+		return;
+
+	ir_graph *const irg = (ir_graph*)ctx;
+	for (size_t i = 0, n = cg_get_call_n_callees(node); i < n; ++i) {
+		ipsccp_irg_t *const info = get_entity_info(cg_get_call_callee(node, i));
+		if (info == NULL)
+			continue;
+		size_t const n_callers = ARR_LEN(info->callers);
+		if (n_callers == 0 || info->callers[n_callers - 1] != irg)
+			ARR_APP1(ir_graph*, info->callers, irg);
+	}
+}
+
+static void init_irg_info(ipsccp_env_t *const env, ir_graph *const irg)
+{
+	ir_type      *const mtp  = get_entity_type(get_irg_entity(irg));
+	ipsccp_irg_t *const info = OALLOCZ(&env->obst, ipsccp_irg_t);
+	info->irg       = irg;
+	info->n_params  = get_method_n_params(mtp);
+	info->n_results = get_method_n_ress(mtp);
+	info->params    = OALLOCN(&env->obst, lattice_elem_t, info->n_params);
+	info->results   = OALLOCN(&env->obst, lattice_elem_t, info->n_results);
+	info->callers   = NEW_ARR_F(ir_graph*, 0);
+	for (size_t i = 0; i < info->n_params; ++i)
+		info->params[i].tv = tarval_bottom;
+	for (size_t i = 0; i < info->n_results; ++i)
+		info->results[i].tv = tarval_bottom;
+	set_irg_link(irg, info);
+}
+
+void ipsccp(void)
+{
+	ir_trace_enter("ipsccp", NULL);
+	FIRM_DBG_REGISTER(dbg, "firm.opt.ipsccp");
+
+	ir_entity **free_methods;
+	size_t const n_free = cgana(&free_methods);
+
+	ipsccp_env_t env;
+	env.ipa.get_param  = ipsccp_get_param;
+	env.ipa.get_result = ipsccp_get_result;
+	env.ipa.visit      = ipsccp_visit;
+	env.worklist       = NEW_ARR_F(ipsccp_irg_t*, 0);
+	env.current        = NULL;
+	obstack_init(&env.obst);
+
+	irp_reserve_resources(irp, IRP_RESOURCE_IRG_LINK);
+	foreach_irp_irg(i, irg) {
+		init_irg_info(&env, irg);
+	}
+	foreach_irp_irg(i, irg) {
+		irg_walk_graph(irg, NULL, collect_callers, irg);
+	}
+
+	/* free methods are reachable and called with unknown arguments */
+	for (size_t i = 0; i < n_free; ++i) {
+		ipsccp_irg_t *const info = get_entity_info(free_methods[i]);
+		if (info == NULL)
+			continue;
+		info->is_free   = true;
+		info->reachable = true;
+		for (size_t p = 0; p < info->n_params; ++p)
+			info->params[p].tv = tarval_top;
+		add_to_worklist(&env, info);
+	}
+	free(free_methods);
+
+	while (ARR_LEN(env.worklist) > 0) {
+		ipsccp_irg_t *const info = env.worklist[ARR_LEN(env.worklist) - 1];
+		ARR_SHRINKLEN(env.worklist, ARR_LEN(env.worklist) - 1);
+		info->on_worklist = false;
+
+		DB((dbg, LEVEL_2, "analyzing %+F\n", info->irg));
+		env.current = info;
+		combo_ipa(info->irg, &env.ipa, false);
+	}
+
+	/* apply the final lattice to all reachable graphs */
+	env.ipa.get_param  = ipsccp_get_param_apply;
+	env.ipa.get_result = ipsccp_get_result_apply;
+	foreach_irp_irg(i, irg) {
+		ipsccp_irg_t *const info = get_irg_info(irg);
+		if (!info->reachable) {
+			DB((dbg, LEVEL_1, "%+F is unreachable\n", irg));
+			continue;
+		}
+#ifdef DEBUG_libfirm
+		for (size_t p = 0; p < info->n_params; ++p) {
+			if (is_lattice_con(info->params[p]))
+				DB((dbg, LEVEL_1, "%+F: parameter %zu is constant\n", irg, p));
+		}
+		for (size_t r = 0; r < info->n_results; ++r) {
+			if (is_lattice_con(info->results[r]))
+				DB((dbg, LEVEL_1, "%+F: result %zu is constant\n", irg, r));
+		}
+#endif
+		env.current = info;
+		combo_ipa(irg, &env.ipa, true);
+	}
+
+	foreach_irp_irg(i, irg) {
+		DEL_ARR_F(get_irg_info(irg)->callers);
+		set_irg_link(irg, NULL);
+	}
+	irp_free_resources(irp, IRP_RESOURCE_IRG_LINK);
+
+	/* combo may have turned indirect calls into direct ones and removed
+	 * calls */
+	free_irp_callee_info();
+
+	DEL_ARR_F(env.worklist);
+	obstack_free(&env.obst, NULL);
+	ir_trace_leave("ipsccp");
+}
@@ -3967,13 +3967,13 @@ static ir_node *transform_node_Div(ir_node *n)
 		ir_tarval *tv = value_of(b);
 
 		if (tarval_is_constant(tv)) {
-			tv = tarval_div(get_mode_one(mode), tv);
+			int exact;
+			tv = tarval_ieee754_div(get_mode_one(mode), tv, &exact);
 
 			/* Do the transformation if the result is either exact or we are
 			   not using strict rules. */
 			if (tarval_is_constant(tv)
-			    && (tarval_ieee754_get_exact()
-				    || ir_imprecise_float_transforms_allowed())) {
+			    && (exact || ir_imprecise_float_transforms_allowed())) {
 				ir_node  *block = get_nodes_block(n);
 				ir_graph *irg   = get_irn_irg(block);
 				ir_node  *c     = new_r_Const(irg, tv);
@@ -21,6 +21,7 @@
 #include "iroptimize.h"
 #include "iroptimize.h"
 #include "irtools.h"
+#include "timing.h"
 #include "tv.h"
 #include "vrp.h"
 #include <assert.h>
@@ -635,6 +636,7 @@ static void thread_jumps(ir_node* block, void* data)
 
 void opt_jumpthreading(ir_graph* irg)
 {
+	ir_trace_enter("opt_jumpthreading", irg);
 	assure_irg_properties(irg,
 		IR_GRAPH_PROPERTY_NO_UNREACHABLE_CODE
 		| IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES
@@ -663,4 +665,5 @@ void opt_jumpthreading(ir_graph* irg)
 	} else {
 		confirm_irg_properties(irg, IR_GRAPH_PROPERTIES_ALL);
 	}
+	ir_trace_leave("opt_jumpthreading");
 }
@@ -31,6 +31,7 @@
 #include "panic.h"
 #include "set.h"
 #include "target_t.h"
+#include "timing.h"
 #include "tv_t.h"
 #include "type_t.h"
 #include "util.h"
@@ -2282,7 +2283,7 @@ again:;
 	}
 }
 
-void combine_memops(ir_graph *irg)
+static void do_combine_memops(ir_graph *irg)
 {
 	/* We don't have code yet to test whether the address is aligned for the
 	 * combined modes, so we can only do this if the backend supports unaligned
@@ -2293,8 +2294,16 @@ void combine_memops(ir_graph *irg)
 	irg_walk_graph(irg, combine_memop, NULL, NULL);
 }
 
+void combine_memops(ir_graph *irg)
+{
+	ir_trace_enter("combine_memops", irg);
+	do_combine_memops(irg);
+	ir_trace_leave("combine_memops");
+}
+
 void optimize_load_store(ir_graph *irg)
 {
+	ir_trace_enter("optimize_load_store", irg);
 	assure_irg_properties(irg, IR_GRAPH_PROPERTY_NO_UNREACHABLE_CODE
 	                         | IR_GRAPH_PROPERTY_CONSISTENT_OUT_EDGES
 	                         | IR_GRAPH_PROPERTY_NO_CRITICAL_EDGES
@@ -2343,4 +2352,5 @@ void optimize_load_store(ir_graph *irg)
 		| IR_GRAPH_PROPERTY_NO_BADS | IR_GRAPH_PROPERTY_NO_TUPLES
 		| IR_GRAPH_PROPERTY_CONSISTENT_ENTITY_USAGE
 		| IR_GRAPH_PROPERTY_MANY_RETURNS);
+	ir_trace_leave("optimize_load_store");
 }
@@ -0,0 +1,478 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Loop-invariant code motion for memory accesses.
+ *
+ * Floating nodes are already moved out of loops by code placement.  This
+ * pass handles Loads, which are pinned: A Load from a loop-invariant
+ * address whose memory is not modified by any aliasing operation of the
+ * loop is replaced by a value that is kept in a register.  The memory is
+ * loaded once in a new block in front of the loop header.  Stores to the
+ * same address inside the loop are forwarded to the following Loads
+ * through Phis, so the Loads vanish even if the loop writes the address.
+ */
+#include "array.h"
+#include "debug.h"
+#include "ircons_t.h"
+#include "irgmod.h"
+#include "irgraph_t.h"
+#include "irloop_t.h"
+#include "irmemory.h"
+#include "irnode_t.h"
+#include "iroptimize.h"
+#include "irouts_t.h"
+#include "pmap.h"
+#include "pset_new.h"
+#include "timing.h"
+#include "typerep.h"
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg;)
+
+/** Information about the loop currently processed. */
+typedef struct licm_env_t {
+	ir_loop  *loop;       /**< the loop */
+	ir_node  *header;     /**< the loop header */
+	int       entry_pos;  /**< the header predecessor entering the loop */
+	ir_node  *preheader;  /**< block in front of the header or NULL */
+	ir_node **blocks;     /**< all blocks of the loop */
+	ir_node **loads;      /**< all Loads of the loop */
+	ir_node **stores;     /**< all Stores of the loop */
+	bool      clobbered;  /**< the loop contains unknown memory writes */
+} licm_env_t;
+
+/** The address currently promoted. */
+typedef struct promote_env_t {
+	licm_env_t *env;
+	ir_node    *ptr;    /**< the address */
+	ir_mode    *mode;   /**< the mode of the accessed value */
+	ir_type    *type;   /**< the type of the accessed value */
+	pmap       *values; /**< maps memory values to the value at ptr */
+} promote_env_t;
+
+static unsigned n_promoted;
+
+static bool is_in_loop(licm_env_t const *const env, ir_node const *const node)
+{
+	return !is_loop_invariant(node, env->header);
+}
+
+static void collect_blocks(licm_env_t *const env, ir_loop *const loop)
+{
+	size_t const n_elements = get_loop_n_elements(loop);
+	for (size_t i = 0; i < n_elements; ++i) {
+		loop_element const element = get_loop_element(loop, i);
+		if (*element.kind == k_ir_node) {
+			ARR_APP1(ir_node*, env->blocks, element.node);
+		} else if (*element.kind == k_ir_loop) {
+			collect_blocks(env, element.son);
+		}
+	}
+}
+
+/**
+ * Finds the loop header and the single control flow edge entering the
+ * loop.  Returns false if the loop has more than one entry.
+ */
+static bool find_loop_entry(licm_env_t *const env)
+{
+	ir_loop *const loop = env->loop;
+	env->header = NULL;
+	for (size_t b = 0, n = ARR_LEN(env->blocks); b < n; ++b) {
+		ir_node *const block = env->blocks[b];
+		for (int i = 0, arity = get_Block_n_cfgpreds(block); i < arity; ++i) {
+			ir_node *const pred = get_Block_cfgpred_block(block, i);
+			if (pred == NULL)
+				return false;
+			ir_loop *pred_loop = get_irn_loop(pred);
+			while (pred_loop != NULL && pred_loop != loop
+			       && get_loop_depth(pred_loop) > get_loop_depth(loop))
+				pred_loop = get_loop_outer_loop(pred_loop);
+			if (pred_loop == loop)
+				continue;
+			if (env->header != NULL)
+				return false;
+			env->header    = block;
+			env->entry_pos = i;
+		}
+	}
+	return env->header != NULL;
+}
+
+static void collect_memops(licm_env_t *const env)
+{
+	for (size_t b = 0, n = ARR_LEN(env->blocks); b < n; ++b) {
+		ir_node *const block = env->blocks[b];
+		foreach_irn_out_r(block, i, node) {
+			if (is_Block(node) || get_nodes_block(node) != block)
+				continue;
+			switch (get_irn_opcode(node)) {
+			case iro_Load:
+				ARR_APP1(ir_node*, env->loads, node);
+				break;
+			case iro_Store:
+				ARR_APP1(ir_node*, env->stores, node);
+				break;
+			case iro_Call: {
+				ir_type *const type = get_Call_type(node);
+				mtp_additional_properties const props
+					= get_method_additional_properties(type);
+				if (!(props & (mtp_property_pure | mtp_property_no_write)))
+					env->clobbered = true;
+				break;
+			}
+			case iro_Div:
+			case iro_Mod:
+				break;
+			default:
+				if (get_irn_mode(node) != mode_T)
+					break;
+				foreach_irn_in(node, j, pred) {
+					if (get_irn_mode(pred) == mode_M)
+						env->clobbered = true;
+				}
+				break;
+			}
+		}
+	}
+}
+
+/**
+ * Returns true if loading from @p ptr cannot trap, so the Load may be
+ * executed even if the loop body is not.
+ */
+static bool is_nontrapping_address(ir_node const *ptr)
+{
+	while (is_Member(ptr))
+		ptr = get_Member_ptr(ptr);
+	return is_Address(ptr) || ptr == get_irg_frame(get_irn_irg(ptr));
+}
+
+static ir_node *get_mem_pred(ir_node const *const pred)
+{
+	switch (get_irn_opcode(pred)) {
+	case iro_Load:  return get_Load_mem(pred);
+	case iro_Store: return get_Store_mem(pred);
+	case iro_Call:  return get_Call_mem(pred);
+	case iro_Div:   return get_Div_mem(pred);
+	case iro_Mod:   return get_Mod_mem(pred);
+	default:        return NULL;
+	}
+}
+
+/**
+ * Checks that the value at the promoted address can be determined for the
+ * memory value @p mem by following the memory chain inside the loop.
+ */
+static bool check_mem(promote_env_t const *const penv, ir_node *const mem,
+                      pset_new_t *const visited)
+{
+	licm_env_t const *const env = penv->env;
+	if (!is_in_loop(env, mem))
+		return false;
+	if (pset_new_contains(visited, mem))
+		return true;
+	pset_new_insert(visited, mem);
+
+	if (is_Phi(mem)) {
+		ir_node *const block = get_nodes_block(mem);
+		foreach_irn_in(mem, i, pred) {
+			if (block == env->header && i == env->entry_pos)
+				continue;
+			if (!check_mem(penv, pred, visited))
+				return false;
+		}
+		return true;
+	} else if (is_Proj(mem)) {
+		ir_node *const pred = get_Proj_pred(mem);
+		if (is_Store(pred) && get_Store_ptr(pred) == penv->ptr)
+			return true;
+		ir_node *const next = get_mem_pred(pred);
+		return next != NULL && check_mem(penv, next, visited);
+	}
+	return false;
+}
+
+static ir_node *get_preheader(licm_env_t *const env)
+{
+	if (env->preheader == NULL) {
+		ir_node  *const header = env->header;
+		ir_graph *const irg    = get_irn_irg(header);
+		ir_node  *const entry  = get_Block_cfgpred(header, env->entry_pos);
+		ir_node  *const pred   = get_nodes_block(entry);
+		ir_node  *const block  = new_r_Block(irg, 1, &entry);
+		set_Block_cfgpred(header, env->entry_pos, new_r_Jmp(block));
+
+		set_irn_loop(block, get_irn_loop(pred));
+		env->preheader = block;
+	}
+	return env->preheader;
+}
+
+/**
+ * Loads the promoted value in front of the loop.  The new Load is inserted
+ * into the memory chain at the entry of the loop memory Phi @p phi.
+ */
+static ir_node *load_in_preheader(promote_env_t const *const penv,
+                                  ir_node *const phi)
+{
+	licm_env_t *const env   = penv->env;
+	int         const pos   = env->entry_pos;
+	ir_node    *const block = get_preheader(env);
+	ir_node    *const load  = new_r_Load(block, get_Phi_pred(phi, pos),
+	                                     penv->ptr, penv->mode, penv->type,
+	                                     cons_none);
+	set_Phi_pred(phi, pos, new_r_Proj(load, mode_M, pn_Load_M));
+	DB((dbg, LEVEL_2, "  loading %+F in %+F\n", penv->ptr, block));
+	return new_r_Proj(load, penv->mode, pn_Load_res);
+}
+
+/**
+ * Replaces a Phi by its single input if all other inputs are the Phi
+ * itself.
+ */
+static ir_node *simplify_phi(ir_node *const phi)
+{
+	ir_node *value = NULL;
+	foreach_irn_in(phi, i, pred) {
+		if (pred == phi || pred == value)
+			continue;
+		if (value != NULL)
+			return phi;
+		value = pred;
+	}
+	if (value == NULL)
+		return phi;
+	exchange(phi, value);
+	return value;
+}
+
+/**
+ * Returns the value stored at the promoted address in memory @p mem.
+ */
+static ir_node *get_promoted_value(promote_env_t const *const penv,
+                                   ir_node *const mem)
+{
+	ir_node *value = pmap_get(ir_node, penv->values, mem);
+	if (value != NULL)
+		return value;
+
+	if (is_Proj(mem)) {
+		ir_node *const pred = get_Proj_pred(mem);
+		if (is_Store(pred) && get_Store_ptr(pred) == penv->ptr) {
+			value = get_Store_value(pred);
+		} else {
+			value = get_promoted_value(penv, get_mem_pred(pred));
+		}
+		pmap_insert(penv->values, mem, value);
+		return value;
+	}
+
+	assert(is_Phi(mem));
+	licm_env_t const *const env   = penv->env;
+	ir_node          *const block = get_nodes_block(mem);
+	ir_graph         *const irg   = get_irn_irg(block);
+	int               const arity = get_Phi_n_preds(mem);
+	ir_node         **const in    = ALLOCAN(ir_node*, arity);
+	ir_node          *const dummy = new_r_Dummy(irg, penv->mode);
+	for (int i = 0; i < arity; ++i)
+		in[i] = dummy;
+	int const opt = get_optimize();
+	set_optimize(0);
+	ir_node *const phi = new_r_Phi(block, arity, in, penv->mode);
+	set_optimize(opt);
+	pmap_insert(penv->values, mem, phi);
+
+	for (int i = 0; i < arity; ++i) {
+		ir_node *const pred = get_Phi_pred(mem, i);
+		ir_node *const pred_value
+			= block == env->header && i == env->entry_pos
+			? load_in_preheader(penv, mem)
+			: get_promoted_value(penv, pred);
+		set_Phi_pred(phi, i, pred_value);
+	}
+
+	value = simplify_phi(phi);
+	pmap_insert(penv->values, mem, value);
+	return value;
+}
+
+static bool is_promotable_load(licm_env_t const *const env,
+                               ir_node const *const load)
+{
+	return get_Load_volatility(load) != volatility_is_volatile
+	    && !ir_throws_exception(load)
+	    && !is_in_loop(env, get_Load_ptr(load));
+}
+
+/**
+ * Tries to keep the value at @p ptr in a register inside the loop.
+ */
+static bool promote_address(licm_env_t *const env, ir_node *const ptr,
+                            ir_mode *const mode, ir_type *const type)
+{
+	unsigned const size        = get_mode_size_bytes(mode);
+	bool           in_header   = false;
+	ir_node      **loads       = NEW_ARR_F(ir_node*, 0);
+	bool           promotable  = true;
+	for (size_t i = 0, n = ARR_LEN(env->loads); i < n; ++i) {
+		ir_node *const load = env->loads[i];
+		if (get_Load_ptr(load) != ptr)
+			continue;
+		if (!is_promotable_load(env, load) || get_Load_mode(load) != mode) {
+			promotable = false;
+			break;
+		}
+		in_header |= get_nodes_block(load) == env->header;
+		ARR_APP1(ir_node*, loads, load);
+	}
+	for (size_t i = 0, n = ARR_LEN(env->stores); promotable && i < n; ++i) {
+		ir_node *const store     = env->stores[i];
+		ir_node *const store_ptr = get_Store_ptr(store);
+		ir_mode *const store_mode = get_irn_mode(get_Store_value(store));
+		if (store_ptr == ptr) {
+			promotable = store_mode == mode && !ir_throws_exception(store)
+			          && get_Store_volatility(store) != volatility_is_volatile;
+			in_header |= get_nodes_block(store) == env->header;
+		} else {
+			ir_alias_relation const rel = get_alias_relation(
+				store_ptr, get_Store_type(store), get_mode_size_bytes(store_mode),
+				ptr, type, size);
+			promotable = rel == ir_no_alias;
+		}
+	}
+	/* The value is loaded in front of the loop, so this must not trap if
+	 * the loop would not have accessed the address. */
+	if (promotable && !in_header && !is_nontrapping_address(ptr))
+		promotable = false;
+
+	pset_new_t visited;
+	pset_new_init(&visited);
+	for (size_t i = 0, n = ARR_LEN(loads); promotable && i < n; ++i) {
+		promote_env_t const penv = { .env = env, .ptr = ptr };
+		promotable = check_mem(&penv, get_Load_mem(loads[i]), &visited);
+	}
+	pset_new_destroy(&visited);
+	if (!promotable) {
+		DEL_ARR_F(loads);
+		return false;
+	}
+
+	DB((dbg, LEVEL_2, "promoting %+F in loop %+F\n", ptr, env->loop));
+	promote_env_t penv = {
+		.env    = env,
+		.ptr    = ptr,
+		.mode   = mode,
+		.type   = type,
+		.values = pmap_create(),
+	};
+	size_t    const n_loads = ARR_LEN(loads);
+	ir_node **const values  = ALLOCAN(ir_node*, n_loads);
+	for (size_t i = 0; i < n_loads; ++i)
+		values[i] = get_promoted_value(&penv, get_Load_mem(loads[i]));
+	for (size_t i = 0; i < n_loads; ++i) {
+		ir_node *const load = loads[i];
+		DB((dbg, LEVEL_3, "  replacing %+F by %+F\n", load, values[i]));
+		foreach_irn_out_r(load, j, proj) {
+			switch (get_Proj_num(proj)) {
+			case pn_Load_M:   exchange(proj, get_Load_mem(load)); break;
+			case pn_Load_res: exchange(proj, values[i]);          break;
+			}
+		}
+	}
+	pmap_destroy(penv.values);
+	DEL_ARR_F(loads);
+	++n_promoted;
+	return true;
+}
+
+static bool optimize_loop(ir_loop *const loop)
+{
+	licm_env_t env = {
+		.loop   = loop,
+		.blocks = NEW_ARR_F(ir_node*, 0),
+		.loads  = NEW_ARR_F(ir_node*, 0),
+		.stores = NEW_ARR_F(ir_node*, 0),
+	};
+	collect_blocks(&env, loop);
+
+	bool changed = false;
+	if (!find_loop_entry(&env))
+		goto out;
+	collect_memops(&env);
+	if (env.clobbered)
+		goto out;
+
+	pset_new_t tried;
+	pset_new_init(&tried);
+	for (size_t i = 0, n = ARR_LEN(env.loads); i < n; ++i) {
+		ir_node *const load = env.loads[i];
+		ir_node *const ptr  = get_Load_ptr(load);
+		if (!is_promotable_load(&env, load) || pset_new_contains(&tried, ptr))
+			continue;
+		pset_new_insert(&tried, ptr);
+		if (promote_address(&env, ptr, get_Load_mode(load),
+		                    get_Load_type(load)))
+			changed = true;
+	}
+	pset_new_destroy(&tried);
+
+out:
+	DEL_ARR_F(env.stores);
+	DEL_ARR_F(env.loads);
+	DEL_ARR_F(env.blocks);
+	return changed;
+}
+
+/**
+ * Optimizes all loops inside @p loop, innermost loops first.
+ */
+static bool optimize_loops(ir_graph *const irg, ir_loop *const loop)
+{
+	bool         changed    = false;
+	size_t const n_elements = get_loop_n_elements(loop);
+	for (size_t i = 0; i < n_elements; ++i) {
+		loop_element const element = get_loop_element(loop, i);
+		if (*element.kind == k_ir_loop)
+			changed |= optimize_loops(irg, element.son);
+	}
+	if (loop == get_irg_loop(irg))
+		return changed;
+
+	if (optimize_loop(loop)) {
+		clear_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUTS);
+		assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_OUTS);
+		changed = true;
+	}
+	return changed;
+}
+
+void loop_invariant_code_motion(ir_graph *const irg)
+{
+	ir_trace_enter("loop_invariant_code_motion", irg);
+	FIRM_DBG_REGISTER(dbg, "firm.opt.licm");
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_NO_BADS
+		| IR_GRAPH_PROPERTY_NO_UNREACHABLE_CODE
+		| IR_GRAPH_PROPERTY_CONSISTENT_OUTS
+		| IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO);
+	assure_irg_entity_usage_computed(irg);
+
+	/* The new blocks in front of inner loops are not part of the loop tree
+	 * until it is recomputed, so Loads moved there are hoisted further in
+	 * the next round. */
+	n_promoted = 0;
+	while (optimize_loops(irg, get_irg_loop(irg))) {
+		clear_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO);
+		assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO);
+	}
+	DB((dbg, LEVEL_1, "%+F: %u addresses promoted\n", irg, n_promoted));
+
+	confirm_irg_properties(irg, n_promoted > 0
+		? IR_GRAPH_PROPERTY_NO_CRITICAL_EDGES | IR_GRAPH_PROPERTY_NO_TUPLES
+		| IR_GRAPH_PROPERTY_NO_BADS | IR_GRAPH_PROPERTY_NO_UNREACHABLE_CODE
+		: IR_GRAPH_PROPERTIES_ALL);
+	ir_trace_leave("loop_invariant_code_motion");
+}
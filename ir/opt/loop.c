@@ -27,6 +27,7 @@
 #include "irtools.h"
 #include "opt_init.h"
 #include "panic.h"
+#include "timing.h"
 #include "util.h"
 #include <math.h>
 #include <stdbool.h>
@@ -2358,17 +2359,23 @@ static void loop_optimization(ir_graph *const irg, loop_op_t const loop_op)
 
 void do_loop_unrolling(ir_graph *const irg)
 {
+	ir_trace_enter("do_loop_unrolling", irg);
 	loop_optimization(irg, loop_op_unrolling);
+	ir_trace_leave("do_loop_unrolling");
 }
 
 void do_loop_inversion(ir_graph *const irg)
 {
+	ir_trace_enter("do_loop_inversion", irg);
 	loop_optimization(irg, loop_op_inversion);
+	ir_trace_leave("do_loop_inversion");
 }
 
 void do_loop_peeling(ir_graph *const irg)
 {
+	ir_trace_enter("do_loop_peeling", irg);
 	loop_optimization(irg, loop_op_peeling);
+	ir_trace_leave("do_loop_peeling");
 }
 
 void firm_init_loop_opt(void)
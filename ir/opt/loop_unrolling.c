@@ -5,15 +5,17 @@
 
 /**
  * @file
- * @brief   loop unrolling using LCSSA form
+ * @brief   loop unrolling and unswitching using LCSSA form
  * @author  Elias Aebi
  */
 #include "lcssa_t.h"
 #include "irtools.h"
+#include "timing.h"
 #include "xmalloc.h"
 #include "debug.h"
 #include <assert.h>
 #include "irnode_t.h"
+#include "util.h"
 
 DEBUG_ONLY(static firm_dbg_module_t *dbg = NULL;)
 
@@ -125,13 +127,9 @@ static void rewire_successor_block(ir_node *const block, int n)
 	}
 }
 
-static void rewire_node(ir_node *const node, ir_node *const header)
+// rewire the successors outside the loop
+static void rewire_loop_exits(ir_node *const node, ir_node *const new_node)
 {
-	ir_node *const new_node = get_irn_link(node);
-	assert(new_node);
-	assert(get_irn_arity(node) == get_irn_arity(new_node));
-
-	// rewire the successors outside the loop
 	unsigned const n_outs = get_irn_n_outs(node);
 	for (unsigned i = 0; i < n_outs; ++i) {
 		int n;
@@ -143,6 +141,15 @@ static void rewire_node(ir_node *const node, ir_node *const header)
 			add_End_keepalive(succ, new_node);
 		}
 	}
+}
+
+static void rewire_node(ir_node *const node, ir_node *const header)
+{
+	ir_node *const new_node = get_irn_link(node);
+	assert(new_node);
+	assert(get_irn_arity(node) == get_irn_arity(new_node));
+
+	rewire_loop_exits(node, new_node);
 
 	// loop header block
 	if (node == header) {
@@ -622,6 +629,7 @@ static void duplicate_innermost_loops(ir_loop *const loop, unsigned const factor
 
 void unroll_loops(ir_graph *const irg, unsigned factor, unsigned maxsize)
 {
+	ir_trace_enter("unroll_loops", irg);
 	FIRM_DBG_REGISTER(dbg, "firm.opt.loop-unrolling");
 	n_loops_unrolled = 0;
 	assure_lcssa(irg);
@@ -631,4 +639,150 @@ void unroll_loops(ir_graph *const irg, unsigned factor, unsigned maxsize)
 	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
 	clear_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE | IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO);
 	DB((dbg, LEVEL_1, "%+F: %d loops unrolled\n", irg, n_loops_unrolled));
+	ir_trace_leave("unroll_loops");
+}
+
+static unsigned n_loops_unswitched = 0;
+
+// returns a Cond inside the loop with a loop-invariant selector or NULL
+static ir_node *find_invariant_cond(ir_loop *const loop)
+{
+	size_t const n_elements = get_loop_n_elements(loop);
+	for (size_t i = 0; i < n_elements; ++i) {
+		loop_element const element = get_loop_element(loop, i);
+		if (*element.kind != k_ir_node)
+			continue;
+		ir_node *const block  = element.node;
+		unsigned const n_outs = get_irn_n_outs(block);
+		for (unsigned j = 0; j < n_outs; ++j) {
+			ir_node *const node = get_irn_out(block, j);
+			if (!is_Cond(node) || get_nodes_block(node) != block)
+				continue;
+			ir_node *const selector = get_Cond_selector(node);
+			if (!is_Const(selector) && !block_is_inside_loop(get_nodes_block(selector), loop))
+				return node;
+		}
+	}
+	return NULL;
+}
+
+// returns the index of the only predecessor of the header outside the loop or -1
+static int get_loop_entry(ir_node *const header, ir_loop *const loop)
+{
+	int entry = -1;
+	int const arity = get_irn_arity(header);
+	for (int i = 0; i < arity; ++i) {
+		if (block_is_inside_loop(get_Block_cfgpred_block(header, i), loop))
+			continue;
+		if (entry >= 0)
+			return -1;
+		entry = i;
+	}
+	return entry;
+}
+
+static void rewire_unswitched_block(ir_node *const block)
+{
+	unsigned const n_outs = get_irn_n_outs(block);
+	for (unsigned i = 0; i <= n_outs; ++i) {
+		ir_node *const node = i < n_outs ? get_irn_out(block, i) : block;
+		if (node != block && get_nodes_block(node) != block)
+			continue;
+		ir_node *const new_node = get_irn_link(node);
+		rewire_loop_exits(node, new_node);
+
+		// the copy only refers to copies of loop values
+		int const arity = get_irn_arity(new_node);
+		for (int j = 0; j < arity; ++j) {
+			ir_node *const new_pred = get_irn_link(get_irn_n(new_node, j));
+			if (new_pred != NULL)
+				set_irn_n(new_node, j, new_pred);
+		}
+	}
+}
+
+// replace a Cond by a jump to its pn successor
+static void fold_cond(ir_node *const cond, unsigned const pn)
+{
+	ir_node *const block = get_nodes_block(cond);
+	ir_node *const bad   = new_r_Bad(get_irn_irg(cond), mode_X);
+	ir_node *const in[]  = {
+		[pn_Cond_false] = pn == pn_Cond_false ? new_r_Jmp(block) : bad,
+		[pn_Cond_true]  = pn == pn_Cond_true  ? new_r_Jmp(block) : bad,
+	};
+	turn_into_tuple(cond, ARRAY_SIZE(in), in);
+}
+
+static void unswitch_loop(ir_loop *const loop, ir_node *const cond)
+{
+	ir_node *const header = get_loop_header(loop);
+	if (header == NULL)
+		return;
+	int const entry = get_loop_entry(header, loop);
+	if (entry < 0)
+		return;
+
+	DB((dbg, LEVEL_2, "unswitch loop %+F on %+F\n", loop, cond));
+	ir_graph *const irg = get_irn_irg(header);
+	irg_walk_graph(irg, firm_clear_link, NULL, NULL);
+
+	// the copy of the loop executes the false case, the original the true case
+	size_t const n_elements = get_loop_n_elements(loop);
+	for (size_t i = 0; i < n_elements; ++i) {
+		loop_element const element = get_loop_element(loop, i);
+		if (*element.kind == k_ir_node)
+			duplicate_block(element.node);
+	}
+	for (size_t i = 0; i < n_elements; ++i) {
+		loop_element const element = get_loop_element(loop, i);
+		if (*element.kind == k_ir_node)
+			rewire_unswitched_block(element.node);
+	}
+
+	// decide which loop to enter in front of the loop
+	ir_node *const pred       = get_Block_cfgpred(header, entry);
+	ir_node *const block      = new_r_Block(irg, 1, &pred);
+	ir_node *const new_cond   = new_r_Cond(block, get_Cond_selector(cond));
+	ir_node *const proj_true  = new_r_Proj(new_cond, mode_X, pn_Cond_true);
+	ir_node *const proj_false = new_r_Proj(new_cond, mode_X, pn_Cond_false);
+	set_Block_cfgpred(header, entry, proj_true);
+	set_Block_cfgpred(get_irn_link(header), entry, proj_false);
+
+	fold_cond(get_irn_link(cond), pn_Cond_false);
+	fold_cond(cond, pn_Cond_true);
+	++n_loops_unswitched;
+}
+
+static void unswitch_innermost_loops(ir_loop *const loop, unsigned const maxsize, bool const outermost)
+{
+	bool         innermost  = true;
+	size_t const n_elements = get_loop_n_elements(loop);
+	for (size_t i = 0; i < n_elements; ++i) {
+		loop_element const element = get_loop_element(loop, i);
+		if (*element.kind == k_ir_loop) {
+			unswitch_innermost_loops(element.son, maxsize, false);
+			innermost = false;
+		}
+	}
+	if (innermost && !outermost && count_nodes(loop) < maxsize) {
+		ir_node *const cond = find_invariant_cond(loop);
+		if (cond != NULL)
+			unswitch_loop(loop, cond);
+	}
+}
+
+void unswitch_loops(ir_graph *const irg, unsigned const maxsize)
+{
+	ir_trace_enter("unswitch_loops", irg);
+	FIRM_DBG_REGISTER(dbg, "firm.opt.loop-unswitching");
+	n_loops_unswitched = 0;
+	assure_lcssa(irg);
+	assure_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO | IR_GRAPH_PROPERTY_CONSISTENT_OUTS | IR_GRAPH_PROPERTY_NO_BADS | IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE);
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
+	unswitch_innermost_loops(get_irg_loop(irg), maxsize, true);
+	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
+	if (n_loops_unswitched > 0)
+		clear_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE | IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO | IR_GRAPH_PROPERTY_CONSISTENT_OUTS | IR_GRAPH_PROPERTY_NO_BADS | IR_GRAPH_PROPERTY_NO_TUPLES | IR_GRAPH_PROPERTY_NO_CRITICAL_EDGES);
+	DB((dbg, LEVEL_1, "%+F: %d loops unswitched\n", irg, n_loops_unswitched));
+	ir_trace_leave("unswitch_loops");
 }
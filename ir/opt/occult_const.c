@@ -21,6 +21,7 @@
 #include "irnodemap.h"
 #include "iropt_t.h"
 #include "iroptimize.h"
+#include "timing.h"
 #include "tv.h"
 #include <stdbool.h>
 
@@ -73,6 +74,7 @@ static void fill_nodemap(ir_node *node, void *data) {
 
 void occult_consts(ir_graph *irg)
 {
+	ir_trace_enter("occult_consts", irg);
 	FIRM_DBG_REGISTER(dbg, "firm.opt.occults");
 
 	constbits_analyze(irg);
@@ -93,4 +95,5 @@ void occult_consts(ir_graph *irg)
 	constbits_clear(irg);
 	confirm_irg_properties(irg,
 	                       env.changed ? IR_GRAPH_PROPERTIES_NONE : IR_GRAPH_PROPERTIES_ALL);
+	ir_trace_leave("occult_consts");
 }
@@ -15,13 +15,14 @@
 #include "irgraph_t.h"
 #include "iroptimize.h"
 #include "irouts_t.h"
+#include "timing.h"
 #include "type_t.h"
 
 /*
  * Optimize the frame type of an irg by removing
  * never touched entities.
  */
-void opt_frame_irg(ir_graph *irg)
+static void do_opt_frame_irg(ir_graph *irg)
 {
 	ir_type *frame_tp = get_irg_frame_type(irg);
 	size_t   n        = get_compound_n_members(frame_tp);
@@ -81,3 +82,10 @@ void opt_frame_irg(ir_graph *irg)
 		| IR_GRAPH_PROPERTY_CONSISTENT_ENTITY_USAGE
 		| IR_GRAPH_PROPERTY_MANY_RETURNS);
 }
+
+void opt_frame_irg(ir_graph *irg)
+{
+	ir_trace_enter("opt_frame_irg", irg);
+	do_opt_frame_irg(irg);
+	ir_trace_leave("opt_frame_irg");
+}
@@ -30,12 +30,14 @@
 #include "iropt_t.h"
 #include "iroptimize.h"
 #include "irouts_t.h"
+#include "irprofile.h"
 #include "irprog_t.h"
 #include "irtools.h"
 #include "list.h"
 #include "opt_init.h"
 #include "pmap.h"
 #include "pqueue.h"
+#include "timing.h"
 #include "xmalloc.h"
 #include <assert.h>
 #include <limits.h>
@@ -623,6 +625,21 @@ static bool inline_method(ir_node *const call, ir_graph *called_graph)
 
 static struct obstack  temp_obst;
 
+/**
+ * Call sites executed less than 1/COLD_CALL_RATIO times as often as the
+ * hottest call site are cold.
+ */
+#define COLD_CALL_RATIO      1024
+/** Inlining into cold call sites may grow a graph by maxsize/COLD_BUDGET_DIVISOR nodes. */
+#define COLD_BUDGET_DIVISOR  8
+/** Indirect calls are promoted if one target makes up this percentage of all calls. */
+#define PROMOTE_PERCENT      90
+/** Indirect calls executed less often are not promoted. */
+#define PROMOTE_MIN_COUNT    16
+
+/** The execution count of the hottest profiled call site. */
+static double max_call_count;
+
 /** Represents a possible inlinable call in a graph. */
 typedef struct call_entry {
 	ir_node    *call;       /**< The Call node. */
@@ -630,7 +647,9 @@ typedef struct call_entry {
 	list_head  list;        /**< List head for linking the next one. */
 	int        loop_depth;  /**< The loop depth of this call. */
 	int        benefice;    /**< The calculated benefice of this call. */
+	double     count;       /**< The profiled execution count of this call. */
 	bool       all_const:1; /**< Set if this call has only constant parameters. */
+	bool       profiled:1;  /**< Set if count is known. */
 } call_entry;
 
 /**
@@ -646,6 +665,7 @@ typedef struct {
 	unsigned  n_call_nodes_orig; /**< for statistics */
 	unsigned  n_callers;         /**< Number of known graphs that call this graphs. */
 	unsigned  n_callers_orig;    /**< for statistics */
+	unsigned  n_cold_nodes;      /**< Number of nodes inlined into cold call sites. */
 	unsigned  got_inline:1;      /**< Set, if at least one call inside this graph was inlined. */
 	unsigned  recursive:1;       /**< Set, if this function is self recursive. */
 } inline_irg_env;
@@ -665,6 +685,7 @@ static inline_irg_env *alloc_inline_irg_env(void)
 	env->n_call_nodes_orig = 0;
 	env->n_callers         = 0;
 	env->n_callers_orig    = 0;
+	env->n_cold_nodes      = 0;
 	env->got_inline        = 0;
 	env->recursive         = 0;
 	return env;
@@ -749,6 +770,12 @@ static void collect_calls2(ir_node *node, void *ctx)
 		entry->benefice   = 0;
 		entry->all_const  = false;
 
+		ir_node *block  = get_nodes_block(node);
+		entry->profiled = ir_profile_has_block_execcount(block);
+		entry->count    = ir_profile_get_block_execcount(block);
+		if (entry->profiled && entry->count > max_call_count)
+			max_call_count = entry->count;
+
 		list_add_tail(&entry->list, &x->calls);
 	}
 }
@@ -760,9 +787,13 @@ static void collect_calls2(ir_node *node, void *ctx)
  * @param new_call  the new call node
  * @param loop_depth_delta
  *                  delta value for the loop depth
+ * @param count_scale
+ *                  factor for the execution count or a negative value if
+ *                  the execution count of the new call is unknown
  */
 static call_entry *duplicate_call_entry(const call_entry *entry,
-                                        ir_node *new_call, int loop_depth_delta)
+                                        ir_node *new_call, int loop_depth_delta,
+                                        double count_scale)
 {
 	call_entry *nentry = OALLOC(&temp_obst, call_entry);
 	nentry->call       = new_call;
@@ -770,10 +801,35 @@ static call_entry *duplicate_call_entry(const call_entry *entry,
 	nentry->benefice   = entry->benefice;
 	nentry->loop_depth = entry->loop_depth + loop_depth_delta;
 	nentry->all_const  = entry->all_const;
+	nentry->profiled   = entry->profiled && count_scale >= 0;
+	nentry->count      = nentry->profiled ? entry->count * count_scale : 0;
 
 	return nentry;
 }
 
+/**
+ * Returns true if a call was rarely executed in the profiled run.
+ */
+static bool is_cold_call(const call_entry *entry)
+{
+	return entry->profiled && entry->count * COLD_CALL_RATIO < max_call_count;
+}
+
+/**
+ * Calculate the benefice of the measured execution count of a call. Every
+ * halving of the count relative to the hottest call site costs as much as
+ * one loop level in the static estimate.
+ */
+static int get_count_benefice(const call_entry *entry)
+{
+	int levels = 10;
+	for (double count = entry->count; levels > 0 && count * 2 <= max_call_count;
+	     count *= 2) {
+		--levels;
+	}
+	return levels * 1024;
+}
+
 /**
  * Calculate the parameter weights for transmitting the address of a local
  * variable.
@@ -955,8 +1011,11 @@ static int calc_inline_benefice(call_entry *entry, ir_graph *callee)
 	if (callee_env->n_call_nodes == 0)
 		weight += 400;
 
-	/** it's important to inline inner loops first */
-	if (entry->loop_depth > 30)
+	/** it's important to inline inner loops first, measured execution counts
+	 * are preferred over the loop depth */
+	if (entry->profiled)
+		weight += get_count_benefice(entry);
+	else if (entry->loop_depth > 30)
 		weight += 30 * 1024;
 	else
 		weight += entry->loop_depth * 1024;
@@ -971,6 +1030,164 @@ static int calc_inline_benefice(call_entry *entry, ir_graph *callee)
 	return entry->benefice = weight;
 }
 
+/**
+ * Replaces an indirect call by a guarded direct call to its most frequent
+ * target:
+ *
+ *   if (ptr == &target) target(args); else ptr(args);
+ *
+ * The direct call can then be inlined.
+ */
+static void promote_indirect_call(ir_node *call, ir_entity *target,
+                                  uint32_t count, uint32_t total)
+{
+	ir_graph *irg         = get_irn_irg(call);
+	ir_node  *block       = get_nodes_block(call);
+	uint32_t  block_count = ir_profile_get_block_execcount(block);
+	dbg_info *dbgi        = get_irn_dbg_info(call);
+	ir_node  *mem         = get_Call_mem(call);
+	ir_node  *ptr         = get_Call_ptr(call);
+	ir_type  *ctp         = get_Call_type(call);
+	int       n_params    = get_Call_n_params(call);
+	ir_node **params      = get_Call_param_arr(call);
+
+	DB((dbg, LEVEL_1, "Promoting %+F to call %+F (%u of %u)\n", call, target,
+	    count, total));
+
+	/* optimizations can cause problems when allocating new nodes */
+	int rem_opt = get_optimize();
+	set_optimize(0);
+
+	/* move the operands of the call into a new block which ends with the
+	 * comparison, the call stays in the lower block */
+	ir_node **in = ALLOCAN(ir_node*, n_params + 2);
+	in[0] = mem;
+	in[1] = ptr;
+	MEMCPY(&in[2], params, n_params);
+	ir_node *pre_call = new_r_Tuple(block, n_params + 2, in);
+	part_block(pre_call);
+	ir_node *upper_block = get_nodes_block(pre_call);
+
+	ir_node *addr       = new_r_Address(irg, target);
+	ir_node *cmp        = new_r_Cmp(upper_block, ptr, addr, ir_relation_equal);
+	ir_node *cond       = new_r_Cond(upper_block, cmp);
+	ir_node *proj_true  = new_r_Proj(cond, mode_X, pn_Cond_true);
+	ir_node *proj_false = new_r_Proj(cond, mode_X, pn_Cond_false);
+	set_Cond_jmp_pred(cond, COND_JMP_PRED_TRUE);
+
+	ir_node *direct_block   = new_r_Block(irg, 1, &proj_true);
+	ir_node *indirect_block = new_r_Block(irg, 1, &proj_false);
+	ir_node *direct         = new_rd_Call(dbgi, direct_block, mem, addr, n_params, in + 2, ctp);
+	ir_node *indirect       = new_rd_Call(dbgi, indirect_block, mem, ptr, n_params, in + 2, ctp);
+
+	/* kill the jump from upper to lower block and replace the in array */
+	assert(get_Block_n_cfgpreds(block) == 1);
+	kill_node(get_Block_cfgpred(block, 0));
+	ir_node *jmps[] = { new_r_Jmp(direct_block), new_r_Jmp(indirect_block) };
+	set_irn_in(block, ARRAY_SIZE(jmps), jmps);
+
+	/* keep the profile up to date for the new blocks */
+	uint64_t direct_count = total > 0
+		? (uint64_t)block_count * count / total : 0;
+	ir_profile_set_block_execcount(upper_block, block_count);
+	ir_profile_set_block_execcount(direct_block, direct_count);
+	ir_profile_set_block_execcount(indirect_block, block_count - direct_count);
+
+	/* merge memory and results and turn the old call into a tuple */
+	ir_node *mems[] = {
+		new_r_Proj(direct, mode_M, pn_Call_M),
+		new_r_Proj(indirect, mode_M, pn_Call_M),
+	};
+	ir_node *call_mem = new_r_Phi(block, ARRAY_SIZE(mems), mems, mode_M);
+	collect_new_phi_node(call_mem);
+
+	size_t   n_res = get_method_n_ress(ctp);
+	ir_node *call_res;
+	if (n_res > 0) {
+		ir_node  *direct_res   = new_r_Proj(direct, mode_T, pn_Call_T_result);
+		ir_node  *indirect_res = new_r_Proj(indirect, mode_T, pn_Call_T_result);
+		ir_node **res          = ALLOCAN(ir_node*, n_res);
+		for (size_t i = 0; i < n_res; ++i) {
+			ir_type *res_type = get_method_res_type(ctp, i);
+			ir_mode *res_mode = is_aggregate_type(res_type) ? mode_P
+			                                                : get_type_mode(res_type);
+			ir_node *vals[] = {
+				new_r_Proj(direct_res, res_mode, i),
+				new_r_Proj(indirect_res, res_mode, i),
+			};
+			res[i] = new_r_Phi(block, ARRAY_SIZE(vals), vals, res_mode);
+			collect_new_phi_node(res[i]);
+		}
+		call_res = new_r_Tuple(block, n_res, res);
+	} else {
+		call_res = new_r_Bad(irg, mode_T);
+	}
+
+	ir_node *call_in[] = {
+		[pn_Call_M]        = call_mem,
+		[pn_Call_T_result] = call_res,
+	};
+	turn_into_tuple(call, ARRAY_SIZE(call_in), call_in);
+
+	set_optimize(rem_opt);
+}
+
+/**
+ * Walker: collect the indirect calls which should be promoted.
+ */
+static void collect_promotable_calls(ir_node *node, void *ctx)
+{
+	ir_node ***calls = (ir_node***)ctx;
+	if (!is_Call(node) || get_Call_callee(node) != NULL)
+		return;
+	/* no exception control flow */
+	if (ir_throws_exception(node))
+		return;
+	if (get_irn_mode(get_Call_ptr(node)) != mode_P)
+		return;
+
+	uint32_t   count;
+	uint32_t   total;
+	ir_entity *target = ir_profile_get_call_target(node, &count, &total);
+	if (target == NULL || count < PROMOTE_MIN_COUNT
+	    || (uint64_t)count * 100 < (uint64_t)total * PROMOTE_PERCENT)
+		return;
+
+	ARR_APP1(ir_node*, *calls, node);
+}
+
+/**
+ * Promote indirect calls with a dominant target according to the profile.
+ */
+static void promote_indirect_calls(void)
+{
+	ir_node **calls = NEW_ARR_F(ir_node*, 0);
+	foreach_irp_irg(i, irg) {
+		ARR_SHRINKLEN(calls, 0);
+		irg_walk_graph(irg, NULL, collect_promotable_calls, &calls);
+		if (ARR_LEN(calls) == 0)
+			continue;
+
+		ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK | IR_RESOURCE_PHI_LIST);
+		collect_phiprojs_and_start_block_nodes(irg);
+		for (size_t c = 0; c < ARR_LEN(calls); ++c) {
+			ir_node   *call   = calls[c];
+			uint32_t   count;
+			uint32_t   total;
+			ir_entity *target = ir_profile_get_call_target(call, &count, &total);
+			promote_indirect_call(call, target, count, total);
+		}
+		ir_free_resources(irg, IR_RESOURCE_IRN_LINK | IR_RESOURCE_PHI_LIST);
+
+		clear_irg_properties(irg, IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE
+		                   | IR_GRAPH_PROPERTY_NO_CRITICAL_EDGES
+		                   | IR_GRAPH_PROPERTY_CONSISTENT_OUTS
+		                   | IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO);
+		set_irg_callee_info_state(irg, irg_callee_info_inconsistent);
+	}
+	DEL_ARR_F(calls);
+}
+
 typedef struct walk_env_t {
 	ir_graph **irgs;
 	size_t     last_irg;
@@ -1101,6 +1318,14 @@ static void inline_into(ir_graph *irg, unsigned maxsize,
 			    env->n_nodes, callee, callee_env->n_nodes));
 			continue;
 		}
+		bool const is_cold = is_cold_call(curr_call);
+		if (is_cold && !(props & mtp_property_always_inline)
+		    && env->n_cold_nodes + callee_env->n_nodes > maxsize / COLD_BUDGET_DIVISOR) {
+			DB((dbg, LEVEL_2, "%+F: cold budget exhausted (%d) + %+F (%d)\n",
+			    irg, env->n_cold_nodes, callee, callee_env->n_nodes));
+			continue;
+		}
+		ir_graph *const orig_callee = callee;
 
 		ir_graph *calleee = pmap_get(ir_graph, copied_graphs, callee);
 		if (calleee != NULL) {
@@ -1195,8 +1420,16 @@ static void inline_into(ir_graph *irg, unsigned maxsize,
 		env->got_inline = 1;
 		--env->n_call_nodes;
 
-		/* we just generate a bunch of new calls */
-		int loop_depth = curr_call->loop_depth;
+		/* we just generate a bunch of new calls, their execution counts are
+		 * those of the callee scaled by the frequency of this call */
+		int      loop_depth  = curr_call->loop_depth;
+		double   count_scale = -1;
+		ir_node *start_block = get_irg_start_block(orig_callee);
+		if (curr_call->profiled && ir_profile_has_block_execcount(start_block)) {
+			uint32_t const entry_count = ir_profile_get_block_execcount(start_block);
+			if (entry_count > 0)
+				count_scale = curr_call->count / entry_count;
+		}
 		list_for_each_entry(call_entry, centry, &callee_env->calls, list) {
 			inline_irg_env *penv = (inline_irg_env*)get_irg_link(centry->callee);
 
@@ -1218,7 +1451,7 @@ static void inline_into(ir_graph *irg, unsigned maxsize,
 			assert(is_Call(new_call));
 
 			call_entry *new_entry
-				= duplicate_call_entry(centry, new_call, loop_depth);
+				= duplicate_call_entry(centry, new_call, loop_depth, count_scale);
 			list_add_tail(&new_entry->list, &env->calls);
 			maybe_push_call(pqueue, new_entry, inline_threshold);
 		}
@@ -1226,6 +1459,8 @@ static void inline_into(ir_graph *irg, unsigned maxsize,
 
 		env->n_call_nodes += callee_env->n_call_nodes;
 		env->n_nodes += callee_env->n_nodes;
+		if (is_cold)
+			env->n_cold_nodes += callee_env->n_nodes;
 		--callee_env->n_callers;
 	}
 	ir_free_resources(irg, IR_RESOURCE_IRN_LINK|IR_RESOURCE_PHI_LIST);
@@ -1239,9 +1474,15 @@ static void inline_into(ir_graph *irg, unsigned maxsize,
 void inline_functions(unsigned maxsize, int inline_threshold,
                       opt_ptr after_inline_opt)
 {
+	ir_trace_enter("inline_functions", NULL);
 	ir_graph *rem = current_ir_graph;
 	obstack_init(&temp_obst);
 
+	/* with profile data make monomorphic indirect calls direct first */
+	if (ir_profile_available())
+		promote_indirect_calls();
+	max_call_count = 0;
+
 	ir_graph **irgs = create_irg_list();
 
 	/* a map for the copied graphs, used to inline recursive calls */
@@ -1301,6 +1542,7 @@ void inline_functions(unsigned maxsize, int inline_threshold,
 
 	obstack_free(&temp_obst, NULL);
 	current_ir_graph = rem;
+	ir_trace_leave("inline_functions");
 }
 
 void firm_init_inline(void)
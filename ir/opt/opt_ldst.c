@@ -26,6 +26,7 @@
 #include "irouts_t.h"
 #include "panic.h"
 #include "raw_bitset.h"
+#include "timing.h"
 #include "type_t.h"
 #include "util.h"
 
@@ -1751,6 +1752,7 @@ static void insert_Loads_upwards(void)
 
 void opt_ldst(ir_graph *irg)
 {
+	ir_trace_enter("opt_ldst", irg);
 	block_t *bl;
 
 	FIRM_DBG_REGISTER(dbg, "firm.opt.ldst");
@@ -1883,4 +1885,5 @@ no_changes:
 #ifdef DEBUG_libfirm
 	DEL_ARR_F(env.id_2_address);
 #endif
+	ir_trace_leave("opt_ldst");
 }
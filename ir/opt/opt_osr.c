@@ -27,11 +27,14 @@
 #include "irop_t.h"
 #include "iroptimize.h"
 #include "irouts.h"
+#include "irprofile.h"
 #include "irtools.h"
 #include "obst.h"
 #include "panic.h"
 #include "pdeq.h"
+#include "pset_new.h"
 #include "set.h"
+#include "timing.h"
 #include "tv.h"
 #include "util.h"
 #include <stdbool.h>
@@ -1184,6 +1187,7 @@ static void lftr(ir_graph *irg, iv_env *env)
 /* Remove any Phi cycles with only one real input. */
 void remove_phi_cycles(ir_graph *irg)
 {
+	ir_trace_enter("remove_phi_cycles", irg);
 	assure_irg_properties(irg,
 		IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE
 		| IR_GRAPH_PROPERTY_CONSISTENT_OUTS
@@ -1230,6 +1234,7 @@ void remove_phi_cycles(ir_graph *irg)
 	obstack_free(&env.obst, NULL);
 
 	confirm_irg_properties(irg, IR_GRAPH_PROPERTIES_CONTROL_FLOW);
+	ir_trace_leave("remove_phi_cycles");
 }
 
 /**
@@ -1301,6 +1306,7 @@ static void fix_adds_and_subs(ir_node *irn, void *ctx)
 /* Performs Operator Strength Reduction for the passed graph. */
 void opt_osr(ir_graph *irg, unsigned flags)
 {
+	ir_trace_enter("opt_osr", irg);
 	FIRM_DBG_REGISTER(dbg, "firm.opt.osr");
 
 	assure_irg_properties(irg,
@@ -1355,4 +1361,306 @@ void opt_osr(ir_graph *irg, unsigned flags)
 	obstack_free(&env.obst, NULL);
 
 	confirm_irg_properties(irg, IR_GRAPH_PROPERTIES_NONE);
+	ir_trace_leave("opt_osr");
+}
+
+/** Assumed latency of a memory access missing all caches in cycles. */
+#define PREFETCH_DEFAULT_LATENCY 200
+/** Never prefetch more than this many iterations ahead. */
+#define PREFETCH_MAX_ITERATIONS  32
+
+/** The environment for prefetch insertion. */
+typedef struct prefetch_env {
+	iv_env     *env;       /**< the induction variable environment */
+	unsigned    latency;   /**< the memory latency to hide in cycles */
+	ir_type    *type;      /**< the method type of the prefetch Builtin */
+	pset_new_t  done;      /**< already prefetched addresses */
+	unsigned    n_inserted;
+} prefetch_env;
+
+/**
+ * Classify the SCCs for prefetch insertion.
+ *
+ * @param pscc  the SCC
+ * @param env   the environment
+ */
+static void process_prefetch_scc(scc *pscc, iv_env *env)
+{
+	node_entry *e = get_irn_ne(pscc->head, env);
+	if (e->next != NULL)
+		classify_iv(pscc, env);
+}
+
+/**
+ * Returns the constant increment of an induction variable or NULL.
+ *
+ * @param iv   any node of the induction variable
+ * @param env  the environment
+ */
+static ir_tarval *get_iv_increment(ir_node *iv, iv_env *env)
+{
+	ir_tarval *incr = NULL;
+	for (ir_node *irn = get_iv_scc(iv, env)->head; irn != NULL;
+	     irn = get_irn_ne(irn, env)->next) {
+		if (is_Add(irn) || is_Sub(irn)) {
+			ir_node *right = get_binop_right(irn);
+			if (incr != NULL || !is_Const(right))
+				return NULL;
+			incr = get_Const_tarval(right);
+			if (is_Sub(irn))
+				incr = tarval_neg(incr);
+		} else if (!is_Phi(irn)) {
+			return NULL;
+		}
+	}
+	return incr;
+}
+
+/**
+ * Returns the number of nodes in a loop and its inner loops.
+ */
+static unsigned count_loop_nodes(const ir_loop *loop)
+{
+	unsigned n_nodes = 0;
+	for (size_t i = 0, n = get_loop_n_elements(loop); i < n; ++i) {
+		loop_element const element = get_loop_element(loop, i);
+		if (*element.kind == k_ir_node)
+			n_nodes += get_irn_n_outs(element.node);
+		else if (*element.kind == k_ir_loop)
+			n_nodes += count_loop_nodes(element.son);
+	}
+	return n_nodes;
+}
+
+/**
+ * Returns the average number of iterations of a loop as measured by the
+ * profile or 0 if unknown.
+ */
+static unsigned get_profiled_trip_count(const ir_node *header)
+{
+	if (!ir_profile_available() || !ir_profile_has_block_execcount(header))
+		return 0;
+	uint32_t entered = 0;
+	for (int i = 0, n = get_Block_n_cfgpreds(header); i < n; ++i) {
+		if (is_backedge(header, i))
+			continue;
+		ir_node const *const pred = get_Block_cfgpred_block(header, i);
+		if (pred == NULL || !ir_profile_has_block_execcount(pred))
+			return 0;
+		entered += ir_profile_get_block_execcount(pred);
+	}
+	if (entered == 0)
+		return 0;
+	return ir_profile_get_block_execcount(header) / entered;
+}
+
+/**
+ * Returns how many iterations ahead an access in the loop with the given
+ * header should be prefetched.  Every node of the loop is assumed to take
+ * one cycle, so enough iterations to cover the memory latency are used.
+ * Short loops are prefetched less far ahead, so the prefetched data is
+ * still used by the loop.
+ */
+static unsigned get_prefetch_distance(const prefetch_env *penv,
+                                      const ir_node *header)
+{
+	unsigned const size     = MAX(count_loop_nodes(get_irn_loop(header)), 1u);
+	unsigned       distance = (penv->latency + size - 1) / size;
+	distance = MIN(distance, PREFETCH_MAX_ITERATIONS);
+
+	unsigned const trip_count = get_profiled_trip_count(header);
+	if (trip_count != 0 && trip_count < 2 * distance)
+		distance = trip_count / 2;
+	return distance;
+}
+
+/**
+ * Computes by how many bytes an address changes per loop iteration.  The
+ * address must be an induction variable with constant increment or be
+ * computed from one by adding region constants, multiplying or shifting by
+ * constants and integer conversions.
+ *
+ * @param irn     the address or a part of it
+ * @param header  set to the header of the induction variable
+ * @param stride  set to the stride
+ * @param env     the environment
+ *
+ * @return true if the stride could be determined
+ */
+static bool get_stride(ir_node *irn, ir_node **header, long *stride,
+                       iv_env *env)
+{
+	ir_node *iv_header = is_iv(irn, env);
+	if (iv_header != NULL) {
+		ir_tarval *incr = get_iv_increment(irn, env);
+		if (incr == NULL || !tarval_is_long(incr))
+			return false;
+		*header = iv_header;
+		*stride = get_tarval_long(incr);
+		return true;
+	}
+
+	switch (get_irn_opcode(irn)) {
+	case iro_Add: {
+		ir_node *left  = get_Add_left(irn);
+		ir_node *right = get_Add_right(irn);
+		if (get_stride(left, header, stride, env))
+			return is_rc(right, *header);
+		if (get_stride(right, header, stride, env))
+			return is_rc(left, *header);
+		return false;
+	}
+	case iro_Sub:
+		return get_stride(get_Sub_left(irn), header, stride, env)
+		    && is_rc(get_Sub_right(irn), *header);
+	case iro_Mul: {
+		ir_node *right = get_Mul_right(irn);
+		if (!is_Const(right) || !tarval_is_long(get_Const_tarval(right))
+		    || !get_stride(get_Mul_left(irn), header, stride, env))
+			return false;
+		*stride *= get_tarval_long(get_Const_tarval(right));
+		return true;
+	}
+	case iro_Shl: {
+		ir_node *right = get_Shl_right(irn);
+		if (!is_Const(right) || !tarval_is_long(get_Const_tarval(right)))
+			return false;
+		long shift = get_tarval_long(get_Const_tarval(right));
+		if (shift < 0 || shift >= 32
+		    || !get_stride(get_Shl_left(irn), header, stride, env))
+			return false;
+		*stride *= 1L << shift;
+		return true;
+	}
+	case iro_Conv: {
+		ir_node *op = get_Conv_op(irn);
+		return mode_is_int(get_irn_mode(op)) && mode_is_int(get_irn_mode(irn))
+		    && get_stride(op, header, stride, env);
+	}
+	default:
+		return false;
+	}
+}
+
+/**
+ * Post-walker: insert a prefetch in front of Loads from addresses which
+ * change by a constant stride in every loop iteration.
+ */
+static void insert_prefetch(ir_node *irn, void *ctx)
+{
+	if (!is_Load(irn) || get_Load_volatility(irn) == volatility_is_volatile)
+		return;
+
+	prefetch_env *penv = (prefetch_env*)ctx;
+	ir_node      *ptr  = get_Load_ptr(irn);
+	/* one prefetch covers all accesses with a small constant offset from
+	 * the same address */
+	ir_node      *base = ptr;
+	if (is_Add(base) && is_Const(get_Add_right(base)))
+		base = get_Add_left(base);
+	if (pset_new_contains(&penv->done, base))
+		return;
+
+	ir_node *header;
+	long     stride;
+	if (!get_stride(base, &header, &stride, penv->env) || stride == 0)
+		return;
+	/* ignore uses of the final value after the loop */
+	ir_node *block = get_nodes_block(irn);
+	if (is_loop_invariant(block, header))
+		return;
+	unsigned distance = get_prefetch_distance(penv, header);
+	if (distance == 0)
+		return;
+	pset_new_insert(&penv->done, base);
+
+	ir_graph *irg         = get_irn_irg(irn);
+	ir_mode  *offset_mode = get_reference_offset_mode(get_irn_mode(ptr));
+	long      offset      = stride * (long)distance;
+	ir_node  *addr        = new_r_Add(block, ptr,
+	                                  new_r_Const_long(irg, offset_mode, offset));
+	ir_node  *in[] = {
+		addr,
+		new_r_Const_long(irg, mode_Is, 0), /* read */
+		new_r_Const_long(irg, mode_Is, 3), /* high temporal locality */
+	};
+	ir_node  *prefetch = new_rd_Builtin(get_irn_dbg_info(irn), block,
+	                                    get_Load_mem(irn), ARRAY_SIZE(in), in,
+	                                    ir_bk_prefetch, penv->type);
+	set_Load_mem(irn, new_r_Proj(prefetch, mode_M, pn_Builtin_M));
+	++penv->n_inserted;
+
+	DB((dbg, LEVEL_2, "  prefetching %+F %u iterations ahead (%ld bytes)\n",
+	    irn, distance, offset));
+}
+
+/**
+ * Returns the method type used for prefetch Builtins.
+ */
+static ir_type *get_prefetch_type(void)
+{
+	static ir_type *type;
+	if (type == NULL) {
+		type = new_type_method(3, 0, false, cc_cdecl_set, mtp_no_property);
+		set_method_param_type(type, 0, get_type_for_mode(mode_P));
+		set_method_param_type(type, 1, get_type_for_mode(mode_Is));
+		set_method_param_type(type, 2, get_type_for_mode(mode_Is));
+	}
+	return type;
+}
+
+void insert_prefetches(ir_graph *irg, unsigned latency)
+{
+	ir_trace_enter("insert_prefetches", irg);
+	assure_irg_properties(irg,
+		IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE
+		| IR_GRAPH_PROPERTY_CONSISTENT_OUTS
+		| IR_GRAPH_PROPERTY_CONSISTENT_LOOPINFO);
+
+	FIRM_DBG_REGISTER(dbg, "firm.opt.prefetch");
+
+	DB((dbg, LEVEL_1, "Doing prefetch insertion for %+F\n", irg));
+
+	iv_env env;
+	obstack_init(&env.obst);
+	env.stack         = NEW_ARR_F(ir_node *, 128);
+	env.tos           = 0;
+	env.nextDFSnum    = 0;
+	env.POnum         = 0;
+	env.quad_map      = NULL;
+	env.lftr_edges    = NULL;
+	env.replaced      = 0;
+	env.lftr_replaced = 0;
+	env.osr_flags     = 0;
+	env.need_postpass = false;
+	env.process_scc   = process_prefetch_scc;
+
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
+	irg_walk_graph(irg, NULL, firm_clear_link, NULL);
+
+	/* calculate the post order number for blocks. */
+	irg_out_block_walk(get_irg_start_block(irg), NULL, assign_po, &env);
+
+	/* find the induction variables */
+	do_dfs(irg, &env);
+
+	prefetch_env penv;
+	penv.env        = &env;
+	penv.latency    = latency != 0 ? latency : PREFETCH_DEFAULT_LATENCY;
+	penv.type       = get_prefetch_type();
+	penv.n_inserted = 0;
+	pset_new_init(&penv.done);
+	irg_walk_graph(irg, NULL, insert_prefetch, &penv);
+	pset_new_destroy(&penv.done);
+	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
+
+	DB((dbg, LEVEL_1, "insert_prefetches: %u prefetches inserted\n\n",
+	    penv.n_inserted));
+
+	DEL_ARR_F(env.stack);
+	obstack_free(&env.obst, NULL);
+
+	confirm_irg_properties(irg, penv.n_inserted > 0
+		? IR_GRAPH_PROPERTIES_CONTROL_FLOW : IR_GRAPH_PROPERTIES_ALL);
+	ir_trace_leave("insert_prefetches");
 }
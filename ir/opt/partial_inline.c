@@ -0,0 +1,487 @@
+/*
+ * This file is part of libFirm.
+ * Copyright (C) 2012 University of Karlsruhe.
+ */
+
+/**
+ * @file
+ * @brief   Partial inlining of function entry fast paths.
+ * @author  Michael Beck
+ *
+ * Many functions check for a cheap special case first and do the actual
+ * work afterwards.  Such functions are usually too big to be inlined as a
+ * whole.  This pass looks for a block which is entered from a single
+ * conditional jump, is rarely executed and whose dominance subtree forms a
+ * single-entry region that only leaves the function by returning.  The
+ * region is moved ("outlined") into a new local function which receives all
+ * values defined before the region as parameters.  The original function
+ * keeps its small entry part and a call of the outlined function, and is
+ * then small enough for the regular inliner.
+ */
+#include "array.h"
+#include "debug.h"
+#include "execfreq.h"
+#include "ircons_t.h"
+#include "irdom.h"
+#include "irgmod.h"
+#include "irgraph_t.h"
+#include "irgwalk.h"
+#include "irnode_t.h"
+#include "iroptimize.h"
+#include "irprofile.h"
+#include "irprog_t.h"
+#include "irtools.h"
+#include "pmap.h"
+#include "timing.h"
+#include "typerep.h"
+
+DEBUG_ONLY(static firm_dbg_module_t *dbg;)
+
+/** The entry part left in a split function may have at most this many nodes. */
+#define MAX_HEAD_SIZE   30
+/** The outlined region must have at least this many nodes. */
+#define MIN_REGION_SIZE 30
+/**
+ * The outlined region may be executed at most 1/COLD_RATIO times as often as
+ * the function itself.
+ */
+#define COLD_RATIO      2
+
+/** Information about a candidate region. */
+typedef struct region_t {
+	ir_node  *entry;    /**< the region entry block */
+	ir_node **nodes;    /**< all nodes of the graph */
+	ir_node **live_ins; /**< values defined outside and used inside the region */
+	ir_node  *mem;      /**< the memory live-in */
+	unsigned  size;     /**< number of nodes in the region */
+} region_t;
+
+/**
+ * Returns true if a node is counted for the size of a graph.
+ */
+static bool is_counted(const ir_node *node)
+{
+	return !is_Block(node) && !is_Proj(node) && !is_irn_start_block_placed(node)
+	    && !is_End(node) && !is_Anchor(node);
+}
+
+/**
+ * Walker: collect all nodes and count the nodes of each block in its link.
+ */
+static void collect_nodes(ir_node *node, void *data)
+{
+	ir_node ***nodes = (ir_node***)data;
+	ARR_APP1(ir_node*, *nodes, node);
+	if (is_counted(node)) {
+		ir_node *block = get_nodes_block(node);
+		set_irn_link(block, (char*)get_irn_link(block) + 1);
+	}
+}
+
+/**
+ * Dominator tree walker: mark a block as part of the region and add its
+ * node count.
+ */
+static void mark_region_block(ir_node *block, void *data)
+{
+	unsigned *size = (unsigned*)data;
+	set_Block_mark(block, true);
+	*size += (unsigned)(size_t)get_irn_link(block);
+}
+
+static void clear_region_block(ir_node *block, void *data)
+{
+	(void)data;
+	set_Block_mark(block, false);
+}
+
+/**
+ * Walker: clear the links of all nodes and the marks of all blocks.
+ */
+static void clear_links_and_marks(ir_node *node, void *data)
+{
+	set_irn_link(node, NULL);
+	if (is_Block(node))
+		clear_region_block(node, data);
+}
+
+static bool in_region(const ir_node *node)
+{
+	const ir_node *block = is_Block(node) ? node : get_nodes_block(node);
+	return get_Block_mark(block);
+}
+
+/**
+ * Returns the execution frequency of a block relative to the graph entry.
+ */
+static double get_relative_freq(const ir_node *block)
+{
+	ir_graph *irg = get_irn_irg(block);
+	if (ir_profile_available()) {
+		ir_node *start_block = get_irg_start_block(irg);
+		uint32_t entry_count = ir_profile_get_block_execcount(start_block);
+		if (entry_count > 0 && ir_profile_has_block_execcount(block))
+			return (double)ir_profile_get_block_execcount(block) / entry_count;
+	}
+	return get_block_execfreq(block);
+}
+
+/**
+ * Adds a value used inside the region but defined outside of it.
+ *
+ * @return false if the value cannot be passed to an outlined function
+ */
+static bool add_live_in(region_t *region, pmap *seen, ir_node *value)
+{
+	if (pmap_contains(seen, value))
+		return true;
+	pmap_insert(seen, value, value);
+
+	/* constants are simply duplicated */
+	if (is_irn_start_block_placed(value) && !is_Start(value))
+		return true;
+
+	ir_graph *irg  = get_irn_irg(value);
+	ir_mode  *mode = get_irn_mode(value);
+	if (mode == mode_M) {
+		/* we can pass only a single memory value */
+		if (region->mem != NULL)
+			return false;
+		region->mem = value;
+		return true;
+	}
+	/* local variables live on the frame of the function */
+	if (value == get_irg_frame(irg) || !mode_is_data(mode))
+		return false;
+
+	ARR_APP1(ir_node*, region->live_ins, value);
+	return true;
+}
+
+/**
+ * Checks that the dominance subtree of the marked entry block forms a region
+ * that can be outlined and collects its live-ins.
+ */
+static bool check_region(region_t *region)
+{
+	ir_node  *entry  = region->entry;
+	ir_graph *irg    = get_irn_irg(entry);
+	ir_node  *end_bl = get_irg_end_block(irg);
+	ir_node  *end    = get_irg_end(irg);
+	pmap     *seen   = pmap_create();
+	bool      res    = true;
+
+	ARR_SHRINKLEN(region->live_ins, 0);
+	region->mem = NULL;
+
+	for (size_t i = 0, n = ARR_LEN(region->nodes); res && i < n; ++i) {
+		ir_node *node = region->nodes[i];
+		if (node == end || node == end_bl || is_Anchor(node))
+			continue;
+		if (!in_region(node)) {
+			/* control and data must not flow from the region into the
+			 * remaining function except to the end block */
+			if (is_Block(node)) {
+				foreach_irn_in(node, p, pred) {
+					if (!is_Bad(pred) && in_region(get_nodes_block(pred)))
+						res = false;
+				}
+			} else if (!is_irn_start_block_placed(node)) {
+				foreach_irn_in(node, p, pred) {
+					if (in_region(pred))
+						res = false;
+				}
+			}
+			continue;
+		}
+
+		if (is_Block(node)) {
+			/* single entry */
+			foreach_irn_in(node, p, pred) {
+				if (node != entry && !in_region(get_nodes_block(pred)))
+					res = false;
+			}
+			continue;
+		}
+		/* the outlined code has its own Start node and frame */
+		if (is_Start(node) || (is_Builtin(node)
+		    && get_Builtin_kind(node) == ir_bk_va_start)) {
+			res = false;
+			break;
+		}
+		foreach_irn_in(node, p, pred) {
+			if (!in_region(pred) && !add_live_in(region, seen, pred)) {
+				res = false;
+				break;
+			}
+		}
+	}
+	pmap_destroy(seen);
+
+	return res && region->mem != NULL;
+}
+
+/**
+ * Returns the mode of result @p pos of method type @p mtp.
+ */
+static ir_mode *get_result_mode(ir_type *mtp, size_t pos)
+{
+	ir_type *res_type = get_method_res_type(mtp, pos);
+	return is_aggregate_type(res_type) ? mode_P : get_type_mode(res_type);
+}
+
+/**
+ * Creates a new method type for the outlined region of @p irg.
+ */
+static ir_type *create_part_type(ir_graph *irg, region_t const *region)
+{
+	ir_type *mtp      = get_entity_type(get_irg_entity(irg));
+	size_t   n_params = ARR_LEN(region->live_ins);
+	size_t   n_res    = get_method_n_ress(mtp);
+	unsigned cc       = get_method_calling_convention(mtp) & ~cc_this_call;
+	ir_type *res      = new_type_method(n_params, n_res, false, cc, mtp_no_property);
+
+	for (size_t i = 0; i < n_params; ++i) {
+		ir_mode *mode = get_irn_mode(region->live_ins[i]);
+		set_method_param_type(res, i, get_type_for_mode(mode));
+	}
+	for (size_t i = 0; i < n_res; ++i)
+		set_method_res_type(res, i, get_method_res_type(mtp, i));
+	return res;
+}
+
+/**
+ * Moves the region into a new graph and replaces it by a call of this graph.
+ */
+static void outline_region(ir_graph *irg, region_t const *region)
+{
+	ir_entity *ent      = get_irg_entity(irg);
+	ir_type   *mtp      = get_entity_type(ent);
+	ident     *name     = id_unique(new_id_fmt("%s.part", get_entity_ld_name(ent)));
+	ir_type   *part_mtp = create_part_type(irg, region);
+	ir_entity *part_ent = new_global_entity(get_entity_owner(ent), name, part_mtp,
+	                                        ir_visibility_local, IR_LINKAGE_DEFAULT);
+	add_entity_additional_properties(part_ent, mtp_property_noinline);
+
+	DB((dbg, LEVEL_1, "Outlining region of %+F at %+F (%u nodes) into %+F\n",
+	    irg, region->entry, region->size, part_ent));
+
+	ir_graph *part = new_ir_graph(part_ent, 0);
+
+	/* map the live-ins to the parameters of the new graph */
+	ir_node *args = get_irg_args(part);
+	for (size_t i = 0, n = ARR_LEN(region->live_ins); i < n; ++i) {
+		ir_node *live_in = region->live_ins[i];
+		set_irn_link(live_in, new_r_Proj(args, get_irn_mode(live_in), i));
+	}
+	set_irn_link(region->mem, get_irg_initial_mem(part));
+	ir_node *entry_pred = get_Block_cfgpred(region->entry, 0);
+	set_irn_link(entry_pred, new_r_Jmp(get_irg_start_block(part)));
+
+	/* copy the region */
+	ir_node  *end_bl = get_irg_end_block(irg);
+	ir_node  *end    = get_irg_end(irg);
+	ir_node **nodes  = region->nodes;
+	size_t    n      = ARR_LEN(nodes);
+	for (size_t i = 0; i < n; ++i) {
+		ir_node *node = nodes[i];
+		if (node == end || node == end_bl || is_Anchor(node) || !in_region(node))
+			continue;
+		set_irn_link(node, irn_copy_into_irg(node, part));
+		/* duplicate constants used by the region */
+		foreach_irn_in(node, p, pred) {
+			if (in_region(pred) || get_irn_link(pred) != NULL)
+				continue;
+			ir_node *copy;
+			if (is_Bad(pred)) {
+				copy = new_r_Bad(part, get_irn_mode(pred));
+			} else if (is_NoMem(pred)) {
+				copy = get_irg_no_mem(part);
+			} else {
+				assert(is_irn_start_block_placed(pred));
+				copy = irn_copy_into_irg(pred, part);
+				set_nodes_block(copy, get_irg_start_block(part));
+			}
+			set_irn_link(pred, copy);
+		}
+	}
+	for (size_t i = 0; i < n; ++i) {
+		ir_node *node = nodes[i];
+		if (node == end || node == end_bl || is_Anchor(node) || !in_region(node))
+			continue;
+		irn_rewire_inputs(node);
+	}
+
+	/* connect the exits of the region to the new end block and replace them
+	 * in the old graph by a call of the new graph */
+	ir_node  *part_end_bl = get_irg_end_block(part);
+	int       arity       = get_Block_n_cfgpreds(end_bl);
+	ir_node **end_in      = ALLOCAN(ir_node*, arity + 1);
+	int       n_end_in    = 0;
+	for (int i = 0; i < arity; ++i) {
+		ir_node *pred = get_Block_cfgpred(end_bl, i);
+		if (!is_Bad(pred) && in_region(pred))
+			add_immBlock_pred(part_end_bl, (ir_node*)get_irn_link(pred));
+		else
+			end_in[n_end_in++] = pred;
+	}
+	for (int i = get_End_n_keepalives(end); i-- > 0;) {
+		ir_node *ka = get_End_keepalive(end, i);
+		if (in_region(ka)) {
+			add_End_keepalive(get_irg_end(part), (ir_node*)get_irn_link(ka));
+			remove_End_n(end, i);
+		}
+	}
+	irg_finalize_cons(part);
+
+	size_t    n_params = ARR_LEN(region->live_ins);
+	size_t    n_res    = get_method_n_ress(mtp);
+	ir_node  *block    = new_r_Block(irg, 1, &entry_pred);
+	/* the old region is dead now, it must not share the control flow Proj
+	 * with the block of the call */
+	set_Block_cfgpred(region->entry, 0, new_r_Bad(irg, mode_X));
+	ir_node  *callee   = new_r_Address(irg, part_ent);
+	ir_node  *call     = new_r_Call(block, region->mem, callee, n_params,
+	                                region->live_ins, part_mtp);
+	ir_node  *call_mem = new_r_Proj(call, mode_M, pn_Call_M);
+	ir_node **results  = ALLOCAN(ir_node*, n_res);
+	if (n_res > 0) {
+		ir_node *call_res = new_r_Proj(call, mode_T, pn_Call_T_result);
+		for (size_t i = 0; i < n_res; ++i)
+			results[i] = new_r_Proj(call_res, get_result_mode(mtp, i), i);
+	}
+	end_in[n_end_in++] = new_r_Return(block, call_mem, n_res, results);
+	set_irn_in(end_bl, n_end_in, end_in);
+
+	confirm_irg_properties(irg, IR_GRAPH_PROPERTIES_NONE);
+}
+
+/**
+ * Tries to split a graph into a small entry part and a cold remainder.
+ */
+static bool split_irg(ir_graph *irg)
+{
+	assure_irg_properties(irg,
+		IR_GRAPH_PROPERTY_CONSISTENT_DOMINANCE
+		| IR_GRAPH_PROPERTY_NO_UNREACHABLE_CODE
+		| IR_GRAPH_PROPERTY_NO_BADS
+		| IR_GRAPH_PROPERTY_NO_TUPLES);
+	if (!ir_profile_available())
+		ir_estimate_execfreq(irg);
+
+	ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK | IR_RESOURCE_BLOCK_MARK);
+	irg_walk_graph(irg, clear_links_and_marks, NULL, NULL);
+
+	region_t region = {
+		.nodes    = NEW_ARR_F(ir_node*, 0),
+		.live_ins = NEW_ARR_F(ir_node*, 0),
+	};
+	irg_walk_graph(irg, collect_nodes, NULL, &region.nodes);
+
+	unsigned total = 0;
+	for (size_t i = 0, n = ARR_LEN(region.nodes); i < n; ++i) {
+		if (is_counted(region.nodes[i]))
+			++total;
+	}
+
+	/* find the biggest cold region leaving a small head */
+	ir_node *end_bl = get_irg_end_block(irg);
+	ir_node *best   = NULL;
+	unsigned best_size = 0;
+	for (size_t i = 0, n = ARR_LEN(region.nodes); i < n; ++i) {
+		ir_node *block = region.nodes[i];
+		if (!is_Block(block) || block == end_bl
+		    || get_Block_n_cfgpreds(block) != 1)
+			continue;
+		ir_node *pred = skip_Proj(get_Block_cfgpred(block, 0));
+		if (!is_Cond(pred) && !is_Switch(pred))
+			continue;
+		if (get_relative_freq(block) * COLD_RATIO > 1.0)
+			continue;
+
+		unsigned size = 0;
+		dom_tree_walk(block, mark_region_block, NULL, &size);
+		set_Block_mark(end_bl, false);
+		region.entry = block;
+		region.size  = size;
+		if (size > best_size && size >= MIN_REGION_SIZE
+		    && total - size + 2 <= MAX_HEAD_SIZE && check_region(&region)) {
+			best      = block;
+			best_size = size;
+		}
+		dom_tree_walk(block, clear_region_block, NULL, NULL);
+	}
+
+	if (best != NULL) {
+		/* the links of the nodes are used for copying now */
+		for (size_t i = 0, n = ARR_LEN(region.nodes); i < n; ++i)
+			set_irn_link(region.nodes[i], NULL);
+
+		dom_tree_walk(best, mark_region_block, NULL, &region.size);
+		set_Block_mark(end_bl, false);
+		region.entry = best;
+		region.size  = best_size;
+		bool ok = check_region(&region);
+		assert(ok);
+		(void)ok;
+		outline_region(irg, &region);
+	}
+
+	ir_free_resources(irg, IR_RESOURCE_IRN_LINK | IR_RESOURCE_BLOCK_MARK);
+	DEL_ARR_F(region.live_ins);
+	DEL_ARR_F(region.nodes);
+	return best != NULL;
+}
+
+/**
+ * Walker: mark the graphs called directly.
+ */
+static void mark_callees(ir_node *node, void *data)
+{
+	(void)data;
+	if (!is_Call(node))
+		return;
+	ir_entity *callee_ent = get_Call_callee(node);
+	if (callee_ent == NULL)
+		return;
+	ir_graph *callee = get_entity_linktime_irg(callee_ent);
+	if (callee != NULL)
+		set_irg_link(callee, callee);
+}
+
+void partial_inline(unsigned maxsize, int inline_threshold,
+                    opt_ptr after_inline_opt)
+{
+	ir_trace_enter("partial_inline", NULL);
+	FIRM_DBG_REGISTER(dbg, "firm.opt.partial_inline");
+
+	/* only graphs with call sites are worth splitting */
+	irp_reserve_resources(irp, IRP_RESOURCE_IRG_LINK);
+	foreach_irp_irg(i, irg) {
+		set_irg_link(irg, NULL);
+	}
+	foreach_irp_irg(i, irg) {
+		irg_walk_graph(irg, NULL, mark_callees, NULL);
+	}
+
+	ir_graph **candidates = NEW_ARR_F(ir_graph*, 0);
+	foreach_irp_irg(i, irg) {
+		ir_entity *ent   = get_irg_entity(irg);
+		ir_type   *mtp   = get_entity_type(ent);
+		mtp_additional_properties props = get_entity_additional_properties(ent);
+		if (get_irg_link(irg) == NULL || is_method_variadic(mtp)
+		    || (props & (mtp_property_noinline | mtp_property_always_inline)))
+			continue;
+		ARR_APP1(ir_graph*, candidates, irg);
+	}
+	irp_free_resources(irp, IRP_RESOURCE_IRG_LINK);
+
+	/* the outlined graphs are appended to the program, so iterate over the
+	 * candidates collected before */
+	for (size_t i = 0, n = ARR_LEN(candidates); i < n; ++i)
+		split_irg(candidates[i]);
+	DEL_ARR_F(candidates);
+
+	inline_functions(maxsize, inline_threshold, after_inline_opt);
+	ir_trace_leave("partial_inline");
+}
@@ -31,6 +31,7 @@
 #include "irtools.h"
 #include "panic.h"
 #include "set.h"
+#include "timing.h"
 #include "tv.h"
 
 /**
@@ -589,6 +590,7 @@ restart:
 
 void proc_cloning(float threshold)
 {
+	ir_trace_enter("proc_cloning", NULL);
 	DEBUG_ONLY(firm_dbg_module_t *dbg;)
 
 	/* register a debug mask */
@@ -665,4 +667,5 @@ void proc_cloning(float threshold)
 		}
 	}
 	obstack_free(&hmap.obst, NULL);
+	ir_trace_leave("proc_cloning");
 }
@@ -29,6 +29,7 @@
 #include "opt_init.h"
 #include "panic.h"
 #include "pdeq.h"
+#include "timing.h"
 #include "unionfind.h"
 
 DEBUG_ONLY(static firm_dbg_module_t *dbg;)
@@ -2069,6 +2070,7 @@ static void do_chaining(ir_graph *irg)
  */
 void optimize_reassociation(ir_graph *irg)
 {
+	ir_trace_enter("optimize_reassociation", irg);
 	assert(get_irg_pinned(irg) != op_pin_state_floats &&
 	       "Reassociation needs pinned graph to work properly");
 
@@ -2111,6 +2113,7 @@ void optimize_reassociation(ir_graph *irg)
 	deq_free(&wq);
 
 	confirm_irg_properties(irg, IR_GRAPH_PROPERTIES_CONTROL_FLOW);
+	ir_trace_leave("optimize_reassociation");
 }
 
 void ir_register_reassoc_node_ops(void)
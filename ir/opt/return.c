@@ -14,6 +14,7 @@
 #include "irnode_t.h"
 #include "iroptimize.h"
 #include "raw_bitset.h"
+#include "timing.h"
 #include "util.h"
 #include <stdbool.h>
 
@@ -37,7 +38,7 @@
  *   res = c;
  * return res;
  */
-void normalize_one_return(ir_graph *irg)
+static void do_normalize_one_return(ir_graph *irg)
 {
 	/* look, if we have more than one return */
 	ir_node *endbl = get_irg_end_block(irg);
@@ -132,6 +133,13 @@ void normalize_one_return(ir_graph *irg)
 	add_irg_properties(irg, IR_GRAPH_PROPERTY_ONE_RETURN);
 }
 
+void normalize_one_return(ir_graph *irg)
+{
+	ir_trace_enter("normalize_one_return", irg);
+	do_normalize_one_return(irg);
+	ir_trace_leave("normalize_one_return");
+}
+
 /**
  * Check, whether a Return can be moved on block upwards.
  *
@@ -199,7 +207,7 @@ static bool can_move_ret(ir_node *ret)
  * else
  *   return c;
  */
-void normalize_n_returns(ir_graph *irg)
+static void do_normalize_n_returns(ir_graph *irg)
 {
 	/* First, link all returns:
 	 * These must be predecessors of the endblock.
@@ -326,3 +334,10 @@ void normalize_n_returns(ir_graph *irg)
 		| IR_GRAPH_PROPERTY_CONSISTENT_ENTITY_USAGE);
 	add_irg_properties(irg, IR_GRAPH_PROPERTY_MANY_RETURNS);
 }
+
+void normalize_n_returns(ir_graph *irg)
+{
+	ir_trace_enter("normalize_n_returns", irg);
+	do_normalize_n_returns(irg);
+	ir_trace_leave("normalize_n_returns");
+}
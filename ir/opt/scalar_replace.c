@@ -25,6 +25,7 @@
 #include "pset.h"
 #include "set.h"
 #include "target_t.h"
+#include "timing.h"
 #include "tv.h"
 #include "util.h"
 #include "xmalloc.h"
@@ -562,6 +563,7 @@ static void do_scalar_replacements(ir_graph *irg, pset *members, unsigned nvals,
  */
 void scalar_replacement_opt(ir_graph *irg)
 {
+	ir_trace_enter("scalar_replacement_opt", irg);
 	assure_irg_properties(irg, IR_GRAPH_PROPERTY_NO_UNREACHABLE_CODE
 	                         | IR_GRAPH_PROPERTY_CONSISTENT_OUTS
 	                         | IR_GRAPH_PROPERTY_NO_TUPLES);
@@ -640,6 +642,7 @@ void scalar_replacement_opt(ir_graph *irg)
 
 	confirm_irg_properties(irg, changed ? IR_GRAPH_PROPERTIES_NONE
 	                                    : IR_GRAPH_PROPERTIES_ALL);
+	ir_trace_leave("scalar_replacement_opt");
 }
 
 void firm_init_scalar_replace(void)
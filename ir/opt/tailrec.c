@@ -24,6 +24,7 @@
 #include "irprog_t.h"
 #include "panic.h"
 #include "scalar_replace.h"
+#include "timing.h"
 #include "util.h"
 #include <assert.h>
 
@@ -583,6 +584,7 @@ static unsigned find_tail_rec_possibilities(tr_env *env, ir_graph *irg)
 
 void opt_tail_rec_irg(ir_graph *irg)
 {
+	ir_trace_enter("opt_tail_rec_irg", irg);
 	FIRM_DBG_REGISTER(dbg, "firm.opt.tailrec");
 	assure_irg_properties(irg,
 		IR_GRAPH_PROPERTY_MANY_RETURNS
@@ -609,4 +611,5 @@ void opt_tail_rec_irg(ir_graph *irg)
 	free(env.variants);
 	free(env.parameter_projs);
 	ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
+	ir_trace_leave("opt_tail_rec_irg");
 }
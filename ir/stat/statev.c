@@ -11,21 +11,33 @@
  */
 #include "statev_t.h"
 
+#include "hashptr.h"
 #include "irprintf.h"
+#include "obst.h"
+#include "set.h"
 #include "stat_timing.h"
 #include "util.h"
 #include <assert.h>
 #include <regex.h>
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define MAX_TIMER 256
 
+/* size of the output buffer of the binary format */
+#define BUFFER_SIZE (64 * 1024)
+
+/* version of the binary format */
+#define BINARY_VERSION 1
+
 int (stat_ev_enabled) = 0;
 
 static FILE          *stat_ev_file;
+static bool           stat_ev_binary;
 static int            stat_ev_timer_sp;
 static timing_ticks_t stat_ev_timer_elapsed[MAX_TIMER];
 static timing_ticks_t stat_ev_timer_start[MAX_TIMER];
@@ -33,6 +45,73 @@ static timing_ticks_t stat_ev_timer_start[MAX_TIMER];
 static regex_t  regex;
 static regex_t *filter;
 
+/**
+ * A key of the event stream.  The filter is applied once per key, not once
+ * per event.
+ */
+typedef struct statev_key_t {
+	const char *name;    /**< the key, allocated on key_obst */
+	unsigned    id;      /**< id of the key in the binary format */
+	bool        matches; /**< whether the key passes the filter */
+} statev_key_t;
+
+static set           *keys;
+static unsigned       n_keys;
+static struct obstack key_obst;
+
+static unsigned char  buffer[BUFFER_SIZE];
+static size_t         buffer_len;
+
+static int cmp_key(const void *a, const void *b, size_t size)
+{
+	const statev_key_t *ka = (const statev_key_t*)a;
+	const statev_key_t *kb = (const statev_key_t*)b;
+	(void)size;
+	return strcmp(ka->name, kb->name);
+}
+
+static void flush_buffer(void)
+{
+	fwrite(buffer, 1, buffer_len, stat_ev_file);
+	buffer_len = 0;
+}
+
+static void put_byte(unsigned char const byte)
+{
+	if (buffer_len == BUFFER_SIZE)
+		flush_buffer();
+	buffer[buffer_len++] = byte;
+}
+
+static void put_bytes(void const *const data, size_t const len)
+{
+	if (buffer_len + len > BUFFER_SIZE) {
+		flush_buffer();
+		if (len > BUFFER_SIZE) {
+			fwrite(data, 1, len, stat_ev_file);
+			return;
+		}
+	}
+	memcpy(&buffer[buffer_len], data, len);
+	buffer_len += len;
+}
+
+/** Writes @p value as unsigned LEB128. */
+static void put_uleb(unsigned long long value)
+{
+	do {
+		unsigned char const byte = value & 0x7F;
+		value >>= 7;
+		put_byte(value != 0 ? byte | 0x80 : byte);
+	} while (value != 0);
+}
+
+static void put_string(const char *const str, size_t const len)
+{
+	put_uleb(len);
+	put_bytes(str, len);
+}
+
 static bool key_matches(const char *key)
 {
 	if (filter == NULL)
@@ -41,26 +120,67 @@ static bool key_matches(const char *key)
 	return regexec(filter, key, 0, NULL, 0) == 0;
 }
 
-static void stat_ev_vprintf(char ev, const char *key, const char *fmt, va_list ap)
+/**
+ * Returns the interned key @p name.  A new key which passes the filter gets
+ * the next id, which the binary format defines with a 'K' record.
+ */
+static statev_key_t const *intern_key(const char *const name)
 {
-	if (!key_matches(key))
-		return;
+	statev_key_t  const query = { .name = name };
+	unsigned      const hash  = hash_str(name);
+	statev_key_t *const key   = set_find(statev_key_t, keys, &query, sizeof(query), hash);
+	if (key != NULL)
+		return key;
+
+	size_t       const len     = strlen(name);
+	statev_key_t const new_key = {
+		.name    = (const char*)obstack_copy0(&key_obst, name, len),
+		.id      = n_keys,
+		.matches = key_matches(name),
+	};
+	if (new_key.matches) {
+		++n_keys;
+		if (stat_ev_binary) {
+			put_byte('K');
+			put_uleb(new_key.id);
+			put_string(name, len);
+		}
+	}
+	return set_insert(statev_key_t, keys, &new_key, sizeof(new_key), hash);
+}
 
-	putc(ev, stat_ev_file);
-	putc(';', stat_ev_file);
-	fputs(key, stat_ev_file);
-	if (fmt != NULL) {
+/**
+ * Starts a record for the key @p name unless the filter rejects the key.
+ * Binary records start with @p tag and the key id, text records with the
+ * line prefix of the event type @p ev and the key.
+ *
+ * @returns whether the record was started
+ */
+static bool begin_record(char const tag, char const ev, const char *const name)
+{
+	statev_key_t const *const key = intern_key(name);
+	if (!key->matches)
+		return false;
+
+	if (stat_ev_binary) {
+		put_byte(tag);
+		put_uleb(key->id);
+	} else {
+		putc(ev, stat_ev_file);
 		putc(';', stat_ev_file);
-		ir_vfprintf(stat_ev_file, fmt, ap);
+		fputs(key->name, stat_ev_file);
 	}
-	putc('\n', stat_ev_file);
+	return true;
 }
 
-static void stat_ev_printf(char ev, const char *key, const char *fmt, ...)
+/** Writes the value of a text record and ends the record. */
+static void end_text_record(const char *fmt, ...)
 {
 	va_list ap;
 	va_start(ap, fmt);
-	stat_ev_vprintf(ev, key, fmt, ap);
+	putc(';', stat_ev_file);
+	vfprintf(stat_ev_file, fmt, ap);
+	putc('\n', stat_ev_file);
 	va_end(ap);
 }
 
@@ -103,7 +223,19 @@ void stat_ev_tim_pop(const char *name)
 void do_stat_ev_ctx_push_vfmt(const char *key, const char *fmt, va_list ap)
 {
 	stat_ev_tim_push();
-	stat_ev_vprintf('P', key, fmt, ap);
+	if (begin_record('P', 'P', key)) {
+		if (stat_ev_binary) {
+			ir_obst_vprintf(&key_obst, fmt, ap);
+			size_t const len   = obstack_object_size(&key_obst);
+			char  *const value = (char*)obstack_finish(&key_obst);
+			put_string(value, len);
+			obstack_free(&key_obst, value);
+		} else {
+			putc(';', stat_ev_file);
+			ir_vfprintf(stat_ev_file, fmt, ap);
+			putc('\n', stat_ev_file);
+		}
+	}
 	stat_ev_tim_pop(NULL);
 }
 
@@ -126,7 +258,8 @@ void (stat_ev_ctx_push_str)(const char *key, const char *str)
 void do_stat_ev_ctx_pop(const char *key)
 {
 	stat_ev_tim_push();
-	stat_ev_printf('O', key, NULL);
+	if (begin_record('O', 'O', key) && !stat_ev_binary)
+		putc('\n', stat_ev_file);
 	stat_ev_tim_pop(NULL);
 }
 
@@ -138,7 +271,16 @@ void (stat_ev_ctx_pop)(const char *key)
 void do_stat_ev_dbl(const char *name, double value)
 {
 	stat_ev_tim_push();
-	stat_ev_printf('E', name, "%g", value);
+	if (begin_record('D', 'E', name)) {
+		if (stat_ev_binary) {
+			uint64_t bits;
+			memcpy(&bits, &value, sizeof(bits));
+			for (unsigned i = 0; i < 8; ++i)
+				put_byte(bits >> (8 * i));
+		} else {
+			end_text_record("%g", value);
+		}
+	}
 	stat_ev_tim_pop(NULL);
 }
 
@@ -150,7 +292,15 @@ void (stat_ev_dbl)(const char *name, double value)
 void do_stat_ev_int(const char *name, int value)
 {
 	stat_ev_tim_push();
-	stat_ev_printf('E', name, "%d", value);
+	if (begin_record('I', 'E', name)) {
+		if (stat_ev_binary) {
+			/* zigzag encoding keeps small negative values short */
+			unsigned long long const v = value;
+			put_uleb(value < 0 ? ~(v << 1) : v << 1);
+		} else {
+			end_text_record("%d", value);
+		}
+	}
 	stat_ev_tim_pop(NULL);
 }
 
@@ -162,7 +312,12 @@ void (stat_ev_int)(const char *name, int value)
 void do_stat_ev_ull(const char *name, unsigned long long value)
 {
 	stat_ev_tim_push();
-	stat_ev_printf('E', name, "%llu", value);
+	if (begin_record('U', 'E', name)) {
+		if (stat_ev_binary)
+			put_uleb(value);
+		else
+			end_text_record("%llu", value);
+	}
 	stat_ev_tim_pop(NULL);
 }
 
@@ -174,7 +329,8 @@ void (stat_ev_ull)(const char *name, unsigned long long value)
 void do_stat_ev(const char *name)
 {
 	stat_ev_tim_push();
-	stat_ev_printf('E', name, "0.0");
+	if (begin_record('E', 'E', name) && !stat_ev_binary)
+		end_text_record("0.0");
 	stat_ev_tim_pop(NULL);
 }
 
@@ -183,12 +339,12 @@ void (stat_ev)(const char *name)
 	stat_ev_(name);
 }
 
-void stat_ev_begin(const char *prefix, const char *filt)
+static void begin(const char *prefix, const char *filt, bool binary)
 {
 	char buf[512];
 
-	snprintf(buf, sizeof(buf), "%s.ev", prefix);
-	stat_ev_file = fopen(buf, "wt");
+	snprintf(buf, sizeof(buf), binary ? "%s.evb" : "%s.ev", prefix);
+	stat_ev_file = fopen(buf, binary ? "wb" : "wt");
 	if (stat_ev_file == NULL) {
 		fprintf(stderr, "Warning: Couldn't create statev output '%s'\n", buf);
 	}
@@ -205,14 +361,41 @@ void stat_ev_begin(const char *prefix, const char *filt)
 	}
 
 	stat_ev_enabled = stat_ev_file != NULL;
+	stat_ev_binary  = binary;
+	if (!stat_ev_enabled)
+		return;
+
+	keys   = new_set(cmp_key, 64);
+	n_keys = 0;
+	obstack_init(&key_obst);
+	if (binary) {
+		put_bytes("firmstev", 8);
+		put_byte(BINARY_VERSION);
+	} else {
+		setvbuf(stat_ev_file, NULL, _IOFBF, BUFFER_SIZE);
+	}
+}
+
+void stat_ev_begin(const char *prefix, const char *filt)
+{
+	begin(prefix, filt, false);
+}
+
+void stat_ev_begin_binary(const char *prefix, const char *filt)
+{
+	begin(prefix, filt, true);
 }
 
 void stat_ev_end(void)
 {
 	if (stat_ev_file != NULL) {
+		flush_buffer();
 		fclose(stat_ev_file);
 		stat_ev_file    = NULL;
 		stat_ev_enabled = 0;
+		del_set(keys);
+		keys = NULL;
+		obstack_free(&key_obst, NULL);
 	}
 	if (filter != NULL) {
 		regfree(filter);
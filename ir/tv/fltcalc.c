@@ -41,16 +41,10 @@ struct fp_value {
 #define _exp(a)  &((a)->value[0])
 #define _mant(a) &((a)->value[value_size])
 
-/** Current rounding mode.*/
-static fc_rounding_mode_t rounding_mode;
-
 static unsigned fp_value_size;
 static unsigned value_size;
 static unsigned max_precision;
 
-/** Exact flag. */
-static bool fc_exact = true;
-
 static float_descriptor_t long_double_desc;
 
 /** pack machine-like */
@@ -90,7 +84,8 @@ static void pack(const fp_value *value, sc_word *packed)
  *
  * @return true if result is exact
  */
-static bool normalize(fp_value *val, bool sticky)
+static bool normalize(fp_value *val, bool sticky,
+                      fc_rounding_mode_t rounding_mode)
 {
 	const float_descriptor_t *desc = &val->desc;
 	unsigned effective_mantissa = desc->mantissa_size - desc->explicit_one;
@@ -267,13 +262,11 @@ static bool handle_NAN(const fp_value *a, const fp_value *b, fp_value *result)
 			goto return_nan_b;
 		if (a != result)
 			memcpy(result, a, fp_value_size);
-		fc_exact = false;
 		return true;
 	}
 	if (b->clss == FC_NAN) {
 return_nan_b:
 		if (b != result) memcpy(result, b, fp_value_size);
-		fc_exact = false;
 		return true;
 	}
 	return false;
@@ -286,8 +279,11 @@ static void fc_get_qnan(const float_descriptor_t *desc, fp_value *result)
 
 /**
  * calculate a + b, where a is the value with the bigger exponent
+ *
+ * @return true if result is exact
  */
-static void _fadd(const fp_value *a, const fp_value *b, fp_value *result)
+static bool _fadd(const fp_value *a, const fp_value *b, fp_value *result,
+                  fc_rounding_mode_t rounding_mode)
 {
 	/* make sure result has a descriptor */
 	if (result != a && result != b)
@@ -298,9 +294,8 @@ static void _fadd(const fp_value *a, const fp_value *b, fp_value *result)
 
 	/* produce NaN on inf - inf */
 	if (sign && (a->clss == FC_INF) && (b->clss == FC_INF)) {
-		fc_exact = false;
 		fc_get_qnan(&a->desc, result);
-		return;
+		return false;
 	}
 
 	sc_word *temp     = ALLOCAN(sc_word, value_size);
@@ -337,16 +332,14 @@ static void _fadd(const fp_value *a, const fp_value *b, fp_value *result)
 	if (a->clss == FC_ZERO || b->clss == FC_INF) {
 		if (b != result)
 			memcpy(result, b, fp_value_size);
-		fc_exact = b->clss == FC_NORMAL;
 		result->sign = res_sign;
-		return;
+		return b->clss == FC_NORMAL;
 	}
 	if (b->clss == FC_ZERO || a->clss == FC_INF) {
 		if (a != result)
 			memcpy(result, a, fp_value_size);
-		fc_exact = a->clss == FC_NORMAL;
 		result->sign = res_sign;
-		return;
+		return a->clss == FC_NORMAL;
 	}
 
 	/* shift the smaller value to the right to align the radix point */
@@ -358,7 +351,6 @@ static void _fadd(const fp_value *a, const fp_value *b, fp_value *result)
 	}
 
 	bool sticky = sc_shr(_mant(b), exp_diff, temp);
-	fc_exact &= !sticky;
 
 	if (sticky && sign) {
 		/* if subtracting a little more than the represented value or adding a
@@ -386,14 +378,15 @@ static void _fadd(const fp_value *a, const fp_value *b, fp_value *result)
 	/* resulting exponent is the bigger one */
 	memmove(_exp(result), _exp(a), value_size);
 
-	fc_exact &= normalize(result, sticky);
+	bool exact = normalize(result, sticky, rounding_mode);
+	return exact && !sticky;
 }
 
-void fc_mul(const fp_value *a, const fp_value *b, fp_value *result)
+bool fc_mul(const fp_value *a, const fp_value *b, fp_value *result,
+            fc_rounding_mode_t rounding_mode)
 {
-	fc_exact = true;
 	if (handle_NAN(a, b, result))
-		return;
+		return false;
 
 	if (result != a && result != b)
 		result->desc = a->desc;
@@ -405,39 +398,35 @@ void fc_mul(const fp_value *a, const fp_value *b, fp_value *result)
 	if (a->clss == FC_ZERO) {
 		if (b->clss == FC_INF) {
 			fc_get_qnan(&a->desc, result);
-			fc_exact = false;
-		} else {
-			if (a != result)
-				memcpy(result, a, fp_value_size);
-			result->sign = res_sign;
+			return false;
 		}
-		return;
+		if (a != result)
+			memcpy(result, a, fp_value_size);
+		result->sign = res_sign;
+		return true;
 	}
 	if (b->clss == FC_ZERO) {
 		if (a->clss == FC_INF) {
 			fc_get_qnan(&a->desc, result);
-			fc_exact = false;
-		} else {
-			if (b != result)
-				memcpy(result, b, fp_value_size);
-			result->sign = res_sign;
+			return false;
 		}
-		return;
+		if (b != result)
+			memcpy(result, b, fp_value_size);
+		result->sign = res_sign;
+		return true;
 	}
 
 	if (a->clss == FC_INF) {
-		fc_exact = false;
 		if (a != result)
 			memcpy(result, a, fp_value_size);
 		result->sign = res_sign;
-		return;
+		return false;
 	}
 	if (b->clss == FC_INF) {
-		fc_exact = false;
 		if (b != result)
 			memcpy(result, b, fp_value_size);
 		result->sign = res_sign;
-		return;
+		return false;
 	}
 
 	/* exp = exp(a) + exp(b) - excess */
@@ -461,16 +450,16 @@ void fc_mul(const fp_value *a, const fp_value *b, fp_value *result)
 	bool sticky = sc_shrI(_mant(result),
 	              (result->desc.mantissa_size - result->desc.explicit_one)
 	              +ROUNDING_BITS, _mant(result));
-	fc_exact &= !sticky;
 
-	fc_exact &= normalize(result, sticky);
+	bool exact = normalize(result, sticky, rounding_mode);
+	return exact && !sticky;
 }
 
-void fc_div(const fp_value *a, const fp_value *b, fp_value *result)
+bool fc_div(const fp_value *a, const fp_value *b, fp_value *result,
+            fc_rounding_mode_t rounding_mode)
 {
-	fc_exact = true;
 	if (handle_NAN(a, b, result))
-		return;
+		return false;
 
 	if (result != a && result != b)
 		result->desc = a->desc;
@@ -483,18 +472,16 @@ void fc_div(const fp_value *a, const fp_value *b, fp_value *result)
 		if (b->clss == FC_ZERO) {
 			/* 0/0 -> NaN */
 			fc_get_qnan(&a->desc, result);
-			fc_exact = false;
-		} else {
-			/* 0/x -> 0 */
-			if (a != result)
-				memcpy(result, a, fp_value_size);
-			result->sign = res_sign;
+			return false;
 		}
-		return;
+		/* 0/x -> 0 */
+		if (a != result)
+			memcpy(result, a, fp_value_size);
+		result->sign = res_sign;
+		return true;
 	}
 
 	if (b->clss == FC_INF) {
-		fc_exact = false;
 		if (a->clss == FC_INF) {
 			/* inf/inf -> NaN */
 			fc_get_qnan(&a->desc, result);
@@ -502,22 +489,20 @@ void fc_div(const fp_value *a, const fp_value *b, fp_value *result)
 			/* x/inf -> 0 */
 			fc_get_zero(&a->desc, result, res_sign);
 		}
-		return;
+		return false;
 	}
 
 	if (a->clss == FC_INF) {
-		fc_exact = false;
 		/* inf/x -> inf */
 		if (a != result)
 			memcpy(result, a, fp_value_size);
 		result->sign = res_sign;
-		return;
+		return false;
 	}
 	if (b->clss == FC_ZERO) {
-		fc_exact = false;
 		/* division by zero */
 		fc_get_inf(&a->desc, result, result->sign);
-		return;
+		return false;
 	}
 
 	/* exp = exp(a) - exp(b) + excess - 1*/
@@ -543,9 +528,9 @@ void fc_div(const fp_value *a, const fp_value *b, fp_value *result)
 	sc_word *divisor = ALLOCAN(sc_word, value_size);
 	sc_shrI(_mant(b), 1, divisor);
 	bool sticky = sc_div(dividend, divisor, _mant(result));
-	fc_exact &= !sticky;
 
-	fc_exact &= normalize(result, sticky);
+	bool exact = normalize(result, sticky, rounding_mode);
+	return exact && !sticky;
 }
 
 void fc_int(const fp_value *a, fp_value *result)
@@ -560,9 +545,6 @@ void fc_int(const fp_value *a, fp_value *result)
 	 * Outside this interval the truncated value is either 0 or
 	 * it does not have fractional parts. */
 
-	/* fixme: can be exact */
-	fc_exact = false;
-
 	int exp_bias = (1 << (a->desc.exponent_size - 1)) - 1;
 	int exp_val  = sc_val_to_long(_exp(a)) - exp_bias;
 	if (exp_val < 0) {
@@ -639,7 +621,7 @@ void fc_val_from_bytes(fp_value *result, const unsigned char *buffer,
 			/* normalize expects the radix point to be normal, so shift
 			 * mantissa of subnormal origin one to the left */
 			sc_shlI(_mant(result), 1, _mant(result));
-			normalize(result, false);
+			normalize(result, false, FC_TONEAREST);
 		}
 	} else if (sc_is_all_one(_exp(result), exponent_size)) {
 		unsigned size = mantissa_size + ROUNDING_BITS - desc->explicit_one;
@@ -655,7 +637,7 @@ void fc_val_from_bytes(fp_value *result, const unsigned char *buffer,
 		/* we always have an explicit one */
 		if (!desc->explicit_one)
 			sc_set_bit_at(_mant(result), ROUNDING_BITS+mantissa_size);
-		normalize(result, false);
+		normalize(result, false, FC_TONEAREST);
 	}
 }
 
@@ -677,7 +659,7 @@ void fc_val_from_ieee754(long double l, fp_value *result)
 long double fc_val_to_ieee754(const fp_value *val)
 {
 	fp_value *temp  = (fp_value*) alloca(fp_value_size);
-	fc_cast(val, &long_double_desc, temp);
+	fc_cast(val, &long_double_desc, temp, FC_TONEAREST);
 
 	sc_word *packed = ALLOCAN(sc_word, value_size);
 	pack(temp, packed);
@@ -709,8 +691,8 @@ bool fc_nan_is_quiet(const fp_value *value)
 	return sc_get_bit_at(_mant(value), bit);
 }
 
-void fc_cast(const fp_value *value, const float_descriptor_t *dest,
-             fp_value *result)
+bool fc_cast(const fp_value *value, const float_descriptor_t *dest,
+             fp_value *result, fc_rounding_mode_t rounding_mode)
 {
 	const float_descriptor_t *desc = &value->desc;
 	/* shortcut */
@@ -719,7 +701,7 @@ void fc_cast(const fp_value *value, const float_descriptor_t *dest,
 		desc->explicit_one  == dest->explicit_one) {
 		if (value != result)
 			memcpy(result, value, fp_value_size);
-		return;
+		return true;
 	}
 	/* Possible: value == result */
 
@@ -741,15 +723,15 @@ void fc_cast(const fp_value *value, const float_descriptor_t *dest,
 			sc_set_bit_at(_mant(result), dest->mantissa_size + ROUNDING_BITS - 1);
 		assert (fc_nan_is_quiet(value) == fc_nan_is_quiet(result));
 		assert (fc_is_nan(result));
-		return;
+		return false;
 	}
 
 	case FC_INF:
 		fc_get_inf(dest, result, value->sign);
-		return;
+		return true;
 	case FC_ZERO:
 		fc_get_zero(dest, result, value->sign);
-		return;
+		return true;
 	case FC_SUBNORMAL:
 	case FC_NORMAL: {
 		/* when the mantissa sizes differ normalizing has to shift to align it.
@@ -776,8 +758,7 @@ void fc_cast(const fp_value *value, const float_descriptor_t *dest,
 		result->desc = *dest;
 		result->clss = value->clss;
 		result->sign = value->sign;
-		normalize(result, false);
-		return;
+		return normalize(result, false, rounding_mode);
 	}
 	}
 	panic("invalid fp_value");
@@ -1035,20 +1016,6 @@ bool fc_can_lossless_conv_to(const fp_value *value,
 	panic("invalid fp_value");
 }
 
-fc_rounding_mode_t fc_set_rounding_mode(fc_rounding_mode_t mode)
-{
-	if (mode == FC_TONEAREST || mode == FC_TOPOSITIVE || mode == FC_TONEGATIVE
-	 || mode == FC_TOZERO)
-		rounding_mode = mode;
-
-	return rounding_mode;
-}
-
-fc_rounding_mode_t fc_get_rounding_mode(void)
-{
-	return rounding_mode;
-}
-
 void init_fltcalc(unsigned precision)
 {
 #ifndef NDEBUG
@@ -1064,7 +1031,6 @@ void init_fltcalc(unsigned precision)
 	max_precision = sc_get_precision() - (2 + ROUNDING_BITS);
 	assert(max_precision >= precision);
 
-	rounding_mode = FC_TONEAREST;
 	value_size    = sc_get_value_length();
 	fp_value_size = sizeof(fp_value) + 2*value_size;
 
@@ -1080,32 +1046,32 @@ void init_fltcalc(unsigned precision)
 }
 
 /* definition of interface functions */
-void fc_add(const fp_value *a, const fp_value *b, fp_value *result)
+bool fc_add(const fp_value *a, const fp_value *b, fp_value *result,
+            fc_rounding_mode_t rounding_mode)
 {
-	fc_exact = true;
 	if (handle_NAN(a, b, result))
-		return;
+		return false;
 
 	/* make the value with the bigger exponent the first one */
 	if (sc_comp(_exp(a), _exp(b)) == ir_relation_less)
-		_fadd(b, a, result);
+		return _fadd(b, a, result, rounding_mode);
 	else
-		_fadd(a, b, result);
+		return _fadd(a, b, result, rounding_mode);
 }
 
-void fc_sub(const fp_value *a, const fp_value *b, fp_value *result)
+bool fc_sub(const fp_value *a, const fp_value *b, fp_value *result,
+            fc_rounding_mode_t rounding_mode)
 {
-	fc_exact = true;
 	if (handle_NAN(a, b, result))
-		return;
+		return false;
 
 	fp_value *temp = (fp_value*) alloca(fp_value_size);
 	memcpy(temp, b, fp_value_size);
 	temp->sign = !b->sign;
 	if (sc_comp(_exp(a), _exp(temp)) == ir_relation_less)
-		_fadd(temp, a, result);
+		return _fadd(temp, a, result, rounding_mode);
 	else
-		_fadd(a, temp, result);
+		return _fadd(a, temp, result, rounding_mode);
 }
 
 void fc_neg(const fp_value *a, fp_value *result)
@@ -1168,11 +1134,6 @@ flt2int_result_t fc_flt2int(const fp_value *a, sc_word *result,
 	return FLT2INT_BAD;
 }
 
-bool fc_is_exact(void)
-{
-	return fc_exact;
-}
-
 #ifdef DEBUG_libfirm
 /* helper to print fp_values in a debugger */
 void fc_debug(fp_value *value);
@@ -21,7 +21,37 @@ typedef enum {
 	FC_HEX,
 } fc_base_t;
 
-/** IEEE-754 Rounding modes. */
+/**
+ * IEEE-754 Rounding modes.
+ *
+ * There is no global rounding mode, every operation which may have to round
+ * its result gets the rounding mode as an explicit parameter and returns
+ * whether the result is exact.  This makes it possible to use the calculator
+ * from several threads at once.
+ *
+ * FC_TONEAREST:
+ *    Any unrepresentable value is rounded to the nearest representable
+ *    value. If it lies in the middle the value with the least significant
+ *    bit of zero is chosen (the even one).
+ *    Values too big to represent will round to +/-infinity.
+ * FC_TONEGATIVE
+ *    Any unrepresentable value is rounded towards negative infinity.
+ *    Positive values too big to represent will round to the biggest
+ *    representable value, negative values too small to represent will
+ *    round to -infinity.
+ * FC_TOPOSITIVE
+ *    Any unrepresentable value is rounded towards positive infinity
+ *    Negative values too small to represent will round to the biggest
+ *    representable value, positive values too big to represent will
+ *    round to +infinity.
+ * FC_TOZERO
+ *    Any unrepresentable value is rounded towards zero, effectively
+ *    chopping off any bits beyond the mantissa size.
+ *    Values too big to represent will round to the biggest/smallest
+ *    representable value.
+ *
+ * @see IEEE754, IEEE854 Floating Point Standard
+ */
 typedef enum {
 	FC_TONEAREST,   /**< if unsure, to the nearest even */
 	FC_TOPOSITIVE,  /**< to +oo */
@@ -82,12 +112,14 @@ long double fc_val_to_ieee754(const fp_value *val);
  * If the new precision is less than the original precision the returned
  * value might not be the same as the original value.
  *
- * @param val     The value to be casted
- * @param desc    The floating point descriptor
- * @param result  A buffer to hold the value built.
+ * @param val       The value to be casted
+ * @param desc      The floating point descriptor
+ * @param result    A buffer to hold the value built.
+ * @param rounding  The rounding mode used if the value is not representable
+ * @return true if the result is exact
  */
-void fc_cast(const fp_value *val, const float_descriptor_t *desc,
-             fp_value *result);
+bool fc_cast(const fp_value *val, const float_descriptor_t *desc,
+             fp_value *result, fc_rounding_mode_t rounding);
 
 /*@{*/
 /** build a special float value
@@ -113,10 +145,22 @@ bool fc_is_nan(const fp_value *a);
 bool fc_nan_is_quiet(const fp_value *a);
 bool fc_is_subnormal(const fp_value *a);
 
-void fc_add(const fp_value *a, const fp_value *b, fp_value *result);
-void fc_sub(const fp_value *a, const fp_value *b, fp_value *result);
-void fc_mul(const fp_value *a, const fp_value *b, fp_value *result);
-void fc_div(const fp_value *a, const fp_value *b, fp_value *result);
+/*@{*/
+/** Arithmetic operations
+ * The result is rounded according to @p rounding.
+ *
+ * @return true if the result is exact, i.e. it was not rounded and no NaN or
+ *         infinity was involved
+ */
+bool fc_add(const fp_value *a, const fp_value *b, fp_value *result,
+            fc_rounding_mode_t rounding);
+bool fc_sub(const fp_value *a, const fp_value *b, fp_value *result,
+            fc_rounding_mode_t rounding);
+bool fc_mul(const fp_value *a, const fp_value *b, fp_value *result,
+            fc_rounding_mode_t rounding);
+bool fc_div(const fp_value *a, const fp_value *b, fp_value *result,
+            fc_rounding_mode_t rounding);
+/*@}*/
 void fc_neg(const fp_value *a, fp_value *result);
 void fc_int(const fp_value *a, fp_value *result);
 
@@ -160,49 +204,6 @@ int fc_get_exponent(const fp_value *value);
 bool fc_can_lossless_conv_to(const fp_value *value,
                              const float_descriptor_t *desc);
 
-/** Set new rounding mode
- * This function sets the rounding mode to one of the following, returning
- * the previously set rounding mode.
- * FC_TONEAREST (default):
- *    Any unrepresentable value is rounded to the nearest representable
- *    value. If it lies in the middle the value with the least significant
- *    bit of zero is chosen (the even one).
- *    Values too big to represent will round to +/-infinity.
- * FC_TONEGATIVE
- *    Any unrepresentable value is rounded towards negative infinity.
- *    Positive values too big to represent will round to the biggest
- *    representable value, negative values too small to represent will
- *    round to -infinity.
- * FC_TOPOSITIVE
- *    Any unrepresentable value is rounded towards positive infinity
- *    Negative values too small to represent will round to the biggest
- *    representable value, positive values too big to represent will
- *    round to +infinity.
- * FC_TOZERO
- *    Any unrepresentable value is rounded towards zero, effectively
- *    chopping off any bits beyond the mantissa size.
- *    Values too big to represent will round to the biggest/smallest
- *    representable value.
- *
- * These modes correspond to the modes required by the IEEE-754 standard.
- *
- * @param mode The new rounding mode. Any value other than the four
- *        defined values will have no effect.
- * @return The previous rounding mode.
- *
- * @see fc_get_rounding_mode()
- * @see IEEE754, IEEE854 Floating Point Standard
- */
-fc_rounding_mode_t fc_set_rounding_mode(fc_rounding_mode_t mode);
-
-/** Get the rounding mode
- * This function retrieves the currently used rounding mode
- *
- * @return The current rounding mode
- * @see fc_set_rounding_mode()
- */
-fc_rounding_mode_t fc_get_rounding_mode(void);
-
 /** Get bit representation of a value
  * This function allows to read a value in encoded form, byte wise.
  * The value will be packed corresponding to the way used by the IEEE
@@ -234,11 +235,6 @@ unsigned char fc_sub_bits(const fp_value *val, unsigned num_bit,
  */
 void fc_val_to_bytes(const fp_value *val, unsigned char *buf);
 
-/**
- * Returns non-zero if the result of the last operation was exact.
- */
-bool fc_is_exact(void);
-
 void init_fltcalc(unsigned precision);
 
 #endif
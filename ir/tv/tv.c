@@ -27,23 +27,21 @@
 #include "irmode_t.h"
 #include "irnode_t.h"
 #include "irprintf.h"
+#include "lfset.h"
 #include "panic.h"
-#include "set.h"
 #include "strcalc.h"
 #include "util.h"
 #include "xmalloc.h"
 #include <assert.h>
 #include <limits.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <stdlib.h>
 #include <string.h>
 
-/** Size of hash tables.  Should correspond to average number of distinct
- * constant target values */
-#define N_CONSTANTS 2048
-
-/** A set containing all existing tarvals. */
-static struct set *tarvals = NULL;
+/** A set containing all existing tarvals.  Constant folding may run in
+ * several threads, so the set is lock-free. */
+static lfset_t tarvals;
 
 static unsigned sc_value_length;
 static unsigned fp_value_size;
@@ -51,15 +49,34 @@ static unsigned fp_value_size;
 /** The integer overflow mode. */
 static bool wrap_on_overflow = true;
 
+/*
+ * Integer modes which fit into a native machine word are computed directly
+ * with host arithmetic.  Only wider modes use the digit-wise strcalc routines.
+ * Word values are kept sign- or zero-extended according to their mode, which
+ * is exactly the low part of the tarval representation.
+ */
+#ifdef __SIZEOF_INT128__
+__extension__ typedef unsigned __int128 tv_word;
+#else
+typedef uint64_t tv_word;
+#endif
+
+#define TV_WORD_BITS   ((unsigned)(sizeof(tv_word) * CHAR_BIT))
+#define TV_WORD_BYTES  ((unsigned)(TV_WORD_BITS / SC_BITS))
+#define TV_WORD_MSB(x) (((x) >> (TV_WORD_BITS - 1)) != 0)
+
 /** Hash a tarval. */
 static unsigned hash_tv(ir_tarval const *const tv)
 {
-	return hash_combine(hash_ptr(tv->mode), hash_data(tv->value, tv->length));
+	/* integer values are extended to the full length, so only the lower part
+	 * of the value is interesting */
+	size_t const length = get_mode_arithmetic(tv->mode) == irma_twos_complement
+		? MIN(tv->length, TV_WORD_BYTES) : tv->length;
+	return hash_combine(hash_ptr(tv->mode), hash_data(tv->value, length));
 }
 
-static int cmp_tv(const void *p1, const void *p2, size_t n)
+static int cmp_tv(const void *p1, const void *p2)
 {
-	(void)n;
 	ir_tarval const *const tv1 = (ir_tarval const*)p1;
 	ir_tarval const *const tv2 = (ir_tarval const*)p2;
 	if (tv1->mode != tv2->mode)
@@ -70,9 +87,19 @@ static int cmp_tv(const void *p1, const void *p2, size_t n)
 
 static ir_tarval *identify_tarval(ir_tarval const *const tv)
 {
-	unsigned hash = hash_tv(tv);
-	return set_insert(ir_tarval, tarvals, tv, sizeof(ir_tarval) + tv->length,
-	                  hash);
+	unsigned   const hash  = hash_tv(tv);
+	ir_tarval *const found = (ir_tarval*)lfset_find(&tarvals, tv, hash);
+	if (found != NULL)
+		return found;
+
+	size_t     const size = offsetof(ir_tarval, value) + tv->length;
+	ir_tarval *const copy = (ir_tarval*)xmalloc(size);
+	memcpy(copy, tv, size);
+	ir_tarval *const res = (ir_tarval*)lfset_insert(&tarvals, copy, hash);
+	/* another thread may have inserted the same value meanwhile */
+	if (res != copy)
+		free(copy);
+	return res;
 }
 
 static ir_tarval *get_fp_tarval(const fp_value *value, ir_mode *mode)
@@ -127,6 +154,196 @@ static ir_tarval *get_int_tarval_overflow(const sc_word *value, ir_mode *mode)
 	return get_int_tarval(value, mode);
 }
 
+static bool is_word_mode(ir_mode const *const mode)
+{
+	return get_mode_size_bits(mode) <= TV_WORD_BITS;
+}
+
+static tv_word get_tarval_word(ir_tarval const *const tv)
+{
+	tv_word res = 0;
+	for (unsigned i = TV_WORD_BYTES; i-- > 0;) {
+		res = (res << SC_BITS) | tv->value[i];
+	}
+	return res;
+}
+
+/** Sign or zero extends the lower @p bits of @p word to the whole word. */
+static tv_word word_extend(tv_word word, unsigned bits, bool is_signed)
+{
+	if (bits >= TV_WORD_BITS)
+		return word;
+	tv_word const mask = ((tv_word)1 << bits) - 1;
+	word &= mask;
+	if (is_signed && ((word >> (bits - 1)) & 1))
+		word |= ~mask;
+	return word;
+}
+
+/** Returns the magnitude of @p word, @p negative is set to its sign. */
+static tv_word word_abs(tv_word word, bool is_signed, bool *negative)
+{
+	*negative = is_signed && TV_WORD_MSB(word);
+	return *negative ? -word : word;
+}
+
+static ir_tarval *get_word_tarval(tv_word word, ir_mode *mode)
+{
+	assert(get_mode_arithmetic(mode) == irma_twos_complement);
+	assert(is_word_mode(mode));
+	bool const is_signed = mode_is_signed(mode);
+	word = word_extend(word, get_mode_size_bits(mode), is_signed);
+
+	unsigned   const size = sc_value_length * sizeof(sc_word);
+	ir_tarval *const tv   = ALLOCAF(ir_tarval, value, size);
+	tv->kind   = k_tarval;
+	tv->mode   = mode;
+	tv->length = size;
+	unsigned char const ext = is_signed && TV_WORD_MSB(word) ? 0xFF : 0;
+	for (unsigned i = 0; i < TV_WORD_BYTES; ++i) {
+		tv->value[i] = (unsigned char)word;
+		word >>= SC_BITS;
+	}
+	memset(tv->value + TV_WORD_BYTES, ext, size - TV_WORD_BYTES);
+	return identify_tarval(tv);
+}
+
+static ir_tarval *get_word_tarval_overflow(tv_word word, bool overflow,
+                                           ir_mode *mode)
+{
+	if (!wrap_on_overflow && overflow)
+		return tarval_bad;
+	return get_word_tarval(word, mode);
+}
+
+/** Returns true if @p word does not fit into @p mode. */
+static bool word_exceeds_mode(tv_word word, ir_mode const *const mode)
+{
+	return word_extend(word, get_mode_size_bits(mode), mode_is_signed(mode))
+	       != word;
+}
+
+static ir_tarval *word_add(tv_word a, tv_word b, ir_mode *mode)
+{
+	tv_word const res = a + b;
+	bool overflow;
+	if (mode_is_signed(mode)) {
+		overflow = TV_WORD_MSB((a ^ res) & (b ^ res))
+		        || word_exceeds_mode(res, mode);
+	} else {
+		overflow = res < a || word_exceeds_mode(res, mode);
+	}
+	return get_word_tarval_overflow(res, overflow, mode);
+}
+
+static ir_tarval *word_sub(tv_word a, tv_word b, ir_mode *mode)
+{
+	tv_word const res = a - b;
+	bool overflow;
+	if (mode_is_signed(mode)) {
+		overflow = TV_WORD_MSB((a ^ b) & (a ^ res))
+		        || word_exceeds_mode(res, mode);
+	} else {
+		overflow = a < b;
+	}
+	return get_word_tarval_overflow(res, overflow, mode);
+}
+
+static ir_tarval *word_neg(tv_word a, ir_mode *mode)
+{
+	tv_word const res = -a;
+	bool overflow;
+	if (mode_is_signed(mode)) {
+		/* only the most negative word is its own negation */
+		overflow = (TV_WORD_MSB(a) && TV_WORD_MSB(res))
+		        || word_exceeds_mode(res, mode);
+	} else {
+		overflow = a != 0;
+	}
+	return get_word_tarval_overflow(res, overflow, mode);
+}
+
+static ir_tarval *word_mul(tv_word a, tv_word b, ir_mode *mode)
+{
+	bool           neg_a;
+	bool           neg_b;
+	bool     const is_signed = mode_is_signed(mode);
+	tv_word  const abs_a     = word_abs(a, is_signed, &neg_a);
+	tv_word  const abs_b     = word_abs(b, is_signed, &neg_b);
+	tv_word  const abs_res   = abs_a * abs_b;
+	bool     const negative  = neg_a != neg_b;
+	unsigned const half      = TV_WORD_BITS / 2;
+
+	bool overflow = ((abs_a | abs_b) >> half) != 0 && abs_a != 0
+	             && abs_res / abs_a != abs_b;
+	/* the magnitude is exact, check whether it fits into the mode */
+	unsigned const bits = get_mode_size_bits(mode) - is_signed;
+	if (!overflow && bits < TV_WORD_BITS) {
+		tv_word const limit = ((tv_word)1 << bits) - 1 + negative;
+		overflow = abs_res > limit;
+	}
+	tv_word const res = negative ? -abs_res : abs_res;
+	return get_word_tarval_overflow(res, overflow, mode);
+}
+
+/** Truncating division like C, the remainder has the sign of the dividend. */
+static void word_divmod(tv_word a, tv_word b, ir_mode const *const mode,
+                        tv_word *div_res, tv_word *mod_res)
+{
+	bool          neg_a;
+	bool          neg_b;
+	bool    const is_signed = mode_is_signed(mode);
+	tv_word const abs_a     = word_abs(a, is_signed, &neg_a);
+	tv_word const abs_b     = word_abs(b, is_signed, &neg_b);
+	assert(abs_b != 0);
+	tv_word const div = abs_a / abs_b;
+	tv_word const mod = abs_a % abs_b;
+	*div_res = neg_a != neg_b ? -div : div;
+	*mod_res = neg_a ? -mod : mod;
+}
+
+static ir_tarval *word_shl(tv_word a, unsigned count, ir_mode *mode)
+{
+	tv_word const res = count < get_mode_size_bits(mode) ? a << count : 0;
+	return get_word_tarval(res, mode);
+}
+
+static ir_tarval *word_shr(tv_word a, unsigned count, ir_mode *mode)
+{
+	tv_word const val = word_extend(a, get_mode_size_bits(mode), false);
+	tv_word const res = count < TV_WORD_BITS ? val >> count : 0;
+	return get_word_tarval(res, mode);
+}
+
+static ir_tarval *word_shrs(tv_word a, unsigned count, ir_mode *mode)
+{
+	tv_word const val  = word_extend(a, get_mode_size_bits(mode), true);
+	tv_word const sign = TV_WORD_MSB(val) ? ~(tv_word)0 : 0;
+	tv_word const res  = count < TV_WORD_BITS
+		? (val >> count) | (count > 0 ? sign << (TV_WORD_BITS - count) : 0)
+		: sign;
+	return get_word_tarval(res, mode);
+}
+
+/**
+ * Determines the shift amount @p b for a shift in @p mode.  Returns false if
+ * the amount is not a word value, in which case strcalc has to be used.
+ */
+static bool get_word_shift_count(ir_tarval const *const b,
+                                 ir_mode const *const mode, unsigned *count)
+{
+	if (!is_word_mode(b->mode))
+		return false;
+	tv_word word = get_tarval_word(b);
+	if (mode_is_signed(b->mode) && TV_WORD_MSB(word))
+		return false;
+	unsigned const modulo = get_mode_modulo_shift(mode);
+	if (modulo != 0)
+		word %= modulo;
+	*count = word < TV_WORD_BITS ? (unsigned)word : TV_WORD_BITS;
+	return true;
+}
+
 static ir_tarval tarval_bad_obj;
 static ir_tarval tarval_unknown_obj;
 
@@ -208,7 +425,7 @@ ir_tarval *new_tarval_from_str(const char *str, size_t len, ir_mode *mode)
 	case irms_float_number: {
 		fp_value *const buffer = (fp_value*)ALLOCAN(char, fp_value_size);
 		fc_val_from_str(str, len, buffer);
-		fc_cast(buffer, get_descriptor(mode), buffer);
+		fc_cast(buffer, get_descriptor(mode), buffer, FC_TONEAREST);
 		return get_fp_tarval(buffer, mode);
 	}
 	case irms_reference:
@@ -226,6 +443,8 @@ ir_tarval *new_tarval_from_str(const char *str, size_t len, ir_mode *mode)
 ir_tarval *new_tarval_from_long(long l, ir_mode *mode)
 {
 	assert(get_mode_arithmetic(mode) == irma_twos_complement);
+	if (is_word_mode(mode))
+		return get_word_tarval((tv_word)l, mode);
 	sc_word *const buffer = ALLOCAN(sc_word, sc_value_length);
 	sc_val_from_long(l, buffer);
 	return get_int_tarval(buffer, mode);
@@ -343,7 +562,7 @@ ir_tarval *new_tarval_from_long_double(long double d, ir_mode *mode)
 	assert(mode_is_float(mode));
 	fp_value *const buffer = (fp_value*)ALLOCAN(char, fp_value_size);
 	fc_val_from_ieee754(d, buffer);
-	fc_cast(buffer, get_descriptor(mode), buffer);
+	fc_cast(buffer, get_descriptor(mode), buffer, FC_TONEAREST);
 	return get_fp_tarval(buffer, mode);
 }
 
@@ -584,7 +803,8 @@ ir_tarval *tarval_convert_to(ir_tarval const *const src,
 		case irms_float_number: {
 			const float_descriptor_t *desc = get_descriptor(dst_mode);
 			fp_value *const buffer = (fp_value*)ALLOCAN(char, fp_value_size);
-			fc_cast((const fp_value*)src->value, desc, buffer);
+			fc_cast((const fp_value*)src->value, desc, buffer,
+			        FC_TONEAREST);
 			return get_fp_tarval(buffer, dst_mode);
 		}
 
@@ -645,7 +865,7 @@ ir_tarval *tarval_convert_to(ir_tarval const *const src,
 
 			fp_value *fpval = (fp_value*)ALLOCAN(char, fp_value_size);
 			fc_val_from_str(buffer, len, fpval);
-			fc_cast(fpval, get_descriptor(dst_mode), fpval);
+			fc_cast(fpval, get_descriptor(dst_mode), fpval, FC_TONEAREST);
 			return get_fp_tarval(fpval, dst_mode);
 		}
 		case irms_auxiliary:
@@ -699,6 +919,8 @@ ir_tarval *tarval_not(ir_tarval const *const a)
 		return a == tarval_b_true ? tarval_b_false : tarval_b_true;
 
 	assert(get_mode_arithmetic(mode) == irma_twos_complement);
+	if (is_word_mode(mode))
+		return get_word_tarval(~get_tarval_word(a), mode);
 	sc_word *const buffer = ALLOCAN(sc_word, sc_value_length);
 	sc_not(a->value, buffer);
 	return get_int_tarval(buffer, mode);
@@ -710,6 +932,8 @@ ir_tarval *tarval_neg(ir_tarval const *const a)
 	switch (get_mode_sort(mode)) {
 	case irms_int_number:
 	case irms_reference: {
+		if (is_word_mode(mode))
+			return word_neg(get_tarval_word(a), mode);
 		sc_word *const buffer = ALLOCAN(sc_word, sc_value_length);
 		sc_neg(a->value, buffer);
 		return get_int_tarval_overflow(buffer, mode);
@@ -745,6 +969,8 @@ ir_tarval *tarval_add(ir_tarval const *a, ir_tarval const *b)
 	case irms_int_number: {
 		/* modes of a,b are equal, so result has mode of a as this might be the
 		 * character */
+		if (is_word_mode(mode))
+			return word_add(get_tarval_word(a), get_tarval_word(b), mode);
 		sc_word *const buffer = ALLOCAN(sc_word, sc_value_length);
 		sc_add(a->value, b->value, buffer);
 		return get_int_tarval_overflow(buffer, mode);
@@ -752,7 +978,8 @@ ir_tarval *tarval_add(ir_tarval const *a, ir_tarval const *b)
 
 	case irms_float_number: {
 		fp_value *const buffer = (fp_value*)ALLOCAN(char, fp_value_size);
-		fc_add((const fp_value*)a->value, (const fp_value*)b->value, buffer);
+		fc_add((const fp_value*)a->value, (const fp_value*)b->value, buffer,
+		       FC_TONEAREST);
 		return get_fp_tarval(buffer, mode);
 	}
 
@@ -786,6 +1013,8 @@ ir_tarval *tarval_sub(ir_tarval const *a, ir_tarval const *b)
 	case irms_int_number: {
 		/* modes of a,b are equal, so result has mode of a as this might be the
 		 * character */
+		if (is_word_mode(dst_mode))
+			return word_sub(get_tarval_word(a), get_tarval_word(b), dst_mode);
 		sc_word *const buffer = ALLOCAN(sc_word, sc_value_length);
 		sc_sub(a->value, b->value, buffer);
 		return get_int_tarval_overflow(buffer, dst_mode);
@@ -793,7 +1022,8 @@ ir_tarval *tarval_sub(ir_tarval const *a, ir_tarval const *b)
 
 	case irms_float_number: {
 		fp_value *const buffer = (fp_value*)ALLOCAN(char, fp_value_size);
-		fc_sub((const fp_value*)a->value, (const fp_value*)b->value, buffer);
+		fc_sub((const fp_value*)a->value, (const fp_value*)b->value, buffer,
+		       FC_TONEAREST);
 		return get_fp_tarval(buffer, dst_mode);
 	}
 
@@ -814,6 +1044,8 @@ ir_tarval *tarval_mul(ir_tarval const *const a, ir_tarval const *const b)
 	case irms_int_number:
 	case irms_reference: {
 		/* modes of a,b are equal */
+		if (is_word_mode(mode))
+			return word_mul(get_tarval_word(a), get_tarval_word(b), mode);
 		sc_word *const buffer = ALLOCAN(sc_word, sc_value_length);
 		sc_mul(a->value, b->value, buffer);
 		return get_int_tarval_overflow(buffer, mode);
@@ -821,7 +1053,8 @@ ir_tarval *tarval_mul(ir_tarval const *const a, ir_tarval const *const b)
 
 	case irms_float_number: {
 		fp_value *const buffer = (fp_value*)ALLOCAN(char, fp_value_size);
-		fc_mul((const fp_value*)a->value, (const fp_value*)b->value, buffer);
+		fc_mul((const fp_value*)a->value, (const fp_value*)b->value, buffer,
+		       FC_TONEAREST);
 		return get_fp_tarval(buffer, mode);
 	}
 
@@ -845,6 +1078,13 @@ ir_tarval *tarval_div(ir_tarval const *const a, ir_tarval const *const b)
 		if (b == get_mode_null(mode))
 			return tarval_bad;
 
+		if (is_word_mode(mode)) {
+			tv_word div_res;
+			tv_word mod_res;
+			word_divmod(get_tarval_word(a), get_tarval_word(b), mode,
+			            &div_res, &mod_res);
+			return get_word_tarval(div_res, mode);
+		}
 		sc_word *const buffer = ALLOCAN(sc_word, sc_value_length);
 		sc_div(a->value, b->value, buffer);
 		return get_int_tarval(buffer, mode);
@@ -852,7 +1092,8 @@ ir_tarval *tarval_div(ir_tarval const *const a, ir_tarval const *const b)
 
 	case irms_float_number: {
 		fp_value *const buffer = (fp_value*)ALLOCAN(char, fp_value_size);
-		fc_div((const fp_value*)a->value, (const fp_value*)b->value, buffer);
+		fc_div((const fp_value*)a->value, (const fp_value*)b->value, buffer,
+		       FC_TONEAREST);
 		return get_fp_tarval(buffer, mode);
 	}
 
@@ -873,6 +1114,13 @@ ir_tarval *tarval_mod(ir_tarval const *const a, ir_tarval const *const b)
 	/* x/0 error */
 	if (b == get_mode_null(mode))
 		return tarval_bad;
+	if (is_word_mode(mode)) {
+		tv_word div_res;
+		tv_word mod_res;
+		word_divmod(get_tarval_word(a), get_tarval_word(b), mode,
+		            &div_res, &mod_res);
+		return get_word_tarval(mod_res, mode);
+	}
 	sc_word *const buffer = ALLOCAN(sc_word, sc_value_length);
 	sc_mod(a->value, b->value, buffer);
 	return get_int_tarval(buffer, mode);
@@ -885,12 +1133,19 @@ ir_tarval *tarval_divmod(ir_tarval const *const a, ir_tarval const *const b,
 	assert(b->mode == mode);
 	assert(get_mode_arithmetic(mode) == irma_twos_complement);
 
-	sc_word *const div_res = ALLOCAN(sc_word, sc_value_length);
-	sc_word *const mod_res = ALLOCAN(sc_word, sc_value_length);
-
 	/* x/0 error */
 	if (b == get_mode_null(mode))
 		return tarval_bad;
+	if (is_word_mode(mode)) {
+		tv_word div_res;
+		tv_word mod_res;
+		word_divmod(get_tarval_word(a), get_tarval_word(b), mode,
+		            &div_res, &mod_res);
+		*mod = get_word_tarval(mod_res, mode);
+		return get_word_tarval(div_res, mode);
+	}
+	sc_word *const div_res = ALLOCAN(sc_word, sc_value_length);
+	sc_word *const mod_res = ALLOCAN(sc_word, sc_value_length);
 	sc_divmod(a->value, b->value, div_res, mod_res);
 	*mod = get_int_tarval(mod_res, mode);
 	return get_int_tarval(div_res, mode);
@@ -911,6 +1166,8 @@ ir_tarval *tarval_and(ir_tarval const *const a, ir_tarval const *const b)
 		return a == tarval_b_false ? (ir_tarval*)a : (ir_tarval*)b;
 
 	assert(get_mode_arithmetic(mode) == irma_twos_complement);
+	if (is_word_mode(mode))
+		return get_word_tarval(get_tarval_word(a) & get_tarval_word(b), mode);
 	sc_word *const buffer = ALLOCAN(sc_word, sc_value_length);
 	sc_and(a->value, b->value, buffer);
 	return get_int_tarval(buffer, mode);
@@ -924,6 +1181,8 @@ ir_tarval *tarval_andnot(ir_tarval const *const a, ir_tarval const *const b)
 		return a == tarval_b_true && b == tarval_b_false ? tarval_b_true
 		                                                 : tarval_b_false;
 	assert(get_mode_arithmetic(mode) == irma_twos_complement);
+	if (is_word_mode(mode))
+		return get_word_tarval(get_tarval_word(a) & ~ get_tarval_word(b), mode);
 	sc_word *const buffer = ALLOCAN(sc_word, sc_value_length);
 	sc_andnot(a->value, b->value, buffer);
 	return get_int_tarval(buffer, mode);
@@ -937,6 +1196,8 @@ ir_tarval *tarval_or(ir_tarval const *const a, ir_tarval const *const b)
 		return a == tarval_b_true ? (ir_tarval*)a : (ir_tarval*)b;
 
 	assert(get_mode_arithmetic(mode) == irma_twos_complement);
+	if (is_word_mode(mode))
+		return get_word_tarval(get_tarval_word(a) | get_tarval_word(b), mode);
 	sc_word *const buffer = ALLOCAN(sc_word, sc_value_length);
 	sc_or(a->value, b->value, buffer);
 	return get_int_tarval(buffer, mode);
@@ -950,6 +1211,8 @@ ir_tarval *tarval_ornot(ir_tarval const *const a, ir_tarval const *const b)
 		return a == tarval_b_true || b == tarval_b_false ? tarval_b_true
 		                                                 : tarval_b_false;
 	assert(get_mode_arithmetic(mode) == irma_twos_complement);
+	if (is_word_mode(mode))
+		return get_word_tarval(get_tarval_word(a) | ~ get_tarval_word(b), mode);
 	sc_word *const buffer = ALLOCAN(sc_word, sc_value_length);
 	sc_ornot(a->value, b->value, buffer);
 	return get_int_tarval(buffer, mode);
@@ -963,6 +1226,8 @@ ir_tarval *tarval_eor(ir_tarval const *const a, ir_tarval const *const b)
 		return a == b ? tarval_b_false : tarval_b_true;
 
 	assert(get_mode_arithmetic(mode) == irma_twos_complement);
+	if (is_word_mode(mode))
+		return get_word_tarval(get_tarval_word(a) ^ get_tarval_word(b), mode);
 	sc_word *const buffer = ALLOCAN(sc_word, sc_value_length);
 	sc_xor(a->value, b->value, buffer);
 	return get_int_tarval(buffer, mode);
@@ -974,6 +1239,10 @@ ir_tarval *tarval_shl(ir_tarval const *const a, ir_tarval const *const b)
 	assert(get_mode_arithmetic(a_mode) == irma_twos_complement);
 	assert(get_mode_arithmetic(b->mode) == irma_twos_complement);
 
+	unsigned count;
+	if (is_word_mode(a_mode) && get_word_shift_count(b, a_mode, &count))
+		return word_shl(get_tarval_word(a), count, a_mode);
+
 	sc_word *temp_val;
 	if (get_mode_modulo_shift(a_mode) != 0) {
 		temp_val = ALLOCAN(sc_word, sc_value_length);
@@ -997,6 +1266,8 @@ ir_tarval *tarval_shl_unsigned(ir_tarval const *const a, unsigned b)
 	unsigned const modulo = get_mode_modulo_shift(mode);
 	if (modulo != 0)
 		b %= modulo;
+	if (is_word_mode(mode))
+		return word_shl(get_tarval_word(a), MIN(b, TV_WORD_BITS), mode);
 	assert((unsigned)(long)b==b);
 
 	sc_word *const buffer = ALLOCAN(sc_word, sc_value_length);
@@ -1010,6 +1281,10 @@ ir_tarval *tarval_shr(ir_tarval const *const a, ir_tarval const *const b)
 	assert(get_mode_arithmetic(a_mode) == irma_twos_complement);
 	assert(get_mode_arithmetic(b->mode) == irma_twos_complement);
 
+	unsigned count;
+	if (is_word_mode(a_mode) && get_word_shift_count(b, a_mode, &count))
+		return word_shr(get_tarval_word(a), count, a_mode);
+
 	sc_word *temp_val;
 	if (get_mode_modulo_shift(a_mode) != 0) {
 		temp_val = ALLOCAN(sc_word, sc_value_length);
@@ -1036,6 +1311,8 @@ ir_tarval *tarval_shr_unsigned(ir_tarval const *const a, unsigned b)
 	unsigned const modulo = get_mode_modulo_shift(mode);
 	if (modulo != 0)
 		b %= modulo;
+	if (is_word_mode(mode))
+		return word_shr(get_tarval_word(a), MIN(b, TV_WORD_BITS), mode);
 	assert((unsigned)(long)b==b);
 
 	sc_word *const temp = ALLOCAN(sc_word, sc_value_length);
@@ -1052,6 +1329,10 @@ ir_tarval *tarval_shrs(ir_tarval const *const a, ir_tarval const *const b)
 	assert(get_mode_arithmetic(a_mode) == irma_twos_complement);
 	assert(get_mode_arithmetic(b->mode) == irma_twos_complement);
 
+	unsigned count;
+	if (is_word_mode(a_mode) && get_word_shift_count(b, a_mode, &count))
+		return word_shrs(get_tarval_word(a), count, a_mode);
+
 	sc_word *temp_val;
 	if (get_mode_modulo_shift(a_mode) != 0) {
 		temp_val = ALLOCAN(sc_word, sc_value_length);
@@ -1075,6 +1356,8 @@ ir_tarval *tarval_shrs_unsigned(ir_tarval const *const a, unsigned b)
 	unsigned const modulo = get_mode_modulo_shift(mode);
 	if (modulo != 0)
 		b %= modulo;
+	if (is_word_mode(mode))
+		return word_shrs(get_tarval_word(a), MIN(b, TV_WORD_BITS), mode);
 	assert((unsigned)(long)b==b);
 
 	sc_word *const temp = ALLOCAN(sc_word, sc_value_length);
@@ -1273,9 +1556,17 @@ int tarval_ieee754_can_conv_lossless(ir_tarval const *tv, const ir_mode *mode)
 	return fc_can_lossless_conv_to((const fp_value*) tv->value, desc);
 }
 
-unsigned tarval_ieee754_get_exact(void)
+ir_tarval *tarval_ieee754_div(ir_tarval const *const a,
+                              ir_tarval const *const b, int *const exact)
 {
-	return fc_is_exact();
+	ir_mode *const mode = a->mode;
+	assert(mode == b->mode);
+	assert(mode_is_float(mode));
+
+	fp_value *const buffer = (fp_value*)ALLOCAN(char, fp_value_size);
+	*exact = fc_div((const fp_value*)a->value, (const fp_value*)b->value,
+	                buffer, FC_TONEAREST);
+	return get_fp_tarval(buffer, mode);
 }
 
 int tarval_is_nan(ir_tarval const *tv)
@@ -1329,9 +1620,8 @@ static ir_tarval *make_b_tarval(unsigned char const val)
 
 void init_tarval_1(void)
 {
-	/* initialize the sets holding the tarvals with a comparison function and
-	 * an initial size, which is the expected number of constants */
-	tarvals = new_set(cmp_tv, N_CONSTANTS);
+	/* initialize the set holding the tarvals with a comparison function */
+	lfset_init(&tarvals, cmp_tv);
 	/* calls init_strcalc() with needed size */
 	init_fltcalc(128);
 
@@ -1359,7 +1649,7 @@ void init_tarval_2(void)
 void finish_tarval(void)
 {
 	finish_strcalc();
-	del_set(tarvals); tarvals = NULL;
+	lfset_destroy(&tarvals, free);
 }
 
 bool tarval_in_range(ir_tarval const *const min, ir_tarval const *const val, ir_tarval const *const max)
@@ -0,0 +1,86 @@
+/**
+ * Sums up profile files of several runs or processes.
+ * This file is a supplement to libFirm. It is public domain.
+ *
+ * Usage: firmprof-merge -o output input...
+ *
+ * The output may also be one of the inputs. Functions are matched by name;
+ * counts of a function whose checksum differs from the one in the first
+ * input containing it are dropped with a warning.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "profile_file.h"
+
+static int read_profile(const char *filename, firmprof_t *profile)
+{
+	FILE *f = fopen(filename, "rb");
+	int   res;
+
+	if (f == NULL) {
+		perror(filename);
+		return -1;
+	}
+	res = __firmprof_read(f, profile);
+	fclose(f);
+	if (res != 0)
+		fprintf(stderr, "%s: not a profile of version %d\n", filename,
+		        FIRMPROF_VERSION);
+	return res;
+}
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr, "Usage: %s -o output input...\n", argv0);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	const char *output = NULL;
+	firmprof_t  result;
+	firmprof_t  profile;
+	FILE       *f;
+	int         i, first = 1, skipped;
+
+	for (i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+			output = argv[++i];
+		} else if (argv[i][0] == '-') {
+			usage(argv[0]);
+		} else {
+			if (read_profile(argv[i], first ? &result : &profile) != 0)
+				return 1;
+			if (first) {
+				first = 0;
+				continue;
+			}
+			skipped = __firmprof_merge(&result, &profile, 1);
+			__firmprof_free(&profile);
+			if (skipped < 0) {
+				fprintf(stderr, "%s: profile of a different kind\n", argv[i]);
+				return 1;
+			}
+			if (skipped > 0)
+				fprintf(stderr, "%s: warning: skipped %d functions with "
+				        "a different control flow graph\n", argv[i], skipped);
+		}
+	}
+	if (output == NULL || first)
+		usage(argv[0]);
+
+	f = fopen(output, "wb");
+	if (f == NULL) {
+		perror(output);
+		return 1;
+	}
+	__firmprof_write(f, &result);
+	if (fclose(f) != 0) {
+		perror(output);
+		return 1;
+	}
+	__firmprof_free(&result);
+	return 0;
+}
@@ -5,15 +5,55 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define HAVE_POSIX
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#include "profile_file.h"
 
 /* Prevent the compiler from mangling the name of this function. */
 void __init_firmprof(const char*, unsigned int*, size_t)
      asm("__init_firmprof");
+void __init_firmprof_edges(const char*, unsigned long long*, size_t)
+     asm("__init_firmprof_edges");
+void __init_firmprof2(const char*, unsigned, void*, unsigned, const char**,
+                      const unsigned*, const unsigned*, unsigned)
+     asm("__init_firmprof2");
+void __init_firmprof_values(const char*, void**, unsigned int*, unsigned int,
+                            void**, const char**, unsigned int)
+     asm("__init_firmprof_values");
+void __firmprof_value(void**, unsigned int*, void*)
+     asm("__firmprof_value");
+void __firmprof_value_int(void**, unsigned int*, size_t)
+     asm("__firmprof_value_int");
+
+typedef struct _profile_values_t {
+	void       **targets;     /**< FIRMPROF_VALUE_SLOTS values per site */
+	unsigned    *counts;      /**< FIRMPROF_VALUE_SLOTS counts + total per site */
+	unsigned     n_sites;
+	void       **functions;   /**< addresses of the functions and labels of
+	                               the unit */
+	const char **names;       /**< names of the functions and labels */
+	unsigned     n_functions;
+} profile_values_t;
 
 typedef struct _profile_counter_t {
-	const char *filename;
-	unsigned   *counters;
-	unsigned    len;
+	const char         *filename;
+	unsigned           *counters;
+	unsigned long long *edge_counters; /**< 64-bit counters of edge profiles */
+	unsigned            len;
+	profile_values_t *values;
+	const char        **names;         /**< function names, NULL for the
+	                                        unversioned format */
+	const unsigned     *checksums;     /**< checksums of the functions */
+	const unsigned     *lengths;       /**< counters of the functions */
+	unsigned            n_functions;
 	struct _profile_counter_t *next;
 } profile_counter_t;
 
@@ -41,31 +81,261 @@ void write_little_endian(unsigned *counter, unsigned len, FILE *f)
 	}
 }
 
+/**
+ * Write 64-bit counter values as low and high 32-bit halves, which yields
+ * 64-bit little endian values.
+ */
+static void write_little_endian64(unsigned long long *counter, unsigned len,
+                                  FILE *f)
+{
+	unsigned i;
+
+	for (i = 0; i < len; ++i) {
+		unsigned half[2];
+		half[0] = (unsigned)(counter[i] & 0xffffffffu);
+		half[1] = (unsigned)(counter[i] >> 32);
+		write_little_endian(half, 2, f);
+	}
+}
+
+/**
+ * Returns the name of the function or label recorded in @p slot of value
+ * profiling site @p site, or an empty string if the value is not a function
+ * or label of the unit.
+ */
+static const char *get_value_name(profile_values_t *values, unsigned site,
+                                  unsigned slot)
+{
+	void    **targets = &values->targets[site * FIRMPROF_VALUE_SLOTS];
+	unsigned *counts  = &values->counts[site * (FIRMPROF_VALUE_SLOTS + 1)];
+	unsigned  j;
+
+	if (counts[slot] != 0) {
+		for (j = 0; j < values->n_functions; ++j) {
+			if (values->functions[j] == targets[slot])
+				return values->names[j];
+		}
+	}
+	return "";
+}
+
+/**
+ * Write the value profiles.  Every site is written as its total count
+ * followed by FIRMPROF_VALUE_SLOTS pairs of count and function name, where
+ * the name is a 32-bit length followed by the characters.  Values that are
+ * not a function of the unit get an empty name.
+ */
+static void write_values(profile_values_t *values, FILE *f)
+{
+	unsigned i, s;
+
+	fputs("firmvals", f);
+	write_little_endian(&values->n_sites, 1, f);
+	for (i = 0; i < values->n_sites; ++i) {
+		unsigned *counts = &values->counts[i * (FIRMPROF_VALUE_SLOTS + 1)];
+
+		write_little_endian(&counts[FIRMPROF_VALUE_SLOTS], 1, f);
+		for (s = 0; s < FIRMPROF_VALUE_SLOTS; ++s) {
+			const char *name = get_value_name(values, i, s);
+			unsigned    len  = strlen(name);
+			write_little_endian(&counts[s], 1, f);
+			write_little_endian(&len, 1, f);
+			fwrite(name, 1, len, f);
+		}
+	}
+}
+
+/**
+ * Converts the counters of a unit registered with __init_firmprof2() into a
+ * profile. Returns 0 on success, -1 if out of memory.
+ */
+static int build_profile(profile_counter_t *counter, firmprof_t *profile)
+{
+	profile_values_t *values = counter->values;
+	unsigned          i, s;
+
+	memset(profile, 0, sizeof(*profile));
+	profile->kind = counter->edge_counters != NULL ? FIRMPROF_EDGES
+	                                               : FIRMPROF_BLOCKS;
+	for (i = 0; i < counter->n_functions; ++i) {
+		if (__firmprof_add_function(profile, counter->names[i],
+		                            counter->checksums[i],
+		                            counter->lengths[i]) != 0)
+			return -1;
+	}
+	if (profile->n_counters != counter->len)
+		return -1;
+	for (i = 0; i < counter->len; ++i) {
+		profile->counters[i] = counter->edge_counters != NULL
+			? counter->edge_counters[i] : counter->counters[i];
+	}
+
+	if (values == NULL)
+		return 0;
+	profile->sites = (firmprof_site_t*)
+		calloc(values->n_sites + 1, sizeof(*profile->sites));
+	if (profile->sites == NULL)
+		return -1;
+	profile->n_sites = values->n_sites;
+	for (i = 0; i < values->n_sites; ++i) {
+		firmprof_site_t *site   = &profile->sites[i];
+		unsigned        *counts = &values->counts[i * (FIRMPROF_VALUE_SLOTS + 1)];
+
+		site->total = counts[FIRMPROF_VALUE_SLOTS];
+		for (s = 0; s < FIRMPROF_VALUE_SLOTS; ++s) {
+			const char *name = get_value_name(values, i, s);
+			site->counts[s] = counts[s];
+			site->values[s] = (size_t) values->targets[i * FIRMPROF_VALUE_SLOTS + s];
+			site->names[s]  = (char*) malloc(strlen(name) + 1);
+			if (site->names[s] == NULL)
+				return -1;
+			strcpy(site->names[s], name);
+		}
+	}
+	return 0;
+}
+
+/**
+ * Adds the counts of a unit registered with __init_firmprof2() to its
+ * profile file. The file is locked while it is updated, so concurrently
+ * exiting processes accumulate their counts instead of overwriting each
+ * other. Functions whose checksum changed since the file was written start
+ * from zero.
+ */
+static void write_profile2(profile_counter_t *counter)
+{
+	firmprof_t profile;
+	firmprof_t old;
+	FILE      *f;
+
+	if (build_profile(counter, &profile) != 0) {
+		fputs("Warning: out of memory while writing profiling data\n",
+		      stderr);
+		__firmprof_free(&profile);
+		return;
+	}
+
+#ifdef HAVE_POSIX
+	{
+		struct flock lock;
+		int          fd = open(counter->filename, O_RDWR | O_CREAT, 0666);
+
+		f = fd >= 0 ? fdopen(fd, "r+b") : NULL;
+		if (f == NULL) {
+			if (fd >= 0)
+				close(fd);
+			perror("Warning: couldn't open file for writing profiling data");
+			__firmprof_free(&profile);
+			return;
+		}
+
+		memset(&lock, 0, sizeof(lock));
+		lock.l_type   = F_WRLCK;
+		lock.l_whence = SEEK_SET;
+		/* without locking support concurrent updates may get lost */
+		while (fcntl(fd, F_SETLKW, &lock) != 0 && errno == EINTR) {
+		}
+
+		if (__firmprof_read(f, &old) == 0) {
+			__firmprof_merge(&profile, &old, 0);
+			__firmprof_free(&old);
+		}
+		rewind(f);
+		__firmprof_write(f, &profile);
+		fflush(f);
+		if (ftruncate(fd, ftell(f)) != 0)
+			perror("Warning: couldn't truncate profiling data");
+	}
+#else
+	f = fopen(counter->filename, "r+b");
+	if (f != NULL) {
+		if (__firmprof_read(f, &old) == 0) {
+			__firmprof_merge(&profile, &old, 0);
+			__firmprof_free(&old);
+		}
+		fclose(f);
+	}
+	f = fopen(counter->filename, "wb");
+	if (f == NULL) {
+		perror("Warning: couldn't open file for writing profiling data");
+		__firmprof_free(&profile);
+		return;
+	}
+	__firmprof_write(f, &profile);
+#endif
+	fclose(f);
+	__firmprof_free(&profile);
+}
+
+/**
+ * Write the counters of a unit registered with __init_firmprof() or
+ * __init_firmprof_edges(), replacing the profile file.
+ */
+static void write_profile1(profile_counter_t *counter)
+{
+	FILE *f = fopen(counter->filename, "wb");
+	if (f == NULL) {
+		perror("Warning: couldn't open file for writing profiling data");
+		return;
+	}
+	if (counter->edge_counters != NULL) {
+		fputs("firmedge", f);
+		write_little_endian64(counter->edge_counters, counter->len, f);
+	} else {
+		fputs("firmprof", f);
+		write_little_endian(counter->counters, counter->len, f);
+	}
+	if (counter->values != NULL)
+		write_values(counter->values, f);
+	fclose(f);
+}
+
 static void write_profiles(void)
 {
 	profile_counter_t *counter = counters;
 	while (counter != NULL) {
 		profile_counter_t *next = counter->next;
-		FILE *f = fopen(counter->filename, "wb");
-		if (f == NULL) {
-			perror("Warning: couldn't open file for writing profiling data");
-		} else {
-			fputs("firmprof", f);
-			write_little_endian(counter->counters, counter->len, f);
-			fclose(f);
-		}
+		if (counter->names != NULL)
+			write_profile2(counter);
+		else
+			write_profile1(counter);
+		free(counter->values);
 		free(counter);
 		counter = next;
 	}
+	counters = NULL;
 }
 
+#ifdef HAVE_POSIX
 /**
- * Register a new profile counter. This is called by separate constructors
- * for each translation unit. Incidentally, referring to this function as
- * "__init_firmprof" is perfectly linker friendly.
+ * A forked child starts counting from zero, the counts collected so far are
+ * written by the parent.
  */
-void __init_firmprof(const char *filename,
-                      unsigned int *counts, size_t len)
+static void reset_counters(void)
+{
+	profile_counter_t *counter;
+
+	for (counter = counters; counter != NULL; counter = counter->next) {
+		profile_values_t *values = counter->values;
+		if (counter->edge_counters != NULL) {
+			memset(counter->edge_counters, 0,
+			       counter->len * sizeof(*counter->edge_counters));
+		} else {
+			memset(counter->counters, 0,
+			       counter->len * sizeof(*counter->counters));
+		}
+		if (values != NULL) {
+			memset(values->counts, 0, values->n_sites
+			       * (FIRMPROF_VALUE_SLOTS + 1) * sizeof(*values->counts));
+		}
+	}
+}
+#endif
+
+static profile_counter_t *register_counters(const char *filename,
+                                            unsigned int *counts,
+                                            unsigned long long *edge_counts,
+                                            size_t len)
 {
 	static int initialized = 0;
 	profile_counter_t *counter;
@@ -73,16 +343,138 @@ void __init_firmprof(const char *filename,
 	if (!initialized) {
 		initialized = 1;
 		atexit(write_profiles);
+#ifdef HAVE_POSIX
+		pthread_atfork(NULL, NULL, reset_counters);
+#endif
 	}
 
 	counter = (profile_counter_t*) malloc(sizeof(*counter));
 	if (counter == NULL)
-		return;
+		return NULL;
 
-	counter->filename = filename;
-	counter->counters = counts;
-	counter->next     = counters;
-	counter->len      = len;
+	counter->filename      = filename;
+	counter->counters      = counts;
+	counter->edge_counters = edge_counts;
+	counter->next          = counters;
+	counter->len           = len;
+	counter->values        = NULL;
+	counter->names         = NULL;
+	counter->checksums     = NULL;
+	counter->lengths       = NULL;
+	counter->n_functions   = 0;
 
 	counters = counter;
+	return counter;
+}
+
+/**
+ * Register a new profile counter. This is called by separate constructors
+ * for each translation unit. Incidentally, referring to this function as
+ * "__init_firmprof" is perfectly linker friendly.
+ */
+void __init_firmprof(const char *filename,
+                      unsigned int *counts, size_t len)
+{
+	register_counters(filename, counts, NULL, len);
+}
+
+/**
+ * Register the 64-bit edge counters of a translation unit instrumented for
+ * edge profiling. The profile gets the header "firmedge" instead of
+ * "firmprof".
+ */
+void __init_firmprof_edges(const char *filename,
+                           unsigned long long *counts, size_t len)
+{
+	register_counters(filename, NULL, counts, len);
+}
+
+/**
+ * Register the counters of a translation unit together with its function
+ * table. The counters are 32-bit block counters or 64-bit edge counters
+ * depending on @p kind, the counters of function i follow those of the
+ * functions before it and number lengths[i]. At exit the counts are added
+ * to those already in the profile file.
+ */
+void __init_firmprof2(const char *filename, unsigned kind, void *counts,
+                      unsigned len, const char **names,
+                      const unsigned *checksums, const unsigned *lengths,
+                      unsigned n_functions)
+{
+	profile_counter_t *counter = kind == FIRMPROF_EDGES
+		? register_counters(filename, NULL, (unsigned long long*) counts, len)
+		: register_counters(filename, (unsigned*) counts, NULL, len);
+
+	if (counter == NULL)
+		return;
+	counter->names       = names;
+	counter->checksums   = checksums;
+	counter->lengths     = lengths;
+	counter->n_functions = n_functions;
+}
+
+/**
+ * Register the value profiling sites of a translation unit. This is called
+ * by the constructor of the unit right after __init_firmprof(),
+ * __init_firmprof_edges() or __init_firmprof2() and attaches
+ * the sites to the counters registered there.
+ */
+void __init_firmprof_values(const char *filename, void **targets,
+                            unsigned int *counts, unsigned int n_sites,
+                            void **functions, const char **names,
+                            unsigned int n_functions)
+{
+	profile_values_t *values;
+
+	if (counters == NULL || strcmp(counters->filename, filename) != 0)
+		return;
+
+	values = (profile_values_t*) malloc(sizeof(*values));
+	if (values == NULL)
+		return;
+
+	values->targets     = targets;
+	values->counts      = counts;
+	values->n_sites     = n_sites;
+	values->functions   = functions;
+	values->names       = names;
+	values->n_functions = n_functions;
+
+	counters->values = values;
+}
+
+/**
+ * Record @p value at a value profiling site. The most frequent values are
+ * kept in a small table; a value missing from a full table decrements the
+ * least frequent entry so that a dominating value eventually displaces it.
+ */
+void __firmprof_value(void **targets, unsigned int *counts, void *value)
+{
+	unsigned i, min = 0;
+
+	++counts[FIRMPROF_VALUE_SLOTS];
+	for (i = 0; i < FIRMPROF_VALUE_SLOTS; ++i) {
+		if (counts[i] != 0 && targets[i] == value) {
+			++counts[i];
+			return;
+		}
+		if (counts[i] < counts[min])
+			min = i;
+	}
+
+	if (counts[min] == 0) {
+		targets[min] = value;
+		counts[min]  = 1;
+	} else {
+		--counts[min];
+	}
+}
+
+/**
+ * Record the integer @p value at a value profiling site, see
+ * __firmprof_value().
+ */
+void __firmprof_value_int(void **targets, unsigned int *counts, size_t value)
+{
+	__firmprof_value(targets, counts, (void*) value);
 }
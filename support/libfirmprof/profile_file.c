@@ -0,0 +1,374 @@
+/**
+ * Reading, writing and merging of profile files.
+ * This file is a supplement to libFirm. It is public domain.
+ */
+#include "profile_file.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static void write_u32(unsigned v, FILE *f)
+{
+	unsigned char bytes[4];
+
+	bytes[0] = ((v >>  0) & 0xff);
+	bytes[1] = ((v >>  8) & 0xff);
+	bytes[2] = ((v >> 16) & 0xff);
+	bytes[3] = ((v >> 24) & 0xff);
+
+	fwrite(bytes, 1, 4, f);
+}
+
+static int read_u32(FILE *f, unsigned *v)
+{
+	unsigned char bytes[4];
+
+	if (fread(bytes, 1, 4, f) != 4)
+		return -1;
+	*v = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16)
+	   | ((unsigned)bytes[3] << 24);
+	return 0;
+}
+
+static void write_u64(unsigned long long v, FILE *f)
+{
+	write_u32((unsigned)(v & 0xffffffffu), f);
+	write_u32((unsigned)(v >> 32), f);
+}
+
+static int read_u64(FILE *f, unsigned long long *v)
+{
+	unsigned lo, hi;
+
+	if (read_u32(f, &lo) != 0 || read_u32(f, &hi) != 0)
+		return -1;
+	*v = (unsigned long long)hi << 32 | lo;
+	return 0;
+}
+
+static void write_string(const char *s, FILE *f)
+{
+	unsigned len = strlen(s);
+
+	write_u32(len, f);
+	fwrite(s, 1, len, f);
+}
+
+static char *read_string(FILE *f)
+{
+	unsigned len;
+	char    *s;
+
+	if (read_u32(f, &len) != 0 || len > 0xffff)
+		return NULL;
+	s = (char*) malloc(len + 1);
+	if (s == NULL)
+		return NULL;
+	if (fread(s, 1, len, f) != len) {
+		free(s);
+		return NULL;
+	}
+	s[len] = '\0';
+	return s;
+}
+
+static char *copy_string(const char *s)
+{
+	size_t len  = strlen(s) + 1;
+	char  *copy = (char*) malloc(len);
+
+	if (copy != NULL)
+		memcpy(copy, s, len);
+	return copy;
+}
+
+/** Adds counts, saturating at the maximum. */
+static unsigned add_count(unsigned a, unsigned b)
+{
+	return a + b < a ? ~0u : a + b;
+}
+
+int __firmprof_add_function(firmprof_t *profile, const char *name,
+                            unsigned checksum, unsigned n_counters)
+{
+	unsigned             n = profile->n_functions;
+	firmprof_function_t *functions;
+	unsigned long long  *counters;
+	char                *copy;
+
+	functions = (firmprof_function_t*)
+		realloc(profile->functions, (n + 1) * sizeof(*functions));
+	if (functions == NULL)
+		return -1;
+	profile->functions = functions;
+
+	counters = (unsigned long long*) realloc(profile->counters,
+		(profile->n_counters + n_counters + 1) * sizeof(*counters));
+	if (counters == NULL)
+		return -1;
+	profile->counters = counters;
+
+	copy = copy_string(name);
+	if (copy == NULL)
+		return -1;
+
+	functions[n].name       = copy;
+	functions[n].checksum   = checksum;
+	functions[n].first      = profile->n_counters;
+	functions[n].n_counters = n_counters;
+	memset(&counters[profile->n_counters], 0, n_counters * sizeof(*counters));
+	profile->n_counters  += n_counters;
+	profile->n_functions  = n + 1;
+	return 0;
+}
+
+static int read_sites(FILE *f, firmprof_t *profile)
+{
+	char     buf[8];
+	unsigned i, s;
+
+	if (fread(buf, 1, 8, f) != 8 || memcmp(buf, "firmvals", 8) != 0)
+		return 0;
+	if (read_u32(f, &profile->n_sites) != 0)
+		return -1;
+
+	profile->sites = (firmprof_site_t*)
+		calloc(profile->n_sites + 1, sizeof(*profile->sites));
+	if (profile->sites == NULL)
+		return -1;
+	for (i = 0; i < profile->n_sites; ++i) {
+		firmprof_site_t *site = &profile->sites[i];
+		if (read_u32(f, &site->total) != 0)
+			return -1;
+		for (s = 0; s < FIRMPROF_VALUE_SLOTS; ++s) {
+			if (read_u32(f, &site->counts[s]) != 0
+			    || read_u64(f, &site->values[s]) != 0)
+				return -1;
+			site->names[s] = read_string(f);
+			if (site->names[s] == NULL)
+				return -1;
+		}
+	}
+	return 0;
+}
+
+int __firmprof_read(FILE *f, firmprof_t *profile)
+{
+	char     buf[8];
+	unsigned version, n_functions, i;
+
+	memset(profile, 0, sizeof(*profile));
+	if (fread(buf, 1, 8, f) != 8 || memcmp(buf, "firmdata", 8) != 0
+	    || read_u32(f, &version) != 0 || version != FIRMPROF_VERSION
+	    || read_u32(f, &profile->kind) != 0
+	    || read_u32(f, &n_functions) != 0)
+		return -1;
+
+	for (i = 0; i < n_functions; ++i) {
+		unsigned checksum, n_counters;
+		char    *name;
+		int      res;
+		if (read_u32(f, &checksum) != 0 || read_u32(f, &n_counters) != 0)
+			goto error;
+		name = read_string(f);
+		if (name == NULL)
+			goto error;
+		res = __firmprof_add_function(profile, name, checksum, n_counters);
+		free(name);
+		if (res != 0)
+			goto error;
+	}
+
+	for (i = 0; i < profile->n_counters; ++i) {
+		if (read_u64(f, &profile->counters[i]) != 0)
+			goto error;
+	}
+
+	if (read_sites(f, profile) != 0)
+		goto error;
+	return 0;
+
+error:
+	__firmprof_free(profile);
+	return -1;
+}
+
+void __firmprof_write(FILE *f, const firmprof_t *profile)
+{
+	unsigned i, s;
+
+	fputs("firmdata", f);
+	write_u32(FIRMPROF_VERSION, f);
+	write_u32(profile->kind, f);
+	write_u32(profile->n_functions, f);
+	for (i = 0; i < profile->n_functions; ++i) {
+		const firmprof_function_t *function = &profile->functions[i];
+		write_u32(function->checksum, f);
+		write_u32(function->n_counters, f);
+		write_string(function->name, f);
+	}
+	for (i = 0; i < profile->n_functions; ++i) {
+		const firmprof_function_t *function = &profile->functions[i];
+		const unsigned long long  *counters = &profile->counters[function->first];
+		for (s = 0; s < function->n_counters; ++s)
+			write_u64(counters[s], f);
+	}
+
+	if (profile->sites == NULL)
+		return;
+	fputs("firmvals", f);
+	write_u32(profile->n_sites, f);
+	for (i = 0; i < profile->n_sites; ++i) {
+		const firmprof_site_t *site = &profile->sites[i];
+		write_u32(site->total, f);
+		for (s = 0; s < FIRMPROF_VALUE_SLOTS; ++s) {
+			write_u32(site->counts[s], f);
+			write_u64(site->values[s], f);
+			write_string(site->names[s] != NULL ? site->names[s] : "", f);
+		}
+	}
+}
+
+static firmprof_function_t *find_function(const firmprof_t *profile,
+                                          const char *name)
+{
+	unsigned i;
+
+	for (i = 0; i < profile->n_functions; ++i) {
+		if (strcmp(profile->functions[i].name, name) == 0)
+			return &profile->functions[i];
+	}
+	return NULL;
+}
+
+/**
+ * Merges the values of two sites and keeps the most frequent ones. Values
+ * with a name are matched by name, others by value.
+ */
+static void merge_site(firmprof_site_t *into, const firmprof_site_t *from)
+{
+	unsigned            counts[2 * FIRMPROF_VALUE_SLOTS];
+	unsigned long long  values[2 * FIRMPROF_VALUE_SLOTS];
+	char               *names[2 * FIRMPROF_VALUE_SLOTS];
+	unsigned            n = 0, i, s;
+
+	for (s = 0; s < FIRMPROF_VALUE_SLOTS; ++s) {
+		counts[n]  = into->counts[s];
+		values[n]  = into->values[s];
+		names[n++] = into->names[s];
+		into->names[s] = NULL;
+	}
+	for (s = 0; s < FIRMPROF_VALUE_SLOTS; ++s) {
+		const char *name = from->names[s];
+		if (from->counts[s] == 0)
+			continue;
+		for (i = 0; i < FIRMPROF_VALUE_SLOTS; ++i) {
+			if (counts[i] == 0 || names[i] == NULL)
+				continue;
+			if (name[0] != '\0' ? strcmp(names[i], name) == 0
+			                    : names[i][0] == '\0' && values[i] == from->values[s])
+				break;
+		}
+		if (i < FIRMPROF_VALUE_SLOTS) {
+			counts[i] = add_count(counts[i], from->counts[s]);
+		} else {
+			counts[n]  = from->counts[s];
+			values[n]  = from->values[s];
+			names[n++] = copy_string(name);
+		}
+	}
+
+	into->total = add_count(into->total, from->total);
+	for (s = 0; s < FIRMPROF_VALUE_SLOTS; ++s) {
+		unsigned max = 0;
+		for (i = 1; i < n; ++i) {
+			if (names[i] != NULL && (names[max] == NULL || counts[i] > counts[max]))
+				max = i;
+		}
+		into->counts[s] = names[max] != NULL ? counts[max] : 0;
+		into->values[s] = values[max];
+		into->names[s]  = names[max];
+		names[max]      = NULL;
+	}
+	for (i = 0; i < n; ++i)
+		free(names[i]);
+}
+
+static int copy_sites(firmprof_t *into, const firmprof_t *from)
+{
+	unsigned i, s;
+
+	into->sites = (firmprof_site_t*)
+		calloc(from->n_sites + 1, sizeof(*into->sites));
+	if (into->sites == NULL)
+		return -1;
+	into->n_sites = from->n_sites;
+	for (i = 0; i < from->n_sites; ++i) {
+		into->sites[i].total = from->sites[i].total;
+		for (s = 0; s < FIRMPROF_VALUE_SLOTS; ++s) {
+			into->sites[i].counts[s] = from->sites[i].counts[s];
+			into->sites[i].values[s] = from->sites[i].values[s];
+			into->sites[i].names[s]  = copy_string(from->sites[i].names[s]);
+		}
+	}
+	return 0;
+}
+
+int __firmprof_merge(firmprof_t *into, const firmprof_t *from,
+                     int add_missing)
+{
+	int      skipped = 0;
+	unsigned i, c;
+
+	if (into->kind != from->kind)
+		return -1;
+
+	for (i = 0; i < from->n_functions; ++i) {
+		const firmprof_function_t *function = &from->functions[i];
+		firmprof_function_t       *match    = find_function(into, function->name);
+		if (match == NULL) {
+			if (!add_missing || __firmprof_add_function(into,
+			        function->name, function->checksum,
+			        function->n_counters) != 0) {
+				++skipped;
+				continue;
+			}
+			match = &into->functions[into->n_functions - 1];
+		} else if (match->checksum != function->checksum
+		           || match->n_counters != function->n_counters) {
+			++skipped;
+			continue;
+		}
+		for (c = 0; c < function->n_counters; ++c)
+			into->counters[match->first + c] += from->counters[function->first + c];
+	}
+
+	if (from->sites != NULL) {
+		if (into->sites == NULL) {
+			if (add_missing)
+				copy_sites(into, from);
+		} else if (into->n_sites == from->n_sites) {
+			for (i = 0; i < from->n_sites; ++i)
+				merge_site(&into->sites[i], &from->sites[i]);
+		}
+	}
+	return skipped;
+}
+
+void __firmprof_free(firmprof_t *profile)
+{
+	unsigned i, s;
+
+	for (i = 0; i < profile->n_functions; ++i)
+		free(profile->functions[i].name);
+	free(profile->functions);
+	free(profile->counters);
+	if (profile->sites != NULL) {
+		for (i = 0; i < profile->n_sites; ++i) {
+			for (s = 0; s < FIRMPROF_VALUE_SLOTS; ++s)
+				free(profile->sites[i].names[s]);
+		}
+		free(profile->sites);
+	}
+	memset(profile, 0, sizeof(*profile));
+}
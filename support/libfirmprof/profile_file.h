@@ -0,0 +1,94 @@
+/**
+ * Reading, writing and merging of profile files.
+ * This file is a supplement to libFirm. It is public domain.
+ *
+ * A profile file starts with the magic "firmdata" and a 32-bit version
+ * followed by the kind of counters, the function table and the counters:
+ *
+ *   "firmdata" version kind n_functions
+ *   n_functions * (checksum n_counters name_length name)
+ *   sum(n_counters) * 64-bit counter
+ *
+ * The counters of a function are only meaningful for the control flow graph
+ * described by its checksum.  A value profile may follow:
+ *
+ *   "firmvals" n_sites
+ *   n_sites * (total FIRMPROF_VALUE_SLOTS * (count 64-bit value
+ *              name_length name))
+ *
+ * Values which are functions or labels of the unit are identified by name,
+ * the name of other values is empty.  All numbers are little endian and 32
+ * bits wide unless noted otherwise.
+ */
+#ifndef FIRMPROF_PROFILE_FILE_H
+#define FIRMPROF_PROFILE_FILE_H
+
+#include <stdio.h>
+
+/** Number of distinct values recorded per value profiling site. */
+#define FIRMPROF_VALUE_SLOTS 4
+
+/** Version of the profile file format. */
+#define FIRMPROF_VERSION 3
+
+/** Kinds of counters. */
+enum {
+	FIRMPROF_BLOCKS = 0, /**< a counter per basic block */
+	FIRMPROF_EDGES  = 1, /**< counters on control flow edges */
+};
+
+typedef struct firmprof_function_t {
+	char     *name;       /**< linker name */
+	unsigned  checksum;   /**< checksum of the control flow graph */
+	unsigned  first;      /**< index of the first counter */
+	unsigned  n_counters; /**< number of counters */
+} firmprof_function_t;
+
+typedef struct firmprof_site_t {
+	unsigned            total;                        /**< executions of the site */
+	unsigned            counts[FIRMPROF_VALUE_SLOTS]; /**< counts of the values */
+	unsigned long long  values[FIRMPROF_VALUE_SLOTS]; /**< the values */
+	char               *names[FIRMPROF_VALUE_SLOTS];  /**< names of the values */
+} firmprof_site_t;
+
+typedef struct firmprof_t {
+	unsigned             kind;
+	unsigned             n_functions;
+	firmprof_function_t *functions;
+	unsigned             n_counters;
+	unsigned long long  *counters;
+	unsigned             n_sites;
+	firmprof_site_t     *sites;       /**< NULL without value profile */
+} firmprof_t;
+
+/**
+ * Reads a profile. Returns 0 on success, -1 if the file does not contain
+ * a profile of this version.
+ */
+int __firmprof_read(FILE *f, firmprof_t *profile);
+
+/** Writes a profile. */
+void __firmprof_write(FILE *f, const firmprof_t *profile);
+
+/**
+ * Appends a function with zeroed counters to a profile. Returns 0 on
+ * success, -1 if out of memory.
+ */
+int __firmprof_add_function(firmprof_t *profile, const char *name,
+                            unsigned checksum, unsigned n_counters);
+
+/**
+ * Adds the counts of @p from to @p into. Functions are matched by name;
+ * functions whose checksum or number of counters differ are skipped, and
+ * functions missing in @p into are added if @p add_missing is set. Value
+ * profiles are merged if they have the same number of sites, keeping the
+ * most frequent values of each site; values without a name are matched by
+ * value. Returns the number of skipped functions, or -1 if the kinds of the profiles differ.
+ */
+int __firmprof_merge(firmprof_t *into, const firmprof_t *from,
+                     int add_missing);
+
+/** Frees the contents of a profile. */
+void __firmprof_free(firmprof_t *profile);
+
+#endif
@@ -0,0 +1,198 @@
+/**
+ * Per-thread counters for profiling multi-threaded programs.
+ * This file is a supplement to libFirm. It is public domain.
+ *
+ * Code instrumented for threads asks __firmprof_shard() for the counters of
+ * the calling thread at each function entry and increments those without
+ * synchronization. Every thread gets its own copy (shard) of the counters of
+ * a unit on first use. The shards are kept when their thread finishes and
+ * added to the counters of the unit at exit. Value profiles are shared by
+ * all threads and therefore only approximate.
+ */
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "profile_file.h"
+
+/* Prevent the compiler from mangling the name of this function. */
+void __init_firmprof2(const char*, unsigned, void*, unsigned, const char**,
+                      const unsigned*, const unsigned*, unsigned)
+     asm("__init_firmprof2");
+void __init_firmprof_threads(const char*, unsigned, void*, unsigned,
+                             const char**, const unsigned*, const unsigned*,
+                             unsigned, unsigned*)
+     asm("__init_firmprof_threads");
+void *__firmprof_shard(unsigned*, void*)
+     asm("__firmprof_shard");
+
+typedef struct _shard_t {
+	void            *counters;
+	struct _shard_t *next;
+} shard_t;
+
+typedef struct _unit_t {
+	void     *counters; /**< the counters of the unit, receive the sum */
+	unsigned  kind;
+	unsigned  len;
+	shard_t  *shards;
+} unit_t;
+
+static pthread_mutex_t lock    = PTHREAD_MUTEX_INITIALIZER;
+static unit_t         *units   = NULL;
+static unsigned        n_units = 0;
+
+static __thread void   **thread_shards   = NULL;
+static __thread unsigned n_thread_shards = 0;
+
+static size_t get_counter_size(unsigned kind)
+{
+	return kind == FIRMPROF_EDGES ? sizeof(unsigned long long)
+	                              : sizeof(unsigned);
+}
+
+static void add_shards(void)
+{
+	unsigned i, c;
+
+	pthread_mutex_lock(&lock);
+	for (i = 0; i < n_units; ++i) {
+		unit_t  *unit = &units[i];
+		shard_t *shard;
+		for (shard = unit->shards; shard != NULL; shard = shard->next) {
+			if (unit->kind == FIRMPROF_EDGES) {
+				unsigned long long *into = (unsigned long long*) unit->counters;
+				unsigned long long *from = (unsigned long long*) shard->counters;
+				for (c = 0; c < unit->len; ++c)
+					into[c] += from[c];
+			} else {
+				unsigned *into = (unsigned*) unit->counters;
+				unsigned *from = (unsigned*) shard->counters;
+				for (c = 0; c < unit->len; ++c)
+					into[c] += from[c];
+			}
+			memset(shard->counters, 0, unit->len * get_counter_size(unit->kind));
+		}
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+static void lock_units(void)
+{
+	pthread_mutex_lock(&lock);
+}
+
+static void unlock_units(void)
+{
+	pthread_mutex_unlock(&lock);
+}
+
+/**
+ * A forked child starts counting from zero, the counts collected so far are
+ * written by the parent.
+ */
+static void reset_shards(void)
+{
+	unsigned i;
+
+	for (i = 0; i < n_units; ++i) {
+		unit_t  *unit = &units[i];
+		shard_t *shard;
+		for (shard = unit->shards; shard != NULL; shard = shard->next)
+			memset(shard->counters, 0, unit->len * get_counter_size(unit->kind));
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+/**
+ * Register the counters of a translation unit instrumented for threads, see
+ * __init_firmprof2(). The runtime stores the number of the unit in
+ * @p unit, which the unit passes to __firmprof_shard().
+ */
+void __init_firmprof_threads(const char *filename, unsigned kind,
+                             void *counts, unsigned len, const char **names,
+                             const unsigned *checksums,
+                             const unsigned *lengths, unsigned n_functions,
+                             unsigned *unit)
+{
+	static int initialized = 0;
+	unit_t    *new_units;
+
+	/* the shards must be added before the profiles are written, which were
+	 * registered with atexit() earlier */
+	__init_firmprof2(filename, kind, counts, len, names, checksums, lengths,
+	                 n_functions);
+
+	pthread_mutex_lock(&lock);
+	if (!initialized) {
+		initialized = 1;
+		atexit(add_shards);
+		pthread_atfork(lock_units, unlock_units, reset_shards);
+	}
+
+	new_units = (unit_t*) realloc(units, (n_units + 1) * sizeof(*units));
+	if (new_units != NULL) {
+		units = new_units;
+		units[n_units].counters = counts;
+		units[n_units].kind     = kind;
+		units[n_units].len      = len;
+		units[n_units].shards   = NULL;
+		*unit = ++n_units;
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+static void *new_shard(unsigned index, void *counters)
+{
+	unit_t  *unit;
+	shard_t *shard;
+	void   **shards;
+
+	pthread_mutex_lock(&lock);
+	unit = &units[index];
+	if (index >= n_thread_shards) {
+		shards = (void**) realloc(thread_shards, n_units * sizeof(*shards));
+		if (shards == NULL)
+			goto error;
+		memset(&shards[n_thread_shards], 0,
+		       (n_units - n_thread_shards) * sizeof(*shards));
+		thread_shards   = shards;
+		n_thread_shards = n_units;
+	}
+
+	shard = (shard_t*) malloc(sizeof(*shard));
+	if (shard == NULL)
+		goto error;
+	shard->counters = calloc(unit->len + 1, get_counter_size(unit->kind));
+	if (shard->counters == NULL) {
+		free(shard);
+		goto error;
+	}
+	shard->next  = unit->shards;
+	unit->shards = shard;
+	pthread_mutex_unlock(&lock);
+
+	thread_shards[index] = shard->counters;
+	return shard->counters;
+
+error:
+	/* count without synchronization rather than not at all */
+	pthread_mutex_unlock(&lock);
+	return counters;
+}
+
+/**
+ * Returns the counters of the calling thread for the unit numbered
+ * @p unit, or @p counters if the unit is not registered yet.
+ */
+void *__firmprof_shard(unsigned *unit, void *counters)
+{
+	unsigned index = *unit;
+
+	if (index == 0)
+		return counters;
+	--index;
+	if (index < n_thread_shards && thread_shards[index] != NULL)
+		return thread_shards[index];
+	return new_shard(index, counters);
+}
@@ -0,0 +1,199 @@
+#! /usr/bin/env python
+#
+# This file is part of libFirm.
+# Copyright (C) 2012 Karlsruhe Institute of Technology.
+#
+# Summarizes statev output (.ev text or .evb binary files) without a
+# database: a table with count, sum, min, max and mean per event key (e.g.
+# the bemain_time_* timers of each pass) and a table with the sum of each
+# event key per value of a context key (e.g. per function with bemain_irg).
+import sys
+import re
+import struct
+import optparse
+
+
+def read_uleb(data, pos):
+    result = 0
+    shift = 0
+    while True:
+        byte = ord(data[pos:pos+1])
+        pos += 1
+        result |= (byte & 0x7F) << shift
+        shift += 7
+        if byte < 0x80:
+            return (result, pos)
+
+
+def read_binary(data):
+    """Yields (op, key, value) for the records of a binary file"""
+    if data[:8] != b"firmstev" or ord(data[8:9]) != 1:
+        raise ValueError("not a statev binary file of version 1")
+    keys = dict()
+    pos = 9
+    end = len(data)
+    while pos < end:
+        tag = data[pos:pos+1]
+        (key, pos) = read_uleb(data, pos + 1)
+        if tag == b'K':
+            (length, pos) = read_uleb(data, pos)
+            keys[key] = data[pos:pos+length].decode('utf-8', 'replace')
+            pos += length
+        elif tag == b'P':
+            (length, pos) = read_uleb(data, pos)
+            value = data[pos:pos+length].decode('utf-8', 'replace')
+            pos += length
+            yield ('P', keys[key], value)
+        elif tag == b'O':
+            yield ('O', keys[key], None)
+        elif tag == b'E':
+            yield ('E', keys[key], 0.0)
+        elif tag == b'I':
+            (value, pos) = read_uleb(data, pos)
+            yield ('E', keys[key], (value >> 1) ^ -(value & 1))
+        elif tag == b'U':
+            (value, pos) = read_uleb(data, pos)
+            yield ('E', keys[key], value)
+        elif tag == b'D':
+            yield ('E', keys[key], struct.unpack('<d', data[pos:pos+8])[0])
+            pos += 8
+        else:
+            raise ValueError("invalid record at offset %d" % (pos - 1))
+
+
+def read_text(f):
+    """Yields (op, key, value) for the lines of a text file"""
+    for line in f:
+        items = line.rstrip('\n').split(';')
+        op = items[0]
+        if op == 'P':
+            for p in range(1, len(items), 2):
+                yield ('P', items[p], items[p+1])
+        elif op == 'O':
+            for p in range(len(items)-1, 0, -1):
+                yield ('O', items[p], None)
+        elif op == 'E':
+            for p in range(1, len(items), 2):
+                yield ('E', items[p], float(items[p+1]))
+
+
+def read_events(filename):
+    with open(filename, 'rb') as f:
+        data = f.read()
+    if data[:8] == b"firmstev":
+        return read_binary(data)
+    return read_text(data.decode('utf-8', 'replace').splitlines(True))
+
+
+class Summary:
+    def __init__(self, group, keyfilter):
+        self.group = group
+        self.filter = keyfilter
+        self.keys = dict()       # key -> [count, sum, min, max]
+        self.groups = dict()     # group value -> {key -> sum}
+        self.group_order = []
+        self.key_order = []
+
+    def add_file(self, filename):
+        stack = []
+        for (op, key, value) in read_events(filename):
+            if op == 'P':
+                stack.append((key, value))
+            elif op == 'O':
+                while stack:
+                    (pushed, dummy) = stack.pop()
+                    if pushed == key:
+                        break
+            elif self.filter is None or self.filter.search(key):
+                self.add_event(stack, key, value)
+
+    def add_event(self, stack, key, value):
+        stats = self.keys.get(key)
+        if stats is None:
+            self.key_order.append(key)
+            self.keys[key] = [1, value, value, value]
+        else:
+            stats[0] += 1
+            stats[1] += value
+            stats[2] = min(stats[2], value)
+            stats[3] = max(stats[3], value)
+
+        for (ctxkey, ctxvalue) in reversed(stack):
+            if ctxkey != self.group:
+                continue
+            sums = self.groups.get(ctxvalue)
+            if sums is None:
+                sums = self.groups[ctxvalue] = dict()
+                self.group_order.append(ctxvalue)
+            sums[key] = sums.get(key, 0) + value
+            break
+
+
+def format_number(value):
+    if isinstance(value, float) and value != int(value):
+        return "%.3f" % value
+    return "%d" % value
+
+
+def print_table(out, header, rows, csv):
+    if csv:
+        for row in [header] + rows:
+            out.write(",".join(row) + "\n")
+        return
+    widths = [len(h) for h in header]
+    for row in rows:
+        widths = [max(w, len(c)) for (w, c) in zip(widths, row)]
+    for row in [header] + rows:
+        cells = [row[0].ljust(widths[0])]
+        cells += [c.rjust(w) for (w, c) in zip(widths[1:], row[1:])]
+        out.write("  ".join(cells).rstrip() + "\n")
+
+
+def main():
+    parser = optparse.OptionParser('usage: %prog [options] <file...>')
+    parser.add_option("-f", "--filter", dest="filter", metavar="REGEXP",
+                      help="only summarize event keys matching REGEXP")
+    parser.add_option("-g", "--group", dest="group", default="bemain_irg",
+                      metavar="KEY", help="context key of the second table"
+                      " [default: %default]")
+    parser.add_option("-c", "--csv", dest="csv", action="store_true",
+                      help="write comma separated values")
+    (options, args) = parser.parse_args()
+    if len(args) < 1:
+        parser.print_help()
+        sys.exit(1)
+
+    keyfilter = re.compile(options.filter) if options.filter else None
+    summary = Summary(options.group, keyfilter)
+    for filename in args:
+        try:
+            summary.add_file(filename)
+        except (IOError, ValueError) as e:
+            sys.stderr.write("%s: %s\n" % (filename, e))
+            sys.exit(1)
+
+    out = sys.stdout
+    rows = []
+    for key in summary.key_order:
+        (count, total, minimum, maximum) = summary.keys[key]
+        rows.append([key, "%d" % count, format_number(total),
+                     format_number(minimum), format_number(maximum),
+                     format_number(float(total) / count)])
+    print_table(out, ["key", "count", "sum", "min", "max", "mean"], rows,
+                options.csv)
+
+    if not summary.group_order:
+        return
+    out.write("\n")
+    columns = [key for key in summary.key_order
+               if any(key in summary.groups[g] for g in summary.group_order)]
+    rows = []
+    for group in summary.group_order:
+        sums = summary.groups[group]
+        rows.append([group] + [format_number(sums[key]) if key in sums else ""
+                               for key in columns])
+    print_table(out, [options.group] + columns, rows, options.csv)
+
+
+if __name__ == "__main__":
+    main()
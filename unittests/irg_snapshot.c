@@ -0,0 +1,128 @@
+#include "firm.h"
+#include "array.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct node_info {
+	unsigned opcode;
+	unsigned idx;
+	long     node_nr;
+} node_info;
+
+static void collect_node(ir_node *node, void *env)
+{
+	node_info **infos = (node_info**)env;
+	node_info   info  = {
+		get_irn_opcode(node), get_irn_idx(node), get_irn_node_nr(node)
+	};
+	ARR_APP1(node_info, *infos, info);
+}
+
+static void set_link_to_self(ir_node *node, void *env)
+{
+	(void)env;
+	set_irn_link(node, node);
+}
+
+static void check_no_link(ir_node *node, void *env)
+{
+	(void)env;
+	assert(get_irn_link(node) == NULL);
+}
+
+static int cmp_node_info(const void *a, const void *b)
+{
+	unsigned idx_a = ((node_info const*)a)->idx;
+	unsigned idx_b = ((node_info const*)b)->idx;
+	return idx_a < idx_b ? -1 : idx_a > idx_b;
+}
+
+/* Restoring may normalize the operands of commutative nodes for CSE, so
+ * compare the reachable nodes by index and not their order in a walk. */
+static node_info *get_node_infos(ir_graph *irg)
+{
+	node_info *infos = NEW_ARR_F(node_info, 0);
+	irg_walk_graph(irg, NULL, collect_node, &infos);
+	qsort(infos, ARR_LEN(infos), sizeof(*infos), cmp_node_info);
+	return infos;
+}
+
+static bool same_nodes(node_info const *a, node_info const *b)
+{
+	if (ARR_LEN(a) != ARR_LEN(b))
+		return false;
+	for (size_t i = 0; i < ARR_LEN(a); ++i) {
+		if (a[i].opcode != b[i].opcode || a[i].idx != b[i].idx
+		    || a[i].node_nr != b[i].node_nr)
+			return false;
+	}
+	return true;
+}
+
+static void optimize(ir_graph *irg)
+{
+	optimize_cf(irg);
+	combo(irg);
+	optimize_load_store(irg);
+	place_code(irg);
+	optimize_cf(irg);
+	assert(irg_verify(irg));
+}
+
+int main(void)
+{
+	ir_init();
+
+	ir_random_shape_t shape;
+	ir_random_shape_init(&shape);
+	for (unsigned seed = 0; seed < 10; ++seed) {
+		char name[32];
+		snprintf(name, sizeof(name), "f%u", seed);
+		ir_graph *irg = new_random_ir_graph(name, &shape, seed);
+
+		/* roll back a transformation */
+		node_info         *before   = get_node_infos(irg);
+		ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
+		irg_walk_graph(irg, set_link_to_self, NULL, NULL);
+		ir_graph_snapshot *original = new_irg_snapshot(irg);
+		ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
+		optimize(irg);
+		node_info         *after    = get_node_infos(irg);
+		assert(!same_nodes(before, after));
+		ir_graph_snapshot *optimized = new_irg_snapshot(irg);
+		/* out edges are rebuilt for the restored nodes */
+		if (seed % 2 == 1)
+			edges_activate(irg);
+		restore_irg_snapshot(original);
+		assert(irg_verify(irg));
+		assert(edges_activated(irg) == (seed % 2 == 1));
+		assert(!edges_activated(irg) || edges_verify(irg));
+		/* the restored nodes do not link to the discarded ones */
+		ir_reserve_resources(irg, IR_RESOURCE_IRN_LINK);
+		irg_walk_graph(irg, check_no_link, NULL, NULL);
+		ir_free_resources(irg, IR_RESOURCE_IRN_LINK);
+		node_info *restored = get_node_infos(irg);
+		assert(same_nodes(before, restored));
+
+		/* keep the result of the transformation */
+		restore_irg_snapshot(optimized);
+		assert(irg_verify(irg));
+		node_info *kept = get_node_infos(irg);
+		assert(same_nodes(after, kept));
+
+		/* the restored graph can be transformed further */
+		ir_graph_snapshot *discarded = new_irg_snapshot(irg);
+		dead_node_elimination(irg);
+		optimize(irg);
+		free_irg_snapshot(discarded);
+
+		DEL_ARR_F(kept);
+		DEL_ARR_F(restored);
+		DEL_ARR_F(after);
+		DEL_ARR_F(before);
+	}
+
+	ir_finish();
+	return 0;
+}
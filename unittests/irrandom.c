@@ -0,0 +1,71 @@
+#include "firm.h"
+#include "array.h"
+#include "util.h"
+#include <assert.h>
+#include <stdio.h>
+
+static void collect_opcode(ir_node *node, void *env)
+{
+	unsigned **opcodes = (unsigned**)env;
+	ARR_APP1(unsigned, *opcodes, get_irn_opcode(node));
+}
+
+static unsigned *get_opcodes(ir_graph *irg)
+{
+	unsigned *opcodes = NEW_ARR_F(unsigned, 0);
+	irg_walk_graph(irg, NULL, collect_opcode, &opcodes);
+	return opcodes;
+}
+
+static void count_block(ir_node *block, void *env)
+{
+	(void)block;
+	++*(unsigned*)env;
+}
+
+int main(void)
+{
+	ir_init();
+
+	ir_random_shape_t shapes[4];
+	ir_random_shape_init(&shapes[0]);
+	shapes[1] = shapes[0];
+	shapes[1].n_blocks    = 0;
+	shapes[2] = shapes[0];
+	shapes[2].n_blocks    = 300;
+	shapes[2].loop_depth  = 8;
+	shapes[2].phi_fan_in  = 2;
+	shapes[3] = shapes[0];
+	shapes[3].n_ops       = 30;
+	shapes[3].mem_percent = 100;
+	shapes[3].phi_fan_in  = 16;
+	shapes[3].n_values    = 1;
+
+	for (size_t s = 0; s < ARRAY_SIZE(shapes); ++s) {
+		for (unsigned seed = 0; seed < 20; ++seed) {
+			char name[32];
+			snprintf(name, sizeof(name), "a%zu_%u", s, seed);
+			ir_graph *irg = new_random_ir_graph(name, &shapes[s], seed);
+			assert(irg_verify(irg));
+
+			/* the start and end block are not part of the shape */
+			unsigned n_blocks = 0;
+			irg_block_walk_graph(irg, count_block, NULL, &n_blocks);
+			assert(n_blocks == shapes[s].n_blocks + 2);
+
+			/* the same seed and shape result in the same graph */
+			snprintf(name, sizeof(name), "b%zu_%u", s, seed);
+			ir_graph *copy = new_random_ir_graph(name, &shapes[s], seed);
+			unsigned *opcodes      = get_opcodes(irg);
+			unsigned *copy_opcodes = get_opcodes(copy);
+			assert(ARR_LEN(opcodes) == ARR_LEN(copy_opcodes));
+			for (size_t i = 0; i < ARR_LEN(opcodes); ++i)
+				assert(opcodes[i] == copy_opcodes[i]);
+			DEL_ARR_F(copy_opcodes);
+			DEL_ARR_F(opcodes);
+		}
+	}
+
+	ir_finish();
+	return 0;
+}
@@ -0,0 +1,182 @@
+#include "lfset.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#define N_VALUES 10000
+/** Number of threads inserting at the same time. */
+#define N_THREADS 8
+/** Maximal number of keys inserted by each thread, neighbouring threads
+ * share half of their keys. */
+#define N_THREAD_KEYS 20000
+#define N_SHARED_KEYS ((N_THREADS + 1) * N_THREAD_KEYS / 2)
+/** Races are rare, so the threads run several times. */
+#define N_ROUNDS 4
+
+static int values[N_VALUES];
+static int freed;
+
+static int cmp_int(void const *element, void const *key)
+{
+	return *(int const*)element != *(int const*)key;
+}
+
+static void count_free(void *element)
+{
+	(void)element;
+	++freed;
+}
+
+static void test_insert_find(unsigned (*hash)(int), int n)
+{
+	lfset_t set;
+	lfset_init(&set, cmp_int);
+
+	for (int i = 0; i < n; ++i) {
+		values[i] = i;
+		assert(lfset_find(&set, &values[i], hash(i)) == NULL);
+		void *res = lfset_insert(&set, &values[i], hash(i));
+		assert(res == &values[i]);
+		(void)res;
+	}
+
+	for (int i = 0; i < n; ++i) {
+		/* an equal key finds the element in the set */
+		int key = i;
+		void *res = lfset_find(&set, &key, hash(i));
+		assert(res == &values[i]);
+		res = lfset_insert(&set, &key, hash(i));
+		assert(res == &values[i]);
+		(void)res;
+	}
+	int key = n;
+	assert(lfset_find(&set, &key, hash(n)) == NULL);
+	(void)key;
+
+	freed = 0;
+	lfset_destroy(&set, count_free);
+	assert(freed == n);
+}
+
+static unsigned hash_good(int i)
+{
+	return (unsigned)i * 2654435761u;
+}
+
+/* many collisions, forces long lists at the bottom of the trie */
+static unsigned hash_bad(int i)
+{
+	return (unsigned)i % 7;
+}
+
+typedef struct thread_env_t {
+	lfset_t   *set;
+	unsigned (*hash)(int);
+	int        first;                    /**< first key of the thread */
+	int        n_keys;                   /**< number of keys of the thread */
+	int        offset;                   /**< index of the first insertion */
+	int        values[N_THREAD_KEYS];    /**< elements of the thread */
+	void      *results[N_THREAD_KEYS];   /**< interned element of each key */
+} thread_env_t;
+
+static thread_env_t    thread_envs[N_THREADS];
+static pthread_mutex_t start_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  start_cond = PTHREAD_COND_INITIALIZER;
+static int             n_started;
+
+/** Waits until all threads are ready, so they really run at once. */
+static void wait_for_start(void)
+{
+	pthread_mutex_lock(&start_lock);
+	if (++n_started == N_THREADS) {
+		pthread_cond_broadcast(&start_cond);
+	} else {
+		while (n_started < N_THREADS)
+			pthread_cond_wait(&start_cond, &start_lock);
+	}
+	pthread_mutex_unlock(&start_lock);
+}
+
+static void *insert_keys(void *data)
+{
+	thread_env_t *const env    = (thread_env_t*)data;
+	int           const n_keys = env->n_keys;
+	wait_for_start();
+	for (int n = 0; n < n_keys; ++n) {
+		int   const i   = (env->offset + n) % n_keys;
+		int   const key = env->first + i;
+		env->values[i] = key;
+		void *const res = lfset_insert(env->set, &env->values[i], env->hash(key));
+		assert(*(int*)res == key);
+		assert(lfset_find(env->set, &key, env->hash(key)) == res);
+		env->results[i] = res;
+	}
+	return NULL;
+}
+
+/* several threads insert overlapping keys without locking */
+static void test_concurrent_insert(unsigned (*hash)(int), int n_keys)
+{
+	assert(n_keys <= N_THREAD_KEYS);
+	assert(n_keys % 2 == 0);
+	int const n_shared = (N_THREADS + 1) * (n_keys / 2);
+	lfset_t set;
+	lfset_init(&set, cmp_int);
+
+	/* Odd threads start in the middle of their keys, so every shared key is
+	 * inserted by two threads at the same time. */
+	n_started = 0;
+	pthread_t threads[N_THREADS];
+	for (int t = 0; t < N_THREADS; ++t) {
+		thread_env_t *const env = &thread_envs[t];
+		env->set    = &set;
+		env->hash   = hash;
+		env->first  = t * (n_keys / 2);
+		env->n_keys = n_keys;
+		env->offset = t % 2 != 0 ? n_keys / 2 : 0;
+		int const res = pthread_create(&threads[t], NULL, insert_keys, env);
+		assert(res == 0);
+		(void)res;
+	}
+	for (int t = 0; t < N_THREADS; ++t) {
+		int const res = pthread_join(threads[t], NULL);
+		assert(res == 0);
+		(void)res;
+	}
+
+	/* every key is interned exactly once */
+	static void *interned[N_SHARED_KEYS];
+	for (int key = 0; key < n_shared; ++key)
+		interned[key] = NULL;
+	for (int t = 0; t < N_THREADS; ++t) {
+		thread_env_t const *const env = &thread_envs[t];
+		for (int i = 0; i < n_keys; ++i) {
+			int const key = env->first + i;
+			if (interned[key] == NULL)
+				interned[key] = env->results[i];
+			assert(env->results[i] == interned[key]);
+		}
+	}
+	for (int key = 0; key < n_shared; ++key) {
+		void *const res = lfset_find(&set, &key, hash(key));
+		assert(res == interned[key]);
+		assert(*(int*)res == key);
+		(void)res;
+	}
+
+	freed = 0;
+	lfset_destroy(&set, count_free);
+	assert(freed == n_shared);
+}
+
+int main(void)
+{
+	test_insert_find(hash_good, N_VALUES);
+	test_insert_find(hash_bad, N_VALUES / 10);
+	for (int round = 0; round < N_ROUNDS; ++round) {
+		test_concurrent_insert(hash_good, N_THREAD_KEYS);
+		test_concurrent_insert(hash_bad, N_THREAD_KEYS / 10);
+	}
+	return 0;
+}
@@ -0,0 +1,217 @@
+#include "lpp.h"
+#include "lpp_bnb.h"
+#include "mps.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+
+#define N_VARS 10
+#define N_CSTS 6
+
+typedef struct problem_t {
+	lpp_opt_t opt_type;
+	lpp_cst_t type[N_CSTS];
+	int       rhs[N_CSTS];
+	int       factor[N_CSTS][N_VARS];
+	int       obj[N_VARS];
+} problem_t;
+
+static unsigned seed = 1;
+
+static int random_int(int min, int max)
+{
+	seed = seed * 1103515245u + 12345u;
+	return min + (int)((seed >> 16) % (unsigned)(max - min + 1));
+}
+
+static void random_problem(problem_t *p)
+{
+	p->opt_type = random_int(0, 1) ? lpp_minimize : lpp_maximize;
+	for (int v = 0; v < N_VARS; ++v)
+		p->obj[v] = random_int(-5, 5);
+	for (int c = 0; c < N_CSTS; ++c) {
+		int const kind = random_int(0, 7);
+		if (kind == 0) {
+			p->type[c] = lpp_equal;
+			p->rhs[c]  = random_int(-1, 2);
+		} else if (kind < 6) {
+			p->type[c] = lpp_less_equal;
+			p->rhs[c]  = random_int(0, 6);
+		} else {
+			p->type[c] = lpp_greater_equal;
+			p->rhs[c]  = random_int(-4, 2);
+		}
+		for (int v = 0; v < N_VARS; ++v)
+			p->factor[c][v] = random_int(0, 2) ? random_int(-3, 3) : 0;
+	}
+}
+
+static lpp_t *build_lpp(problem_t const *p)
+{
+	lpp_t *lpp = lpp_new("test", p->opt_type);
+	int    vars[N_VARS];
+	for (int v = 0; v < N_VARS; ++v) {
+		char name[16];
+		snprintf(name, sizeof(name), "x%d", v);
+		vars[v] = lpp_add_var(lpp, name, lpp_binary, p->obj[v]);
+	}
+	for (int c = 0; c < N_CSTS; ++c) {
+		int const cst = lpp_add_cst(lpp, NULL, p->type[c], p->rhs[c]);
+		for (int v = 0; v < N_VARS; ++v) {
+			if (p->factor[c][v] != 0)
+				lpp_set_factor_fast(lpp, cst, vars[v], p->factor[c][v]);
+		}
+	}
+	return lpp;
+}
+
+static bool is_feasible(problem_t const *p, unsigned assignment, int *obj)
+{
+	for (int c = 0; c < N_CSTS; ++c) {
+		int sum = 0;
+		for (int v = 0; v < N_VARS; ++v) {
+			if (assignment & (1u << v))
+				sum += p->factor[c][v];
+		}
+		if ((p->type[c] == lpp_equal && sum != p->rhs[c])
+		 || (p->type[c] == lpp_less_equal && sum > p->rhs[c])
+		 || (p->type[c] == lpp_greater_equal && sum < p->rhs[c]))
+			return false;
+	}
+	*obj = 0;
+	for (int v = 0; v < N_VARS; ++v) {
+		if (assignment & (1u << v))
+			*obj += p->obj[v];
+	}
+	return true;
+}
+
+/** Computes the optimal objective by enumeration, returns false if infeasible. */
+static bool brute_force(problem_t const *p, int *best)
+{
+	bool found = false;
+	for (unsigned a = 0; a < 1u << N_VARS; ++a) {
+		int obj;
+		if (!is_feasible(p, a, &obj))
+			continue;
+		if (!found || (p->opt_type == lpp_minimize ? obj < *best : obj > *best))
+			*best = obj;
+		found = true;
+	}
+	return found;
+}
+
+static void check_solution(problem_t const *p, lpp_t *lpp)
+{
+	int  best;
+	bool feasible = brute_force(p, &best);
+	if (!feasible) {
+		assert(lpp_get_sol_state(lpp) == lpp_infeasible);
+		return;
+	}
+	assert(lpp_get_sol_state(lpp) == lpp_optimal);
+	assert(lpp->objval == best);
+
+	/* the returned values must form an optimal solution */
+	unsigned assignment = 0;
+	for (int v = 0; v < N_VARS; ++v) {
+		double const x = lpp_get_var_sol(lpp, 1 + v);
+		assert(x == 0.0 || x == 1.0);
+		if (x == 1.0)
+			assignment |= 1u << v;
+	}
+	int obj;
+	assert(is_feasible(p, assignment, &obj));
+	assert(obj == best);
+	(void)obj;
+}
+
+static void test_random(void)
+{
+	for (int i = 0; i < 300; ++i) {
+		problem_t p;
+		random_problem(&p);
+		lpp_t *lpp = build_lpp(&p);
+		lpp_solve_bnb(lpp);
+		check_solution(&p, lpp);
+		lpp_free(lpp);
+	}
+}
+
+/* the solver must reach the same result after a roundtrip through MPS */
+static void test_mps(void)
+{
+	for (int i = 0; i < 50; ++i) {
+		problem_t p;
+		random_problem(&p);
+		lpp_t *lpp = build_lpp(&p);
+
+		FILE *f = tmpfile();
+		assert(f != NULL);
+		mps_write_mps(lpp, i % 2 ? s_mps_free : s_mps_fixed, f);
+		lpp_free(lpp);
+		rewind(f);
+		lpp = mps_read_mps(f);
+		fclose(f);
+		assert(lpp != NULL);
+
+		lpp_solve_bnb(lpp);
+		check_solution(&p, lpp);
+		lpp_free(lpp);
+	}
+}
+
+/* an optimal start solution must be kept */
+static void test_start_values(void)
+{
+	for (int i = 0; i < 50; ++i) {
+		problem_t p;
+		int       best;
+		random_problem(&p);
+		if (!brute_force(&p, &best))
+			continue;
+
+		lpp_t *lpp = build_lpp(&p);
+		for (unsigned a = 0; a < 1u << N_VARS; ++a) {
+			int obj;
+			if (is_feasible(&p, a, &obj) && obj == best) {
+				for (int v = 0; v < N_VARS; ++v)
+					lpp_set_start_value(lpp, 1 + v, (a >> v) & 1);
+				break;
+			}
+		}
+		lpp_solve_bnb(lpp);
+		check_solution(&p, lpp);
+		lpp_free(lpp);
+	}
+}
+
+/* max x + y  s.t.  x + 2y <= 4,  3x + y <= 6  has its optimum at (1.6, 1.2) */
+static void test_continuous(void)
+{
+	lpp_t *lpp = lpp_new("lp", lpp_maximize);
+	int const x  = lpp_add_var(lpp, "x", lpp_continous, 1.0);
+	int const y  = lpp_add_var(lpp, "y", lpp_continous, 1.0);
+	int const c0 = lpp_add_cst(lpp, "c0", lpp_less_equal, 4.0);
+	int const c1 = lpp_add_cst(lpp, "c1", lpp_less_equal, 6.0);
+	lpp_set_factor_fast(lpp, c0, x, 1.0);
+	lpp_set_factor_fast(lpp, c0, y, 2.0);
+	lpp_set_factor_fast(lpp, c1, x, 3.0);
+	lpp_set_factor_fast(lpp, c1, y, 1.0);
+	lpp_solve_bnb(lpp);
+	assert(lpp_get_sol_state(lpp) == lpp_optimal);
+	assert(fabs(lpp->objval - 2.8) < 1e-6);
+	assert(fabs(lpp_get_var_sol(lpp, x) - 1.6) < 1e-6);
+	assert(fabs(lpp_get_var_sol(lpp, y) - 1.2) < 1e-6);
+	lpp_free(lpp);
+}
+
+int main(void)
+{
+	test_random();
+	test_mps();
+	test_start_values();
+	test_continuous();
+	return 0;
+}
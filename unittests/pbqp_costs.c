@@ -0,0 +1,132 @@
+#include "costs.h"
+#include "vector.h"
+
+#include <assert.h>
+#include <stdbool.h>
+
+#define MAX_LEN    40
+#define MAX_STRIDE 3
+
+static unsigned seed = 1;
+
+static unsigned random_int(unsigned max)
+{
+	seed = seed * 1103515245u + 12345u;
+	return (seed >> 16) % (max + 1);
+}
+
+/* random costs with many zeros and infinities, but no finite overflow */
+static num random_cost(void)
+{
+	switch (random_int(5)) {
+	case 0:  return 0;
+	case 1:  return INF_COSTS;
+	case 2:  return INF_COSTS / 4;
+	default: return random_int(1000);
+	}
+}
+
+static void fill(num *costs, unsigned len)
+{
+	for (unsigned i = 0; i < len; ++i)
+		costs[i] = random_cost();
+}
+
+static num ref_min(num const *vals, size_t stride, num const *flags,
+                   size_t flags_stride, unsigned len, unsigned *index)
+{
+	num min = INF_COSTS;
+	*index = 0;
+	for (unsigned i = 0; i < len; ++i) {
+		if (flags != NULL && flags[i * flags_stride] == INF_COSTS)
+			continue;
+		if (vals[i * stride] < min) {
+			min    = vals[i * stride];
+			*index = i;
+		}
+	}
+	return min;
+}
+
+static void test_add(unsigned len, size_t dst_stride, size_t src_stride)
+{
+	num dst[MAX_LEN * MAX_STRIDE];
+	num src[MAX_LEN * MAX_STRIDE];
+	num ref[MAX_LEN * MAX_STRIDE];
+	fill(dst, len * dst_stride);
+	fill(src, len * src_stride);
+	for (unsigned i = 0; i < len * dst_stride; ++i)
+		ref[i] = dst[i];
+	for (unsigned i = 0; i < len; ++i)
+		ref[i * dst_stride] = pbqp_add(ref[i * dst_stride], src[i * src_stride]);
+
+	costs_add(dst, dst_stride, src, src_stride, len);
+	for (unsigned i = 0; i < len * dst_stride; ++i)
+		assert(dst[i] == ref[i]);
+
+	num const value = random_cost();
+	for (unsigned i = 0; i < len; ++i)
+		ref[i * dst_stride] = pbqp_add(ref[i * dst_stride], value);
+	costs_add_value(dst, dst_stride, value, len);
+	for (unsigned i = 0; i < len * dst_stride; ++i)
+		assert(dst[i] == ref[i]);
+}
+
+static void test_min(unsigned len, size_t stride, size_t flags_stride)
+{
+	num vals[MAX_LEN * MAX_STRIDE];
+	num flags[MAX_LEN * MAX_STRIDE];
+	fill(vals, len * stride);
+	fill(flags, len * flags_stride);
+
+	for (int with_flags = 0; with_flags < 2; ++with_flags) {
+		num const *f = with_flags ? flags : NULL;
+		unsigned   index;
+		num const  min = ref_min(vals, stride, f, flags_stride, len, &index);
+		assert(costs_min(vals, stride, f, flags_stride, len) == min);
+		assert(costs_min_index(vals, stride, f, flags_stride, len) == index);
+		(void)min;
+	}
+
+	num other[MAX_LEN * MAX_STRIDE];
+	fill(other, len * flags_stride);
+	num min = INF_COSTS;
+	for (unsigned i = 0; i < len; ++i) {
+		num const sum = pbqp_add(vals[i * stride], other[i * flags_stride]);
+		if (sum < min)
+			min = sum;
+	}
+	assert(costs_min_sum(vals, stride, other, flags_stride, len) == min);
+}
+
+static void test_col_mins(unsigned rows, unsigned cols)
+{
+	num mat[MAX_LEN * MAX_LEN];
+	num flags[MAX_LEN];
+	num mins[MAX_LEN];
+	fill(mat, rows * cols);
+	fill(flags, rows);
+
+	costs_col_mins(mins, mat, rows, cols, flags, 1);
+	for (unsigned col = 0; col < cols; ++col) {
+		unsigned index;
+		assert(mins[col] == ref_min(mat + col, cols, flags, 1, rows, &index));
+	}
+}
+
+int main(void)
+{
+	for (unsigned len = 1; len <= MAX_LEN; ++len) {
+		for (size_t s0 = 1; s0 <= MAX_STRIDE; ++s0) {
+			for (size_t s1 = 1; s1 <= MAX_STRIDE; ++s1) {
+				for (int i = 0; i < 20; ++i) {
+					test_add(len, s0, s1);
+					test_min(len, s0, s1);
+				}
+			}
+		}
+		for (unsigned cols = 1; cols <= MAX_LEN; ++cols)
+			test_col_mins(len, cols);
+	}
+	return 0;
+}
@@ -591,6 +591,7 @@ int main(void)
 		new_int_mode("uint24", 24, false, 0),
 		new_int_mode("uint32", 32, false, 0),
 		new_int_mode("uint64", 64, false, 0),
+		new_int_mode("uint128", 128, false, 0),
 		new_int_mode("uint6",  6,  false, 0),
 		new_int_mode("uint13", 13, false, 0),
 
@@ -599,6 +600,7 @@ int main(void)
 		new_int_mode("int24", 24, true, 0),
 		new_int_mode("int32", 32, true, 0),
 		new_int_mode("int64", 64, true, 0),
+		new_int_mode("int128", 128, true, 0),
 		new_int_mode("int6",  6,  true, 0),
 		new_int_mode("int13", 13, true, 0),
 